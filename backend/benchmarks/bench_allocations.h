@@ -0,0 +1,67 @@
+#pragma once
+
+#include "bench_framework.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Every heap allocation in the benchmark binary goes through here, so a
+// benchmark can report allocation counts and bytes next to its timing. The
+// replacement operators are defined here, which works because all
+// benchmarks are compiled as the single bench_main.cpp translation unit.
+static std::atomic<size_t> bench_heap_allocations{0};
+static std::atomic<size_t> bench_heap_bytes{0};
+
+// GCC flags free() in the replacement deletes once they are inlined next to
+// a new-expression; the pairing is correct since every new here is malloc'd.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(std::size_t size) {
+    bench_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    bench_heap_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// std::pmr::new_delete_resource allocates through the aligned forms
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    bench_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    bench_heap_bytes.fetch_add(size, std::memory_order_relaxed);
+    size_t align = std::max(static_cast<size_t>(alignment), sizeof(void*));
+    if (void* p = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+#pragma GCC diagnostic pop
+
+// Runs `fn` `operations` times through measure() and prints the heap
+// allocations it made per call.
+void measureAllocations(const std::string& name, size_t operations, const std::function<void(size_t)>& fn) {
+    size_t before = bench_heap_allocations.load(std::memory_order_relaxed);
+    BenchmarkFramework::getInstance().measure(name, operations, fn);
+    size_t allocations = bench_heap_allocations.load(std::memory_order_relaxed) - before;
+    std::cout << std::left << std::setw(48) << ("  " + name)
+              << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+              << static_cast<double>(allocations) / operations << " allocs/op\n";
+}
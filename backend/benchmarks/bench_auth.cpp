@@ -0,0 +1,220 @@
+#include "bench_framework.h"
+#include "../include/auth_service.h"
+#include "../include/todo_service.h"
+#include "../include/bloom_filter.h"
+#include "../include/token_codec.h"
+#include "bench_allocations.h"
+#include <sstream>
+#include <filesystem>
+
+// The auth stage every todo request starts with: a few tokens validated
+// over and over, as from a set of logged-in clients. Uncached, each call
+// checks the signature and reads the user from storage; cached, it is one
+// lookup in the session cache.
+void benchValidateToken(const std::string& label, size_t session_cache_capacity) {
+    const int user_count = 32;
+    const size_t operations = 20000;
+    
+    DatabaseOptions options;
+    options.path = "bench_auth.db";
+    cleanupBenchStorage(options.path);
+    {
+        auto db = std::make_shared<Database>(options);
+        if (!db->initialize()) {
+            std::cerr << "Failed to initialize " << label << std::endl;
+            return;
+        }
+        AuthOptions auth_options;
+        auth_options.session_cache_capacity = session_cache_capacity;
+        AuthService auth(db, auth_options);
+        std::vector<std::string> tokens;
+        for (int i = 0; i < user_count; ++i) {
+            auto user = auth.registerUser("bench" + std::to_string(i), "bench" + std::to_string(i) + "@example.com",
+                                          "password");
+            tokens.push_back(auth.generateToken({user->id, user->username, user->email}));
+        }
+        
+        size_t threads = std::max(2u, std::thread::hardware_concurrency());
+        BenchmarkFramework::getInstance().measureParallel(label, threads, operations, [&](size_t t, size_t i) {
+            auth.validateToken(tokens[(t * 7 + i) % tokens.size()]);
+        });
+        AuthStats stats = auth.stats();
+        uint64_t lookups = stats.sessions.hits + stats.sessions.misses;
+        std::cout << "  hit rate " << std::fixed << std::setprecision(3)
+                  << (lookups > 0 ? static_cast<double>(stats.sessions.hits) / lookups : 0.0)
+                  << "  p50 " << std::setprecision(2) << stats.p50_ns / 1000.0 << " us  p99 "
+                  << stats.p99_ns / 1000.0 << " us\n";
+    }
+    cleanupBenchStorage(options.path);
+}
+
+BENCHMARK(validate_token) {
+    benchValidateToken("validate_token uncached", 0);
+    benchValidateToken("validate_token session cache", 65536);
+}
+
+// Todo reads while other clients hammer the login endpoint. The reads never
+// hash anything; what they feel is how many threads are burning CPU on
+// hashes at once. With a pool as wide as the flood (what hashing on every
+// request thread amounts to), each read competes with all of them; with a
+// narrow pool, at most that many hash at a time and the rest are refused.
+void benchReadsDuringLoginFlood(const std::string& label, size_t flood_threads, size_t hash_threads) {
+    const size_t readers = 4;
+    const size_t reads = 1500;
+    
+    DatabaseOptions options;
+    options.path = "bench_login_flood.db";
+    cleanupBenchStorage(options.path);
+    {
+        auto db = std::make_shared<Database>(options);
+        if (!db->initialize()) {
+            std::cerr << "Failed to initialize " << label << std::endl;
+            return;
+        }
+        TodoService service(db);
+        for (int i = 0; i < 100; ++i) {
+            service.createTodo("Todo read during a login flood " + std::to_string(i), 1);
+        }
+        AuthOptions auth_options;
+        auth_options.hash_threads = hash_threads;
+        auth_options.hash_max_queued = hash_threads;
+        AuthService auth(db, auth_options);
+        auth.registerUser("flood", "flood@example.com", "password");
+        
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> flood;
+        for (size_t i = 0; i < flood_threads; ++i) {
+            flood.emplace_back([&] {
+                while (!stop.load()) {
+                    bool busy = false;
+                    auth.loginUser("flood", "password", &busy);
+                    if (busy) {
+                        // A refused client backs off before trying again
+                        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                    }
+                }
+            });
+        }
+        
+        std::vector<std::vector<double>> latencies(readers);
+        BenchmarkFramework::getInstance().measureParallel(label, readers, reads, [&](size_t t, size_t) {
+            auto start = std::chrono::steady_clock::now();
+            CompactTodoList todos(1);
+            service.getAllTodos(1, todos);
+            latencies[t].push_back(
+                std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        });
+        stop = true;
+        for (auto& thread : flood) {
+            thread.join();
+        }
+        
+        std::vector<double> all;
+        for (auto& thread_latencies : latencies) {
+            all.insert(all.end(), thread_latencies.begin(), thread_latencies.end());
+        }
+        printLatencies("  reads", all);
+        AuthStats stats = auth.stats();
+        std::cout << "  logins hashed " << stats.hashing.completed << ", refused " << stats.hashing.rejected << "\n";
+    }
+    cleanupBenchStorage(options.path);
+}
+
+BENCHMARK(todo_reads_during_login_flood) {
+    benchReadsDuringLoginFlood("todo reads, no logins", 0, 2);
+    benchReadsDuringLoginFlood("todo reads, 16 logins at once, 16 hashers", 16, 16);
+    benchReadsDuringLoginFlood("todo reads, 16 logins at once, 2 hashers", 16, 2);
+}
+
+// Memory and false-positive rate of the user filter at one million users
+// (two keys each: username and email), both full to its sizing and with the
+// headroom the database gives it after a rebuild.
+void benchUserFilterSizing(const std::string& label, size_t users, size_t capacity_keys) {
+    BloomFilter filter(capacity_keys);
+    for (size_t i = 0; i < users; ++i) {
+        filter.insert("u:user" + std::to_string(i));
+        filter.insert("e:user" + std::to_string(i) + "@example.com");
+    }
+    const size_t probes = 1000000;
+    size_t false_positives = 0;
+    BenchmarkFramework::getInstance().measure(label, probes, [&](size_t i) {
+        false_positives += filter.mightContain("u:absent" + std::to_string(i));
+    });
+    std::cout << "  " << std::fixed << std::setprecision(2)
+              << filter.memoryBytes() / 1048576.0 / (users / 1000000.0) << " MiB per million users, "
+              << std::setprecision(3) << 100.0 * false_positives / probes << "% false positives\n";
+}
+
+// Logins for usernames that do not exist, as in credential stuffing
+void benchUnknownUserLogins(const std::string& label, bool user_filter) {
+    DatabaseOptions options;
+    options.path = "bench_user_filter.db";
+    options.user_filter = user_filter;
+    cleanupBenchStorage(options.path);
+    {
+        auto db = std::make_shared<Database>(options);
+        if (!db->initialize()) {
+            std::cerr << "Failed to initialize " << label << std::endl;
+            return;
+        }
+        for (int i = 0; i < 1000; ++i) {
+            db->createUser("member" + std::to_string(i), "member" + std::to_string(i) + "@example.com", "hash");
+        }
+        AuthService auth(db);
+        BenchmarkFramework::getInstance().measure(label, 20000, [&](size_t i) {
+            auth.loginUser("stuffed" + std::to_string(i), "password");
+        });
+    }
+    cleanupBenchStorage(options.path);
+}
+
+BENCHMARK(user_filter) {
+    benchUserFilterSizing("user filter lookup, 1M users, full", 1000000, 2000000);
+    benchUserFilterSizing("user filter lookup, 1M users, 2x headroom", 1000000, 4000000);
+    benchUnknownUserLogins("unknown-user login, no filter", false);
+    benchUnknownUserLogins("unknown-user login, user filter", true);
+}
+
+// The token format this codec replaced: "user_id:username:timestamp:hash",
+// split with getline and checked against std::hash, timed the same way for
+// comparison
+bool legacyTokenValid(const std::string& token) {
+    std::vector<std::string> parts;
+    std::stringstream ss(token);
+    std::string item;
+    while (std::getline(ss, item, ':')) {
+        parts.push_back(item);
+    }
+    if (parts.size() != 4) {
+        return false;
+    }
+    std::stoi(parts[0]);
+    std::stol(parts[2]);
+    std::string expected = std::to_string(std::hash<std::string>()(parts[0] + ":" + parts[1] + ":" + parts[2] + "secret_key"));
+    return parts[3] == expected;
+}
+
+BENCHMARK(token_codec) {
+    TokenCodec codec("bench secret");
+    const size_t operations = 200000;
+    char buffer[TokenCodec::kEncodedLength];
+    size_t valid = 0;
+    
+    measureAllocations("token encode", operations, [&](size_t i) {
+        codec.encode({static_cast<int>(i), 1750000000}, buffer);
+    });
+    std::string token = codec.encode({12345, 1750000000});
+    measureAllocations("token verify", operations, [&](size_t) {
+        TokenClaims claims;
+        valid += codec.decode(token, claims);
+    });
+    
+    std::string legacy = "12345:someone:1750000000:" +
+                         std::to_string(std::hash<std::string>()("12345:someone:1750000000secret_key"));
+    measureAllocations("legacy token verify", operations, [&](size_t) {
+        valid += legacyTokenValid(legacy);
+    });
+    if (valid != 2 * operations) {
+        std::cerr << "token_codec: tokens failed to verify" << std::endl;
+    }
+}
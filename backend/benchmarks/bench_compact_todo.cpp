@@ -0,0 +1,74 @@
+#include "bench_framework.h"
+#include "bench_allocations.h"
+#include "../include/compact_todo.h"
+#include "../include/json_utils.h"
+
+// A todo as the API layer sees it: timestamps in the canonical form, a due
+// date on every third one, texts of typical length.
+Todo makeBenchTodo(int i) {
+    char timestamp[CompactTodoList::kTimestampBufferSize];
+    std::string created(CompactTodoList::formatTimestamp(1735689600000000LL + i * 1000003LL, timestamp));
+    return Todo{i + 1, 1, "Follow up on ticket " + std::to_string(i) + " with the team", i % 5 == 0,
+                created, created, i % 3 == 0 ? "2025-09-01" : ""};
+}
+
+BENCHMARK(compact_todo_memory_1m) {
+    const int count = 1000000;
+    auto& bench = BenchmarkFramework::getInstance();
+    
+    std::vector<Todo> todos;
+    todos.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        todos.push_back(makeBenchTodo(i));
+    }
+    // Counted from capacities rather than the allocator, which also saw the
+    // temporaries of makeBenchTodo
+    size_t vector_bytes = todos.capacity() * sizeof(Todo);
+    for (const Todo& todo : todos) {
+        for (const std::string* field : {&todo.text, &todo.created_at, &todo.updated_at, &todo.due_date}) {
+            if (field->capacity() > std::string().capacity()) {
+                vector_bytes += field->capacity() + 1;
+            }
+        }
+    }
+    
+    CompactTodoList compact(1);
+    size_t pool_bytes = 0;
+    for (const Todo& todo : todos) {
+        pool_bytes += todo.text.size() + todo.due_date.size();
+    }
+    size_t before = bench_heap_bytes.load(std::memory_order_relaxed);
+    compact.reserve(count, pool_bytes);
+    for (const Todo& todo : todos) {
+        compact.append(todo);
+    }
+    size_t compact_bytes = bench_heap_bytes.load(std::memory_order_relaxed) - before;
+    
+    std::cout << std::left << std::setw(48) << "std::vector<Todo>, 1M todos"
+              << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+              << vector_bytes / 1048576.0 << " MiB" << std::setw(12) << vector_bytes / count << " B/todo\n";
+    std::cout << std::left << std::setw(48) << "CompactTodoList, 1M todos"
+              << std::right << std::setw(12) << std::fixed << std::setprecision(1)
+              << compact_bytes / 1048576.0 << " MiB" << std::setw(12) << compact_bytes / count << " B/todo\n";
+    
+    size_t completed = 0;
+    bench.measure("scan completed flag, std::vector<Todo> (1M)", 20, [&](size_t) {
+        for (const Todo& todo : todos) completed += todo.completed;
+    });
+    bench.measure("scan completed flag, CompactTodoList (1M)", 20, [&](size_t) {
+        for (const CompactTodo& todo : compact) completed += todo.completed();
+    });
+    
+    bench.measure("serialize 1M, todosToJson(std::vector<Todo>)", 3, [&](size_t) {
+        completed += todosToJson(todos).size();
+    });
+    bench.measure("serialize 1M, appendTodosJson(CompactTodoList)", 3, [&](size_t) {
+        std::pmr::string json;
+        json.reserve(count * 160 + compact.poolSize());
+        appendTodosJson(json, compact);
+        completed += json.size();
+    });
+    if (completed == 0) {
+        std::cout << "(nothing completed)\n";
+    }
+}
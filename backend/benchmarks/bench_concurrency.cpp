@@ -0,0 +1,59 @@
+#include "bench_framework.h"
+#include "../include/database.h"
+#include "../include/todo_service.h"
+#include "../include/compact_todo.h"
+#include <filesystem>
+
+// Mixed traffic over many users: nine list reads for every update. With
+// per-user striping, throughput should grow with the thread count up to the
+// number of cores.
+void benchConcurrentService(const std::string& label, DatabaseOptions options) {
+    const int user_count = 64;
+    const int todos_per_user = 100;
+    const size_t operations = 2000;
+    
+    cleanupBenchStorage(options.path);
+    {
+        auto db = std::make_shared<Database>(options);
+        if (!db->initialize()) {
+            std::cerr << "Failed to initialize " << label << std::endl;
+            return;
+        }
+        TodoService service(db);
+        std::vector<std::vector<int>> ids(user_count + 1);
+        for (int user_id = 1; user_id <= user_count; ++user_id) {
+            for (int i = 0; i < todos_per_user; ++i) {
+                ids[user_id].push_back(service.createTodo("Concurrent todo " + std::to_string(i), user_id).id);
+            }
+        }
+        
+        size_t max_threads = std::max<size_t>(8, std::thread::hardware_concurrency());
+        for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+            BenchmarkFramework::getInstance().measureParallel(
+                label + " " + std::to_string(threads) + " thread(s)", threads, operations, [&](size_t t, size_t i) {
+                    int user_id = static_cast<int>((t * 7 + i) % user_count) + 1;
+                    if (i % 10 == 0) {
+                        int id = ids[user_id][i % todos_per_user];
+                        service.updateTodo(id, "Concurrent todo", i % 20 == 0, user_id);
+                    } else {
+                        CompactTodoList todos(user_id);
+                        service.getAllTodos(user_id, todos);
+                    }
+                });
+        }
+        db->flush();
+    }
+    cleanupBenchStorage(options.path);
+}
+
+BENCHMARK(concurrent_service_throughput) {
+    DatabaseOptions sqlite;
+    sqlite.path = "bench_concurrency_sqlite.db";
+    sqlite.readers_per_shard = static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+    benchConcurrentService("sqlite", sqlite);
+    
+    DatabaseOptions log;
+    log.path = "bench_concurrency_log.db";
+    log.engine = StorageEngine::Log;
+    benchConcurrentService("log", log);
+}
@@ -0,0 +1,308 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <chrono>
+#include <thread>
+
+struct BenchmarkOptions {
+    // Run only the benchmarks whose name contains one of these; all when empty
+    std::vector<std::string> filters;
+    // Timed samples taken by measureSamples(), after its warmup
+    size_t samples = 10;
+    double warmup_seconds = 0.1;
+    // Each sample makes as many calls as fit in about this long
+    double sample_seconds = 0.02;
+    // Every result is written here as JSON, one per line; nothing when empty
+    std::string json_path;
+    // A file written through json_path by an earlier run, e.g. on another
+    // commit; each result is printed with its change against it
+    std::string baseline_path;
+};
+
+class BenchmarkFramework {
+public:
+    struct BenchmarkResult {
+        // The BENCHMARK that recorded it
+        std::string benchmark;
+        std::string name;
+        size_t operations;
+        double seconds;
+        // Time per call of each of measureSamples()'s samples, in
+        // nanoseconds; empty for the single-run measurements
+        std::vector<double> sample_ns;
+    };
+    
+    struct SampleStats {
+        double median;
+        double mean;
+        double stddev;
+        double min;
+        double max;
+    };
+    
+    static BenchmarkFramework& getInstance() {
+        static BenchmarkFramework instance;
+        return instance;
+    }
+    
+    void addBenchmark(const std::string& name, std::function<void()> benchmark) {
+        benchmarks_.push_back({name, benchmark});
+    }
+    
+    // Times `operations` calls of `fn` and records the resulting throughput.
+    void measure(const std::string& name, size_t operations, const std::function<void(size_t)>& fn) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < operations; ++i) {
+            fn(i);
+        }
+        auto end = std::chrono::steady_clock::now();
+        record(name, operations, std::chrono::duration<double>(end - start).count());
+    }
+    
+    // Runs `operations` calls of `fn(thread, i)` on each of `threads` threads
+    // at once and records the combined throughput.
+    void measureParallel(const std::string& name, size_t threads, size_t operations,
+                         const std::function<void(size_t, size_t)>& fn) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&fn, t, operations]() {
+                for (size_t i = 0; i < operations; ++i) {
+                    fn(t, i);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        auto end = std::chrono::steady_clock::now();
+        record(name, threads * operations, std::chrono::duration<double>(end - start).count());
+    }
+    
+    // The repeatable form of measure(), for comparing runs: calls `fn`
+    // until the warmup time has passed, sizes samples from what that cost,
+    // then times the samples and reports the median time per call with its
+    // spread. `fn` gets one increasing index across warmup and samples.
+    void measureSamples(const std::string& name, const std::function<void(size_t)>& fn) {
+        size_t index = 0;
+        size_t warmup_calls = 0;
+        auto warmup_start = std::chrono::steady_clock::now();
+        double warmup_seconds = 0;
+        do {
+            fn(index++);
+            ++warmup_calls;
+            warmup_seconds = secondsSince(warmup_start);
+        } while (warmup_seconds < options_.warmup_seconds);
+        size_t batch = std::max<size_t>(1, static_cast<size_t>(options_.sample_seconds * warmup_calls / warmup_seconds));
+        
+        std::vector<double> sample_ns;
+        double total_seconds = 0;
+        for (size_t sample = 0; sample < std::max<size_t>(options_.samples, 1); ++sample) {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < batch; ++i) {
+                fn(index++);
+            }
+            double seconds = secondsSince(start);
+            total_seconds += seconds;
+            sample_ns.push_back(seconds * 1e9 / batch);
+        }
+        results_.push_back({current_, name, batch * sample_ns.size(), total_seconds, sample_ns});
+        
+        SampleStats stats = statsOf(sample_ns);
+        std::cout << std::left << std::setw(48) << name << std::right << std::setw(12) << formatNanos(stats.median)
+                  << "/op  +/-" << std::fixed << std::setprecision(1) << std::setw(5)
+                  << (stats.mean > 0 ? stats.stddev / stats.mean * 100 : 0) << "%  [" << formatNanos(stats.min)
+                  << " .. " << formatNanos(stats.max) << "]  " << sample_ns.size() << " x " << batch
+                  << baselineChange(name, stats.median) << "\n";
+    }
+    
+    void record(const std::string& name, size_t operations, double seconds) {
+        results_.push_back({current_, name, operations, seconds, {}});
+        std::cout << std::left << std::setw(48) << name
+                  << std::right << std::setw(12) << std::fixed << std::setprecision(0)
+                  << (seconds > 0 ? operations / seconds : 0) << " ops/s"
+                  << std::setw(12) << std::setprecision(3) << (seconds * 1e6 / operations) << " us/op"
+                  << baselineChange(name, seconds * 1e9 / operations) << "\n";
+    }
+    
+    // Runs the benchmarks `options` selects; returns false when its files
+    // cannot be read or written
+    bool runAll(const BenchmarkOptions& options = BenchmarkOptions()) {
+        options_ = options;
+        if (!options_.baseline_path.empty() && !loadBaseline(options_.baseline_path)) {
+            return false;
+        }
+        std::cout << "\n=== Running Benchmarks ===\n\n";
+        for (const auto& benchmark : benchmarks_) {
+            if (!selected(benchmark.name)) {
+                continue;
+            }
+            std::cout << "[" << benchmark.name << "]\n";
+            current_ = benchmark.name;
+            benchmark.function();
+            std::cout << "\n";
+        }
+        return options_.json_path.empty() || writeJson(options_.json_path);
+    }
+    
+    static SampleStats statsOf(std::vector<double> values) {
+        SampleStats stats{0, 0, 0, 0, 0};
+        if (values.empty()) {
+            return stats;
+        }
+        std::sort(values.begin(), values.end());
+        size_t middle = values.size() / 2;
+        stats.median = values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+        stats.min = values.front();
+        stats.max = values.back();
+        for (double value : values) {
+            stats.mean += value;
+        }
+        stats.mean /= values.size();
+        for (double value : values) {
+            stats.stddev += (value - stats.mean) * (value - stats.mean);
+        }
+        stats.stddev = values.size() > 1 ? std::sqrt(stats.stddev / (values.size() - 1)) : 0;
+        return stats;
+    }
+    
+    const std::vector<BenchmarkResult>& getResults() const {
+        return results_;
+    }
+
+private:
+    struct Benchmark {
+        std::string name;
+        std::function<void()> function;
+    };
+    
+    std::vector<Benchmark> benchmarks_;
+    std::vector<BenchmarkResult> results_;
+    BenchmarkOptions options_;
+    std::string current_;
+    // Time per call of each result in the baseline run, by name
+    std::map<std::string, double> baseline_ns_;
+    
+    static double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    
+    static std::string formatNanos(double nanos) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(nanos < 10 ? 2 : 1);
+        if (nanos < 1e3) {
+            out << nanos << " ns";
+        } else if (nanos < 1e6) {
+            out << nanos / 1e3 << " us";
+        } else {
+            out << nanos / 1e6 << " ms";
+        }
+        return out.str();
+    }
+    
+    bool selected(const std::string& name) const {
+        if (options_.filters.empty()) {
+            return true;
+        }
+        return std::any_of(options_.filters.begin(), options_.filters.end(), [&](const std::string& filter) {
+            return name.find(filter) != std::string::npos;
+        });
+    }
+    
+    std::string baselineChange(const std::string& name, double nanos) const {
+        auto it = baseline_ns_.find(name);
+        if (it == baseline_ns_.end() || it->second <= 0) {
+            return "";
+        }
+        std::ostringstream out;
+        out << "  (" << std::showpos << std::fixed << std::setprecision(1) << (nanos / it->second - 1) * 100
+            << "% vs baseline)";
+        return out.str();
+    }
+    
+    static std::string quoted(const std::string& text) {
+        std::string out = "\"";
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+            }
+            out += c;
+        }
+        return out + "\"";
+    }
+    
+    bool writeJson(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) {
+            std::cerr << "Failed to write benchmark results to " << path << std::endl;
+            return false;
+        }
+        out << std::setprecision(6) << "{\"results\":[\n";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const BenchmarkResult& result = results_[i];
+            double ns_per_op = result.operations > 0 ? result.seconds * 1e9 / result.operations : 0;
+            if (!result.sample_ns.empty()) {
+                ns_per_op = statsOf(result.sample_ns).median;
+            }
+            out << "{\"benchmark\":" << quoted(result.benchmark) << ",\"name\":" << quoted(result.name)
+                << ",\"ns_per_op\":" << ns_per_op << ",\"operations\":" << result.operations
+                << ",\"seconds\":" << result.seconds;
+            if (!result.sample_ns.empty()) {
+                SampleStats stats = statsOf(result.sample_ns);
+                out << ",\"samples\":" << result.sample_ns.size() << ",\"mean_ns\":" << stats.mean
+                    << ",\"stddev_ns\":" << stats.stddev << ",\"min_ns\":" << stats.min << ",\"max_ns\":" << stats.max;
+            }
+            out << "}" << (i + 1 < results_.size() ? "," : "") << "\n";
+        }
+        out << "]}\n";
+        std::cout << "Wrote " << results_.size() << " results to " << path << "\n";
+        return true;
+    }
+    
+    // Reads the name and ns_per_op of each line writeJson wrote
+    bool loadBaseline(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "Failed to read baseline " << path << std::endl;
+            return false;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t name_at = line.find("\"name\":\"");
+            size_t value_at = line.find("\"ns_per_op\":");
+            if (name_at == std::string::npos || value_at == std::string::npos) {
+                continue;
+            }
+            std::string name;
+            for (size_t i = name_at + 8; i < line.size() && line[i] != '"'; ++i) {
+                if (line[i] == '\\' && i + 1 < line.size()) {
+                    ++i;
+                }
+                name += line[i];
+            }
+            baseline_ns_[name] = std::atof(line.c_str() + value_at + 12);
+        }
+        return true;
+    }
+};
+
+#define BENCHMARK(name) \
+    void bench_##name(); \
+    static bool registered_bench_##name = []() { \
+        BenchmarkFramework::getInstance().addBenchmark(#name, bench_##name); \
+        return true; \
+    }(); \
+    void bench_##name()
+
+#define RUN_ALL_BENCHMARKS() \
+    BenchmarkFramework::getInstance().runAll();
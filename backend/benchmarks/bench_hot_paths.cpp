@@ -0,0 +1,108 @@
+#include "bench_framework.h"
+#include "../include/database.h"
+#include "../include/json_utils.h"
+#include "../include/auth_service.h"
+#include "../include/password_hash.h"
+
+// Repeatable timings of the calls every request leans on, for comparing
+// commits: run with --json on each and --baseline for the second. Unlike
+// the throughput benchmarks above, each figure is the median of several
+// samples taken after a warmup.
+
+std::vector<Todo> hotPathTodos(size_t count) {
+    std::vector<Todo> todos;
+    for (size_t i = 0; i < count; ++i) {
+        todos.push_back({static_cast<int>(i + 1), 1, "Buy \"oat\" milk and eggs #" + std::to_string(i), i % 3 == 0,
+                         "2025-08-01 09:00:00", "2025-08-02 10:30:00", i % 2 == 0 ? "2025-08-10" : ""});
+    }
+    return todos;
+}
+
+BENCHMARK(database_hot_paths) {
+    auto& bench = BenchmarkFramework::getInstance();
+    DatabaseOptions options;
+    options.path = "bench_hot_paths.db";
+    cleanupBenchStorage(options.path);
+    {
+        Database db(options);
+        if (!db.initialize()) {
+            std::cerr << "Failed to initialize database_hot_paths" << std::endl;
+            return;
+        }
+        // One user per list size, so each read returns exactly that many rows
+        for (size_t size : {10, 100, 1000, 10000}) {
+            auto user = db.createUser("hot" + std::to_string(size), "hot" + std::to_string(size) + "@example.com",
+                                      "hash");
+            std::vector<Todo> todos = hotPathTodos(size);
+            db.importTodos(user->id, todos);
+            bench.measureSamples("getAllTodos, " + std::to_string(size) + " todos", [&](size_t) {
+                db.getAllTodos(user->id);
+            });
+        }
+        
+        auto writer = db.createUser("hotwriter", "hotwriter@example.com", "hash");
+        bench.measureSamples("createTodo", [&](size_t i) {
+            db.createTodo("Benchmark todo " + std::to_string(i), writer->id, i % 2 == 0 ? "2025-09-01" : "");
+        });
+    }
+    cleanupBenchStorage(options.path);
+}
+
+BENCHMARK(json_hot_paths) {
+    auto& bench = BenchmarkFramework::getInstance();
+    std::vector<Todo> todos = hotPathTodos(100);
+    bench.measureSamples("todoToJson", [&](size_t i) {
+        todoToJson(todos[i % todos.size()]);
+    });
+    bench.measureSamples("todosToJson, 100 todos", [&](size_t) {
+        todosToJson(todos);
+    });
+    
+    std::string plain(120, 'a');
+    std::string special = "Line one\nLine \"two\"\twith a \\ backslash and \x01 control; " + std::string(60, 'b');
+    bench.measureSamples("escapeJson, 120 plain chars", [&](size_t) {
+        escapeJson(plain);
+    });
+    bench.measureSamples("escapeJson, 120 chars with escapes", [&](size_t) {
+        escapeJson(special);
+    });
+    
+    std::string body = "{\"text\":\"Buy oat milk and eggs\",\"completed\":true,\"dueDate\":\"2025-08-10\"}";
+    bench.measureSamples("extractJsonField, first field", [&](size_t) {
+        extractJsonField(body, "text");
+    });
+    bench.measureSamples("extractJsonField, last field", [&](size_t) {
+        extractJsonField(body, "dueDate");
+    });
+}
+
+BENCHMARK(auth_hot_paths) {
+    auto& bench = BenchmarkFramework::getInstance();
+    DatabaseOptions options;
+    options.path = "bench_hot_auth.db";
+    cleanupBenchStorage(options.path);
+    {
+        auto db = std::make_shared<Database>(options);
+        if (!db->initialize()) {
+            std::cerr << "Failed to initialize auth_hot_paths" << std::endl;
+            return;
+        }
+        for (size_t capacity : {0, 65536}) {
+            AuthOptions auth_options;
+            auth_options.session_cache_capacity = capacity;
+            AuthService auth(db, auth_options);
+            std::string name = "hot" + std::to_string(capacity);
+            auto user = db->createUser(name, name + "@example.com", "hash");
+            std::string token = auth.generateToken({user->id, user->username, user->email});
+            bench.measureSamples(capacity == 0 ? "validateToken, uncached" : "validateToken, cached", [&](size_t) {
+                auth.validateToken(token);
+            });
+        }
+    }
+    cleanupBenchStorage(options.path);
+    
+    PasswordHashParams params;
+    bench.measureSamples("hashPassword, scrypt ln=" + std::to_string(params.log2_n), [&](size_t) {
+        hashPassword("correct horse battery staple", params);
+    });
+}
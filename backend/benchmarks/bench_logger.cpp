@@ -0,0 +1,40 @@
+#include "bench_framework.h"
+#include "../include/logger.h"
+#include <fstream>
+#include <mutex>
+
+// What an error record costs the thread that logs it during an error storm.
+// Buffered, it is a copy into the thread's ring; the baseline is the old
+// way, formatting under a shared lock and writing through at once (std::cerr
+// flushed with std::endl, here into /dev/null). Once the rate limit kicks
+// in, a repeated message is a few relaxed atomics.
+BENCHMARK(logger_error_storm) {
+    const size_t operations = 200000;
+    size_t threads = std::max(4u, std::thread::hardware_concurrency());
+    auto& bench = BenchmarkFramework::getInstance();
+    
+    LogOptions options;
+    options.path = "/dev/null";
+    options.rate_limit_per_second = 0;
+    options.thread_buffer_records = 4096;
+    options.flush_interval = std::chrono::milliseconds(5);
+    Logger::start(options);
+    bench.measureParallel("log error, buffered", threads, operations, [&](size_t t, size_t i) {
+        logError("Failed to read todos", {{"error", "database is locked"}, {"thread", t}, {"attempt", i}});
+    });
+    Logger::stop();
+    
+    options.rate_limit_per_second = 20;
+    Logger::start(options);
+    bench.measureParallel("log error, rate limited", threads, operations, [&](size_t t, size_t i) {
+        logError("Failed to read todos", {{"error", "database is locked"}, {"thread", t}, {"attempt", i}});
+    });
+    Logger::stop();
+    
+    std::ofstream sink("/dev/null");
+    std::mutex mutex;
+    bench.measureParallel("log error, synchronous stream", threads, operations, [&](size_t t, size_t i) {
+        std::lock_guard<std::mutex> lock(mutex);
+        sink << "Failed to read todos: database is locked (thread " << t << ", attempt " << i << ")" << std::endl;
+    });
+}
@@ -0,0 +1,53 @@
+#include "bench_framework.h"
+
+// Include all benchmark files
+#include "bench_storage.cpp"
+#include "bench_search.cpp"
+#include "bench_request_arena.cpp"
+#include "bench_compact_todo.cpp"
+#include "bench_concurrency.cpp"
+#include "bench_scheduler.cpp"
+#include "bench_auth.cpp"
+#include "bench_metrics.cpp"
+#include "bench_logger.cpp"
+#include "bench_hot_paths.cpp"
+
+namespace {
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--filter NAME]... [--samples N] [--json FILE] [--baseline FILE]\n"
+              << "  --filter NAME    run only benchmarks whose name contains NAME (repeatable)\n"
+              << "  --samples N      timed samples per repeatable measurement (default 10)\n"
+              << "  --json FILE      write every result to FILE\n"
+              << "  --baseline FILE  print each result's change against an earlier --json FILE\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--filter") {
+            options.filters.push_back(value);
+        } else if (arg == "--samples") {
+            options.samples = static_cast<size_t>(std::max(std::atoi(value.c_str()), 1));
+        } else if (arg == "--json") {
+            options.json_path = value;
+        } else if (arg == "--baseline") {
+            options.baseline_path = value;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    
+    std::cout << "=== Todo Backend Benchmarks ===\n";
+    
+    return BenchmarkFramework::getInstance().runAll(options) ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+#include "bench_framework.h"
+#include "../include/metrics.h"
+#include "../include/request_trace.h"
+#include <filesystem>
+#include <mutex>
+
+// What recording one request costs the request thread. The sharded counters
+// are a few relaxed adds on the thread's own cache lines; the baseline is
+// the obvious alternative, one histogram behind one mutex, which every
+// request thread contends on once they run on more than one core.
+BENCHMARK(metrics_record) {
+    const size_t operations = 1000000;
+    size_t threads = std::max(4u, std::thread::hardware_concurrency());
+    size_t route = HttpMetrics::routeOf("GET", "/api/todos");
+    
+    HttpMetrics metrics;
+    BenchmarkFramework::getInstance().measureParallel("record request, sharded atomics", threads, operations,
+                                                      [&](size_t t, size_t i) {
+        metrics.recordRequest(route, 200, 20000 + (t * 131 + i) % 4096 * 1000);
+    });
+    
+    std::mutex mutex;
+    std::array<uint64_t, LatencyBuckets::kCount> buckets{};
+    uint64_t requests = 0;
+    uint64_t sum_ns = 0;
+    BenchmarkFramework::getInstance().measureParallel("record request, one mutex", threads, operations,
+                                                      [&](size_t t, size_t i) {
+        uint64_t nanos = 20000 + (t * 131 + i) % 4096 * 1000;
+        std::lock_guard<std::mutex> lock(mutex);
+        ++requests;
+        ++buckets[LatencyBuckets::bucketOf(nanos)];
+        sum_ns += nanos;
+    });
+    
+    BenchmarkFramework::getInstance().measure("route lookup, PUT /api/todos/:id", operations, [&](size_t i) {
+        HttpMetrics::routeOf("PUT", i % 2 == 0 ? "/api/todos/42" : "/api/todos/1234");
+    });
+    
+    std::string text;
+    auto start = std::chrono::steady_clock::now();
+    metrics.appendPrometheus(text);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "  render: " << text.size() << " bytes in " << std::fixed << std::setprecision(1)
+              << seconds * 1e6 << " us\n";
+}
+
+// The cost of timing a request stage: a span is two clock reads into a
+// fixed array. steady_clock is what the spans would cost without the TSC.
+BENCHMARK(request_trace_spans) {
+    const size_t operations = 1000000;
+    BenchmarkFramework::getInstance().measure("span, TSC clock", operations, [&](size_t) {
+        RequestTrace trace;
+        TraceSpan span(trace, "db");
+    });
+    BenchmarkFramework::getInstance().measure("span, steady_clock", operations, [&](size_t) {
+        auto start = std::chrono::steady_clock::now();
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        (void)elapsed;
+    });
+    
+    RequestTrace trace;
+    for (const char* stage : {"read", "parse", "queue", "auth", "db", "serialize"}) {
+        TraceSpan span(trace, stage);
+    }
+    std::string header;
+    BenchmarkFramework::getInstance().measure("Server-Timing header, 6 stages", operations / 10, [&](size_t) {
+        header.clear();
+        trace.appendServerTiming(header);
+    });
+    
+    TraceOptions options;
+    options.sample_rate = 1;
+    options.path = "bench_traces.json";
+    {
+        TraceWriter writer(options);
+        BenchmarkFramework::getInstance().measure("write sampled trace, 6 stages", operations / 10, [&](size_t) {
+            writer.write(trace, "GET", "/api/todos", 200);
+        });
+        writer.flushThread();
+    }
+    std::filesystem::remove(options.path);
+}
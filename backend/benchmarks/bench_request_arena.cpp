@@ -0,0 +1,96 @@
+#include "bench_framework.h"
+#include "../include/database.h"
+#include "../include/json_utils.h"
+#include "../include/http_request.h"
+#include "../include/request_arena.h"
+#include "../include/compact_todo.h"
+#include "bench_allocations.h"
+#include <sstream>
+
+const char* kBenchListRequest =
+    "GET /api/todos HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: Mozilla/5.0\r\n"
+    "Accept: application/json\r\n"
+    "Authorization: Bearer 1:benchuser:1767225600:0123456789abcdef\r\n"
+    "\r\n";
+
+// The request path as processRequest handles GET /api/todos (minus the
+// token check): stream parsing, substr copies, a vector of Todos and
+// stringstream serialization.
+size_t serveListOnHeap(Database& db, int user_id) {
+    std::string request(kBenchListRequest);
+    std::istringstream iss(request);
+    std::string method, path, version;
+    iss >> method >> path >> version;
+    std::string query;
+    size_t query_start = path.find('?');
+    if (query_start != std::string::npos) {
+        query = path.substr(query_start + 1);
+        path = path.substr(0, query_start);
+    }
+    std::string headers = request.substr(0, request.find("\r\n\r\n"));
+    std::string body = request.substr(request.find("\r\n\r\n") + 4);
+    
+    std::string response_body = todosToJson(db.getAllTodos(user_id));
+    
+    std::ostringstream response;
+    response << "HTTP/1.1 200 OK\r\n";
+    response << "Content-Type: application/json\r\n";
+    response << "Content-Length: " << response_body.length() << "\r\n";
+    response << "\r\n";
+    response << response_body;
+    return response.str().size();
+}
+
+// The same request as handleRequest now serves it: parsed in place, rows and
+// response built in a RequestArena that is dropped at the end.
+size_t serveListInArena(Database& db, int user_id) {
+    RequestArena arena;
+    HttpRequest request;
+    parseHttpRequest(kBenchListRequest, request);
+    
+    CompactTodoList todos(user_id, arena.resource());
+    db.getAllTodos(user_id, todos);
+    std::pmr::string response_body(arena.resource());
+    response_body.reserve(todos.size() * 160 + todos.poolSize() + 2);
+    appendTodosJson(response_body, todos);
+    
+    std::pmr::string response(arena.resource());
+    response.reserve(320 + response_body.size());
+    response += "HTTP/1.1 200 OK\r\n";
+    response += "Content-Type: application/json\r\n";
+    response += "Content-Length: ";
+    response += std::to_string(response_body.length());
+    response += "\r\n\r\n";
+    response += response_body;
+    return response.size();
+}
+
+BENCHMARK(request_allocations) {
+    for (StorageEngine engine : {StorageEngine::SQLite, StorageEngine::Log}) {
+        DatabaseOptions options;
+        options.path = "bench_request_arena.db";
+        options.engine = engine;
+        cleanupBenchStorage(options.path);
+        {
+            Database db(options);
+            if (!db.initialize()) {
+                std::cerr << "Failed to initialize request benchmark database" << std::endl;
+                return;
+            }
+            for (int i = 0; i < 50; ++i) {
+                db.createTodo("Request benchmark todo number " + std::to_string(i), 1, i % 3 ? "" : "2025-09-01");
+            }
+            
+            std::string label = engine == StorageEngine::Log ? "log" : "sqlite";
+            measureAllocations(label + " GET /api/todos, 50 todos, heap", 2000, [&](size_t) {
+                serveListOnHeap(db, 1);
+            });
+            measureAllocations(label + " GET /api/todos, 50 todos, arena", 2000, [&](size_t) {
+                serveListInArena(db, 1);
+            });
+        }
+        cleanupBenchStorage(options.path);
+    }
+}
@@ -0,0 +1,68 @@
+#include "bench_framework.h"
+#include "../include/compact_todo.h"
+#include "../include/json_utils.h"
+#include "../include/task_scheduler.h"
+#include <algorithm>
+
+CompactTodoList benchTodoList(int count) {
+    CompactTodoList list(1);
+    for (int id = 1; id <= count; ++id) {
+        list.append(id, "Scheduler benchmark todo " + std::to_string(id), id % 3 == 0, "2025-08-01 09:30:15.123456",
+                    "2025-08-02 10:00:00.000001", id % 5 == 0 ? "2025-09-01" : "");
+    }
+    return list;
+}
+
+void printLatencies(const std::string& name, std::vector<double>& micros) {
+    std::sort(micros.begin(), micros.end());
+    auto at = [&micros](double quantile) { return micros[static_cast<size_t>(quantile * (micros.size() - 1))]; };
+    std::cout << std::left << std::setw(48) << name << std::right << std::fixed << std::setprecision(0)
+              << "p50 " << std::setw(8) << at(0.5) << " us  p99 " << std::setw(8) << at(0.99)
+              << " us  max " << std::setw(8) << micros.back() << " us\n";
+}
+
+// Many connections at once, one in eight asking for a big list. Inline, each
+// connection thread encodes its own response, so small requests queue behind
+// every big encoding the OS is time-slicing. With the scheduler, big lists are
+// encoded in chunks by a fixed set of workers and small requests only compete
+// with those.
+void benchMixedEncoding(const std::string& label, TaskScheduler* scheduler) {
+    const size_t connections = 16;
+    const size_t requests = 100;
+    CompactTodoList big = benchTodoList(5000);
+    CompactTodoList small = benchTodoList(20);
+    
+    std::vector<std::vector<double>> small_latencies(connections);
+    std::vector<std::vector<double>> big_latencies(connections);
+    BenchmarkFramework::getInstance().measureParallel(label, connections, requests, [&](size_t t, size_t i) {
+        bool is_big = (t + i) % 8 == 0;
+        auto start = std::chrono::steady_clock::now();
+        std::pmr::string json;
+        const CompactTodoList& list = is_big ? big : small;
+        if (scheduler) {
+            appendTodosJson(json, list, *scheduler);
+        } else {
+            appendTodosJson(json, list);
+        }
+        double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        (is_big ? big_latencies : small_latencies)[t].push_back(micros);
+    });
+    
+    std::vector<double> all_small, all_big;
+    for (size_t t = 0; t < connections; ++t) {
+        all_small.insert(all_small.end(), small_latencies[t].begin(), small_latencies[t].end());
+        all_big.insert(all_big.end(), big_latencies[t].begin(), big_latencies[t].end());
+    }
+    printLatencies("  small lists", all_small);
+    printLatencies("  5000-todo lists", all_big);
+}
+
+BENCHMARK(mixed_encoding_tail_latency) {
+    benchMixedEncoding("inline on connection threads", nullptr);
+    
+    TaskScheduler scheduler;
+    benchMixedEncoding("work-stealing scheduler (" + std::to_string(scheduler.workerCount()) + " workers)", &scheduler);
+    auto stats = scheduler.stats();
+    std::cout << "  " << stats.executed << " tasks, " << stats.stolen << " stolen, " << stats.overflowed
+              << " run inline on a full queue\n";
+}
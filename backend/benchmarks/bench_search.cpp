@@ -0,0 +1,73 @@
+#include "bench_framework.h"
+#include "../include/database.h"
+#include <random>
+
+// Bulk-loads `count` todos for one user straight through SQLite in a single
+// transaction; going through createTodo would spend minutes in fsync.
+void seedSearchBenchTodos(const std::string& path, int user_id, size_t count) {
+    static const char* words[] = {
+        "buy", "milk", "call", "email", "report", "review", "fix", "bug", "plan", "trip",
+        "book", "flight", "pay", "invoice", "clean", "garage", "walk", "dog", "water", "plants",
+        "schedule", "dentist", "renew", "passport", "update", "resume", "order", "groceries", "prepare", "slides",
+    };
+    const size_t word_count = sizeof(words) / sizeof(words[0]);
+    std::mt19937 rng(42);
+    
+    sqlite3* db = nullptr;
+    sqlite3_open(path.c_str(), &db);
+    sqlite3_exec(db, "BEGIN", nullptr, nullptr, nullptr);
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(db, "INSERT INTO todos (user_id, text, completed, created_at, updated_at) "
+                           "VALUES (?, ?, 0, '2025-01-01 00:00:00', '2025-01-01 00:00:00')", -1, &stmt, nullptr);
+    for (size_t i = 0; i < count; ++i) {
+        std::string text = words[rng() % word_count];
+        for (int w = 0; w < 4; ++w) {
+            text += " ";
+            text += words[rng() % word_count];
+        }
+        // A rare token, so some queries are highly selective
+        if (i % 1000 == 0) {
+            text += " quarterly";
+        }
+        sqlite3_bind_int(stmt, 1, user_id);
+        sqlite3_bind_text(stmt, 2, text.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr);
+    sqlite3_close(db);
+}
+
+BENCHMARK(search_100k_todos) {
+    const std::string path = "bench_search.db";
+    cleanupBenchStorage(path);
+    {
+        Database schema(path);
+        schema.initialize();
+    }
+    seedSearchBenchTodos(path, 1, 100000);
+    seedSearchBenchTodos(path, 2, 20000);
+    
+    Database db(path);
+    if (!db.initialize()) {
+        std::cerr << "Failed to initialize search benchmark database" << std::endl;
+        return;
+    }
+    
+    auto& bench = BenchmarkFramework::getInstance();
+    bench.measure("search rare word (~100 hits)", 200, [&](size_t) {
+        db.searchTodos(1, "quarterly", 20, 0);
+    });
+    bench.measure("search two common words", 50, [&](size_t) {
+        db.searchTodos(1, "buy milk", 20, 0);
+    });
+    bench.measure("search common prefix", 20, [&](size_t) {
+        db.searchTodos(1, "re", 20, 0);
+    });
+    bench.measure("search page 10 of rare word", 200, [&](size_t) {
+        db.searchTodos(1, "quarterly", 10, 90);
+    });
+    
+    cleanupBenchStorage(path);
+}
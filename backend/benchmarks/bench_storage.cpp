@@ -0,0 +1,54 @@
+#include "bench_framework.h"
+#include "../include/database.h"
+#include <filesystem>
+
+// Helper function to clean up benchmark database files
+void cleanupBenchStorage(const std::string& path) {
+    for (const auto& suffix : {"", "-journal", "-wal", "-shm", ".wal", ".snapshot", ".snapshot.tmp"}) {
+        std::filesystem::remove(path + suffix);
+    }
+}
+
+void benchStorageWrites(const std::string& label, DatabaseOptions options, size_t operations) {
+    cleanupBenchStorage(options.path);
+    {
+        Database db(options);
+        if (!db.initialize()) {
+            std::cerr << "Failed to initialize " << label << std::endl;
+            return;
+        }
+        
+        auto user = db.createUser("benchuser", "bench@example.com", "hash");
+        int user_id = user ? user->id : 1;
+        
+        BenchmarkFramework::getInstance().measure(label + " createTodo", operations, [&](size_t i) {
+            db.createTodo("Benchmark todo " + std::to_string(i), user_id);
+        });
+        
+        auto todos = db.getAllTodos(user_id);
+        BenchmarkFramework::getInstance().measure(label + " updateTodo", operations, [&](size_t i) {
+            const Todo& todo = todos[i % todos.size()];
+            db.updateTodo(todo.id, todo.text, i % 2 == 0, user_id);
+        });
+        db.flush();
+    }
+    cleanupBenchStorage(options.path);
+}
+
+BENCHMARK(storage_write_throughput) {
+    const size_t operations = 2000;
+    
+    DatabaseOptions sqlite;
+    sqlite.path = "bench_storage_sqlite.db";
+    benchStorageWrites("sqlite", sqlite, operations);
+    
+    DatabaseOptions log_per_write;
+    log_per_write.path = "bench_storage_log.db";
+    log_per_write.engine = StorageEngine::Log;
+    log_per_write.log_sync_batch = 1;
+    benchStorageWrites("log (fsync every record)", log_per_write, operations);
+    
+    DatabaseOptions log_batched = log_per_write;
+    log_batched.log_sync_batch = 64;
+    benchStorageWrites("log (fsync every 64 records)", log_batched, operations);
+}
@@ -3,27 +3,85 @@
 #include <string>
 #include <memory>
 #include <optional>
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include "database.h"
+#include "bounded_executor.h"
+#include "latency_histogram.h"
+#include "password_hash.h"
+#include "session_cache.h"
+#include "token_codec.h"
 
-struct UserAuth {
-    int user_id;
-    std::string username;
-    std::string email;
+struct AuthOptions {
+    // Key that signs session tokens; tokens stay valid across restarts and
+    // instances only while it stays the same. Empty means a random key.
+    std::string token_secret;
+    // Validated tokens kept in memory; 0 disables the session cache
+    size_t session_cache_capacity = 65536;
+    // Cost of new password hashes. A stored hash made with other parameters
+    // (or with the old non-KDF scheme) is replaced at the user's next
+    // successful login.
+    PasswordHashParams password_hash;
+    // Password hashing runs on its own threads, so a burst of logins queues
+    // there instead of taking the CPU from other requests; logins and
+    // registrations beyond `hash_max_queued` waiting ones are refused.
+    size_t hash_threads = 2;
+    size_t hash_max_queued = 32;
+};
+
+struct AuthStats {
+    SessionCacheStats sessions;
+    // validateToken calls, and their latency percentiles in nanoseconds
+    uint64_t validations;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    BoundedExecutorStats hashing;
+    // Stored password hashes upgraded to the current parameters at login
+    uint64_t rehashed;
+    UserFilterStats user_filter;
 };
 
 class AuthService {
 public:
     AuthService();
+    explicit AuthService(std::shared_ptr<Database> db, const AuthOptions& options = AuthOptions());
     ~AuthService();
     
-    std::optional<User> registerUser(const std::string& username, const std::string& email, const std::string& password);
-    std::optional<UserAuth> loginUser(const std::string& username, const std::string& password);
+    // Both wait for the password hashing pool. When its queue is full they
+    // fail at once and set `busy`, so the caller can ask the client to retry.
+    std::optional<User> registerUser(const std::string& username, const std::string& email, const std::string& password,
+                                     bool* busy = nullptr);
+    std::optional<UserAuth> loginUser(const std::string& username, const std::string& password, bool* busy = nullptr);
     std::optional<UserAuth> validateToken(const std::string& token);
+    // validateToken in two halves, for threads that must not wait for
+    // storage. checkToken answers from the session cache, or rejects a token
+    // whose signature or expiry fails, in memory; only when it sets
+    // `needs_lookup` does loadSession have to read the user to finish.
+    std::optional<UserAuth> checkToken(const std::string& token, bool& needs_lookup);
+    std::optional<UserAuth> loadSession(const std::string& token);
     std::string generateToken(const UserAuth& user);
     std::optional<User> getUserById(int user_id);
-    
+    // Forgets the user's validated tokens; every change to or deletion of a
+    // user must go through here so no request sees the old user
+    void invalidateUser(int user_id);
+    AuthStats stats() const;
+
 private:
-    std::unique_ptr<Database> db_;
+    std::shared_ptr<Database> db_;
+    AuthOptions options_;
+    TokenCodec tokens_;
+    SessionCache sessions_;
+    LatencyHistogram validate_latency_;
+    // Verified against when the username is unknown, so a miss takes as
+    // long as a wrong password. Made on first use.
+    std::once_flag dummy_hash_once_;
+    std::string dummy_hash_;
+    BoundedExecutor hashers_;
+    std::atomic<uint64_t> rehashed_{0};
+    void recordValidation(std::chrono::steady_clock::time_point start);
+    // Run on the hashing pool
     std::string hashPassword(const std::string& password);
     bool verifyPassword(const std::string& password, const std::string& hash);
+    void verifyDummy(const std::string& password);
 };
\ No newline at end of file
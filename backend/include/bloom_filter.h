@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+// Blocked Bloom filter: each key maps to one 64-byte block and sets
+// kHashes bits inside it, so a lookup touches a single cache line instead of
+// kHashes random ones, at the cost of a slightly higher false-positive rate
+// than a classic Bloom filter of the same size.
+//
+// Answers "definitely not present" or "maybe present". Keys cannot be
+// removed. Inserts and lookups may run concurrently (the bits are atomic
+// words); a lookup racing an insert of the same key may miss it.
+class BloomFilter {
+public:
+    // Sized for `expected_keys` at `bits_per_key`; 12 bits with 7 hashes
+    // gives about 0.5% false positives at the expected load
+    explicit BloomFilter(size_t expected_keys, size_t bits_per_key = 12);
+    
+    BloomFilter(const BloomFilter&) = delete;
+    BloomFilter& operator=(const BloomFilter&) = delete;
+    
+    void insert(std::string_view key);
+    bool mightContain(std::string_view key) const;
+    
+    // Keys inserted, including repeats
+    size_t size() const { return keys_.load(std::memory_order_relaxed); }
+    // Keys it was sized for; past this the false-positive rate climbs
+    size_t capacity() const { return capacity_; }
+    size_t memoryBytes() const { return blocks_ * kBlockBytes; }
+
+private:
+    static constexpr size_t kBlockBytes = 64;
+    static constexpr size_t kWordsPerBlock = kBlockBytes / sizeof(uint64_t);
+    static constexpr int kHashes = 7;
+    
+    size_t capacity_;
+    size_t blocks_;
+    std::unique_ptr<std::atomic<uint64_t>[]> words_;
+    std::atomic<size_t> keys_{0};
+    
+    // Block index and the kHashes bit positions (0-511) inside it
+    void locate(std::string_view key, size_t& block, uint16_t bits[kHashes]) const;
+};
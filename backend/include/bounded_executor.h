@@ -0,0 +1,77 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+struct BoundedExecutorOptions {
+    size_t threads = 3;
+    // Jobs waiting for a thread; submissions beyond this are refused
+    size_t max_queued = 1024;
+};
+
+struct BoundedExecutorStats {
+    size_t threads;
+    size_t queued;
+    size_t running;
+    size_t max_queued;
+    uint64_t completed;
+    // Submissions refused because the queue was full
+    uint64_t rejected;
+};
+
+// A fixed set of dedicated threads with a bounded FIFO queue, for work that
+// must not run on whichever thread happens to need it: requests that block
+// on storage (SQLite reads and commits, log fsyncs) and password hashing each
+// get their own, so a slow disk or a login storm makes requests queue there
+// instead of stalling everything else.
+//
+// Jobs run in submission order. submit() hands back a future the submitting
+// thread waits on for the result; when the queue is full it returns an
+// invalid future right away, so the caller can shed load instead of piling
+// more work onto a pool that is already behind.
+class BoundedExecutor {
+public:
+    explicit BoundedExecutor(const BoundedExecutorOptions& options = BoundedExecutorOptions());
+    // Finishes the queued jobs, then joins the threads
+    ~BoundedExecutor();
+    
+    BoundedExecutor(const BoundedExecutor&) = delete;
+    BoundedExecutor& operator=(const BoundedExecutor&) = delete;
+    
+    template <typename Fn>
+    std::future<std::invoke_result_t<Fn>> submit(Fn&& fn) {
+        using Result = std::invoke_result_t<Fn>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+        std::future<Result> future = task->get_future();
+        if (!enqueue([task] { (*task)(); })) {
+            return std::future<Result>();
+        }
+        return future;
+    }
+    
+    BoundedExecutorStats stats() const;
+
+private:
+    BoundedExecutorOptions options_;
+    std::vector<std::thread> threads_;
+    
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> jobs_;
+    size_t running_ = 0;
+    uint64_t completed_ = 0;
+    uint64_t rejected_ = 0;
+    bool stopping_ = false;
+    
+    bool enqueue(std::function<void()> job);
+    void run();
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct BufferPoolOptions {
+    // Buffer sizes handed out, ascending; a request gets the smallest that fits
+    std::vector<size_t> size_classes = {4 * 1024, 16 * 1024, 64 * 1024};
+    // Upper bound on buffer memory, in use and cached together
+    size_t max_bytes = 64 * 1024 * 1024;
+};
+
+struct BufferPoolStats {
+    struct SizeClass {
+        size_t size;
+        size_t in_use;
+        // Released buffers kept for reuse
+        size_t cached;
+    };
+    std::vector<SizeClass> classes;
+    size_t bytes_in_use;
+    size_t bytes_cached;
+    size_t max_bytes;
+    uint64_t acquired;
+    // Acquisitions refused because of max_bytes
+    uint64_t exhausted;
+};
+
+// Reusable I/O buffers in a few size classes, shared by all connections.
+//
+// A connection acquires a buffer only once it has bytes to read and hands it
+// back when it goes idle, so buffer memory follows the number of requests in
+// flight instead of the number of open connections. Released buffers are
+// cached per class; when the cap is reached, cached buffers of other classes
+// are freed to make room before an acquisition is refused.
+class BufferPool {
+public:
+    // Move-only handle; returns the buffer to its pool when destroyed.
+    class Buffer {
+    public:
+        Buffer() = default;
+        Buffer(Buffer&& other) noexcept;
+        Buffer& operator=(Buffer&& other) noexcept;
+        ~Buffer();
+        
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+        
+        char* data() const { return data_; }
+        size_t capacity() const { return capacity_; }
+        explicit operator bool() const { return data_ != nullptr; }
+        
+        void release();
+
+    private:
+        friend class BufferPool;
+        Buffer(BufferPool* pool, char* data, size_t capacity, size_t size_class)
+            : pool_(pool), data_(data), capacity_(capacity), size_class_(size_class) {}
+        
+        BufferPool* pool_ = nullptr;
+        char* data_ = nullptr;
+        size_t capacity_ = 0;
+        size_t size_class_ = 0;
+    };
+    
+    explicit BufferPool(const BufferPoolOptions& options = BufferPoolOptions());
+    ~BufferPool();
+    
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+    
+    // A buffer of at least `size` bytes, or an empty one when `size` exceeds
+    // the largest class or the memory cap is reached.
+    Buffer acquire(size_t size);
+    
+    size_t maxBufferSize() const { return classes_.back().size; }
+    BufferPoolStats stats();
+
+private:
+    struct SizeClass {
+        size_t size;
+        size_t in_use = 0;
+        std::vector<char*> cached;
+    };
+    
+    size_t max_bytes_;
+    std::mutex mutex_;
+    std::vector<SizeClass> classes_;
+    size_t bytes_in_use_ = 0;
+    size_t bytes_cached_ = 0;
+    uint64_t acquired_ = 0;
+    uint64_t exhausted_ = 0;
+    
+    void release(char* data, size_t size_class);
+    // Frees cached buffers until `needed` more bytes fit under the cap
+    bool makeRoomLocked(size_t needed);
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "database.h"
+
+// Fixed-size, 32-byte form of a Todo. The strings live in the owning
+// CompactTodoList's pool, back to back starting at pool_offset: the text,
+// the due date, then any timestamps that had to be kept verbatim.
+struct CompactTodo {
+    static constexpr uint32_t kCompleted = 1;
+    // The timestamp is not in the canonical "YYYY-MM-DD HH:MM:SS.ffffff"
+    // form, so the field holds the byte length of the pooled original.
+    static constexpr uint32_t kRawCreatedAt = 2;
+    static constexpr uint32_t kRawUpdatedAt = 4;
+    // Removed from a keyed list; the slot is reclaimed by compact()
+    static constexpr uint32_t kErased = 8;
+    
+    // Microseconds since the Unix epoch (UTC), unless flagged raw
+    int64_t created_at;
+    int64_t updated_at;
+    int32_t id;
+    uint32_t pool_offset;
+    uint32_t text_length : 28;
+    uint32_t flags : 4;
+    uint32_t due_date_length;
+    
+    bool completed() const { return flags & kCompleted; }
+    bool erased() const { return flags & kErased; }
+};
+
+static_assert(sizeof(CompactTodo) == 32, "CompactTodo should stay cache-line friendly");
+
+// One user's todos as a packed array of CompactTodo plus a single string
+// pool, both allocated from `resource` (a per-request arena for response
+// lists). Iterating touches two contiguous buffers instead of four heap
+// strings per todo.
+//
+// A list is either append-only in display order (query results), or keyed:
+// kept in ascending id order through put()/erase(), as LogStore holds its
+// working set. Keyed lookups are binary searches; erased slots and replaced
+// strings are garbage until compact(), which put() and erase() trigger once
+// they make up half of the list.
+class CompactTodoList {
+public:
+    // Enough for "YYYY-MM-DD HH:MM:SS.ffffff"
+    static constexpr size_t kTimestampBufferSize = 32;
+    
+    explicit CompactTodoList(int user_id = 0,
+                             std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    
+    int userId() const { return user_id_; }
+    // Slots, including erased ones in a keyed list
+    size_t slotCount() const { return entries_.size(); }
+    // Todos that are not erased
+    size_t size() const { return entries_.size() - erased_; }
+    bool empty() const { return size() == 0; }
+    const CompactTodo& operator[](size_t slot) const { return entries_[slot]; }
+    const CompactTodo* begin() const { return entries_.data(); }
+    const CompactTodo* end() const { return entries_.data() + entries_.size(); }
+    size_t poolSize() const { return pool_.size(); }
+    
+    void reserve(size_t todos, size_t pool_bytes);
+    void clear();
+    
+    // Append-only use
+    void append(int id, std::string_view text, bool completed, std::string_view created_at,
+                std::string_view updated_at, std::string_view due_date);
+    void append(const Todo& todo);
+    // Copies one todo of `other` (possibly another user's list) to the end
+    void append(const CompactTodoList& other, const CompactTodo& todo);
+    
+    // Keyed use (ascending ids)
+    const CompactTodo* find(int id) const;
+    // Inserts the todo, or replaces the one with the same id
+    void put(const Todo& todo);
+    bool erase(int id);
+    // Drops erased slots and rewrites the pool without dead strings
+    void compact();
+    
+    // Field access; views stay valid until the list is modified
+    std::string_view text(const CompactTodo& todo) const;
+    std::string_view dueDate(const CompactTodo& todo) const;
+    std::string_view createdAt(const CompactTodo& todo, char (&buffer)[kTimestampBufferSize]) const;
+    std::string_view updatedAt(const CompactTodo& todo, char (&buffer)[kTimestampBufferSize]) const;
+    
+    // Back to the API type
+    Todo toTodo(const CompactTodo& todo) const;
+    
+    // Bytes reserved by the entry array and the pool
+    size_t memoryUsage() const;
+    
+    // Canonical timestamp <-> microseconds. parseTimestamp fails for
+    // anything formatTimestamp would not reproduce byte for byte.
+    static bool parseTimestamp(std::string_view text, int64_t& micros);
+    static std::string_view formatTimestamp(int64_t micros, char (&buffer)[kTimestampBufferSize]);
+
+private:
+    int user_id_;
+    std::pmr::vector<CompactTodo> entries_;
+    std::pmr::string pool_;
+    size_t erased_;
+    // Pool bytes no live todo refers to
+    size_t garbage_;
+    
+    CompactTodo encode(int id, std::string_view text, bool completed, std::string_view created_at,
+                       std::string_view updated_at, std::string_view due_date);
+    size_t stringBytes(const CompactTodo& todo) const;
+    std::string_view timestamp(const CompactTodo& todo, bool created, char (&buffer)[kTimestampBufferSize]) const;
+    CompactTodo* findSlot(int id);
+};
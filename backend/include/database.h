@@ -3,6 +3,13 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <chrono>
+#include <string_view>
+#include <functional>
 #include <sqlite3.h>
 
 struct Todo {
@@ -15,6 +22,46 @@ struct Todo {
     std::string due_date;
 };
 
+// Narrows a todo listing. Empty bounds are open; both bounds are exclusive
+// and compare as ISO-8601 strings, so "2025-08-01T09:00" falls after
+// "2025-08-01". Todos without a due date never match a due-date bound.
+struct TodoFilter {
+    std::string due_after;
+    std::string due_before;
+    std::optional<bool> completed;
+    
+    bool hasDueRange() const { return !due_after.empty() || !due_before.empty(); }
+};
+
+// Where the next readTodoBatch call resumes: just past the last todo the
+// previous one returned. A default cursor starts at the newest todo.
+struct TodoCursor {
+    std::string created_at;
+    int id = 0;
+    // Set once a batch comes back short: there is nothing after it
+    bool done = false;
+};
+
+// Number of open todos due on one calendar day (YYYY-MM-DD).
+struct DueDateBucket {
+    std::string date;
+    int count;
+};
+
+// Result of a delta sync query (Database::getChangesSince).
+struct TodoChanges {
+    // Created or updated todos, in change order
+    std::vector<Todo> changed;
+    std::vector<int> deleted;
+    // Sync point to send as `since` next time
+    int64_t seq = 0;
+    // The result was cut at the limit; ask again from `seq`
+    bool has_more = false;
+    // `since` is older than the retained tombstones (or unknown to this
+    // database): the client must drop its copy and sync again from 0
+    bool reset = false;
+};
+
 struct User {
     int id;
     std::string username;
@@ -24,29 +71,152 @@ struct User {
     std::string updated_at;
 };
 
+struct UserFilterStats {
+    bool enabled;
+    // Usernames plus emails in the filter, its current sizing and memory
+    size_t keys;
+    size_t capacity;
+    size_t bytes;
+    uint64_t lookups;
+    // Answered "no such user" without a query
+    uint64_t rejected;
+    // Passed to the database, which then found no user
+    uint64_t false_positives;
+};
+
+enum class StorageEngine {
+    SQLite,
+    // In-memory working set persisted through an append-only log (see LogStore).
+    Log,
+};
+
+struct DatabaseOptions {
+    std::string path = "todos.db";
+    StorageEngine engine = StorageEngine::SQLite;
+    
+    // Log engine: fsync after this many records or this much time, whichever
+    // comes first, and snapshot + truncate the log every N records.
+    size_t log_sync_batch = 64;
+    std::chrono::milliseconds log_sync_interval{10};
+    size_t log_snapshot_interval = 10000;
+    
+    // SQLite engine: todos are spread over `shard_count` files by a stable
+    // hash of user_id; users live in the directory file at `path`. Each shard
+    // has one writer connection and `readers_per_shard` reader connections.
+    int shard_count = 1;
+    int readers_per_shard = 2;
+    // SQLite engine: keep a Bloom filter of usernames and emails in memory,
+    // so lookups of users that do not exist (most failed logins) and
+    // registration checks of fresh names skip the query. Built at startup.
+    bool user_filter = true;
+};
+
+class LogStore;
+class CompactTodoList;
+class BloomFilter;
+
 class Database {
 public:
     Database(const std::string& db_path = "todos.db");
+    explicit Database(const DatabaseOptions& options);
     ~Database();
     
     bool initialize();
+    // Forces batched log writes to stable storage; SQLite commits are already durable.
+    void flush();
     
     // Todo methods
     std::vector<Todo> getAllTodos(int user_id);
+    // Same rows as above, appended to a compact list (see compact_todo.h).
+    void getAllTodos(int user_id, CompactTodoList& todos);
+    // Same rows in the same order, up to `batch_size` at a time: appends the
+    // todos after `cursor` to `batch` and moves the cursor past them. Each
+    // call is a read of its own that holds no connection or lock afterwards,
+    // so a caller may take its time between batches; a todo written in
+    // between may or may not be among the later ones. Returns false on a
+    // storage error.
+    bool readTodoBatch(int user_id, TodoCursor& cursor, size_t batch_size, CompactTodoList& batch);
     Todo getTodoById(int id, int user_id);
     Todo createTodo(const std::string& text, int user_id, const std::string& due_date = "");
     Todo updateTodo(int id, const std::string& text, bool completed, int user_id);
+    // Bulk insert: the whole batch in one transaction through one prepared
+    // statement. Text, completion, due date and timestamps are taken as
+    // given (missing timestamps become now); ids are assigned and written
+    // back into `todos`. On SQLite all or nothing; the log engine keeps the
+    // todos appended before a failed write and trims `todos` to them.
+    bool importTodos(int user_id, std::vector<Todo>& todos);
     bool deleteTodo(int id, int user_id);
+    // Full-text search over the user's todo text, best matches first.
+    std::vector<Todo> searchTodos(int user_id, const std::string& query, int limit, int offset);
+    // Filtered listing: soonest due first when a due-date bound is set,
+    // otherwise newest first like getAllTodos.
+    std::vector<Todo> findTodos(int user_id, const TodoFilter& filter);
+    // Open todos due in [from, to), counted per day without loading rows.
+    std::vector<DueDateBucket> countOpenTodosByDay(int user_id, const std::string& from, const std::string& to);
+    // Todos changed and deleted after sync point `since` (0 = everything
+    // live). Costs time in the number of changes, not the size of the list.
+    TodoChanges getChangesSince(int user_id, int64_t since, int limit);
+    // Drops tombstones older than `retention`; clients that last synced
+    // before them get `reset`. Returns the number removed.
+    int compactTombstones(std::chrono::seconds retention);
     
     // User methods
     std::optional<User> createUser(const std::string& username, const std::string& email, const std::string& password_hash);
     std::optional<User> getUserByUsername(const std::string& username);
     std::optional<User> getUserById(int id);
+    bool updatePasswordHash(int user_id, const std::string& password_hash);
     bool userExists(const std::string& username, const std::string& email);
+    UserFilterStats userFilterStats() const;
+    
+    StorageEngine engine() const { return options_.engine; }
+    int shardCount() const { return options_.shard_count; }
+    // Storage calls that can run at once without waiting for a connection:
+    // each shard's writer and readers, plus the user directory's when
+    // sharded. The log engine reports the size of one shard.
+    int connectionCount() const;
     
+    // Sharding layout, stable across releases: changing either function
+    // strands existing users in the wrong file.
+    static const int kMaxShards = 64;
+    static int shardOf(int user_id, int shard_count);
+    static std::string shardPath(const std::string& db_path, int shard, int shard_count);
+    
+    // Offline: moves every user's todos to the shard they map to under
+    // `new_shard_count` and records the new layout in the directory.
+    static bool reshard(const std::string& db_path, int new_shard_count);
+
 private:
-    sqlite3* db_;
+    struct Connection;
+    struct Shard;
+    
     std::string db_path_;
+    DatabaseOptions options_;
+    std::unique_ptr<LogStore> log_;
+    
+    std::vector<std::unique_ptr<Shard>> shards_;
+    // Holds users and layout metadata. Aliases shards_[0] when unsharded.
+    Shard* directory_;
+    std::unique_ptr<Shard> directory_storage_;
+    
+    // Replaced (under the unique lock) only while the directory writer is
+    // held, so no user insert can slip between the scan and the swap
+    std::unique_ptr<BloomFilter> user_filter_;
+    mutable std::shared_mutex user_filter_mutex_;
+    std::atomic<uint64_t> user_filter_lookups_{0};
+    std::atomic<uint64_t> user_filter_rejected_{0};
+    std::atomic<uint64_t> user_filter_false_positives_{0};
+    
+    Shard& shardFor(int user_id);
+    Connection& lockReader(Shard& shard, std::unique_lock<std::mutex>& lock);
+    bool openShard(Shard& shard, bool is_directory, bool holds_todos);
+    bool checkLayout();
+    int allocateTodoId(Shard& shard);
+    // Scans the users table through `db` into a filter with room to grow
+    std::unique_ptr<BloomFilter> buildUserFilter(sqlite3* db);
+    bool loadUserFilter();
+    // False only when no user has this username (kind 'u') or email ('e')
+    bool userKeyMayExist(char kind, std::string_view value) const;
     
     std::string getCurrentTimestamp();
+    static std::string formatTimestamp(std::chrono::system_clock::time_point time);
 };
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+struct EventHubOptions {
+    // Comment line written to every stream this often so proxies keep the
+    // connection open and dead peers are noticed.
+    std::chrono::milliseconds heartbeat_interval{15000};
+    // Bytes a subscriber may have queued beyond what the kernel accepted;
+    // a consumer that falls further behind is disconnected. Checked as
+    // events are published, so a burst cannot grow a queue past it.
+    size_t max_queued_bytes = 64 * 1024;
+};
+
+// Per-user fan-out of Server-Sent Events over long-lived sockets.
+//
+// Subscribed sockets are owned by the hub and serviced by a single epoll
+// thread, so an idle stream costs a file descriptor and a small queue rather
+// than a thread. publish() only appends to the subscribers' queues and wakes
+// the hub; all socket writes, heartbeats and disconnects happen on the hub
+// thread with non-blocking I/O.
+class EventHub {
+public:
+    explicit EventHub(const EventHubOptions& options = EventHubOptions());
+    ~EventHub();
+    
+    EventHub(const EventHub&) = delete;
+    EventHub& operator=(const EventHub&) = delete;
+    
+    bool start();
+    void stop();
+    
+    // Takes ownership of a connected socket whose response headers were
+    // already sent; on failure the caller still owns it. `initial` is queued
+    // ahead of any event.
+    bool subscribe(int fd, int user_id, const std::string& initial = "");
+    // As above, with the initial frame built once the stream is registered:
+    // whatever `initial` reads then (the user's version, say) already covers
+    // every event published before it, and each later one follows it.
+    bool subscribe(int fd, int user_id, const std::function<std::string()>& initial);
+    // Queues a complete SSE frame for every stream of the user.
+    void publish(int user_id, const std::string& frame);
+    
+    size_t subscriberCount();
+    size_t droppedCount() const { return dropped_.load(); }
+    
+    // Formats one SSE frame; multi-line data is split into data: lines.
+    static std::string formatEvent(const std::string& event, const std::string& data, const std::string& id = "");
+
+private:
+    struct Subscriber {
+        int user_id;
+        std::string pending;
+        bool want_write = false;
+        // Went over max_queued_bytes; nothing more is queued and the hub
+        // thread disconnects it
+        bool overflowed = false;
+    };
+    
+    EventHubOptions options_;
+    int epoll_fd_;
+    int wake_fd_;
+    std::atomic<bool> running_;
+    std::atomic<size_t> dropped_;
+    std::thread thread_;
+    
+    std::mutex mutex_;
+    std::unordered_map<int, Subscriber> subscribers_;
+    std::unordered_map<int, std::unordered_set<int>> fds_by_user_;
+    std::unordered_set<int> dirty_;
+    
+    void run();
+    void wake();
+    void flushLocked(int fd);
+    void removeLocked(int fd);
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// A request parsed in place: every field is a view into the raw bytes read
+// from the socket, so parsing allocates nothing. The raw buffer must outlive
+// the HttpRequest.
+struct HttpRequest {
+    std::string_view method;
+    // Path without the query string
+    std::string_view path;
+    // Everything after '?', empty if there is none
+    std::string_view query;
+    std::string_view version;
+    // Request line and header lines, without the terminating blank line
+    std::string_view headers;
+    std::string_view body;
+};
+
+// Splits `raw` into request line, headers and body. Returns false when
+// there is no request line to speak of.
+bool parseHttpRequest(std::string_view raw, HttpRequest& request);
+
+// Case-insensitive lookup of a request header's value (first occurrence),
+// with surrounding whitespace trimmed. Empty if the header is absent.
+std::string_view extractHeader(std::string_view headers, std::string_view name);
+
+// Size of the head of the first request in `data`, up to and including the
+// blank line; 0 while it is incomplete.
+size_t requestHeadLength(std::string_view data);
+
+// Size of the first request in `data`: the head up to the blank line plus
+// Content-Length bytes of body. Returns 0 while the head is incomplete;
+// otherwise the full size, which may exceed data.size() while the body is
+// still arriving. Sets `malformed` for an unparsable Content-Length.
+size_t requestLength(std::string_view data, bool& malformed);
+
+// HTTP/1.1 keeps the connection unless the client sends "Connection: close";
+// HTTP/1.0 closes it unless the client asks for keep-alive.
+bool wantsKeepAlive(const HttpRequest& request);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "database.h"
+#include "auth_service.h"
+#include "compact_todo.h"
+#include "buffer_pool.h"
+#include "task_scheduler.h"
+#include "bounded_executor.h"
+
+// JSON encoding of API responses and the minimal field extraction used for
+// request bodies.
+std::string escapeJson(const std::string& input);
+std::string todoToJson(const Todo& todo);
+std::string todosToJson(const std::vector<Todo>& todos);
+std::string searchResultsToJson(const std::vector<Todo>& todos, int limit, int offset, bool has_more);
+std::string dueDateBucketsToJson(const std::vector<DueDateBucket>& buckets);
+std::string todoChangesToJson(const TodoChanges& changes);
+std::string userToJson(const User& user);
+std::string authResponseToJson(const UserAuth& user, const std::string& token);
+std::string statusToJson(const BufferPoolStats& buffers, const TaskSchedulerStats& scheduler,
+                         const BoundedExecutorStats& database, const AuthStats& auth);
+
+// Append-only writers for the per-request arena: output goes straight into
+// the response buffer, with no temporary strings or streams. Byte-for-byte
+// the same JSON as the functions above.
+void appendJsonEscaped(std::pmr::string& out, std::string_view value);
+void appendTodoJson(std::pmr::string& out, const CompactTodoList& list, const CompactTodo& todo);
+void appendTodosJson(std::pmr::string& out, const CompactTodoList& todos);
+// Same output; lists longer than one chunk are encoded chunk by chunk on
+// `scheduler` and stitched together in order.
+void appendTodosJson(std::pmr::string& out, const CompactTodoList& todos, TaskScheduler& scheduler,
+                     size_t todos_per_chunk = 512);
+
+struct ImportSummary {
+    size_t imported = 0;
+    // Lines that were not a todo, and the first few of their numbers
+    size_t rejected = 0;
+    std::vector<size_t> rejected_lines;
+    double seconds = 0;
+    // Set when the import stopped early; the todos imported so far stay
+    std::string error;
+};
+
+std::string importSummaryToJson(const ImportSummary& summary);
+
+// One line of an NDJSON import: a flat object with "text" and optionally
+// "completed", "due_date" (or "dueDate", as POST /api/todos takes it),
+// "created_at" and "updated_at", i.e. what an export line holds. Other
+// fields, such as "id", are ignored, and so are timestamps not in canonical
+// form. False when the line is not such an object or has no text.
+bool parseImportedTodo(std::string_view line, Todo& todo);
+
+std::string extractJsonField(std::string_view json, const std::string& field);
+bool extractJsonBool(std::string_view json, const std::string& field);
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Lock-free latency histogram for hot paths. Values are bucketed by their
+// highest set bit, and each power of two is split into 16 linear
+// sub-buckets, so a reported percentile is within 1/16 of the recorded value
+// at any scale while the whole histogram stays a fixed array of counters.
+class LatencyHistogram {
+public:
+    void record(uint64_t nanos);
+    uint64_t count() const;
+    // Upper bound of the bucket holding the q-th quantile (0 < q <= 1), in
+    // nanoseconds; 0 while nothing has been recorded
+    uint64_t percentile(double q) const;
+    // Adds everything recorded in `other`, e.g. to report several histograms as one
+    void merge(const LatencyHistogram& other);
+
+private:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+    // Values below kSubBuckets get a bucket each, then kSubBuckets per power of two
+    static constexpr size_t kBuckets = kSubBuckets + (64 - kSubBucketBits) * kSubBuckets;
+    
+    std::array<std::atomic<uint64_t>, kBuckets> counts_{};
+    
+    static size_t bucketOf(uint64_t value);
+    static uint64_t upperBoundOf(size_t bucket);
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <optional>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include "database.h"
+#include "compact_todo.h"
+
+// In-memory storage engine backed by an append-only write-ahead log.
+//
+// Every mutation is framed as [u32 length][u32 crc32][payload] and appended to
+// "<path>.wal". The log is fsynced in batches: after `sync_batch` records, or
+// by the background flusher once `sync_interval` has elapsed, whichever comes
+// first. Every `snapshot_interval` records the full state is written to
+// "<path>.snapshot" (tmp file + rename) and the log is truncated, which bounds
+// recovery to one snapshot load plus a short log tail.
+//
+// On open, the snapshot is loaded and the log is replayed up to the first
+// short or corrupt record; the torn tail is truncated away. Replay is
+// idempotent, so a crash between writing a snapshot and truncating the log is
+// harmless.
+//
+// Todos and their change history are split by user id over kStripes stripes,
+// each behind a reader/writer lock. A mutation holds its user's stripe
+// exclusively while it is appended and applied; reads share the stripe, so
+// they wait only for writes to users of the same stripe, never for log I/O
+// (fsync happens outside any stripe) or snapshots.
+class LogStore {
+public:
+    LogStore(const std::string& path,
+             size_t sync_batch,
+             std::chrono::milliseconds sync_interval,
+             size_t snapshot_interval);
+    ~LogStore();
+    
+    LogStore(const LogStore&) = delete;
+    LogStore& operator=(const LogStore&) = delete;
+    
+    bool open();
+    void sync();
+    bool snapshot();
+    
+    // Todo methods
+    std::vector<Todo> getAllTodos(int user_id);
+    void getAllTodos(int user_id, CompactTodoList& todos);
+    // A batch is copied under the stripe lock; the cursor resumes below the
+    // last id returned.
+    bool readTodoBatch(int user_id, TodoCursor& cursor, size_t batch_size, CompactTodoList& batch);
+    Todo getTodoById(int id, int user_id);
+    Todo createTodo(const std::string& text, int user_id, const std::string& due_date, const std::string& timestamp);
+    // One lock acquisition and one sync check for the whole batch
+    bool importTodos(int user_id, std::vector<Todo>& todos);
+    Todo updateTodo(int id, const std::string& text, bool completed, int user_id, const std::string& timestamp);
+    bool deleteTodo(int id, int user_id, const std::string& timestamp);
+    std::vector<Todo> searchTodos(int user_id, const std::string& query, int limit, int offset);
+    std::vector<Todo> findTodos(int user_id, const TodoFilter& filter);
+    std::vector<DueDateBucket> countOpenTodosByDay(int user_id, const std::string& from, const std::string& to);
+    TodoChanges getChangesSince(int user_id, int64_t since, int limit);
+    // Drops tombstones deleted before `cutoff` and snapshots, so they stay gone.
+    int compactTombstones(const std::string& cutoff);
+    
+    // User methods
+    std::optional<User> createUser(const std::string& username, const std::string& email,
+                                   const std::string& password_hash, const std::string& timestamp);
+    std::optional<User> getUserByUsername(const std::string& username);
+    std::optional<User> getUserById(int id);
+    bool updatePasswordHash(int user_id, const std::string& password_hash, const std::string& timestamp);
+    bool userExists(const std::string& username, const std::string& email);
+    
+    const std::string& logPath() const { return log_path_; }
+    const std::string& snapshotPath() const { return snapshot_path_; }
+
+private:
+    enum class RecordType : uint8_t {
+        UserCreated = 1,
+        TodoCreated = 2,
+        TodoUpdated = 3,
+        TodoDeleted = 4,
+        SnapshotMeta = 5,
+        SnapshotEnd = 6,
+        // Same payload as UserCreated, replacing the user
+        UserUpdated = 7,
+    };
+    
+    std::string log_path_;
+    std::string snapshot_path_;
+    size_t sync_batch_;
+    std::chrono::milliseconds sync_interval_;
+    size_t snapshot_interval_;
+    
+    int log_fd_;
+    // Set when the log can no longer be trusted to hold what was appended
+    // (a write that could not be undone, a failed sync); appends and
+    // snapshots then fail
+    bool failed_;
+    size_t unsynced_records_;
+    size_t records_since_snapshot_;
+    std::chrono::steady_clock::time_point last_sync_;
+    
+    // Guarded by users_mutex_
+    int next_user_id_;
+    std::unordered_map<int, User> users_;
+    std::unordered_map<std::string, int> user_ids_by_name_;
+    std::unordered_map<std::string, int> user_ids_by_email_;
+    
+    // Delta sync: the latest change of every todo (live or tombstone) per
+    // user, keyed by its sequence number.
+    struct ChangeEntry {
+        int id;
+        bool deleted;
+        std::string deleted_at;
+    };
+    
+    struct Stripe {
+        std::shared_mutex mutex;
+        // Per-user todos as keyed compact lists (ascending id); ids are
+        // allocated in creation order, so reverse iteration yields newest first.
+        std::unordered_map<int, CompactTodoList> todos_by_user;
+        std::unordered_map<int, std::map<int64_t, ChangeEntry>> changes_by_user;
+        std::unordered_map<int, int64_t> change_seq_by_todo;
+        
+        CompactTodoList& todos(int user_id);
+        const CompactTodoList* findTodos(int user_id) const;
+        // Keeps exactly one change entry per todo: its latest write or its tombstone.
+        void recordChange(int user_id, int id, int64_t seq, bool deleted, const std::string& deleted_at);
+    };
+    static constexpr size_t kStripes = 64;
+    std::array<Stripe, kStripes> stripes_;
+    
+    // Allocated under log_mutex_, in log order
+    int next_todo_id_;
+    std::atomic<int64_t> change_seq_;
+    std::atomic<int64_t> purged_seq_;
+    
+    // Lock order: snapshot_gate_, a stripe or users_mutex_, then log_mutex_.
+    // Mutations hold the gate shared; a snapshot holds it exclusively.
+    std::shared_mutex snapshot_gate_;
+    std::shared_mutex users_mutex_;
+    // The log file and its counters
+    std::mutex log_mutex_;
+    std::condition_variable flusher_cv_;
+    bool stopping_;
+    std::thread flusher_;
+    
+    bool loadSnapshot();
+    bool replayLog();
+    bool applyRecord(const std::string& payload);
+    Stripe& stripeFor(int user_id);
+    bool appendLocked(const std::string& payload);
+    // Runs after a mutation has released its locks: fsyncs a full batch and
+    // snapshots when one is due.
+    void finishWrite();
+    void syncLocked();
+    // With `only_if_due` the snapshot is skipped unless the interval has
+    // been reached by the time the gate is held.
+    bool takeSnapshot(bool only_if_due);
+    bool snapshotLocked();
+    void flusherLoop();
+    
+    static std::string encodeUser(RecordType type, const User& user);
+    static std::string encodeTodo(RecordType type, const Todo& todo, int64_t seq);
+    static std::string encodeTombstone(int id, int user_id, int64_t seq, const std::string& deleted_at);
+};
+
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+enum class LogLevel { Debug, Info, Warning, Error };
+
+// A named value on a log record. Keys must outlive the record (string
+// literals); text is copied when the record is taken.
+struct LogField {
+    enum class Kind { Text, Integer, Real };
+    
+    const char* key;
+    Kind kind;
+    int64_t integer = 0;
+    double real = 0;
+    std::string_view text;
+    
+    LogField(const char* key, std::string_view text) : key(key), kind(Kind::Text), text(text) {}
+    LogField(const char* key, const char* text) : LogField(key, std::string_view(text ? text : "")) {}
+    LogField(const char* key, const std::string& text) : LogField(key, std::string_view(text)) {}
+    template <typename Integer, typename = std::enable_if_t<std::is_integral_v<Integer>>>
+    LogField(const char* key, Integer value) : key(key), kind(Kind::Integer), integer(static_cast<int64_t>(value)) {}
+    LogField(const char* key, double value) : key(key), kind(Kind::Real), real(value) {}
+};
+
+struct LogOptions {
+    LogLevel level = LogLevel::Info;
+    // File records are appended to; stderr when empty
+    std::string path;
+    // Records a thread can have waiting for the flusher; past that its
+    // records are dropped (and counted) rather than blocking the thread
+    size_t thread_buffer_records = 64;
+    std::chrono::milliseconds flush_interval{100};
+    // Records one message may log per second; the rest are counted and the
+    // count goes out with the next one let through. 0 turns this off.
+    uint32_t rate_limit_per_second = 20;
+};
+
+struct LogStats {
+    uint64_t written;
+    // Lost to a full thread buffer
+    uint64_t dropped;
+    // Held back by the rate limit
+    uint64_t suppressed;
+};
+
+// Structured logging as JSON lines. A record is captured into a ring buffer
+// of the logging thread, with its message and field values unformatted;
+// a background thread formats and writes everything buffered, so logging on
+// a request path costs a copy and no lock or system call even when errors
+// pour in. Until start() (and after stop()) records are formatted and
+// written at once, which is what tools and tests want.
+class Logger {
+public:
+    static bool start(const LogOptions& options = LogOptions());
+    // Writes out what is buffered and stops the background thread; records
+    // logged while it stops may be lost
+    static void stop();
+    static LogStats stats();
+    
+    // `message` must outlive the record: use the logError() etc. helpers,
+    // which take string literals only
+    static void write(LogLevel level, const char* message, std::initializer_list<LogField> fields);
+};
+
+// The request and user the calling thread is working for, added to every
+// record it logs. A context lasts for its scope and restores the one it
+// replaced, so it can be set on whichever thread runs part of a request.
+class LogContext {
+public:
+    explicit LogContext(uint64_t request_id);
+    ~LogContext();
+    
+    LogContext(const LogContext&) = delete;
+    LogContext& operator=(const LogContext&) = delete;
+    
+    // Tags the rest of the current context's records with `user_id`
+    static void setUser(int user_id);
+
+private:
+    uint64_t request_id_;
+    int user_id_;
+};
+
+template <size_t N>
+void logError(const char (&message)[N], std::initializer_list<LogField> fields = {}) {
+    Logger::write(LogLevel::Error, message, fields);
+}
+
+template <size_t N>
+void logWarning(const char (&message)[N], std::initializer_list<LogField> fields = {}) {
+    Logger::write(LogLevel::Warning, message, fields);
+}
+
+template <size_t N>
+void logInfo(const char (&message)[N], std::initializer_list<LogField> fields = {}) {
+    Logger::write(LogLevel::Info, message, fields);
+}
+
+template <size_t N>
+void logDebug(const char (&message)[N], std::initializer_list<LogField> fields = {}) {
+    Logger::write(LogLevel::Debug, message, fields);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "auth_service.h"
+#include "bounded_executor.h"
+#include "buffer_pool.h"
+#include "logger.h"
+#include "task_scheduler.h"
+
+// Bucket layout of every exported latency histogram: two log-linear buckets
+// per power of two, with upper bounds (inclusive) of 2^k and 1.5 * 2^k
+// nanoseconds from about 8 µs to about 8.6 s, then +Inf. Coarse enough that
+// a route's histogram is a few dozen series, fine enough that a quantile
+// estimated from it is within a third of the real value.
+class LatencyBuckets {
+public:
+    static constexpr int kMinOctave = 13;
+    static constexpr int kMaxOctave = 33;
+    // Finite bounds, then the +Inf bucket
+    static constexpr size_t kFinite = 2 * (kMaxOctave - kMinOctave) + 1;
+    static constexpr size_t kCount = kFinite + 1;
+    
+    static size_t bucketOf(uint64_t nanos);
+    // Inclusive upper bound in nanoseconds, for bucket < kFinite
+    static uint64_t upperBoundOf(size_t bucket);
+};
+
+// Request counters and latency histograms for /metrics.
+//
+// Recording is a handful of relaxed atomic adds: every thread writes to one
+// of kShards cache-line-aligned copies of all the counters, picked once per
+// thread, so request threads do not contend on a shared line or lock. The
+// copies are only summed when the metrics are rendered.
+//
+// Requests are labelled by route template ("/api/todos/:id") and never by
+// raw path, so the number of series is fixed.
+class HttpMetrics {
+public:
+    enum class StorageStage { Queue, Execute };
+    
+    HttpMetrics() = default;
+    HttpMetrics(const HttpMetrics&) = delete;
+    HttpMetrics& operator=(const HttpMetrics&) = delete;
+    
+    static constexpr size_t kRoutes = 18;
+    // Requests no route serves, and those that could not be parsed
+    static constexpr size_t kOtherRoute = kRoutes - 1;
+    
+    // Index of the route that serves `method` `path`
+    static size_t routeOf(std::string_view method, std::string_view path);
+    static const char* routeMethod(size_t route);
+    static const char* routePath(size_t route);
+    
+    void recordRequest(size_t route, int status, uint64_t nanos);
+    // Time a storage request waited for a database thread, and then ran on it
+    void recordStorageStage(StorageStage stage, uint64_t nanos);
+    // Connections currently being served by a request thread
+    void connectionOpened();
+    void connectionClosed();
+    
+    uint64_t requests(size_t route, int status) const;
+    int64_t connections() const;
+    
+    // Appends every non-empty series in the Prometheus text format
+    void appendPrometheus(std::string& out) const;
+
+private:
+    static constexpr size_t kShards = 16;
+    // The codes the server answers with, then one for any other
+    static constexpr size_t kStatuses = 11;
+    
+    struct Histogram {
+        std::array<std::atomic<uint64_t>, LatencyBuckets::kCount> buckets{};
+        std::atomic<uint64_t> sum_ns{0};
+        
+        void record(uint64_t nanos);
+    };
+    
+    struct alignas(64) Shard {
+        std::array<std::array<std::atomic<uint64_t>, kStatuses>, kRoutes> requests{};
+        std::array<Histogram, kRoutes> latency{};
+        std::array<Histogram, 2> storage{};
+        std::atomic<int64_t> connections{0};
+    };
+    
+    // A histogram summed over the shards
+    struct HistogramTotals {
+        std::array<uint64_t, LatencyBuckets::kCount> buckets{};
+        uint64_t sum_ns = 0;
+        uint64_t count = 0;
+    };
+    
+    std::array<Shard, kShards> shards_;
+    
+    Shard& localShard();
+    static size_t statusIndex(int status);
+    template <typename Pick>
+    HistogramTotals total(Pick pick) const;
+    static void appendHistogram(std::string& out, const char* name, const std::string& labels,
+                                const HistogramTotals& totals);
+};
+
+// Gauges and counters of the server's pools for /metrics: queue depths of
+// the storage and password hashing pools, buffer pool occupancy, scheduler
+// and session cache counters.
+void appendRuntimeMetrics(std::string& out, const BufferPoolStats& buffers, const TaskSchedulerStats& scheduler,
+                          const BoundedExecutorStats& storage, const AuthStats& auth);
+
+// Log records written, lost to full thread buffers and held back by the rate limit
+void appendLogMetrics(std::string& out, const LogStats& logs);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// scrypt cost parameters (RFC 7914). Memory per hash is 128 * r * 2^log2_n
+// bytes, 16 MiB with the defaults, and the time grows with it.
+struct PasswordHashParams {
+    int log2_n = 14;
+    int r = 8;
+    int p = 1;
+};
+
+// Salted scrypt hash in the form $scrypt$ln=<log2_n>,r=<r>,p=<p>$<salt>$<key>,
+// salt and key in hex. The parameters travel with the hash, so raising them
+// later leaves existing hashes verifiable (see passwordHashMatches).
+std::string hashPassword(std::string_view password, const PasswordHashParams& params);
+// False for a wrong password and for anything that is not such a hash
+bool verifyPasswordHash(std::string_view password, std::string_view encoded);
+// Whether `encoded` is a scrypt hash made with exactly `params`
+bool passwordHashMatches(std::string_view encoded, const PasswordHashParams& params);
+
+// The raw KDF, for tests against the RFC vectors. False when the parameters
+// are out of the supported range.
+bool scrypt(std::string_view password, std::string_view salt, const PasswordHashParams& params,
+            uint8_t* key, size_t key_length);
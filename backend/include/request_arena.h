@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+// Monotonic arena for everything one request allocates: parsed fields,
+// materialized rows and the response. The first kInlineBytes come from the
+// arena object itself (on the handling thread's stack); beyond that it grows
+// in chunks from the heap. Nothing is freed until the arena is destroyed at
+// the end of the request, which releases it all at once.
+class RequestArena {
+public:
+    static constexpr size_t kInlineBytes = 16 * 1024;
+    
+    RequestArena() : resource_(buffer_, sizeof(buffer_), std::pmr::new_delete_resource()) {}
+    
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+    
+    std::pmr::memory_resource* resource() { return &resource_; }
+    
+private:
+    alignas(std::max_align_t) std::byte buffer_[kInlineBytes];
+    std::pmr::monotonic_buffer_resource resource_;
+};
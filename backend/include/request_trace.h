@@ -0,0 +1,170 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Timestamps for request stage timing. On x86 a reading is the time stamp
+// counter, a few nanoseconds with no system call, converted to nanoseconds
+// with a rate measured once against steady_clock; elsewhere it is
+// steady_clock in nanoseconds.
+class TraceClock {
+public:
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+    
+    static uint64_t toNanos(uint64_t ticks);
+    static uint64_t nanosBetween(uint64_t from, uint64_t to) { return to > from ? toNanos(to - from) : 0; }
+};
+
+// The stages of one request, as spans on the thread that serves it. Spans
+// live in a fixed array, so timing a stage allocates nothing; spans past
+// kMaxSpans are dropped.
+class RequestTrace {
+public:
+    static constexpr size_t kMaxSpans = 16;
+    
+    struct Span {
+        const char* name;
+        uint64_t start;
+        // 0 while the span is open
+        uint64_t end;
+    };
+    
+    explicit RequestTrace(uint64_t start = TraceClock::now()) : start_(start) {}
+    
+    uint64_t start() const { return start_; }
+    // Opens a span now; returns its index for end(), or kMaxSpans when full
+    size_t begin(const char* name);
+    void end(size_t span);
+    // Adds a span that was timed elsewhere
+    void add(const char* name, uint64_t start, uint64_t end);
+    
+    size_t size() const { return count_; }
+    const Span& operator[](size_t i) const { return spans_[i]; }
+    
+    // Appends a Server-Timing header line ("Server-Timing: db;dur=1.204,
+    // ...\r\n") with the finished spans and the time since start(), in ms
+    template <typename String>
+    void appendServerTiming(String& out) const;
+
+private:
+    uint64_t start_;
+    std::array<Span, kMaxSpans> spans_;
+    size_t count_ = 0;
+    
+    // "12.345": milliseconds to the microsecond, without printf
+    template <typename String>
+    static void appendMillis(String& out, uint64_t nanos);
+};
+
+// Times the enclosing scope as a span of `trace`
+class TraceSpan {
+public:
+    TraceSpan(RequestTrace& trace, const char* name) : trace_(trace), span_(trace.begin(name)) {}
+    ~TraceSpan() { trace_.end(span_); }
+    
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    RequestTrace& trace_;
+    size_t span_;
+};
+
+struct TraceOptions {
+    // Fraction of requests whose trace is written, from 0 (none) to 1 (all)
+    double sample_rate = 0;
+    std::string path = "traces.json";
+    // Each thread's traces are written once this many bytes have built up
+    size_t thread_buffer_bytes = 64 * 1024;
+    // Whether responses carry a Server-Timing header with their stages
+    bool server_timing = true;
+};
+
+// Writes sampled request traces to a file in the Chrome trace event format
+// (a JSON array of complete events; open it in chrome://tracing or
+// Perfetto). Each thread formats its traces into its own buffer and takes
+// the file lock only to write a full buffer out, so tracing stays off the
+// request path's critical sections. The array is closed when the writer is
+// destroyed; trace viewers also load it unclosed, after a kill. A process
+// runs one writer at a time.
+class TraceWriter {
+public:
+    explicit TraceWriter(const TraceOptions& options = TraceOptions());
+    ~TraceWriter();
+    
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+    
+    bool enabled() const { return file_ != nullptr; }
+    // Whether to keep the current request's trace; true for about
+    // sample_rate of the calls
+    bool sample();
+    // Buffers `trace` as one event for the request and one per span
+    void write(const RequestTrace& trace, std::string_view method, std::string_view route, int status);
+    // Writes out the calling thread's buffer; call before the thread exits
+    void flushThread();
+    uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+
+private:
+    TraceOptions options_;
+    uint64_t sample_threshold_;
+    std::FILE* file_ = nullptr;
+    // Event timestamps count from here
+    uint64_t base_ = 0;
+    std::mutex file_mutex_;
+    std::atomic<uint64_t> written_{0};
+    
+    void writeOut(std::string& events);
+};
+
+template <typename String>
+void RequestTrace::appendMillis(String& out, uint64_t nanos) {
+    uint64_t micros = nanos / 1000;
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* at = end;
+    for (int i = 0; i < 3; ++i) {
+        *--at = static_cast<char>('0' + micros % 10);
+        micros /= 10;
+    }
+    *--at = '.';
+    do {
+        *--at = static_cast<char>('0' + micros % 10);
+        micros /= 10;
+    } while (micros > 0);
+    out.append(at, static_cast<size_t>(end - at));
+}
+
+template <typename String>
+void RequestTrace::appendServerTiming(String& out) const {
+    out += "Server-Timing: ";
+    for (size_t i = 0; i < count_; ++i) {
+        if (spans_[i].end == 0) {
+            continue;
+        }
+        out += spans_[i].name;
+        out += ";dur=";
+        appendMillis(out, TraceClock::nanosBetween(spans_[i].start, spans_[i].end));
+        out += ", ";
+    }
+    out += "total;dur=";
+    appendMillis(out, TraceClock::nanosBetween(start_, TraceClock::now()));
+    out += "\r\n";
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct UserAuth {
+    int user_id;
+    std::string username;
+    std::string email;
+};
+
+struct SessionCacheStats {
+    size_t entries;
+    size_t capacity;
+    uint64_t hits;
+    uint64_t misses;
+    // Sessions dropped because their user changed or was deleted
+    uint64_t invalidations;
+    // Sessions dropped to make room for new ones
+    uint64_t evictions;
+};
+
+// Tokens that already passed validation, with the user they resolved to, so
+// repeat requests skip the signature check and the user lookup.
+//
+// Entries are keyed by a digest of the token and spread over shards by that
+// digest; each shard has its own reader/writer lock, so lookups from
+// different connections rarely touch the same lock and never wait for each
+// other. The full token is kept and compared, so a digest collision is a
+// miss, never someone else's session.
+//
+// A full shard makes room with CLOCK: lookups mark the session they hit,
+// and an insert moves the shard's hand over a few slots, unmarking them,
+// until it reaches an expired or unmarked session to replace. Expired
+// sessions are dropped as the hand passes them, not all at once.
+class SessionCache {
+public:
+    // At most `capacity` sessions are kept; 0 disables the cache
+    explicit SessionCache(size_t capacity = 65536);
+    
+    SessionCache(const SessionCache&) = delete;
+    SessionCache& operator=(const SessionCache&) = delete;
+    
+    // The session for `token`, unless it is not cached or expired before
+    // `now` (Unix seconds)
+    std::optional<UserAuth> find(std::string_view token, int64_t now);
+    // Read before looking the user up, and handed to insert(): a session
+    // looked up before invalidateUser ran is then not cached after it. It
+    // changes with every invalidation of the user (and, rarely, of another
+    // user sharing its slot, which only costs a cache miss).
+    uint64_t generation(int user_id) const;
+    // Nothing is cached when the user's generation is no longer `generation`
+    void insert(std::string_view token, const UserAuth& user, int64_t expires_at, int64_t now, uint64_t generation);
+    // Drops every session of the user; call it whenever a user changes or
+    // is deleted
+    void invalidateUser(int user_id);
+    
+    SessionCacheStats stats() const;
+
+private:
+    struct Session {
+        uint64_t digest;
+        std::string token;
+        UserAuth user;
+        int64_t expires_at;
+        // False once invalidated; the slot is then on the free list
+        bool live;
+    };
+    
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        // Token digest to its slot in `slots`
+        std::unordered_map<uint64_t, uint32_t> index;
+        std::vector<Session> slots;
+        // One per slot; set by find() under the shared lock
+        std::unique_ptr<std::atomic<bool>[]> referenced;
+        std::vector<uint32_t> free_slots;
+        size_t hand = 0;
+    };
+    
+    // Slots the hand passes before it replaces whatever it stands on
+    static constexpr size_t kClockSteps = 8;
+    static constexpr size_t kShards = 16;
+    std::array<Shard, kShards> shards_;
+    static constexpr size_t kGenerationSlots = 1024;
+    std::array<std::atomic<uint64_t>, kGenerationSlots> generations_{};
+    size_t capacity_per_shard_;
+    
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> invalidations_{0};
+    std::atomic<uint64_t> evictions_{0};
+    
+    // Frees a slot of a full shard; called with its lock held
+    uint32_t evictLocked(Shard& shard, int64_t now);
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// SHA-256 (FIPS 180-4), incremental. Copyable, so a prefix can be hashed
+// once and the state reused.
+class Sha256 {
+public:
+    static constexpr size_t kDigestBytes = 32;
+    
+    Sha256() { reset(); }
+    
+    void reset();
+    void update(const uint8_t* data, size_t size);
+    void finish(uint8_t digest[kDigestBytes]);
+
+private:
+    uint32_t state_[8];
+    uint8_t block_[64];
+    uint64_t length_;
+    size_t buffered_;
+    
+    void compress(const uint8_t* block);
+};
+
+// HMAC-SHA256 with the key schedule done once, for callers that MAC many
+// messages under one key. mac() does not allocate.
+class HmacSha256 {
+public:
+    explicit HmacSha256(std::string_view key);
+    
+    // MAC of `data` followed by `more`
+    void mac(const uint8_t* data, size_t size, const uint8_t* more, size_t more_size,
+             uint8_t out[Sha256::kDigestBytes]) const;
+    void mac(const uint8_t* data, size_t size, uint8_t out[Sha256::kDigestBytes]) const {
+        mac(data, size, nullptr, 0, out);
+    }
+
+private:
+    Sha256 inner_;
+    Sha256 outer_;
+};
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Bounded multi-producer/multi-consumer ring (Vyukov's sequence-numbered
+// queue): push and pop are a single CAS on their index, with no locks.
+template <typename T>
+class MpmcQueue {
+public:
+    // `capacity` is rounded up to a power of two
+    explicit MpmcQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        mask_ = size - 1;
+        cells_ = std::make_unique<Cell[]>(size);
+        for (size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+    
+    // False when the queue is full
+    bool push(T value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[pos & mask_];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    
+    // False when the queue is empty
+    bool pop(T& value) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[pos & mask_];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+    
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+struct TaskSchedulerStats {
+    size_t workers;
+    uint64_t executed;
+    // Taken from another worker's deque
+    uint64_t stolen;
+    // Submitted from outside the pool through the injection queue
+    uint64_t injected;
+    // Ran on the submitting thread because the injection queue was full
+    uint64_t overflowed;
+};
+
+// Work-stealing pool for CPU-bound request stages.
+//
+// Each worker owns a deque: tasks submitted from a worker go to the back of
+// its own deque and it pops from the back (newest first, still warm in
+// cache). Threads outside the pool submit through a lock-free injection
+// queue. A worker that runs dry takes from the injection queue, then steals
+// the oldest task from the front of another worker's deque, and sleeps only
+// when there is nothing queued anywhere.
+//
+// await() on a worker thread keeps running other tasks until the awaited one
+// is done, so a task can fan out subtasks and wait for them without tying up
+// the pool.
+class TaskScheduler {
+public:
+    // 0 workers means one per hardware thread
+    explicit TaskScheduler(size_t workers = 0, size_t injection_capacity = 1024);
+    // Runs everything already queued, then joins the workers
+    ~TaskScheduler();
+    
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+    
+    template <typename Fn>
+    std::future<std::invoke_result_t<Fn>> submit(Fn&& fn) {
+        using Result = std::invoke_result_t<Fn>;
+        std::packaged_task<Result()> task(std::forward<Fn>(fn));
+        std::future<Result> future = task.get_future();
+        post(std::make_unique<Job<std::packaged_task<Result()>>>(std::move(task)));
+        return future;
+    }
+    
+    template <typename T>
+    T await(std::future<T>& future) {
+        helpUntilReady(future);
+        return future.get();
+    }
+    
+    size_t workerCount() const { return workers_.size(); }
+    TaskSchedulerStats stats() const;
+
+private:
+    struct JobBase {
+        virtual ~JobBase() = default;
+        virtual void run() = 0;
+    };
+    
+    template <typename Fn>
+    struct Job : JobBase {
+        explicit Job(Fn fn) : fn(std::move(fn)) {}
+        void run() override { fn(); }
+        Fn fn;
+    };
+    
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::deque<JobBase*> tasks;
+        std::thread thread;
+    };
+    
+    std::vector<std::unique_ptr<Worker>> workers_;
+    MpmcQueue<JobBase*> injected_;
+    
+    // Tasks queued anywhere and not yet taken
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> sleepers_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    bool stopping_ = false;
+    
+    std::atomic<uint64_t> executed_{0};
+    std::atomic<uint64_t> stolen_{0};
+    std::atomic<uint64_t> injected_count_{0};
+    std::atomic<uint64_t> overflowed_{0};
+    
+    void post(std::unique_ptr<JobBase> job);
+    void wake();
+    // Finds one task (own deque, injection queue, then stealing) and runs it
+    bool runOne(size_t self);
+    void workerLoop(size_t index);
+    // Index of the calling thread in this pool, or -1 outside it
+    long currentWorker() const;
+    
+    template <typename T>
+    void helpUntilReady(std::future<T>& future) {
+        long self = currentWorker();
+        if (self < 0) {
+            future.wait();
+            return;
+        }
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!runOne(static_cast<size_t>(self))) {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
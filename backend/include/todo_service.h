@@ -3,19 +3,79 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <array>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <functional>
 #include "database.h"
+#include "compact_todo.h"
 
+struct TodoChange {
+    enum class Type { Created, Updated, Deleted };
+    Type type;
+    int user_id;
+    // The user's version after this change (see TodoService::getVersion)
+    uint64_t version;
+    // For deletions only id and user_id are set
+    Todo todo;
+};
+
+using TodoChangeListener = std::function<void(const TodoChange&)>;
+
+// Safe to share between request threads. Writes of one user are serialized
+// by a lock striped on user_id, so versions and change notifications follow
+// the order in which the writes were applied; reads take no service lock.
 class TodoService {
 public:
     TodoService();
+    explicit TodoService(std::shared_ptr<Database> db);
     ~TodoService();
     
     std::vector<Todo> getAllTodos(int user_id);
+    void getAllTodos(int user_id, CompactTodoList& todos);
+    bool readTodoBatch(int user_id, TodoCursor& cursor, size_t batch_size, CompactTodoList& batch);
     Todo getTodoById(int id, int user_id);
     Todo createTodo(const std::string& text, int user_id, const std::string& due_date = "");
     Todo updateTodo(int id, const std::string& text, bool completed, int user_id);
     bool deleteTodo(int id, int user_id);
+    // One batch of a bulk import. Bumps the version once and sends no
+    // per-todo change notifications; clients catch up through the change feed.
+    bool importTodos(int user_id, std::vector<Todo>& todos);
+    std::vector<Todo> searchTodos(int user_id, const std::string& query, int limit, int offset);
+    std::vector<Todo> findTodos(int user_id, const TodoFilter& filter);
+    // Open todos due before `today` (YYYY-MM-DD), most overdue first.
+    std::vector<Todo> getOverdueTodos(int user_id, const std::string& today);
+    std::vector<DueDateBucket> countOpenTodosByDay(int user_id, const std::string& from, const std::string& to);
+    TodoChanges getChangesSince(int user_id, int64_t since, int limit);
+    
+    // Per-user change counter, bumped after every successful write made
+    // through this service. Lives in memory only, so the ETag also carries a
+    // per-process epoch and a restart invalidates every client copy.
+    uint64_t getVersion(int user_id);
+    std::string getEtag(int user_id);
     
+    // Called after every successful write, on the writing thread, while the
+    // user's write stripe is held: it must not write through this service.
+    // Set it before the service starts handling requests.
+    void setChangeListener(TodoChangeListener listener);
+
 private:
-    std::unique_ptr<Database> db_;
+    std::shared_ptr<Database> db_;
+    std::string epoch_;
+    TodoChangeListener listener_;
+    
+    struct Stripe {
+        std::mutex write_mutex;
+        // Held exclusively only for the bump after a write
+        std::shared_mutex versions_mutex;
+        std::unordered_map<int, uint64_t> versions;
+    };
+    static constexpr size_t kStripes = 64;
+    std::array<Stripe, kStripes> stripes_;
+    
+    Stripe& stripeFor(int user_id);
+    uint64_t bumpVersion(int user_id);
+    void notify(TodoChange::Type type, const Todo& todo);
 };
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "sha256.h"
+
+struct TokenClaims {
+    int user_id;
+    // Unix seconds
+    int64_t issued_at;
+};
+
+// Session tokens: a fixed binary layout, base64url without padding.
+//
+//   version (1 byte) | user_id (4, big-endian) | issued_at (8, big-endian)
+//   | HMAC-SHA256 of the preceding 13 bytes, truncated to 16
+//
+// Nothing variable-length goes into a token, so every token is exactly
+// kEncodedLength characters and decode() works on the caller's buffer with
+// no allocation. The version byte lets the layout change later while old
+// tokens are still recognized (and rejected) cleanly.
+class TokenCodec {
+public:
+    static constexpr uint8_t kVersion = 1;
+    static constexpr size_t kEncodedLength = 39;
+    
+    explicit TokenCodec(std::string_view secret);
+    
+    // Writes exactly kEncodedLength characters to `out`
+    void encode(const TokenClaims& claims, char* out) const;
+    std::string encode(const TokenClaims& claims) const;
+    // False for anything encode() did not produce with this secret. The MAC
+    // is compared in constant time.
+    bool decode(std::string_view token, TokenClaims& claims) const;
+
+private:
+    static constexpr size_t kClaimBytes = 13;
+    static constexpr size_t kMacBytes = 16;
+    static constexpr size_t kTokenBytes = kClaimBytes + kMacBytes;
+    
+    HmacSha256 hmac_;
+};
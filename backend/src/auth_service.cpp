@@ -1,6 +1,6 @@
 #include "auth_service.h"
 #include "database.h"
-#include <iostream>
+#include "logger.h"
 #include <sstream>
 #include <iomanip>
 #include <chrono>
@@ -8,28 +8,62 @@
 #include <random>
 #include <algorithm>
 
-// Simple hash function (for demo - in production use bcrypt or similar)
+namespace {
+
+// The scheme passwords were stored with before scrypt: salt:hash. Only
+// verified, so those users can still log in and get upgraded.
 std::string simpleHash(const std::string& input, const std::string& salt) {
     std::hash<std::string> hasher;
     return std::to_string(hasher(input + salt));
 }
 
-AuthService::AuthService() : db_(std::make_unique<Database>()) {
+const int64_t kTokenLifetimeSeconds = 24 * 60 * 60;
+
+// Without a configured secret, tokens are signed with a random one and do
+// not outlive the process
+std::string tokenSecret(const AuthOptions& options) {
+    if (!options.token_secret.empty()) {
+        return options.token_secret;
+    }
+    std::random_device random;
+    std::string secret(32, '\0');
+    for (char& c : secret) {
+        c = static_cast<char>(random() & 0xff);
+    }
+    return secret;
+}
+
+BoundedExecutorOptions hashingPoolOptions(const AuthOptions& options) {
+    BoundedExecutorOptions pool;
+    pool.threads = options.hash_threads;
+    pool.max_queued = options.hash_max_queued;
+    return pool;
+}
+
+} // namespace
+
+AuthService::AuthService()
+    : db_(std::make_shared<Database>()), tokens_(tokenSecret(options_)), hashers_(hashingPoolOptions(options_)) {
     if (!db_->initialize()) {
         throw std::runtime_error("Failed to initialize database");
     }
 }
 
+AuthService::AuthService(std::shared_ptr<Database> db, const AuthOptions& options)
+    : db_(std::move(db)), options_(options), tokens_(tokenSecret(options)), sessions_(options.session_cache_capacity),
+      hashers_(hashingPoolOptions(options)) {}
+
 AuthService::~AuthService() = default;
 
 std::string AuthService::hashPassword(const std::string& password) {
-    // Simple salt generation (in production use secure random)
-    std::string salt = "todo_app_salt_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
-    std::string hash = simpleHash(password, salt);
-    return salt + ":" + hash;
+    return ::hashPassword(password, options_.password_hash);
 }
 
 bool AuthService::verifyPassword(const std::string& password, const std::string& hash) {
+    if (hash.rfind("$scrypt$", 0) == 0) {
+        return verifyPasswordHash(password, hash);
+    }
+    
     size_t colon_pos = hash.find(':');
     if (colon_pos == std::string::npos) {
         return false;
@@ -41,73 +75,66 @@ bool AuthService::verifyPassword(const std::string& password, const std::string&
     return simpleHash(password, salt) == stored_hash;
 }
 
+void AuthService::verifyDummy(const std::string& password) {
+    std::call_once(dummy_hash_once_, [this] { dummy_hash_ = hashPassword("not a password"); });
+    verifyPassword(password, dummy_hash_);
+}
+
 std::string AuthService::generateToken(const UserAuth& user) {
-    // Simple token generation (in production use JWT library)
-    auto now = std::chrono::system_clock::now();
-    auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
-    
-    std::string token_data = std::to_string(user.user_id) + ":" + 
-                           user.username + ":" + 
-                           std::to_string(timestamp);
-    
-    std::hash<std::string> hasher;
-    std::string token_hash = std::to_string(hasher(token_data + "secret_key"));
-    
-    // Base64-like encoding (simplified)
-    std::string token = token_data + ":" + token_hash;
-    return token;
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    return tokens_.encode({user.user_id, now});
 }
 
 std::optional<UserAuth> AuthService::validateToken(const std::string& token) {
-    std::vector<std::string> parts;
-    std::stringstream ss(token);
-    std::string item;
-    
-    while (std::getline(ss, item, ':')) {
-        parts.push_back(item);
-    }
+    bool needs_lookup = false;
+    auto user = checkToken(token, needs_lookup);
+    return needs_lookup ? loadSession(token) : user;
+}
+
+// A validation that finishes here is counted here; one that needs the user
+// looked up is counted by loadSession
+std::optional<UserAuth> AuthService::checkToken(const std::string& token, bool& needs_lookup) {
+    auto start = std::chrono::steady_clock::now();
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
     
-    if (parts.size() != 4) {
+    needs_lookup = false;
+    auto user = sessions_.find(token, now);
+    TokenClaims claims;
+    if (!user && tokens_.decode(token, claims) && now <= claims.issued_at + kTokenLifetimeSeconds) {
+        needs_lookup = true;
         return std::nullopt;
     }
+    recordValidation(start);
+    return user;
+}
+
+std::optional<UserAuth> AuthService::loadSession(const std::string& token) {
+    auto start = std::chrono::steady_clock::now();
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
     
-    try {
-        int user_id = std::stoi(parts[0]);
-        std::string username = parts[1];
-        long timestamp = std::stol(parts[2]);
-        std::string provided_hash = parts[3];
-        
-        // Check if token is expired (24 hours)
-        auto now = std::chrono::system_clock::now();
-        auto current_timestamp = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
-        
-        if (current_timestamp - timestamp > 86400) { // 24 hours
-            return std::nullopt;
-        }
-        
-        // Verify hash
-        std::string token_data = parts[0] + ":" + parts[1] + ":" + parts[2];
-        std::hash<std::string> hasher;
-        std::string expected_hash = std::to_string(hasher(token_data + "secret_key"));
-        
-        if (provided_hash != expected_hash) {
-            return std::nullopt;
-        }
-        
-        // Get user info
-        auto user = db_->getUserById(user_id);
-        if (!user) {
-            return std::nullopt;
+    std::optional<UserAuth> user_auth;
+    TokenClaims claims;
+    if (tokens_.decode(token, claims) && now <= claims.issued_at + kTokenLifetimeSeconds) {
+        uint64_t generation = sessions_.generation(claims.user_id);
+        if (auto user = db_->getUserById(claims.user_id)) {
+            user_auth = UserAuth{user->id, user->username, user->email};
+            sessions_.insert(token, *user_auth, claims.issued_at + kTokenLifetimeSeconds, now, generation);
         }
-        
-        return UserAuth{user_id, username, user->email};
-        
-    } catch (const std::exception& e) {
-        return std::nullopt;
     }
+    recordValidation(start);
+    return user_auth;
+}
+
+void AuthService::recordValidation(std::chrono::steady_clock::time_point start) {
+    validate_latency_.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count()));
 }
 
-std::optional<User> AuthService::registerUser(const std::string& username, const std::string& email, const std::string& password) {
+std::optional<User> AuthService::registerUser(const std::string& username, const std::string& email, const std::string& password,
+                                              bool* busy) {
     if (username.empty() || email.empty() || password.empty()) {
         return std::nullopt;
     }
@@ -116,23 +143,70 @@ std::optional<User> AuthService::registerUser(const std::string& username, const
         return std::nullopt;
     }
     
-    std::string password_hash = hashPassword(password);
+    auto hashed = hashers_.submit([this, &password] { return hashPassword(password); });
+    if (!hashed.valid()) {
+        if (busy) *busy = true;
+        return std::nullopt;
+    }
+    std::string password_hash = hashed.get();
+    if (password_hash.empty()) {
+        logError("Failed to hash password");
+        return std::nullopt;
+    }
     return db_->createUser(username, email, password_hash);
 }
 
-std::optional<UserAuth> AuthService::loginUser(const std::string& username, const std::string& password) {
+std::optional<UserAuth> AuthService::loginUser(const std::string& username, const std::string& password, bool* busy) {
     auto user = db_->getUserByUsername(username);
     if (!user) {
+        // Same pool, same wait and same cost as a wrong password
+        auto verified = hashers_.submit([this, &password] { verifyDummy(password); });
+        if (!verified.valid()) {
+            if (busy) *busy = true;
+            return std::nullopt;
+        }
+        verified.get();
         return std::nullopt;
     }
     
-    if (!verifyPassword(password, user->password_hash)) {
+    // The upgrade is hashed in the same job: the plain password is only
+    // around now, and the user has already paid for one hash
+    struct Verified {
+        bool ok;
+        std::string upgraded_hash;
+    };
+    auto verified = hashers_.submit([this, &password, &user] {
+        Verified result{verifyPassword(password, user->password_hash), ""};
+        if (result.ok && !passwordHashMatches(user->password_hash, options_.password_hash)) {
+            result.upgraded_hash = hashPassword(password);
+        }
+        return result;
+    });
+    if (!verified.valid()) {
+        if (busy) *busy = true;
+        return std::nullopt;
+    }
+    Verified result = verified.get();
+    if (!result.ok) {
         return std::nullopt;
     }
     
+    if (!result.upgraded_hash.empty() && db_->updatePasswordHash(user->id, result.upgraded_hash)) {
+        rehashed_++;
+        invalidateUser(user->id);
+    }
     return UserAuth{user->id, user->username, user->email};
 }
 
 std::optional<User> AuthService::getUserById(int user_id) {
     return db_->getUserById(user_id);
+}
+
+void AuthService::invalidateUser(int user_id) {
+    sessions_.invalidateUser(user_id);
+}
+
+AuthStats AuthService::stats() const {
+    return {sessions_.stats(), validate_latency_.count(), validate_latency_.percentile(0.5),
+            validate_latency_.percentile(0.99), hashers_.stats(), rehashed_.load(), db_->userFilterStats()};
 }
\ No newline at end of file
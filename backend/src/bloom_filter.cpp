@@ -0,0 +1,61 @@
+#include "bloom_filter.h"
+#include <functional>
+
+namespace {
+
+// splitmix64 finalizer: spreads std::hash output, which for strings is good
+// but not guaranteed to use all 64 bits evenly
+uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+} // namespace
+
+BloomFilter::BloomFilter(size_t expected_keys, size_t bits_per_key)
+    : capacity_(expected_keys == 0 ? 1 : expected_keys) {
+    size_t bits = capacity_ * bits_per_key;
+    blocks_ = (bits + kBlockBytes * 8 - 1) / (kBlockBytes * 8);
+    words_ = std::make_unique<std::atomic<uint64_t>[]>(blocks_ * kWordsPerBlock);
+    for (size_t i = 0; i < blocks_ * kWordsPerBlock; ++i) {
+        words_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void BloomFilter::locate(std::string_view key, size_t& block, uint16_t bits[kHashes]) const {
+    uint64_t h1 = mix(std::hash<std::string_view>()(key));
+    uint64_t h2 = mix(h1);
+    // Multiply-shift maps the top 32 bits onto [0, blocks_) without a division
+    block = static_cast<size_t>(((h1 >> 32) * blocks_) >> 32);
+    for (int i = 0; i < kHashes; ++i) {
+        bits[i] = static_cast<uint16_t>((h2 >> (9 * i)) & 511);
+    }
+}
+
+void BloomFilter::insert(std::string_view key) {
+    size_t block;
+    uint16_t bits[kHashes];
+    locate(key, block, bits);
+    std::atomic<uint64_t>* words = &words_[block * kWordsPerBlock];
+    for (uint16_t bit : bits) {
+        words[bit / 64].fetch_or(uint64_t(1) << (bit % 64), std::memory_order_relaxed);
+    }
+    keys_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool BloomFilter::mightContain(std::string_view key) const {
+    size_t block;
+    uint16_t bits[kHashes];
+    locate(key, block, bits);
+    const std::atomic<uint64_t>* words = &words_[block * kWordsPerBlock];
+    for (uint16_t bit : bits) {
+        if (!(words[bit / 64].load(std::memory_order_relaxed) & (uint64_t(1) << (bit % 64)))) {
+            return false;
+        }
+    }
+    return true;
+}
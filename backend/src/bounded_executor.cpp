@@ -0,0 +1,59 @@
+#include "bounded_executor.h"
+#include "logger.h"
+
+BoundedExecutor::BoundedExecutor(const BoundedExecutorOptions& options) : options_(options) {
+    if (options_.threads == 0) {
+        logWarning("Executor configured without threads, using 1");
+        options_.threads = 1;
+    }
+    for (size_t i = 0; i < options_.threads; ++i) {
+        threads_.emplace_back(&BoundedExecutor::run, this);
+    }
+}
+
+BoundedExecutor::~BoundedExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+BoundedExecutorStats BoundedExecutor::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {threads_.size(), jobs_.size(), running_, options_.max_queued, completed_, rejected_};
+}
+
+bool BoundedExecutor::enqueue(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || jobs_.size() >= options_.max_queued) {
+            rejected_++;
+            return false;
+        }
+        jobs_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void BoundedExecutor::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+        if (jobs_.empty()) {
+            return;
+        }
+        std::function<void()> job = std::move(jobs_.front());
+        jobs_.pop_front();
+        running_++;
+        lock.unlock();
+        job();
+        lock.lock();
+        running_--;
+        completed_++;
+    }
+}
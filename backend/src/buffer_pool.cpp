@@ -0,0 +1,130 @@
+#include "buffer_pool.h"
+#include "logger.h"
+#include <algorithm>
+#include <new>
+
+BufferPool::Buffer::Buffer(Buffer&& other) noexcept
+    : pool_(other.pool_), data_(other.data_), capacity_(other.capacity_), size_class_(other.size_class_) {
+    other.pool_ = nullptr;
+    other.data_ = nullptr;
+    other.capacity_ = 0;
+}
+
+BufferPool::Buffer& BufferPool::Buffer::operator=(Buffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = other.pool_;
+        data_ = other.data_;
+        capacity_ = other.capacity_;
+        size_class_ = other.size_class_;
+        other.pool_ = nullptr;
+        other.data_ = nullptr;
+        other.capacity_ = 0;
+    }
+    return *this;
+}
+
+BufferPool::Buffer::~Buffer() {
+    release();
+}
+
+void BufferPool::Buffer::release() {
+    if (data_) {
+        pool_->release(data_, size_class_);
+        pool_ = nullptr;
+        data_ = nullptr;
+        capacity_ = 0;
+    }
+}
+
+BufferPool::BufferPool(const BufferPoolOptions& options) : max_bytes_(options.max_bytes) {
+    std::vector<size_t> sizes = options.size_classes;
+    std::sort(sizes.begin(), sizes.end());
+    sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+    sizes.erase(std::remove(sizes.begin(), sizes.end(), size_t(0)), sizes.end());
+    if (sizes.empty()) {
+        logWarning("Buffer pool configured without size classes, using 4096");
+        sizes.push_back(4096);
+    }
+    for (size_t size : sizes) {
+        SizeClass size_class;
+        size_class.size = size;
+        classes_.push_back(size_class);
+    }
+}
+
+BufferPool::~BufferPool() {
+    // Handles must not outlive the pool; only cached buffers are freed here
+    for (SizeClass& size_class : classes_) {
+        for (char* data : size_class.cached) {
+            ::operator delete(data);
+        }
+    }
+}
+
+BufferPool::Buffer BufferPool::acquire(size_t size) {
+    auto it = std::lower_bound(classes_.begin(), classes_.end(), size,
+                               [](const SizeClass& size_class, size_t key) { return size_class.size < key; });
+    if (it == classes_.end()) {
+        return Buffer();
+    }
+    size_t index = static_cast<size_t>(it - classes_.begin());
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    SizeClass& size_class = classes_[index];
+    char* data = nullptr;
+    if (!size_class.cached.empty()) {
+        data = size_class.cached.back();
+        size_class.cached.pop_back();
+        bytes_cached_ -= size_class.size;
+    } else {
+        if (!makeRoomLocked(size_class.size)) {
+            exhausted_++;
+            return Buffer();
+        }
+        data = static_cast<char*>(::operator new(size_class.size, std::nothrow));
+        if (!data) {
+            exhausted_++;
+            return Buffer();
+        }
+    }
+    size_class.in_use++;
+    bytes_in_use_ += size_class.size;
+    acquired_++;
+    return Buffer(this, data, size_class.size, index);
+}
+
+void BufferPool::release(char* data, size_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SizeClass& size_class = classes_[index];
+    size_class.in_use--;
+    bytes_in_use_ -= size_class.size;
+    size_class.cached.push_back(data);
+    bytes_cached_ += size_class.size;
+}
+
+bool BufferPool::makeRoomLocked(size_t needed) {
+    // Largest classes first, so the fewest buffers are given up
+    for (auto it = classes_.rbegin(); it != classes_.rend(); ++it) {
+        while (bytes_in_use_ + bytes_cached_ + needed > max_bytes_ && !it->cached.empty()) {
+            ::operator delete(it->cached.back());
+            it->cached.pop_back();
+            bytes_cached_ -= it->size;
+        }
+    }
+    return bytes_in_use_ + bytes_cached_ + needed <= max_bytes_;
+}
+
+BufferPoolStats BufferPool::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    BufferPoolStats stats;
+    for (const SizeClass& size_class : classes_) {
+        stats.classes.push_back({size_class.size, size_class.in_use, size_class.cached.size()});
+    }
+    stats.bytes_in_use = bytes_in_use_;
+    stats.bytes_cached = bytes_cached_;
+    stats.max_bytes = max_bytes_;
+    stats.acquired = acquired_;
+    stats.exhausted = exhausted_;
+    return stats;
+}
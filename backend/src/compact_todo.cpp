@@ -0,0 +1,263 @@
+#include "compact_todo.h"
+#include <algorithm>
+
+namespace {
+
+constexpr int64_t kMicrosPerDay = 86400LL * 1000000LL;
+
+// Days since 1970-01-01 in the proleptic Gregorian calendar.
+int64_t daysFromCivil(int64_t y, int64_t m, int64_t d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+void civilFromDays(int64_t z, int64_t& y, int64_t& m, int64_t& d) {
+    z += 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int64_t doe = z - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = yoe + era * 400 + (m <= 2);
+}
+
+bool readDigits(std::string_view text, size_t pos, size_t count, int64_t& value) {
+    value = 0;
+    for (size_t i = pos; i < pos + count; ++i) {
+        if (text[i] < '0' || text[i] > '9') return false;
+        value = value * 10 + (text[i] - '0');
+    }
+    return true;
+}
+
+void writeDigits(char* out, int64_t value, int count) {
+    for (int i = count - 1; i >= 0; --i) {
+        out[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+}
+
+} // namespace
+
+CompactTodoList::CompactTodoList(int user_id, std::pmr::memory_resource* resource)
+    : user_id_(user_id), entries_(resource), pool_(resource), erased_(0), garbage_(0) {}
+
+void CompactTodoList::reserve(size_t todos, size_t pool_bytes) {
+    entries_.reserve(todos);
+    pool_.reserve(pool_bytes);
+}
+
+void CompactTodoList::clear() {
+    entries_.clear();
+    pool_.clear();
+    erased_ = 0;
+    garbage_ = 0;
+}
+
+bool CompactTodoList::parseTimestamp(std::string_view text, int64_t& micros) {
+    // YYYY-MM-DD HH:MM:SS.ffffff
+    if (text.size() != 26 || text[4] != '-' || text[7] != '-' || text[10] != ' ' ||
+        text[13] != ':' || text[16] != ':' || text[19] != '.') {
+        return false;
+    }
+    int64_t year, month, day, hour, minute, second, fraction;
+    if (!readDigits(text, 0, 4, year) || !readDigits(text, 5, 2, month) || !readDigits(text, 8, 2, day) ||
+        !readDigits(text, 11, 2, hour) || !readDigits(text, 14, 2, minute) || !readDigits(text, 17, 2, second) ||
+        !readDigits(text, 20, 6, fraction)) {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 59) {
+        return false;
+    }
+    micros = daysFromCivil(year, month, day) * kMicrosPerDay +
+             ((hour * 60 + minute) * 60 + second) * 1000000LL + fraction;
+    
+    // Rejects dates like 2025-02-30 that would come back as another day
+    char buffer[kTimestampBufferSize];
+    return formatTimestamp(micros, buffer) == text;
+}
+
+std::string_view CompactTodoList::formatTimestamp(int64_t micros, char (&buffer)[kTimestampBufferSize]) {
+    int64_t days = micros / kMicrosPerDay;
+    int64_t rest = micros % kMicrosPerDay;
+    if (rest < 0) {
+        days -= 1;
+        rest += kMicrosPerDay;
+    }
+    int64_t year, month, day;
+    civilFromDays(days, year, month, day);
+    int64_t seconds = rest / 1000000;
+    
+    writeDigits(buffer, year, 4);
+    buffer[4] = '-';
+    writeDigits(buffer + 5, month, 2);
+    buffer[7] = '-';
+    writeDigits(buffer + 8, day, 2);
+    buffer[10] = ' ';
+    writeDigits(buffer + 11, seconds / 3600, 2);
+    buffer[13] = ':';
+    writeDigits(buffer + 14, seconds / 60 % 60, 2);
+    buffer[16] = ':';
+    writeDigits(buffer + 17, seconds % 60, 2);
+    buffer[19] = '.';
+    writeDigits(buffer + 20, rest % 1000000, 6);
+    return std::string_view(buffer, 26);
+}
+
+CompactTodo CompactTodoList::encode(int id, std::string_view text, bool completed, std::string_view created_at,
+                                    std::string_view updated_at, std::string_view due_date) {
+    CompactTodo todo;
+    todo.id = id;
+    todo.pool_offset = static_cast<uint32_t>(pool_.size());
+    todo.text_length = static_cast<uint32_t>(text.size());
+    todo.due_date_length = static_cast<uint32_t>(due_date.size());
+    todo.flags = completed ? CompactTodo::kCompleted : 0;
+    
+    pool_.append(text);
+    pool_.append(due_date);
+    if (!parseTimestamp(created_at, todo.created_at)) {
+        todo.flags |= CompactTodo::kRawCreatedAt;
+        todo.created_at = static_cast<int64_t>(created_at.size());
+        pool_.append(created_at);
+    }
+    if (!parseTimestamp(updated_at, todo.updated_at)) {
+        todo.flags |= CompactTodo::kRawUpdatedAt;
+        todo.updated_at = static_cast<int64_t>(updated_at.size());
+        pool_.append(updated_at);
+    }
+    return todo;
+}
+
+size_t CompactTodoList::stringBytes(const CompactTodo& todo) const {
+    size_t bytes = todo.text_length + todo.due_date_length;
+    if (todo.flags & CompactTodo::kRawCreatedAt) bytes += static_cast<size_t>(todo.created_at);
+    if (todo.flags & CompactTodo::kRawUpdatedAt) bytes += static_cast<size_t>(todo.updated_at);
+    return bytes;
+}
+
+void CompactTodoList::append(int id, std::string_view text, bool completed, std::string_view created_at,
+                             std::string_view updated_at, std::string_view due_date) {
+    entries_.push_back(encode(id, text, completed, created_at, updated_at, due_date));
+}
+
+void CompactTodoList::append(const Todo& todo) {
+    append(todo.id, todo.text, todo.completed, todo.created_at, todo.updated_at, todo.due_date);
+}
+
+void CompactTodoList::append(const CompactTodoList& other, const CompactTodo& todo) {
+    CompactTodo copy = todo;
+    copy.pool_offset = static_cast<uint32_t>(pool_.size());
+    copy.flags &= ~CompactTodo::kErased;
+    pool_.append(other.pool_, todo.pool_offset, other.stringBytes(todo));
+    entries_.push_back(copy);
+}
+
+CompactTodo* CompactTodoList::findSlot(int id) {
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), id,
+                               [](const CompactTodo& todo, int key) { return todo.id < key; });
+    return it != entries_.end() && it->id == id ? &*it : nullptr;
+}
+
+const CompactTodo* CompactTodoList::find(int id) const {
+    const CompactTodo* todo = const_cast<CompactTodoList*>(this)->findSlot(id);
+    return todo && !todo->erased() ? todo : nullptr;
+}
+
+void CompactTodoList::put(const Todo& todo) {
+    if (CompactTodo* slot = findSlot(todo.id)) {
+        if (slot->erased()) {
+            erased_--;
+        } else {
+            garbage_ += stringBytes(*slot);
+        }
+        *slot = encode(todo.id, todo.text, todo.completed, todo.created_at, todo.updated_at, todo.due_date);
+    } else if (entries_.empty() || entries_.back().id < todo.id) {
+        append(todo);
+    } else {
+        // Only replay re-inserts an older id
+        auto it = std::lower_bound(entries_.begin(), entries_.end(), todo.id,
+                                   [](const CompactTodo& entry, int key) { return entry.id < key; });
+        entries_.insert(it, encode(todo.id, todo.text, todo.completed, todo.created_at, todo.updated_at, todo.due_date));
+    }
+    
+    if (garbage_ > 4096 && garbage_ * 2 > pool_.size()) {
+        compact();
+    }
+}
+
+bool CompactTodoList::erase(int id) {
+    CompactTodo* slot = findSlot(id);
+    if (!slot || slot->erased()) {
+        return false;
+    }
+    slot->flags |= CompactTodo::kErased;
+    erased_++;
+    garbage_ += stringBytes(*slot);
+    
+    if ((erased_ > 32 && erased_ * 2 > entries_.size()) || (garbage_ > 4096 && garbage_ * 2 > pool_.size())) {
+        compact();
+    }
+    return true;
+}
+
+void CompactTodoList::compact() {
+    CompactTodoList packed(user_id_, entries_.get_allocator().resource());
+    packed.reserve(size(), pool_.size() - garbage_);
+    for (const CompactTodo& todo : entries_) {
+        if (!todo.erased()) {
+            packed.append(*this, todo);
+        }
+    }
+    entries_.swap(packed.entries_);
+    pool_.swap(packed.pool_);
+    erased_ = 0;
+    garbage_ = 0;
+}
+
+std::string_view CompactTodoList::text(const CompactTodo& todo) const {
+    return std::string_view(pool_.data() + todo.pool_offset, todo.text_length);
+}
+
+std::string_view CompactTodoList::dueDate(const CompactTodo& todo) const {
+    return std::string_view(pool_.data() + todo.pool_offset + todo.text_length, todo.due_date_length);
+}
+
+std::string_view CompactTodoList::timestamp(const CompactTodo& todo, bool created,
+                                            char (&buffer)[kTimestampBufferSize]) const {
+    uint32_t raw_flag = created ? CompactTodo::kRawCreatedAt : CompactTodo::kRawUpdatedAt;
+    int64_t value = created ? todo.created_at : todo.updated_at;
+    if (!(todo.flags & raw_flag)) {
+        return formatTimestamp(value, buffer);
+    }
+    size_t offset = todo.pool_offset + todo.text_length + todo.due_date_length;
+    if (!created && (todo.flags & CompactTodo::kRawCreatedAt)) {
+        offset += static_cast<size_t>(todo.created_at);
+    }
+    return std::string_view(pool_.data() + offset, static_cast<size_t>(value));
+}
+
+std::string_view CompactTodoList::createdAt(const CompactTodo& todo, char (&buffer)[kTimestampBufferSize]) const {
+    return timestamp(todo, true, buffer);
+}
+
+std::string_view CompactTodoList::updatedAt(const CompactTodo& todo, char (&buffer)[kTimestampBufferSize]) const {
+    return timestamp(todo, false, buffer);
+}
+
+Todo CompactTodoList::toTodo(const CompactTodo& todo) const {
+    char created[kTimestampBufferSize];
+    char updated[kTimestampBufferSize];
+    return Todo{todo.id, user_id_, std::string(text(todo)), todo.completed(),
+                std::string(createdAt(todo, created)), std::string(updatedAt(todo, updated)),
+                std::string(dueDate(todo))};
+}
+
+size_t CompactTodoList::memoryUsage() const {
+    return entries_.capacity() * sizeof(CompactTodo) + pool_.capacity();
+}
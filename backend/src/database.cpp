@@ -1,24 +1,163 @@
 #include "database.h"
-#include <iostream>
+#include "log_store.h"
+#include "compact_todo.h"
+#include "bloom_filter.h"
+#include "logger.h"
 #include <sstream>
 #include <chrono>
 #include <iomanip>
+#include <ctime>
+#include <mutex>
+#include <atomic>
+#include <map>
+#include <set>
+#include <filesystem>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
 
-Database::Database(const std::string& db_path) : db_(nullptr), db_path_(db_path) {}
-
-Database::~Database() {
-    if (db_) {
-        sqlite3_close(db_);
+struct Database::Connection {
+    sqlite3* handle = nullptr;
+    std::mutex mutex;
+    
+    ~Connection() {
+        if (handle) {
+            sqlite3_close(handle);
+        }
     }
-}
+};
 
-bool Database::initialize() {
-    int rc = sqlite3_open(db_path_.c_str(), &db_);
+struct Database::Shard {
+    std::string path;
+    Connection writer;
+    std::vector<std::unique_ptr<Connection>> readers;
+    std::atomic<size_t> next_reader{0};
+    // Todo ids leased from the directory (sharded layout only), guarded by writer.mutex
+    int next_todo_id = 0;
+    int todo_id_limit = 0;
+};
+
+namespace {
+
+// Ids are leased from the directory in blocks so todo ids stay unique across
+// shards (and survive resharding) without a directory write per insert.
+const int kTodoIdBlock = 1024;
+
+// Small integer settings and counters. The directory records the layout
+// here; every file holding todos keeps its change sequence here.
+const char* kCreateMetaTable = R"(
+    CREATE TABLE IF NOT EXISTS meta (
+        key TEXT PRIMARY KEY,
+        value INTEGER NOT NULL
+    );
+)";
+
+bool execSql(sqlite3* db, const char* sql, const char* what) {
+    char* err_msg = nullptr;
+    int rc = sqlite3_exec(db, sql, nullptr, nullptr, &err_msg);
     if (rc != SQLITE_OK) {
-        std::cerr << "Cannot open database: " << sqlite3_errmsg(db_) << std::endl;
+        logError("SQL error", {{"while", what}, {"error", err_msg ? err_msg : sqlite3_errmsg(db)}});
+        sqlite3_free(err_msg);
         return false;
     }
+    return true;
+}
+
+// Per-query statistics for todoRank, computed on the first scored row.
+struct SearchRankStats {
+    double average_length = 1.0;
+    std::vector<double> idf;
+};
+
+int countPhraseRows(const Fts5ExtensionApi*, Fts5Context*, void* rows) {
+    ++*static_cast<sqlite3_int64*>(rows);
+    return SQLITE_OK;
+}
+
+// bm25 over the text column, skipping the leading owner phrase. The builtin
+// bm25() computes an IDF for every phrase, and for the owner token that means
+// walking all of the user's postings on each query, which dominated latency
+// for users with many todos. Called as todo_rank(todos_fts, first_phrase).
+void todoRank(const Fts5ExtensionApi* api, Fts5Context* fts, sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    const double k1 = 1.2;
+    const double b = 0.75;
+    int first_phrase = argc > 0 ? sqlite3_value_int(argv[0]) : 0;
+    int phrase_count = api->xPhraseCount(fts);
+    
+    auto* stats = static_cast<SearchRankStats*>(api->xGetAuxdata(fts, 0));
+    if (!stats) {
+        stats = new SearchRankStats;
+        sqlite3_int64 rows = 0;
+        sqlite3_int64 tokens = 0;
+        api->xRowCount(fts, &rows);
+        api->xColumnTotalSize(fts, 0, &tokens);
+        if (rows > 0 && tokens > 0) {
+            stats->average_length = static_cast<double>(tokens) / rows;
+        }
+        stats->idf.assign(phrase_count, 0.0);
+        for (int i = first_phrase; i < phrase_count; ++i) {
+            sqlite3_int64 hits = 0;
+            api->xQueryPhrase(fts, i, &hits, countPhraseRows);
+            double idf = std::log((rows - hits + 0.5) / (hits + 0.5));
+            stats->idf[i] = idf > 1e-6 ? idf : 1e-6;
+        }
+        int rc = api->xSetAuxdata(fts, stats, [](void* p) { delete static_cast<SearchRankStats*>(p); });
+        if (rc != SQLITE_OK) {
+            sqlite3_result_error_code(ctx, rc);
+            return;
+        }
+    }
     
+    std::vector<int> frequency(phrase_count, 0);
+    int instances = 0;
+    api->xInstCount(fts, &instances);
+    for (int i = 0; i < instances; ++i) {
+        int phrase, column, offset;
+        if (api->xInst(fts, i, &phrase, &column, &offset) == SQLITE_OK && column == 0) {
+            ++frequency[phrase];
+        }
+    }
+    int length = 0;
+    api->xColumnSize(fts, 0, &length);
+    
+    double score = 0.0;
+    for (int i = first_phrase; i < phrase_count; ++i) {
+        double tf = frequency[i];
+        score += stats->idf[i] * tf * (k1 + 1) / (tf + k1 * (1 - b + b * length / stats->average_length));
+    }
+    // Negated like bm25(), so ascending order puts the best match first
+    sqlite3_result_double(ctx, -score);
+}
+
+void registerSearchRanking(sqlite3* db) {
+    fts5_api* api = nullptr;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT fts5(?1)", -1, &stmt, nullptr) != SQLITE_OK) {
+        return;
+    }
+    sqlite3_bind_pointer(stmt, 1, &api, "fts5_api_ptr", nullptr);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (api) {
+        api->xCreateFunction(api, "todo_rank", nullptr, todoRank, nullptr);
+    }
+}
+
+sqlite3* openConnection(const std::string& path, bool read_only) {
+    sqlite3* db = nullptr;
+    int flags = SQLITE_OPEN_NOMUTEX | (read_only ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    int rc = sqlite3_open_v2(path.c_str(), &db, flags, nullptr);
+    if (rc != SQLITE_OK) {
+        logError("Cannot open database", {{"error", sqlite3_errmsg(db)}});
+        sqlite3_close(db);
+        return nullptr;
+    }
+    sqlite3_busy_timeout(db, 5000);
+    registerSearchRanking(db);
+    return db;
+}
+
+bool createDirectorySchema(sqlite3* db) {
     // Create users table
     const char* create_users_table = R"(
         CREATE TABLE IF NOT EXISTS users (
@@ -30,17 +169,172 @@ bool Database::initialize() {
             updated_at TEXT NOT NULL
         );
     )";
+    if (!execSql(db, create_users_table, "creating users table")) {
+        return false;
+    }
     
-    char* err_msg = nullptr;
-    rc = sqlite3_exec(db_, create_users_table, nullptr, nullptr, &err_msg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "SQL error creating users table: " << err_msg << std::endl;
-        sqlite3_free(err_msg);
+    // Layout metadata (shard count, next leased todo id)
+    return execSql(db, kCreateMetaTable, "creating meta table");
+}
+
+bool tableExists(sqlite3* db, const char* name) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE name = ?", -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+    bool exists = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return exists;
+}
+
+// Full-text index over todos.text. The FTS table is external-content (it
+// stores only the index, reading text back from todos) and carries an
+// "owner" column holding a per-user token, so a search intersects the
+// query's postings with the user's instead of filtering every match. Prefix
+// indexes on 2 and 3 characters keep short search-as-you-type queries cheap.
+bool createSearchSchema(sqlite3* db) {
+    bool existed = tableExists(db, "todos_fts");
+    
+    const char* create_search_schema = R"(
+        CREATE VIEW IF NOT EXISTS todos_fts_source AS
+            SELECT id, text, 'u' || user_id AS owner FROM todos;
+        CREATE VIRTUAL TABLE IF NOT EXISTS todos_fts USING fts5(
+            text, owner, content='todos_fts_source', content_rowid='id', prefix='2 3'
+        );
+        CREATE TRIGGER IF NOT EXISTS todos_fts_insert AFTER INSERT ON todos BEGIN
+            INSERT INTO todos_fts(rowid, text, owner) VALUES (new.id, new.text, 'u' || new.user_id);
+        END;
+        CREATE TRIGGER IF NOT EXISTS todos_fts_delete AFTER DELETE ON todos BEGIN
+            INSERT INTO todos_fts(todos_fts, rowid, text, owner) VALUES ('delete', old.id, old.text, 'u' || old.user_id);
+        END;
+        CREATE TRIGGER IF NOT EXISTS todos_fts_update AFTER UPDATE OF text, user_id ON todos BEGIN
+            INSERT INTO todos_fts(todos_fts, rowid, text, owner) VALUES ('delete', old.id, old.text, 'u' || old.user_id);
+            INSERT INTO todos_fts(rowid, text, owner) VALUES (new.id, new.text, 'u' || new.user_id);
+        END;
+    )";
+    if (!execSql(db, create_search_schema, "creating search index")) {
+        return false;
+    }
+    if (existed) {
+        return true;
+    }
+    
+    // Index any todos written before search existed
+    return execSql(db, "INSERT INTO todos_fts(todos_fts) VALUES ('rebuild');", "building search index");
+}
+
+// Turns free text into an FTS5 expression scoped to one user: every word
+// must match (the last one as a prefix, for search-as-you-type), and words
+// are quoted so FTS5 operators in user input are taken literally.
+std::string buildSearchExpression(int user_id, const std::string& query) {
+    std::vector<std::string> terms;
+    std::string term;
+    for (char c : query) {
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            if (!term.empty()) terms.push_back(term);
+            term.clear();
+        } else if (c == '"') {
+            term += "\"\"";
+        } else {
+            term += c;
+        }
+    }
+    if (!term.empty()) terms.push_back(term);
+    
+    if (terms.empty()) {
+        return "";
+    }
+    
+    std::string expression = "owner : \"u" + std::to_string(user_id) + "\" AND text : (";
+    for (size_t i = 0; i < terms.size(); ++i) {
+        if (i > 0) expression += " AND ";
+        expression += "\"" + terms[i] + "\"";
+        if (i + 1 == terms.size()) expression += "*";
+    }
+    expression += ")";
+    return expression;
+}
+
+bool columnExists(sqlite3* db, const char* table, const char* column) {
+    sqlite3_stmt* stmt;
+    std::string sql = std::string("SELECT 1 FROM pragma_table_info('") + table + "') WHERE name = ?";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
         return false;
     }
+    sqlite3_bind_text(stmt, 1, column, -1, SQLITE_STATIC);
+    bool exists = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return exists;
+}
+
+// Change tracking for delta sync. Every insert or update stamps the row with
+// the next value of the file's change_seq counter, and every delete leaves a
+// tombstone carrying its own sequence number, so "what changed since N" is a
+// range scan over (user_id, seq) on both tables. Doing this in triggers keeps
+// it in the same transaction as the write, including rows moved by reshard.
+bool createChangeSchema(sqlite3* db) {
+    if (!execSql(db, kCreateMetaTable, "creating meta table")) {
+        return false;
+    }
+    
+    // Databases from before delta sync: number existing rows once
+    if (!columnExists(db, "todos", "seq")) {
+        const char* migrate = R"(
+            ALTER TABLE todos ADD COLUMN seq INTEGER NOT NULL DEFAULT 0;
+            UPDATE todos SET seq = id;
+            INSERT OR REPLACE INTO meta (key, value) VALUES ('change_seq', (SELECT COALESCE(MAX(seq), 0) FROM todos));
+        )";
+        if (!execSql(db, migrate, "adding change sequence")) {
+            return false;
+        }
+    }
     
-    // Create todos table with user_id foreign key
-    const char* create_todos_table = R"(
+    const char* create_change_schema = R"(
+        CREATE TABLE IF NOT EXISTS todo_tombstones (
+            id INTEGER PRIMARY KEY,
+            user_id INTEGER NOT NULL,
+            seq INTEGER NOT NULL,
+            deleted_at TEXT NOT NULL
+        );
+        CREATE INDEX IF NOT EXISTS idx_todos_user_seq ON todos(user_id, seq);
+        CREATE INDEX IF NOT EXISTS idx_tombstones_user_seq ON todo_tombstones(user_id, seq);
+        INSERT OR IGNORE INTO meta (key, value) VALUES ('change_seq', 0);
+        
+        CREATE TRIGGER IF NOT EXISTS todos_seq_insert AFTER INSERT ON todos BEGIN
+            UPDATE meta SET value = value + 1 WHERE key = 'change_seq';
+            UPDATE todos SET seq = (SELECT value FROM meta WHERE key = 'change_seq') WHERE id = new.id;
+            DELETE FROM todo_tombstones WHERE id = new.id;
+        END;
+        CREATE TRIGGER IF NOT EXISTS todos_seq_update AFTER UPDATE OF text, completed, due_date, updated_at, user_id ON todos BEGIN
+            UPDATE meta SET value = value + 1 WHERE key = 'change_seq';
+            UPDATE todos SET seq = (SELECT value FROM meta WHERE key = 'change_seq') WHERE id = new.id;
+        END;
+        CREATE TRIGGER IF NOT EXISTS todos_seq_delete AFTER DELETE ON todos BEGIN
+            UPDATE meta SET value = value + 1 WHERE key = 'change_seq';
+            INSERT OR REPLACE INTO todo_tombstones (id, user_id, seq, deleted_at)
+                VALUES (old.id, old.user_id, (SELECT value FROM meta WHERE key = 'change_seq'),
+                        strftime('%Y-%m-%d %H:%M:%f', 'now'));
+        END;
+    )";
+    return execSql(db, create_change_schema, "creating change tracking");
+}
+
+bool createTodoSchema(sqlite3* db, bool sharded) {
+    // Unsharded: todos live next to users with a user_id foreign key.
+    // Sharded: users are in another file and ids come from the directory.
+    const char* create_todos_table = sharded ? R"(
+        CREATE TABLE IF NOT EXISTS todos (
+            id INTEGER PRIMARY KEY,
+            user_id INTEGER NOT NULL,
+            text TEXT NOT NULL,
+            completed INTEGER DEFAULT 0,
+            created_at TEXT NOT NULL,
+            updated_at TEXT NOT NULL,
+            due_date TEXT,
+            seq INTEGER NOT NULL DEFAULT 0
+        );
+    )" : R"(
         CREATE TABLE IF NOT EXISTS todos (
             id INTEGER PRIMARY KEY AUTOINCREMENT,
             user_id INTEGER NOT NULL,
@@ -49,67 +343,505 @@ bool Database::initialize() {
             created_at TEXT NOT NULL,
             updated_at TEXT NOT NULL,
             due_date TEXT,
+            seq INTEGER NOT NULL DEFAULT 0,
             FOREIGN KEY (user_id) REFERENCES users(id) ON DELETE CASCADE
         );
     )";
+    if (!execSql(db, create_todos_table, "creating todos table")) {
+        return false;
+    }
     
-    rc = sqlite3_exec(db_, create_todos_table, nullptr, nullptr, &err_msg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "SQL error creating todos table: " << err_msg << std::endl;
-        sqlite3_free(err_msg);
+    if (!execSql(db, "CREATE INDEX IF NOT EXISTS idx_todos_user ON todos(user_id, created_at);",
+                 "creating todos index")) {
+        return false;
+    }
+    
+    // Overdue/upcoming lists and calendar counts only look at open todos, so
+    // a partial index keeps completed history out of those range scans. The
+    // trailing completed column lets older SQLite releases treat the index
+    // as covering for the calendar counts.
+    if (!execSql(db, "CREATE INDEX IF NOT EXISTS idx_todos_open_due ON todos(user_id, due_date, completed) WHERE completed = 0;",
+                 "creating due date index")) {
+        return false;
+    }
+    
+    return createChangeSchema(db) && createSearchSchema(db);
+}
+
+std::optional<int64_t> readMeta(sqlite3* db, const char* key) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT value FROM meta WHERE key = ?", -1, &stmt, nullptr) != SQLITE_OK) {
+        return std::nullopt;
+    }
+    sqlite3_bind_text(stmt, 1, key, -1, SQLITE_STATIC);
+    
+    std::optional<int64_t> value;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        value = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+bool writeMeta(sqlite3* db, const char* key, int64_t value) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO meta (key, value) VALUES (?, ?)", -1, &stmt, nullptr) != SQLITE_OK) {
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
         return false;
     }
+    sqlite3_bind_text(stmt, 1, key, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, value);
     
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE;
+}
+
+const char* kSelectUserTodosSql =
+    "SELECT id, user_id, text, completed, created_at, updated_at, due_date FROM todos WHERE user_id = ? ORDER BY created_at DESC, id DESC";
+
+Todo readTodoRow(sqlite3_stmt* stmt) {
+    Todo todo;
+    todo.id = sqlite3_column_int(stmt, 0);
+    todo.user_id = sqlite3_column_int(stmt, 1);
+    todo.text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+    todo.completed = sqlite3_column_int(stmt, 3) != 0;
+    todo.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
+    todo.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+    const char* due_date_text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
+    todo.due_date = due_date_text ? due_date_text : "";
+    return todo;
+}
+
+std::string_view columnView(sqlite3_stmt* stmt, int column) {
+    // Text first: sqlite3_column_bytes is only meaningful after the conversion
+    const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+    return text ? std::string_view(text, sqlite3_column_bytes(stmt, column)) : std::string_view();
+}
+
+void appendTodoRow(sqlite3_stmt* stmt, CompactTodoList& todos) {
+    todos.append(sqlite3_column_int(stmt, 0), columnView(stmt, 2), sqlite3_column_int(stmt, 3) != 0,
+                 columnView(stmt, 4), columnView(stmt, 5), columnView(stmt, 6));
+}
+
+User readUserRow(sqlite3_stmt* stmt) {
+    User user;
+    user.id = sqlite3_column_int(stmt, 0);
+    user.username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+    user.email = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+    user.password_hash = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+    user.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
+    user.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+    return user;
+}
+
+} // namespace
+
+Database::Database(const std::string& db_path) : db_path_(db_path), directory_(nullptr) {
+    options_.path = db_path;
+}
+
+Database::Database(const DatabaseOptions& options)
+    : db_path_(options.path), options_(options), directory_(nullptr) {}
+
+Database::~Database() = default;
+
+int Database::connectionCount() const {
+    int per_shard = options_.readers_per_shard + 1;
+    if (options_.engine == StorageEngine::Log || options_.shard_count <= 1) {
+        return per_shard;
+    }
+    return (options_.shard_count + 1) * per_shard;
+}
+
+int Database::shardOf(int user_id, int shard_count) {
+    if (shard_count <= 1) {
+        return 0;
+    }
+    // MurmurHash3 fmix64: cheap, well mixed, and fixed forever.
+    uint64_t x = static_cast<uint64_t>(static_cast<uint32_t>(user_id));
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return static_cast<int>(x % static_cast<uint64_t>(shard_count));
+}
+
+std::string Database::shardPath(const std::string& db_path, int shard, int shard_count) {
+    if (shard_count <= 1) {
+        return db_path;
+    }
+    std::string base = db_path;
+    if (base.size() > 3 && base.compare(base.size() - 3, 3, ".db") == 0) {
+        base.resize(base.size() - 3);
+    }
+    return base + ".shard-" + std::to_string(shard) + ".db";
+}
+
+bool Database::openShard(Shard& shard, bool is_directory, bool holds_todos) {
+    shard.writer.handle = openConnection(shard.path, false);
+    if (!shard.writer.handle) {
+        return false;
+    }
+    
+    // WAL lets the reader connections run alongside the shard's writer.
+    if (!execSql(shard.writer.handle, "PRAGMA journal_mode=WAL;", "enabling WAL")) {
+        return false;
+    }
+    if (is_directory && !createDirectorySchema(shard.writer.handle)) {
+        return false;
+    }
+    if (holds_todos && !createTodoSchema(shard.writer.handle, options_.shard_count > 1)) {
+        return false;
+    }
+    
+    for (int i = 0; i < options_.readers_per_shard; ++i) {
+        auto reader = std::make_unique<Connection>();
+        reader->handle = openConnection(shard.path, true);
+        if (!reader->handle) {
+            return false;
+        }
+        shard.readers.push_back(std::move(reader));
+    }
+    return true;
+}
+
+bool Database::checkLayout() {
+    sqlite3* db = directory_->writer.handle;
+    auto stored = readMeta(db, "shard_count");
+    if (!stored) {
+        if (!writeMeta(db, "shard_count", options_.shard_count)) {
+            logError("Failed to record shard layout", {{"error", sqlite3_errmsg(db)}});
+            return false;
+        }
+        return true;
+    }
+    
+    if (*stored != options_.shard_count) {
+        logError("Database has a different shard count; run todo_reshard to change it",
+                 {{"path", db_path_}, {"shards", *stored}, {"configured_shards", options_.shard_count}});
+        return false;
+    }
+    return true;
+}
+
+bool Database::initialize() {
+    if (options_.engine == StorageEngine::Log) {
+        log_ = std::make_unique<LogStore>(db_path_, options_.log_sync_batch,
+                                          options_.log_sync_interval, options_.log_snapshot_interval);
+        return log_->open();
+    }
+    
+    if (options_.shard_count < 1 || options_.shard_count > kMaxShards) {
+        logError("Invalid shard count", {{"shards", options_.shard_count}});
+        return false;
+    }
+    
+    if (options_.shard_count == 1) {
+        auto shard = std::make_unique<Shard>();
+        shard->path = db_path_;
+        if (!openShard(*shard, true, true)) {
+            return false;
+        }
+        directory_ = shard.get();
+        shards_.push_back(std::move(shard));
+        return checkLayout() && loadUserFilter();
+    }
+    
+    directory_storage_ = std::make_unique<Shard>();
+    directory_storage_->path = db_path_;
+    if (!openShard(*directory_storage_, true, false)) {
+        return false;
+    }
+    directory_ = directory_storage_.get();
+    if (!checkLayout()) {
+        return false;
+    }
+    
+    for (int i = 0; i < options_.shard_count; ++i) {
+        auto shard = std::make_unique<Shard>();
+        shard->path = shardPath(db_path_, i, options_.shard_count);
+        if (!openShard(*shard, false, true)) {
+            return false;
+        }
+        shards_.push_back(std::move(shard));
+    }
+    return loadUserFilter();
+}
+
+namespace {
+
+// Usernames and emails share the filter, told apart by a one-letter prefix
+std::string userFilterKey(char kind, std::string_view value) {
+    std::string key;
+    key.reserve(value.size() + 2);
+    key += kind;
+    key += ':';
+    key += value;
+    return key;
+}
+
+// A filter is built with room for twice the keys it starts with, so a
+// growing directory is rescanned only each time it doubles
+const size_t kMinUserFilterKeys = 4096;
+
+} // namespace
+
+std::unique_ptr<BloomFilter> Database::buildUserFilter(sqlite3* db) {
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM users", -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
+        return nullptr;
+    }
+    size_t users = sqlite3_step(stmt) == SQLITE_ROW ? static_cast<size_t>(sqlite3_column_int64(stmt, 0)) : 0;
+    sqlite3_finalize(stmt);
+    
+    auto filter = std::make_unique<BloomFilter>(std::max(kMinUserFilterKeys, users * 2 * 2));
+    rc = sqlite3_prepare_v2(db, "SELECT username, email FROM users", -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
+        return nullptr;
+    }
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        auto column = [stmt](int index) {
+            const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, index));
+            return std::string_view(text ? text : "", static_cast<size_t>(sqlite3_column_bytes(stmt, index)));
+        };
+        filter->insert(userFilterKey('u', column(0)));
+        filter->insert(userFilterKey('e', column(1)));
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        logError("Failed to scan users", {{"error", sqlite3_errmsg(db)}});
+        return nullptr;
+    }
+    return filter;
+}
+
+bool Database::loadUserFilter() {
+    if (!options_.user_filter) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(directory_->writer.mutex);
+    auto filter = buildUserFilter(directory_->writer.handle);
+    if (!filter) {
+        return false;
+    }
+    std::unique_lock<std::shared_mutex> filter_lock(user_filter_mutex_);
+    user_filter_ = std::move(filter);
     return true;
 }
 
+bool Database::userKeyMayExist(char kind, std::string_view value) const {
+    std::shared_lock<std::shared_mutex> lock(user_filter_mutex_);
+    return !user_filter_ || user_filter_->mightContain(userFilterKey(kind, value));
+}
+
+UserFilterStats Database::userFilterStats() const {
+    std::shared_lock<std::shared_mutex> lock(user_filter_mutex_);
+    UserFilterStats stats{user_filter_ != nullptr, 0, 0, 0, user_filter_lookups_.load(),
+                          user_filter_rejected_.load(), user_filter_false_positives_.load()};
+    if (user_filter_) {
+        stats.keys = user_filter_->size();
+        stats.capacity = user_filter_->capacity();
+        stats.bytes = user_filter_->memoryBytes();
+    }
+    return stats;
+}
+
+Database::Shard& Database::shardFor(int user_id) {
+    return *shards_[shardOf(user_id, options_.shard_count)];
+}
+
+// Takes the first idle reader, starting from a rotating index, so reads of a
+// shard only queue once every reader connection is busy.
+Database::Connection& Database::lockReader(Shard& shard, std::unique_lock<std::mutex>& lock) {
+    if (shard.readers.empty()) {
+        lock = std::unique_lock<std::mutex>(shard.writer.mutex);
+        return shard.writer;
+    }
+    size_t start = shard.next_reader.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = 0; i < shard.readers.size(); ++i) {
+        Connection& reader = *shard.readers[(start + i) % shard.readers.size()];
+        std::unique_lock<std::mutex> attempt(reader.mutex, std::try_to_lock);
+        if (attempt.owns_lock()) {
+            lock = std::move(attempt);
+            return reader;
+        }
+    }
+    Connection& reader = *shard.readers[start % shard.readers.size()];
+    lock = std::unique_lock<std::mutex>(reader.mutex);
+    return reader;
+}
+
+// Caller holds shard.writer.mutex. Lock order is always shard writer, then
+// directory writer.
+int Database::allocateTodoId(Shard& shard) {
+    if (shard.next_todo_id < shard.todo_id_limit) {
+        return shard.next_todo_id++;
+    }
+    
+    std::lock_guard<std::mutex> lock(directory_->writer.mutex);
+    sqlite3* db = directory_->writer.handle;
+    
+    sqlite3_stmt* stmt;
+    const char* sql = "INSERT INTO meta (key, value) VALUES ('next_todo_id', 1 + ?1) "
+                      "ON CONFLICT(key) DO UPDATE SET value = value + ?1 RETURNING value";
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
+        return -1;
+    }
+    sqlite3_bind_int(stmt, 1, kTodoIdBlock);
+    
+    int limit = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        limit = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    
+    if (limit < 0) {
+        logError("Failed to lease todo ids", {{"error", sqlite3_errmsg(db)}});
+        return -1;
+    }
+    shard.next_todo_id = limit - kTodoIdBlock;
+    shard.todo_id_limit = limit;
+    return shard.next_todo_id++;
+}
+
+void Database::flush() {
+    if (log_) {
+        log_->sync();
+    }
+}
+
 std::string Database::getCurrentTimestamp() {
-    auto now = std::chrono::system_clock::now();
+    return formatTimestamp(std::chrono::system_clock::now());
+}
+
+std::string Database::formatTimestamp(std::chrono::system_clock::time_point now) {
     auto time_t = std::chrono::system_clock::to_time_t(now);
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count() % 1000000;
+    std::tm tm_utc;
+    gmtime_r(&time_t, &tm_utc);
     std::stringstream ss;
-    ss << std::put_time(std::gmtime(&time_t), "%Y-%m-%d %H:%M:%S");
+    ss << std::put_time(&tm_utc, "%Y-%m-%d %H:%M:%S")
+       << '.' << std::setw(6) << std::setfill('0') << micros;
     return ss.str();
 }
 
 // Todo methods
 std::vector<Todo> Database::getAllTodos(int user_id) {
+    if (log_) return log_->getAllTodos(user_id);
     std::vector<Todo> todos;
-    const char* sql = "SELECT id, user_id, text, completed, created_at, updated_at, due_date FROM todos WHERE user_id = ? ORDER BY created_at DESC";
+    const char* sql = kSelectUserTodosSql;
+    
+    std::unique_lock<std::mutex> lock;
+    Connection& conn = lockReader(shardFor(user_id), lock);
+    sqlite3* db = conn.handle;
     
     sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db_) << std::endl;
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
         return todos;
     }
     
     sqlite3_bind_int(stmt, 1, user_id);
     
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Todo todo;
-        todo.id = sqlite3_column_int(stmt, 0);
-        todo.user_id = sqlite3_column_int(stmt, 1);
-        todo.text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        todo.completed = sqlite3_column_int(stmt, 3) != 0;
-        todo.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-        todo.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        const char* due_date_text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
-        todo.due_date = due_date_text ? due_date_text : "";
-        todos.push_back(todo);
+        todos.push_back(readTodoRow(stmt));
     }
     
     sqlite3_finalize(stmt);
     return todos;
 }
 
+void Database::getAllTodos(int user_id, CompactTodoList& todos) {
+    if (log_) return log_->getAllTodos(user_id, todos);
+    
+    std::unique_lock<std::mutex> lock;
+    Connection& conn = lockReader(shardFor(user_id), lock);
+    sqlite3* db = conn.handle;
+    
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, kSelectUserTodosSql, -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
+        return;
+    }
+    
+    sqlite3_bind_int(stmt, 1, user_id);
+    
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        appendTodoRow(stmt, todos);
+    }
+    
+    sqlite3_finalize(stmt);
+}
+
+// Keyset pagination over the (user_id, created_at) index, so a batch deep
+// into the list costs as much as the first.
+bool Database::readTodoBatch(int user_id, TodoCursor& cursor, size_t batch_size, CompactTodoList& batch) {
+    if (log_) return log_->readTodoBatch(user_id, cursor, batch_size, batch);
+    if (cursor.done) {
+        return true;
+    }
+    const char* sql = cursor.id == 0
+        ? "SELECT id, user_id, text, completed, created_at, updated_at, due_date FROM todos "
+          "WHERE user_id = ?1 ORDER BY created_at DESC, id DESC LIMIT ?2"
+        : "SELECT id, user_id, text, completed, created_at, updated_at, due_date FROM todos "
+          "WHERE user_id = ?1 AND (created_at, id) < (?3, ?4) ORDER BY created_at DESC, id DESC LIMIT ?2";
+    
+    std::unique_lock<std::mutex> lock;
+    Connection& conn = lockReader(shardFor(user_id), lock);
+    sqlite3* db = conn.handle;
+    
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
+        return false;
+    }
+    
+    sqlite3_bind_int(stmt, 1, user_id);
+    sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(batch_size));
+    if (cursor.id != 0) {
+        sqlite3_bind_text(stmt, 3, cursor.created_at.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 4, cursor.id);
+    }
+    
+    size_t read = 0;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (++read == batch_size) {
+            cursor.id = sqlite3_column_int(stmt, 0);
+            cursor.created_at = std::string(columnView(stmt, 4));
+        }
+        appendTodoRow(stmt, batch);
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        logError("Failed to read todos", {{"error", sqlite3_errmsg(db)}});
+        return false;
+    }
+    cursor.done = read < batch_size;
+    return true;
+}
+
 Todo Database::getTodoById(int id, int user_id) {
+    if (log_) return log_->getTodoById(id, user_id);
     Todo todo = {-1, -1, "", false, "", "", ""};
     const char* sql = "SELECT id, user_id, text, completed, created_at, updated_at, due_date FROM todos WHERE id = ? AND user_id = ?";
     
+    std::unique_lock<std::mutex> lock;
+    Connection& conn = lockReader(shardFor(user_id), lock);
+    sqlite3* db = conn.handle;
+    
     sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db_) << std::endl;
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
         return todo;
     }
     
@@ -117,14 +849,7 @@ Todo Database::getTodoById(int id, int user_id) {
     sqlite3_bind_int(stmt, 2, user_id);
     
     if (sqlite3_step(stmt) == SQLITE_ROW) {
-        todo.id = sqlite3_column_int(stmt, 0);
-        todo.user_id = sqlite3_column_int(stmt, 1);
-        todo.text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        todo.completed = sqlite3_column_int(stmt, 3) != 0;
-        todo.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-        todo.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        const char* due_date_text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
-        todo.due_date = due_date_text ? due_date_text : "";
+        todo = readTodoRow(stmt);
     }
     
     sqlite3_finalize(stmt);
@@ -133,72 +858,166 @@ Todo Database::getTodoById(int id, int user_id) {
 
 Todo Database::createTodo(const std::string& text, int user_id, const std::string& due_date) {
     std::string timestamp = getCurrentTimestamp();
-    const char* sql = "INSERT INTO todos (user_id, text, completed, created_at, updated_at, due_date) VALUES (?, ?, 0, ?, ?, ?)";
+    if (log_) return log_->createTodo(text, user_id, due_date, timestamp);
+    const char* sql = "INSERT INTO todos (id, user_id, text, completed, created_at, updated_at, due_date) VALUES (?, ?, ?, 0, ?, ?, ?)";
+    
+    Shard& shard = shardFor(user_id);
+    std::lock_guard<std::mutex> lock(shard.writer.mutex);
+    sqlite3* db = shard.writer.handle;
     
     sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db_) << std::endl;
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
         return {-1, -1, "", false, "", "", ""};
     }
     
-    sqlite3_bind_int(stmt, 1, user_id);
-    sqlite3_bind_text(stmt, 2, text.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, timestamp.c_str(), -1, SQLITE_STATIC);
+    // Unsharded databases keep AUTOINCREMENT ids; shards use leased ids
+    if (options_.shard_count > 1) {
+        int id = allocateTodoId(shard);
+        if (id < 0) {
+            sqlite3_finalize(stmt);
+            return {-1, -1, "", false, "", "", ""};
+        }
+        sqlite3_bind_int(stmt, 1, id);
+    } else {
+        sqlite3_bind_null(stmt, 1);
+    }
+    sqlite3_bind_int(stmt, 2, user_id);
+    sqlite3_bind_text(stmt, 3, text.c_str(), -1, SQLITE_STATIC);
     sqlite3_bind_text(stmt, 4, timestamp.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 5, timestamp.c_str(), -1, SQLITE_STATIC);
     if (due_date.empty()) {
-        sqlite3_bind_null(stmt, 5);
+        sqlite3_bind_null(stmt, 6);
     } else {
-        sqlite3_bind_text(stmt, 5, due_date.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 6, due_date.c_str(), -1, SQLITE_STATIC);
     }
     
     rc = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
     
     if (rc != SQLITE_DONE) {
-        std::cerr << "Failed to insert todo: " << sqlite3_errmsg(db_) << std::endl;
+        logError("Failed to insert todo", {{"error", sqlite3_errmsg(db)}});
         return {-1, -1, "", false, "", "", ""};
     }
     
-    int id = sqlite3_last_insert_rowid(db_);
+    int id = sqlite3_last_insert_rowid(db);
     return {id, user_id, text, false, timestamp, timestamp, due_date};
 }
 
-Todo Database::updateTodo(int id, const std::string& text, bool completed, int user_id) {
+bool Database::importTodos(int user_id, std::vector<Todo>& todos) {
     std::string timestamp = getCurrentTimestamp();
-    const char* sql = "UPDATE todos SET text = ?, completed = ?, updated_at = ? WHERE id = ? AND user_id = ?";
+    for (Todo& todo : todos) {
+        todo.user_id = user_id;
+        if (todo.created_at.empty()) todo.created_at = timestamp;
+        if (todo.updated_at.empty()) todo.updated_at = todo.created_at;
+    }
+    if (log_) return log_->importTodos(user_id, todos);
+    const char* sql = "INSERT INTO todos (id, user_id, text, completed, created_at, updated_at, due_date) VALUES (?, ?, ?, ?, ?, ?, ?)";
+    
+    Shard& shard = shardFor(user_id);
+    std::lock_guard<std::mutex> lock(shard.writer.mutex);
+    sqlite3* db = shard.writer.handle;
     
+    if (!execSql(db, "BEGIN IMMEDIATE;", "starting import")) {
+        return false;
+    }
     sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db_) << std::endl;
-        return {-1, -1, "", false, "", "", ""};
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
+        execSql(db, "ROLLBACK;", "rolling back import");
+        return false;
     }
     
-    sqlite3_bind_text(stmt, 1, text.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 2, completed ? 1 : 0);
-    sqlite3_bind_text(stmt, 3, timestamp.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 4, id);
-    sqlite3_bind_int(stmt, 5, user_id);
-    
-    rc = sqlite3_step(stmt);
+    bool ok = true;
+    for (Todo& todo : todos) {
+        if (options_.shard_count > 1) {
+            todo.id = allocateTodoId(shard);
+            if (todo.id < 0) {
+                ok = false;
+                break;
+            }
+            sqlite3_bind_int(stmt, 1, todo.id);
+        } else {
+            sqlite3_bind_null(stmt, 1);
+        }
+        sqlite3_bind_int(stmt, 2, user_id);
+        sqlite3_bind_text(stmt, 3, todo.text.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 4, todo.completed ? 1 : 0);
+        sqlite3_bind_text(stmt, 5, todo.created_at.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 6, todo.updated_at.c_str(), -1, SQLITE_STATIC);
+        if (todo.due_date.empty()) {
+            sqlite3_bind_null(stmt, 7);
+        } else {
+            sqlite3_bind_text(stmt, 7, todo.due_date.c_str(), -1, SQLITE_STATIC);
+        }
+        
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            logError("Failed to import todo", {{"error", sqlite3_errmsg(db)}});
+            ok = false;
+            break;
+        }
+        if (options_.shard_count <= 1) {
+            todo.id = static_cast<int>(sqlite3_last_insert_rowid(db));
+        }
+        sqlite3_reset(stmt);
+    }
     sqlite3_finalize(stmt);
     
-    if (rc != SQLITE_DONE) {
-        std::cerr << "Failed to update todo: " << sqlite3_errmsg(db_) << std::endl;
-        return {-1, -1, "", false, "", "", ""};
+    if (!ok || !execSql(db, "COMMIT;", "committing import")) {
+        execSql(db, "ROLLBACK;", "rolling back import");
+        return false;
+    }
+    return true;
+}
+
+Todo Database::updateTodo(int id, const std::string& text, bool completed, int user_id) {
+    std::string timestamp = getCurrentTimestamp();
+    if (log_) return log_->updateTodo(id, text, completed, user_id, timestamp);
+    const char* sql = "UPDATE todos SET text = ?, completed = ?, updated_at = ? WHERE id = ? AND user_id = ?";
+    
+    {
+        Shard& shard = shardFor(user_id);
+        std::lock_guard<std::mutex> lock(shard.writer.mutex);
+        sqlite3* db = shard.writer.handle;
+        
+        sqlite3_stmt* stmt;
+        int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+        if (rc != SQLITE_OK) {
+            logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
+            return {-1, -1, "", false, "", "", ""};
+        }
+        
+        sqlite3_bind_text(stmt, 1, text.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, completed ? 1 : 0);
+        sqlite3_bind_text(stmt, 3, timestamp.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 4, id);
+        sqlite3_bind_int(stmt, 5, user_id);
+        
+        rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+        
+        if (rc != SQLITE_DONE) {
+            logError("Failed to update todo", {{"error", sqlite3_errmsg(db)}});
+            return {-1, -1, "", false, "", "", ""};
+        }
     }
     
     return getTodoById(id, user_id);
 }
 
 bool Database::deleteTodo(int id, int user_id) {
+    if (log_) return log_->deleteTodo(id, user_id, getCurrentTimestamp());
     const char* sql = "DELETE FROM todos WHERE id = ? AND user_id = ?";
     
+    Shard& shard = shardFor(user_id);
+    std::lock_guard<std::mutex> lock(shard.writer.mutex);
+    sqlite3* db = shard.writer.handle;
+    
     sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db_) << std::endl;
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
         return false;
     }
     
@@ -208,18 +1027,267 @@ bool Database::deleteTodo(int id, int user_id) {
     rc = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
     
-    return rc == SQLITE_DONE;
+    return rc == SQLITE_DONE && sqlite3_changes(db) > 0;
+}
+
+std::vector<Todo> Database::searchTodos(int user_id, const std::string& query, int limit, int offset) {
+    if (log_) return log_->searchTodos(user_id, query, limit, offset);
+    std::vector<Todo> todos;
+    std::string expression = buildSearchExpression(user_id, query);
+    if (expression.empty()) {
+        return todos;
+    }
+    // Every match is ranked, so each page is cut from the same ordering; the
+    // owner phrase already narrows the postings to the user's own todos.
+    const char* sql = "SELECT t.id, t.user_id, t.text, t.completed, t.created_at, t.updated_at, t.due_date "
+                      "FROM (SELECT rowid, todo_rank(todos_fts, 1) AS score FROM todos_fts "
+                      "      WHERE todos_fts MATCH ?) m "
+                      "JOIN todos t ON t.id = m.rowid "
+                      "WHERE t.user_id = ? ORDER BY m.score, t.id DESC LIMIT ? OFFSET ?";
+    
+    std::unique_lock<std::mutex> lock;
+    Connection& conn = lockReader(shardFor(user_id), lock);
+    sqlite3* db = conn.handle;
+    
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
+        return todos;
+    }
+    
+    sqlite3_bind_text(stmt, 1, expression.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, user_id);
+    sqlite3_bind_int(stmt, 3, limit);
+    sqlite3_bind_int(stmt, 4, offset);
+    
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        todos.push_back(readTodoRow(stmt));
+    }
+    if (rc != SQLITE_DONE) {
+        logError("Failed to search todos", {{"error", sqlite3_errmsg(db)}});
+    }
+    
+    sqlite3_finalize(stmt);
+    return todos;
 }
 
 // User methods
+std::vector<Todo> Database::findTodos(int user_id, const TodoFilter& filter) {
+    if (log_) return log_->findTodos(user_id, filter);
+    std::vector<Todo> todos;
+    
+    // The completed flag is spelled out rather than bound so the planner can
+    // match "completed = 0" against the partial due date index.
+    std::string sql = "SELECT id, user_id, text, completed, created_at, updated_at, due_date FROM todos WHERE user_id = ?";
+    if (!filter.due_after.empty()) sql += " AND due_date > ?";
+    if (!filter.due_before.empty()) sql += " AND due_date < ?";
+    if (filter.completed) sql += *filter.completed ? " AND completed = 1" : " AND completed = 0";
+    sql += filter.hasDueRange() ? " ORDER BY due_date, id" : " ORDER BY created_at DESC, id DESC";
+    
+    std::unique_lock<std::mutex> lock;
+    Connection& conn = lockReader(shardFor(user_id), lock);
+    sqlite3* db = conn.handle;
+    
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
+        return todos;
+    }
+    
+    int param = 1;
+    sqlite3_bind_int(stmt, param++, user_id);
+    if (!filter.due_after.empty()) sqlite3_bind_text(stmt, param++, filter.due_after.c_str(), -1, SQLITE_STATIC);
+    if (!filter.due_before.empty()) sqlite3_bind_text(stmt, param++, filter.due_before.c_str(), -1, SQLITE_STATIC);
+    
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        todos.push_back(readTodoRow(stmt));
+    }
+    if (rc != SQLITE_DONE) {
+        logError("Failed to list todos", {{"error", sqlite3_errmsg(db)}});
+    }
+    
+    sqlite3_finalize(stmt);
+    return todos;
+}
+
+std::vector<DueDateBucket> Database::countOpenTodosByDay(int user_id, const std::string& from, const std::string& to) {
+    if (log_) return log_->countOpenTodosByDay(user_id, from, to);
+    std::vector<DueDateBucket> buckets;
+    // Answered from the partial index alone; due dates with a time part are
+    // grouped by their date prefix.
+    const char* sql = "SELECT substr(due_date, 1, 10) AS day, COUNT(*) FROM todos "
+                      "WHERE user_id = ? AND completed = 0 AND due_date >= ? AND due_date < ? "
+                      "GROUP BY day ORDER BY day";
+    
+    std::unique_lock<std::mutex> lock;
+    Connection& conn = lockReader(shardFor(user_id), lock);
+    sqlite3* db = conn.handle;
+    
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
+        return buckets;
+    }
+    
+    sqlite3_bind_int(stmt, 1, user_id);
+    sqlite3_bind_text(stmt, 2, from.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, to.c_str(), -1, SQLITE_STATIC);
+    
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        buckets.push_back({reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)), sqlite3_column_int(stmt, 1)});
+    }
+    if (rc != SQLITE_DONE) {
+        logError("Failed to count todos", {{"error", sqlite3_errmsg(db)}});
+    }
+    
+    sqlite3_finalize(stmt);
+    return buckets;
+}
+
+TodoChanges Database::getChangesSince(int user_id, int64_t since, int limit) {
+    if (log_) return log_->getChangesSince(user_id, since, limit);
+    TodoChanges changes;
+    changes.seq = since;
+    
+    // A first sync (since = 0) has nothing to delete, so it skips tombstones
+    const char* sql = "SELECT id, user_id, text, completed, created_at, updated_at, due_date, seq, 0 FROM todos "
+                      "WHERE user_id = ?1 AND seq > ?2 "
+                      "UNION ALL "
+                      "SELECT id, user_id, NULL, NULL, NULL, NULL, NULL, seq, 1 FROM todo_tombstones "
+                      "WHERE user_id = ?1 AND seq > ?2 AND ?2 > 0 "
+                      "ORDER BY 8 LIMIT ?3";
+    
+    std::unique_lock<std::mutex> lock;
+    Connection& conn = lockReader(shardFor(user_id), lock);
+    sqlite3* db = conn.handle;
+    
+    // One read transaction, so the rows and the counters come from the same snapshot
+    if (!execSql(db, "BEGIN;", "starting change query")) {
+        return changes;
+    }
+    int64_t change_seq = readMeta(db, "change_seq").value_or(0);
+    int64_t purged_seq = readMeta(db, "purged_seq").value_or(0);
+    if (since > change_seq || (since > 0 && since < purged_seq)) {
+        execSql(db, "COMMIT;", "finishing change query");
+        changes.reset = true;
+        return changes;
+    }
+    
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
+        execSql(db, "COMMIT;", "finishing change query");
+        return changes;
+    }
+    
+    // Fetch one extra row to learn whether the result was cut short
+    sqlite3_bind_int(stmt, 1, user_id);
+    sqlite3_bind_int64(stmt, 2, since);
+    sqlite3_bind_int(stmt, 3, limit + 1);
+    
+    int rows = 0;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (++rows > limit) {
+            changes.has_more = true;
+            break;
+        }
+        if (sqlite3_column_int(stmt, 8)) {
+            changes.deleted.push_back(sqlite3_column_int(stmt, 0));
+        } else {
+            changes.changed.push_back(readTodoRow(stmt));
+        }
+        changes.seq = sqlite3_column_int64(stmt, 7);
+    }
+    if (rc != SQLITE_DONE && rc != SQLITE_ROW) {
+        logError("Failed to read changes", {{"error", sqlite3_errmsg(db)}});
+    } else if (!changes.has_more) {
+        // Caught up: later syncs can start from the current counter
+        changes.seq = change_seq;
+    }
+    
+    sqlite3_finalize(stmt);
+    execSql(db, "COMMIT;", "finishing change query");
+    return changes;
+}
+
+int Database::compactTombstones(std::chrono::seconds retention) {
+    std::string cutoff = formatTimestamp(std::chrono::system_clock::now() - retention);
+    if (log_) return log_->compactTombstones(cutoff);
+    
+    int removed = 0;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->writer.mutex);
+        sqlite3* db = shard->writer.handle;
+        
+        // Remember the newest purged tombstone so clients older than it resync
+        const char* sql = R"(
+            INSERT INTO meta (key, value)
+                SELECT 'purged_seq', MAX(seq) FROM todo_tombstones WHERE deleted_at < ?1 HAVING COUNT(*) > 0
+                ON CONFLICT(key) DO UPDATE SET value = MAX(value, excluded.value);
+        )";
+        sqlite3_stmt* mark = nullptr;
+        sqlite3_stmt* purge = nullptr;
+        if (!execSql(db, "BEGIN IMMEDIATE;", "starting tombstone compaction")) {
+            continue;
+        }
+        bool ok = sqlite3_prepare_v2(db, sql, -1, &mark, nullptr) == SQLITE_OK;
+        ok = sqlite3_prepare_v2(db, "DELETE FROM todo_tombstones WHERE deleted_at < ?1", -1, &purge, nullptr) == SQLITE_OK && ok;
+        if (ok) {
+            sqlite3_bind_text(mark, 1, cutoff.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(purge, 1, cutoff.c_str(), -1, SQLITE_STATIC);
+            ok = sqlite3_step(mark) == SQLITE_DONE && sqlite3_step(purge) == SQLITE_DONE;
+        }
+        int purged = ok ? sqlite3_changes(db) : 0;
+        sqlite3_finalize(mark);
+        sqlite3_finalize(purge);
+        
+        if (!ok) {
+            logError("Failed to compact tombstones", {{"path", shard->path}, {"error", sqlite3_errmsg(db)}});
+            execSql(db, "ROLLBACK;", "rolling back tombstone compaction");
+            continue;
+        }
+        if (execSql(db, "COMMIT;", "committing tombstone compaction")) {
+            removed += purged;
+        }
+    }
+    return removed;
+}
+
 std::optional<User> Database::createUser(const std::string& username, const std::string& email, const std::string& password_hash) {
     std::string timestamp = getCurrentTimestamp();
+    if (log_) return log_->createUser(username, email, password_hash, timestamp);
     const char* sql = "INSERT INTO users (username, email, password_hash, created_at, updated_at) VALUES (?, ?, ?, ?, ?)";
     
+    std::lock_guard<std::mutex> lock(directory_->writer.mutex);
+    sqlite3* db = directory_->writer.handle;
+    
+    // Added before the insert, so a lookup never misses a committed user;
+    // keys of an insert that fails only cost a false positive
+    if (options_.user_filter) {
+        std::unique_lock<std::shared_mutex> filter_lock(user_filter_mutex_, std::defer_lock);
+        if (user_filter_ && user_filter_->size() + 2 > user_filter_->capacity()) {
+            auto grown = buildUserFilter(db);
+            filter_lock.lock();
+            if (grown) {
+                user_filter_ = std::move(grown);
+            }
+            filter_lock.unlock();
+        }
+        std::shared_lock<std::shared_mutex> shared(user_filter_mutex_);
+        if (user_filter_) {
+            user_filter_->insert(userFilterKey('u', username));
+            user_filter_->insert(userFilterKey('e', email));
+        }
+    }
+    
     sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db_) << std::endl;
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
         return std::nullopt;
     }
     
@@ -233,64 +1301,70 @@ std::optional<User> Database::createUser(const std::string& username, const std:
     sqlite3_finalize(stmt);
     
     if (rc != SQLITE_DONE) {
-        std::cerr << "Failed to insert user: " << sqlite3_errmsg(db_) << std::endl;
+        logError("Failed to insert user", {{"error", sqlite3_errmsg(db)}});
         return std::nullopt;
     }
     
-    int id = sqlite3_last_insert_rowid(db_);
+    int id = sqlite3_last_insert_rowid(db);
     return User{id, username, email, password_hash, timestamp, timestamp};
 }
 
 std::optional<User> Database::getUserByUsername(const std::string& username) {
+    if (log_) return log_->getUserByUsername(username);
+    if (options_.user_filter) {
+        user_filter_lookups_++;
+        if (!userKeyMayExist('u', username)) {
+            user_filter_rejected_++;
+            return std::nullopt;
+        }
+    }
     const char* sql = "SELECT id, username, email, password_hash, created_at, updated_at FROM users WHERE username = ?";
     
+    std::unique_lock<std::mutex> lock;
+    Connection& conn = lockReader(*directory_, lock);
+    sqlite3* db = conn.handle;
+    
     sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db_) << std::endl;
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
         return std::nullopt;
     }
     
     sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
     
     if (sqlite3_step(stmt) == SQLITE_ROW) {
-        User user;
-        user.id = sqlite3_column_int(stmt, 0);
-        user.username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        user.email = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        user.password_hash = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        user.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-        user.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        
+        User user = readUserRow(stmt);
         sqlite3_finalize(stmt);
         return user;
     }
     
     sqlite3_finalize(stmt);
+    if (options_.user_filter) {
+        user_filter_false_positives_++;
+    }
     return std::nullopt;
 }
 
 std::optional<User> Database::getUserById(int id) {
+    if (log_) return log_->getUserById(id);
     const char* sql = "SELECT id, username, email, password_hash, created_at, updated_at FROM users WHERE id = ?";
     
+    std::unique_lock<std::mutex> lock;
+    Connection& conn = lockReader(*directory_, lock);
+    sqlite3* db = conn.handle;
+    
     sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db_) << std::endl;
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
         return std::nullopt;
     }
     
     sqlite3_bind_int(stmt, 1, id);
     
     if (sqlite3_step(stmt) == SQLITE_ROW) {
-        User user;
-        user.id = sqlite3_column_int(stmt, 0);
-        user.username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        user.email = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        user.password_hash = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        user.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-        user.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        
+        User user = readUserRow(stmt);
         sqlite3_finalize(stmt);
         return user;
     }
@@ -299,13 +1373,54 @@ std::optional<User> Database::getUserById(int id) {
     return std::nullopt;
 }
 
+bool Database::updatePasswordHash(int user_id, const std::string& password_hash) {
+    std::string timestamp = getCurrentTimestamp();
+    if (log_) return log_->updatePasswordHash(user_id, password_hash, timestamp);
+    const char* sql = "UPDATE users SET password_hash = ?, updated_at = ? WHERE id = ?";
+    
+    std::lock_guard<std::mutex> lock(directory_->writer.mutex);
+    sqlite3* db = directory_->writer.handle;
+    
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
+        return false;
+    }
+    
+    sqlite3_bind_text(stmt, 1, password_hash.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, timestamp.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 3, user_id);
+    
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        logError("Failed to update password hash", {{"error", sqlite3_errmsg(db)}});
+        return false;
+    }
+    return sqlite3_changes(db) > 0;
+}
+
 bool Database::userExists(const std::string& username, const std::string& email) {
+    if (log_) return log_->userExists(username, email);
+    if (options_.user_filter) {
+        user_filter_lookups_++;
+        if (!userKeyMayExist('u', username) && !userKeyMayExist('e', email)) {
+            user_filter_rejected_++;
+            return false;
+        }
+    }
     const char* sql = "SELECT 1 FROM users WHERE username = ? OR email = ?";
     
+    std::unique_lock<std::mutex> lock;
+    Connection& conn = lockReader(*directory_, lock);
+    sqlite3* db = conn.handle;
+    
     sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
     if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db_) << std::endl;
+        logError("Failed to prepare statement", {{"error", sqlite3_errmsg(db)}});
         return false;
     }
     
@@ -314,6 +1429,193 @@ bool Database::userExists(const std::string& username, const std::string& email)
     
     bool exists = (sqlite3_step(stmt) == SQLITE_ROW);
     sqlite3_finalize(stmt);
+    if (!exists && options_.user_filter) {
+        user_filter_false_positives_++;
+    }
     
     return exists;
-}
\ No newline at end of file
+}
+
+// Resharding
+bool Database::reshard(const std::string& db_path, int new_shard_count) {
+    if (new_shard_count < 1 || new_shard_count > kMaxShards) {
+        logError("Invalid shard count", {{"shards", new_shard_count}});
+        return false;
+    }
+    
+    std::unique_ptr<sqlite3, decltype(&sqlite3_close)> directory(openConnection(db_path, false), &sqlite3_close);
+    if (!directory || !createDirectorySchema(directory.get())) {
+        return false;
+    }
+    
+    int old_shard_count = static_cast<int>(readMeta(directory.get(), "shard_count").value_or(1));
+    if (old_shard_count == new_shard_count) {
+        return true;
+    }
+    
+    // Moved rows are restamped from their new file's change counter, which
+    // must therefore start above every sequence number a client may hold.
+    int64_t max_change_seq = 0;
+    int64_t max_purged_seq = 0;
+    for (int s = 0; s < old_shard_count; ++s) {
+        std::string source_path = shardPath(db_path, s, old_shard_count);
+        if (!std::filesystem::exists(source_path)) {
+            continue;
+        }
+        std::unique_ptr<sqlite3, decltype(&sqlite3_close)> source(openConnection(source_path, false), &sqlite3_close);
+        if (!source || !createTodoSchema(source.get(), old_shard_count > 1)) {
+            return false;
+        }
+        max_change_seq = std::max(max_change_seq, readMeta(source.get(), "change_seq").value_or(0));
+        max_purged_seq = std::max(max_purged_seq, readMeta(source.get(), "purged_seq").value_or(0));
+    }
+    
+    // Make sure every target file exists with the right schema before moving rows
+    for (int i = 0; i < new_shard_count; ++i) {
+        std::string path = shardPath(db_path, i, new_shard_count);
+        std::unique_ptr<sqlite3, decltype(&sqlite3_close)> target(openConnection(path, false), &sqlite3_close);
+        if (!target || !execSql(target.get(), "PRAGMA journal_mode=WAL;", "enabling WAL") ||
+            !createTodoSchema(target.get(), new_shard_count > 1)) {
+            return false;
+        }
+        if (!writeMeta(target.get(), "change_seq", std::max(max_change_seq, readMeta(target.get(), "change_seq").value_or(0))) ||
+            !writeMeta(target.get(), "purged_seq", std::max(max_purged_seq, readMeta(target.get(), "purged_seq").value_or(0)))) {
+            logError("Failed to carry change sequence", {{"path", path}, {"error", sqlite3_errmsg(target.get())}});
+            return false;
+        }
+    }
+    
+    int64_t max_todo_id = 0;
+    std::set<std::string> emptied;
+    
+    for (int s = 0; s < old_shard_count; ++s) {
+        std::string source_path = shardPath(db_path, s, old_shard_count);
+        if (!std::filesystem::exists(source_path)) {
+            continue;
+        }
+        std::unique_ptr<sqlite3, decltype(&sqlite3_close)> source(openConnection(source_path, false), &sqlite3_close);
+        if (!source) {
+            return false;
+        }
+        
+        // Group this shard's users by their new home
+        std::map<std::string, std::vector<int>> moves;
+        sqlite3_stmt* stmt;
+        const char* users_sql = "SELECT user_id FROM todos UNION SELECT user_id FROM todo_tombstones";
+        if (sqlite3_prepare_v2(source.get(), users_sql, -1, &stmt, nullptr) != SQLITE_OK) {
+            logError("Failed to prepare statement", {{"error", sqlite3_errmsg(source.get())}});
+            return false;
+        }
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            int user_id = sqlite3_column_int(stmt, 0);
+            std::string target_path = shardPath(db_path, shardOf(user_id, new_shard_count), new_shard_count);
+            if (target_path != source_path) {
+                moves[target_path].push_back(user_id);
+            }
+        }
+        sqlite3_finalize(stmt);
+        
+        for (const auto& move : moves) {
+            // Bound, so any character in the path is taken literally
+            sqlite3_stmt* attach = nullptr;
+            bool attached =
+                sqlite3_prepare_v2(source.get(), "ATTACH DATABASE ?1 AS target", -1, &attach, nullptr) == SQLITE_OK &&
+                sqlite3_bind_text(attach, 1, move.first.c_str(), -1, SQLITE_TRANSIENT) == SQLITE_OK &&
+                sqlite3_step(attach) == SQLITE_DONE;
+            sqlite3_finalize(attach);
+            if (!attached) {
+                logError("Failed to attach target shard", {{"path", move.first}, {"error", sqlite3_errmsg(source.get())}});
+                return false;
+            }
+            if (!execSql(source.get(), "BEGIN IMMEDIATE;", "starting reshard transaction")) {
+                return false;
+            }
+            
+            // INSERT OR REPLACE keeps the move idempotent if a previous run
+            // copied rows but died before deleting them from the source.
+            // Tombstones travel with their user; the ones the DELETE leaves
+            // behind in the source are dropped with them.
+            const char* move_sql[] = {
+                "INSERT OR REPLACE INTO target.todo_tombstones SELECT * FROM main.todo_tombstones WHERE user_id = ?",
+                "INSERT OR REPLACE INTO target.todos SELECT * FROM main.todos WHERE user_id = ?",
+                "DELETE FROM main.todos WHERE user_id = ?",
+                "DELETE FROM main.todo_tombstones WHERE user_id = ?",
+            };
+            std::vector<sqlite3_stmt*> steps;
+            bool ok = true;
+            for (const char* sql : move_sql) {
+                sqlite3_stmt* step = nullptr;
+                ok = sqlite3_prepare_v2(source.get(), sql, -1, &step, nullptr) == SQLITE_OK && ok;
+                steps.push_back(step);
+            }
+            for (size_t i = 0; ok && i < move.second.size(); ++i) {
+                for (sqlite3_stmt* step : steps) {
+                    sqlite3_bind_int(step, 1, move.second[i]);
+                    ok = ok && sqlite3_step(step) == SQLITE_DONE;
+                    sqlite3_reset(step);
+                }
+            }
+            for (sqlite3_stmt* step : steps) {
+                sqlite3_finalize(step);
+            }
+            
+            if (!ok) {
+                logError("Failed to move todos", {{"path", move.first}, {"error", sqlite3_errmsg(source.get())}});
+                execSql(source.get(), "ROLLBACK;", "rolling back reshard");
+                return false;
+            }
+            if (!execSql(source.get(), "COMMIT;", "committing reshard") ||
+                !execSql(source.get(), "DETACH DATABASE target;", "detaching target shard")) {
+                return false;
+            }
+            logInfo("Moved users to their new shard",
+                    {{"users", move.second.size()}, {"from", source_path}, {"to", move.first}});
+        }
+        
+        if (sqlite3_prepare_v2(source.get(), "SELECT COUNT(*) FROM todos", -1, &stmt, nullptr) == SQLITE_OK) {
+            if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int64(stmt, 0) == 0) {
+                emptied.insert(source_path);
+            }
+            sqlite3_finalize(stmt);
+        }
+    }
+    
+    // New ids must stay above every id that now lives in any shard. The
+    // search index is rebuilt because REPLACE on a rerun skips the FTS
+    // delete trigger.
+    for (int i = 0; i < new_shard_count; ++i) {
+        std::unique_ptr<sqlite3, decltype(&sqlite3_close)> target(openConnection(shardPath(db_path, i, new_shard_count), false), &sqlite3_close);
+        if (!target || !execSql(target.get(), "INSERT INTO todos_fts(todos_fts) VALUES ('rebuild');", "rebuilding search index")) {
+            return false;
+        }
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(target.get(), "SELECT COALESCE(MAX(id), 0) FROM todos", -1, &stmt, nullptr) == SQLITE_OK) {
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                max_todo_id = std::max<int64_t>(max_todo_id, sqlite3_column_int64(stmt, 0));
+            }
+            sqlite3_finalize(stmt);
+        }
+    }
+    int64_t next_todo_id = std::max(max_todo_id + 1, readMeta(directory.get(), "next_todo_id").value_or(1));
+    
+    if (!writeMeta(directory.get(), "next_todo_id", next_todo_id) ||
+        !writeMeta(directory.get(), "shard_count", new_shard_count)) {
+        logError("Failed to record shard layout", {{"error", sqlite3_errmsg(directory.get())}});
+        return false;
+    }
+    
+    // Drop shard files that are no longer part of the layout once they are empty
+    for (int s = 0; s < old_shard_count; ++s) {
+        std::string path = shardPath(db_path, s, old_shard_count);
+        bool in_new_layout = false;
+        for (int i = 0; i < new_shard_count; ++i) {
+            in_new_layout = in_new_layout || shardPath(db_path, i, new_shard_count) == path;
+        }
+        if (!in_new_layout && path != db_path && emptied.count(path)) {
+            for (const char* suffix : {"", "-wal", "-shm"}) {
+                std::filesystem::remove(path + suffix);
+            }
+        }
+    }
+    return true;
+}
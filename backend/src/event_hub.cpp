@@ -0,0 +1,272 @@
+#include "event_hub.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+EventHub::EventHub(const EventHubOptions& options)
+    : options_(options), epoll_fd_(-1), wake_fd_(-1), running_(false), dropped_(0) {}
+
+EventHub::~EventHub() {
+    stop();
+}
+
+bool EventHub::start() {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+        logError("Cannot create event hub", {{"error", std::strerror(errno)}});
+        return false;
+    }
+    
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wake_fd_;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev) < 0) {
+        logError("Cannot register event hub wakeup", {{"error", std::strerror(errno)}});
+        return false;
+    }
+    
+    running_ = true;
+    thread_ = std::thread([this]() { run(); });
+    return true;
+}
+
+void EventHub::stop() {
+    if (running_.exchange(false)) {
+        wake();
+        thread_.join();
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!subscribers_.empty()) {
+        removeLocked(subscribers_.begin()->first);
+    }
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+}
+
+bool EventHub::subscribe(int fd, int user_id, const std::string& initial) {
+    return subscribe(fd, user_id, [&initial] { return initial; });
+}
+
+// `initial` runs under the mutex, so no publish() falls between it and the
+// stream being registered
+bool EventHub::subscribe(int fd, int user_id, const std::function<std::string()>& initial) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) {
+        return false;
+    }
+    
+    // Level-triggered read interest only tells us when the peer goes away
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        logError("Cannot register stream", {{"error", std::strerror(errno)}});
+        return false;
+    }
+    
+    Subscriber& subscriber = subscribers_[fd];
+    subscriber = Subscriber{user_id, initial()};
+    fds_by_user_[user_id].insert(fd);
+    if (!subscriber.pending.empty()) {
+        dirty_.insert(fd);
+        wake();
+    }
+    return true;
+}
+
+void EventHub::publish(int user_id, const std::string& frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = fds_by_user_.find(user_id);
+    if (it == fds_by_user_.end()) {
+        return;
+    }
+    for (int fd : it->second) {
+        Subscriber& subscriber = subscribers_[fd];
+        if (subscriber.overflowed) {
+            continue;
+        }
+        if (subscriber.pending.size() + frame.size() > options_.max_queued_bytes) {
+            subscriber.overflowed = true;
+            subscriber.pending.clear();
+            subscriber.pending.shrink_to_fit();
+            dropped_++;
+        } else {
+            subscriber.pending += frame;
+        }
+        dirty_.insert(fd);
+    }
+    wake();
+}
+
+size_t EventHub::subscriberCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return subscribers_.size();
+}
+
+std::string EventHub::formatEvent(const std::string& event, const std::string& data, const std::string& id) {
+    std::string frame;
+    if (!id.empty()) {
+        frame += "id: " + id + "\n";
+    }
+    frame += "event: " + event + "\n";
+    size_t start = 0;
+    while (true) {
+        size_t end = data.find('\n', start);
+        frame += "data: " + data.substr(start, end == std::string::npos ? std::string::npos : end - start) + "\n";
+        if (end == std::string::npos) break;
+        start = end + 1;
+    }
+    frame += "\n";
+    return frame;
+}
+
+void EventHub::run() {
+    const int max_events = 256;
+    epoll_event events[max_events];
+    auto next_heartbeat = std::chrono::steady_clock::now() + options_.heartbeat_interval;
+    
+    while (running_) {
+        auto now = std::chrono::steady_clock::now();
+        int timeout = static_cast<int>(std::max<int64_t>(0,
+            std::chrono::duration_cast<std::chrono::milliseconds>(next_heartbeat - now).count()));
+        int n = epoll_wait(epoll_fd_, events, max_events, timeout);
+        if (n < 0 && errno != EINTR) {
+            logError("Event hub wait failed", {{"error", std::strerror(errno)}});
+            break;
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd_) {
+                uint64_t count;
+                while (read(wake_fd_, &count, sizeof(count)) > 0) {}
+                continue;
+            }
+            if (!subscribers_.count(fd)) {
+                continue;
+            }
+            if (events[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) {
+                removeLocked(fd);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                // Clients never send anything on a stream; EOF means they left
+                char discard[512];
+                ssize_t r = read(fd, discard, sizeof(discard));
+                if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                    removeLocked(fd);
+                    continue;
+                }
+            }
+            if (events[i].events & EPOLLOUT) {
+                dirty_.insert(fd);
+            }
+        }
+        
+        if (std::chrono::steady_clock::now() >= next_heartbeat) {
+            for (auto& [fd, subscriber] : subscribers_) {
+                subscriber.pending += ":\n\n";
+                dirty_.insert(fd);
+            }
+            next_heartbeat = std::chrono::steady_clock::now() + options_.heartbeat_interval;
+        }
+        
+        std::unordered_set<int> dirty;
+        dirty.swap(dirty_);
+        for (int fd : dirty) {
+            if (subscribers_.count(fd)) {
+                flushLocked(fd);
+            }
+        }
+    }
+}
+
+void EventHub::wake() {
+    if (wake_fd_ < 0) {
+        return;
+    }
+    uint64_t one = 1;
+    ssize_t written = write(wake_fd_, &one, sizeof(one));
+    (void)written;
+}
+
+void EventHub::flushLocked(int fd) {
+    Subscriber& subscriber = subscribers_[fd];
+    if (subscriber.overflowed) {
+        removeLocked(fd);
+        return;
+    }
+    size_t sent = 0;
+    while (sent < subscriber.pending.size()) {
+        ssize_t n = send(fd, subscriber.pending.data() + sent, subscriber.pending.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            removeLocked(fd);
+            return;
+        }
+    }
+    subscriber.pending.erase(0, sent);
+    
+    if (subscriber.pending.size() > options_.max_queued_bytes) {
+        dropped_++;
+        removeLocked(fd);
+        return;
+    }
+    
+    // Only ask for writability while something is actually queued
+    bool want_write = !subscriber.pending.empty();
+    if (want_write != subscriber.want_write) {
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        if (want_write) ev.events |= EPOLLOUT;
+        ev.data.fd = fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev);
+        subscriber.want_write = want_write;
+    }
+}
+
+void EventHub::removeLocked(int fd) {
+    auto it = subscribers_.find(fd);
+    if (it == subscribers_.end()) {
+        return;
+    }
+    auto user = fds_by_user_.find(it->second.user_id);
+    if (user != fds_by_user_.end()) {
+        user->second.erase(fd);
+        if (user->second.empty()) {
+            fds_by_user_.erase(user);
+        }
+    }
+    subscribers_.erase(it);
+    dirty_.erase(fd);
+    if (epoll_fd_ >= 0) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    }
+    close(fd);
+}
@@ -0,0 +1,104 @@
+#include "http_request.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+
+namespace {
+
+// Next whitespace-separated token on the request line, advancing `pos`.
+std::string_view nextToken(std::string_view line, size_t& pos) {
+    size_t start = line.find_first_not_of(" \t", pos);
+    if (start == std::string_view::npos) {
+        pos = line.size();
+        return {};
+    }
+    size_t end = line.find_first_of(" \t", start);
+    if (end == std::string_view::npos) end = line.size();
+    pos = end;
+    return line.substr(start, end - start);
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+} // namespace
+
+bool parseHttpRequest(std::string_view raw, HttpRequest& request) {
+    size_t head_end = raw.find("\r\n\r\n");
+    request.headers = raw.substr(0, head_end);
+    request.body = head_end == std::string_view::npos ? std::string_view() : raw.substr(head_end + 4);
+    
+    std::string_view line = request.headers.substr(0, request.headers.find("\r\n"));
+    size_t pos = 0;
+    request.method = nextToken(line, pos);
+    std::string_view target = nextToken(line, pos);
+    request.version = nextToken(line, pos);
+    
+    size_t query_start = target.find('?');
+    if (query_start != std::string_view::npos) {
+        request.query = target.substr(query_start + 1);
+        target = target.substr(0, query_start);
+    } else {
+        request.query = {};
+    }
+    request.path = target;
+    return !request.method.empty() && !request.path.empty();
+}
+
+std::string_view extractHeader(std::string_view headers, std::string_view name) {
+    size_t line_start = 0;
+    while (line_start < headers.size()) {
+        size_t line_end = headers.find("\r\n", line_start);
+        if (line_end == std::string_view::npos) line_end = headers.size();
+        size_t colon = headers.find(':', line_start);
+        if (colon != std::string_view::npos && colon < line_end && colon - line_start == name.size() &&
+            std::equal(name.begin(), name.end(), headers.begin() + line_start, [](char a, char b) {
+                return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+            })) {
+            size_t value_start = headers.find_first_not_of(" \t", colon + 1);
+            if (value_start == std::string_view::npos || value_start >= line_end) return {};
+            size_t value_end = headers.find_last_not_of(" \t", line_end - 1);
+            return headers.substr(value_start, value_end - value_start + 1);
+        }
+        line_start = line_end + 2;
+    }
+    return {};
+}
+
+size_t requestHeadLength(std::string_view data) {
+    size_t head_end = data.find("\r\n\r\n");
+    return head_end == std::string_view::npos ? 0 : head_end + 4;
+}
+
+size_t requestLength(std::string_view data, bool& malformed) {
+    malformed = false;
+    size_t length = requestHeadLength(data);
+    if (length == 0) {
+        return 0;
+    }
+    std::string_view content_length = extractHeader(data.substr(0, length - 4), "Content-Length");
+    if (!content_length.empty()) {
+        size_t body_length = 0;
+        auto result = std::from_chars(content_length.data(), content_length.data() + content_length.size(),
+                                      body_length);
+        if (result.ec != std::errc() || result.ptr != content_length.data() + content_length.size() ||
+            body_length > SIZE_MAX - length) {
+            malformed = true;
+            return length;
+        }
+        length += body_length;
+    }
+    return length;
+}
+
+bool wantsKeepAlive(const HttpRequest& request) {
+    std::string_view connection = extractHeader(request.headers, "Connection");
+    if (request.version == "HTTP/1.1") {
+        return !equalsIgnoreCase(connection, "close");
+    }
+    return equalsIgnoreCase(connection, "keep-alive");
+}
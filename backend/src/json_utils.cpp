@@ -0,0 +1,523 @@
+#include "json_utils.h"
+#include <sstream>
+#include <iomanip>
+#include <regex>
+#include <charconv>
+#include <cstdio>
+#include <algorithm>
+
+std::string escapeJson(const std::string& input) {
+    std::string output;
+    for (char c : input) {
+        switch (c) {
+            case '"': output += "\\\""; break;
+            case '\\': output += "\\\\"; break;
+            case '\b': output += "\\b"; break;
+            case '\f': output += "\\f"; break;
+            case '\n': output += "\\n"; break;
+            case '\r': output += "\\r"; break;
+            case '\t': output += "\\t"; break;
+            default:
+                // Other control characters are only valid JSON as \u escapes
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    output += escaped;
+                } else {
+                    output += c;
+                }
+                break;
+        }
+    }
+    return output;
+}
+
+std::string todoToJson(const Todo& todo) {
+    std::stringstream ss;
+    ss << "{";
+    ss << "\"id\":" << todo.id << ",";
+    ss << "\"user_id\":" << todo.user_id << ",";
+    ss << "\"text\":\"" << escapeJson(todo.text) << "\",";
+    ss << "\"completed\":" << (todo.completed ? "true" : "false") << ",";
+    ss << "\"created_at\":\"" << escapeJson(todo.created_at) << "\",";
+    ss << "\"updated_at\":\"" << escapeJson(todo.updated_at) << "\",";
+    ss << "\"due_date\":";
+    if (todo.due_date.empty()) {
+        ss << "null";
+    } else {
+        ss << "\"" << escapeJson(todo.due_date) << "\"";
+    }
+    ss << "}";
+    return ss.str();
+}
+
+std::string todosToJson(const std::vector<Todo>& todos) {
+    std::stringstream ss;
+    ss << "[";
+    for (size_t i = 0; i < todos.size(); ++i) {
+        if (i > 0) ss << ",";
+        ss << todoToJson(todos[i]);
+    }
+    ss << "]";
+    return ss.str();
+}
+
+std::string searchResultsToJson(const std::vector<Todo>& todos, int limit, int offset, bool has_more) {
+    std::stringstream ss;
+    ss << "{";
+    ss << "\"todos\":" << todosToJson(todos) << ",";
+    ss << "\"limit\":" << limit << ",";
+    ss << "\"offset\":" << offset << ",";
+    ss << "\"next_offset\":";
+    if (has_more) {
+        ss << (offset + limit);
+    } else {
+        ss << "null";
+    }
+    ss << "}";
+    return ss.str();
+}
+
+std::string dueDateBucketsToJson(const std::vector<DueDateBucket>& buckets) {
+    std::stringstream ss;
+    ss << "{\"days\":[";
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        if (i > 0) ss << ",";
+        ss << "{\"date\":\"" << escapeJson(buckets[i].date) << "\",\"count\":" << buckets[i].count << "}";
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+std::string todoChangesToJson(const TodoChanges& changes) {
+    std::stringstream ss;
+    ss << "{";
+    ss << "\"changes\":" << todosToJson(changes.changed) << ",";
+    ss << "\"deleted\":[";
+    for (size_t i = 0; i < changes.deleted.size(); ++i) {
+        if (i > 0) ss << ",";
+        ss << changes.deleted[i];
+    }
+    ss << "],";
+    ss << "\"seq\":" << changes.seq << ",";
+    ss << "\"has_more\":" << (changes.has_more ? "true" : "false") << ",";
+    ss << "\"reset\":" << (changes.reset ? "true" : "false");
+    ss << "}";
+    return ss.str();
+}
+
+std::string statusToJson(const BufferPoolStats& stats, const TaskSchedulerStats& scheduler,
+                         const BoundedExecutorStats& database, const AuthStats& auth) {
+    std::stringstream ss;
+    ss << "{\"io_buffers\":{";
+    ss << "\"bytes_in_use\":" << stats.bytes_in_use << ",";
+    ss << "\"bytes_cached\":" << stats.bytes_cached << ",";
+    ss << "\"max_bytes\":" << stats.max_bytes << ",";
+    ss << "\"acquired\":" << stats.acquired << ",";
+    ss << "\"exhausted\":" << stats.exhausted << ",";
+    ss << "\"classes\":[";
+    for (size_t i = 0; i < stats.classes.size(); ++i) {
+        if (i > 0) ss << ",";
+        ss << "{\"size\":" << stats.classes[i].size << ",\"in_use\":" << stats.classes[i].in_use
+           << ",\"cached\":" << stats.classes[i].cached << "}";
+    }
+    ss << "]},\"scheduler\":{";
+    ss << "\"workers\":" << scheduler.workers << ",";
+    ss << "\"executed\":" << scheduler.executed << ",";
+    ss << "\"stolen\":" << scheduler.stolen << ",";
+    ss << "\"injected\":" << scheduler.injected << ",";
+    ss << "\"overflowed\":" << scheduler.overflowed;
+    ss << "},\"database\":{";
+    ss << "\"threads\":" << database.threads << ",";
+    ss << "\"queued\":" << database.queued << ",";
+    ss << "\"running\":" << database.running << ",";
+    ss << "\"max_queued\":" << database.max_queued << ",";
+    ss << "\"completed\":" << database.completed << ",";
+    ss << "\"rejected\":" << database.rejected;
+    ss << "},\"auth\":{";
+    uint64_t lookups = auth.sessions.hits + auth.sessions.misses;
+    ss << "\"validations\":" << auth.validations << ",";
+    ss << "\"p50_us\":" << auth.p50_ns / 1000.0 << ",";
+    ss << "\"p99_us\":" << auth.p99_ns / 1000.0 << ",";
+    ss << "\"sessions\":" << auth.sessions.entries << ",";
+    ss << "\"session_capacity\":" << auth.sessions.capacity << ",";
+    ss << "\"cache_hits\":" << auth.sessions.hits << ",";
+    ss << "\"cache_misses\":" << auth.sessions.misses << ",";
+    ss << "\"hit_rate\":" << (lookups > 0 ? static_cast<double>(auth.sessions.hits) / lookups : 0.0) << ",";
+    ss << "\"invalidations\":" << auth.sessions.invalidations << ",";
+    ss << "\"evictions\":" << auth.sessions.evictions << ",";
+    ss << "\"rehashed\":" << auth.rehashed << ",";
+    ss << "\"hashing\":{";
+    ss << "\"threads\":" << auth.hashing.threads << ",";
+    ss << "\"queued\":" << auth.hashing.queued << ",";
+    ss << "\"running\":" << auth.hashing.running << ",";
+    ss << "\"max_queued\":" << auth.hashing.max_queued << ",";
+    ss << "\"completed\":" << auth.hashing.completed << ",";
+    ss << "\"rejected\":" << auth.hashing.rejected;
+    ss << "},\"user_filter\":{";
+    ss << "\"enabled\":" << (auth.user_filter.enabled ? "true" : "false") << ",";
+    ss << "\"keys\":" << auth.user_filter.keys << ",";
+    ss << "\"capacity\":" << auth.user_filter.capacity << ",";
+    ss << "\"bytes\":" << auth.user_filter.bytes << ",";
+    ss << "\"lookups\":" << auth.user_filter.lookups << ",";
+    ss << "\"rejected\":" << auth.user_filter.rejected << ",";
+    ss << "\"false_positives\":" << auth.user_filter.false_positives;
+    ss << "}}}";
+    return ss.str();
+}
+
+std::string importSummaryToJson(const ImportSummary& summary) {
+    std::stringstream ss;
+    ss << "{";
+    if (!summary.error.empty()) {
+        ss << "\"error\":\"" << escapeJson(summary.error) << "\",";
+    }
+    ss << "\"imported\":" << summary.imported << ",";
+    ss << "\"rejected\":" << summary.rejected << ",";
+    ss << "\"rejected_lines\":[";
+    for (size_t i = 0; i < summary.rejected_lines.size(); ++i) {
+        if (i > 0) ss << ",";
+        ss << summary.rejected_lines[i];
+    }
+    ss << "],";
+    ss << "\"seconds\":" << std::fixed << std::setprecision(3) << summary.seconds << ",";
+    ss << "\"rows_per_second\":" << std::setprecision(0)
+       << (summary.seconds > 0 ? summary.imported / summary.seconds : 0.0);
+    ss << "}";
+    return ss.str();
+}
+
+std::string userToJson(const User& user) {
+    std::stringstream ss;
+    ss << "{";
+    ss << "\"id\":" << user.id << ",";
+    ss << "\"username\":\"" << escapeJson(user.username) << "\",";
+    ss << "\"email\":\"" << escapeJson(user.email) << "\",";
+    ss << "\"created_at\":\"" << escapeJson(user.created_at) << "\",";
+    ss << "\"updated_at\":\"" << escapeJson(user.updated_at) << "\"";
+    ss << "}";
+    return ss.str();
+}
+
+std::string authResponseToJson(const UserAuth& user, const std::string& token) {
+    std::stringstream ss;
+    ss << "{";
+    ss << "\"user\":{";
+    ss << "\"id\":" << user.user_id << ",";
+    ss << "\"username\":\"" << escapeJson(user.username) << "\",";
+    ss << "\"email\":\"" << escapeJson(user.email) << "\"";
+    ss << "},";
+    ss << "\"token\":\"" << escapeJson(token) << "\"";
+    ss << "}";
+    return ss.str();
+}
+
+void appendJsonEscaped(std::pmr::string& out, std::string_view value) {
+    for (char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+                break;
+        }
+    }
+}
+
+namespace {
+
+void appendInt(std::pmr::string& out, int value) {
+    char digits[16];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr - digits);
+}
+
+} // namespace
+
+void appendTodoJson(std::pmr::string& out, const CompactTodoList& list, const CompactTodo& todo) {
+    char timestamp[CompactTodoList::kTimestampBufferSize];
+    out += "{\"id\":";
+    appendInt(out, todo.id);
+    out += ",\"user_id\":";
+    appendInt(out, list.userId());
+    out += ",\"text\":\"";
+    appendJsonEscaped(out, list.text(todo));
+    out += "\",\"completed\":";
+    out += todo.completed() ? "true" : "false";
+    out += ",\"created_at\":\"";
+    appendJsonEscaped(out, list.createdAt(todo, timestamp));
+    out += "\",\"updated_at\":\"";
+    appendJsonEscaped(out, list.updatedAt(todo, timestamp));
+    out += "\",\"due_date\":";
+    std::string_view due_date = list.dueDate(todo);
+    if (due_date.empty()) {
+        out += "null";
+    } else {
+        out += '"';
+        appendJsonEscaped(out, due_date);
+        out += '"';
+    }
+    out += '}';
+}
+
+namespace {
+
+// Live todos in slots [begin, end), comma-separated, no brackets
+void appendTodoSlotsJson(std::pmr::string& out, const CompactTodoList& todos, size_t begin, size_t end) {
+    bool first = true;
+    for (size_t slot = begin; slot < end; ++slot) {
+        const CompactTodo& todo = todos[slot];
+        if (todo.erased()) continue;
+        if (!first) out += ',';
+        first = false;
+        appendTodoJson(out, todos, todo);
+    }
+}
+
+} // namespace
+
+void appendTodosJson(std::pmr::string& out, const CompactTodoList& todos) {
+    out += '[';
+    appendTodoSlotsJson(out, todos, 0, todos.slotCount());
+    out += ']';
+}
+
+void appendTodosJson(std::pmr::string& out, const CompactTodoList& todos, TaskScheduler& scheduler,
+                     size_t todos_per_chunk) {
+    size_t slots = todos.slotCount();
+    todos_per_chunk = std::max<size_t>(todos_per_chunk, 1);
+    if (slots <= todos_per_chunk) {
+        appendTodosJson(out, todos);
+        return;
+    }
+    
+    // Chunks are encoded on other threads, so they get the heap rather than
+    // `out`'s resource, which may be a single-threaded arena
+    std::vector<std::future<std::pmr::string>> chunks;
+    for (size_t begin = 0; begin < slots; begin += todos_per_chunk) {
+        size_t end = std::min(begin + todos_per_chunk, slots);
+        chunks.push_back(scheduler.submit([&todos, begin, end] {
+            std::pmr::string chunk(std::pmr::new_delete_resource());
+            chunk.reserve((end - begin) * 160);
+            appendTodoSlotsJson(chunk, todos, begin, end);
+            return chunk;
+        }));
+    }
+    
+    out += '[';
+    bool first = true;
+    for (auto& future : chunks) {
+        std::pmr::string chunk = scheduler.await(future);
+        if (chunk.empty()) continue;
+        if (!first) out += ',';
+        first = false;
+        out += chunk;
+    }
+    out += ']';
+}
+
+namespace {
+
+void skipJsonSpace(std::string_view json, size_t& pos) {
+    while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\t' || json[pos] == '\r' || json[pos] == '\n')) {
+        ++pos;
+    }
+}
+
+bool readHex4(std::string_view json, size_t pos, uint32_t& value) {
+    if (pos + 4 > json.size()) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = pos; i < pos + 4; ++i) {
+        char c = json[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= c - '0';
+        else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+        else return false;
+    }
+    return true;
+}
+
+void appendUtf8(std::string& out, uint32_t code_point) {
+    if (code_point < 0x80) {
+        out += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        out += static_cast<char>(0xc0 | (code_point >> 6));
+        out += static_cast<char>(0x80 | (code_point & 0x3f));
+    } else if (code_point < 0x10000) {
+        out += static_cast<char>(0xe0 | (code_point >> 12));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code_point & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (code_point >> 18));
+        out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code_point & 0x3f));
+    }
+}
+
+// Reads the string starting at the quote at `pos`, unescaped, and leaves
+// `pos` after the closing quote
+bool readJsonString(std::string_view json, size_t& pos, std::string& out) {
+    out.clear();
+    ++pos;
+    while (pos < json.size()) {
+        char c = json[pos++];
+        if (c == '"') {
+            return true;
+        }
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (pos >= json.size()) {
+            return false;
+        }
+        switch (json[pos++]) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t code_point;
+                if (!readHex4(json, pos, code_point)) {
+                    return false;
+                }
+                pos += 4;
+                // A high surrogate must be followed by an escaped low one
+                if (code_point >= 0xd800 && code_point < 0xdc00) {
+                    uint32_t low;
+                    if (json.substr(pos, 2) != "\\u" || !readHex4(json, pos + 2, low) || low < 0xdc00 || low >= 0xe000) {
+                        return false;
+                    }
+                    pos += 6;
+                    code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+                } else if (code_point >= 0xdc00 && code_point < 0xe000) {
+                    return false;
+                }
+                appendUtf8(out, code_point);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool parseImportedTodo(std::string_view line, Todo& todo) {
+    todo = {-1, -1, "", false, "", "", ""};
+    size_t pos = 0;
+    skipJsonSpace(line, pos);
+    if (pos >= line.size() || line[pos] != '{') {
+        return false;
+    }
+    ++pos;
+    skipJsonSpace(line, pos);
+    bool has_text = false;
+    bool first = true;
+    std::string name;
+    std::string value;
+    int64_t micros;
+    while (pos < line.size() && line[pos] != '}') {
+        if (!first) {
+            if (line[pos] != ',') {
+                return false;
+            }
+            ++pos;
+            skipJsonSpace(line, pos);
+        }
+        first = false;
+        if (pos >= line.size() || line[pos] != '"' || !readJsonString(line, pos, name)) {
+            return false;
+        }
+        skipJsonSpace(line, pos);
+        if (pos >= line.size() || line[pos] != ':') {
+            return false;
+        }
+        ++pos;
+        skipJsonSpace(line, pos);
+        if (pos >= line.size()) {
+            return false;
+        }
+        
+        if (line[pos] == '"') {
+            if (!readJsonString(line, pos, value)) {
+                return false;
+            }
+            if (name == "completed") {
+                return false;
+            } else if (name == "text") {
+                todo.text = value;
+                has_text = !value.empty();
+            } else if (name == "due_date" || name == "dueDate") {
+                todo.due_date = value;
+            } else if (name == "created_at" && CompactTodoList::parseTimestamp(value, micros)) {
+                todo.created_at = value;
+            } else if (name == "updated_at" && CompactTodoList::parseTimestamp(value, micros)) {
+                todo.updated_at = value;
+            }
+        } else {
+            // Numbers and literals; objects and arrays have no place here
+            size_t end = pos;
+            while (end < line.size() && line[end] != ',' && line[end] != '}' && line[end] != ' ' && line[end] != '\t') {
+                ++end;
+            }
+            std::string_view token = line.substr(pos, end - pos);
+            if (token.empty() || token[0] == '{' || token[0] == '[') {
+                return false;
+            }
+            if (name == "completed") {
+                if (token != "true" && token != "false") {
+                    return false;
+                }
+                todo.completed = token == "true";
+            }
+            pos = end;
+        }
+        skipJsonSpace(line, pos);
+    }
+    if (pos >= line.size()) {
+        return false;
+    }
+    ++pos;
+    skipJsonSpace(line, pos);
+    return pos == line.size() && has_text;
+}
+
+std::string extractJsonField(std::string_view json, const std::string& field) {
+    std::regex pattern("\"" + field + "\"\\s*:\\s*\"([^\"]+)\"");
+    std::cmatch match;
+    if (std::regex_search(json.data(), json.data() + json.size(), match, pattern)) {
+        return match[1].str();
+    }
+    return "";
+}
+
+bool extractJsonBool(std::string_view json, const std::string& field) {
+    std::regex pattern("\"" + field + "\"\\s*:\\s*(true|false)");
+    std::cmatch match;
+    if (std::regex_search(json.data(), json.data() + json.size(), match, pattern)) {
+        return match[1].str() == "true";
+    }
+    return false;
+}
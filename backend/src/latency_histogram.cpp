@@ -0,0 +1,63 @@
+#include "latency_histogram.h"
+#include <cmath>
+
+size_t LatencyHistogram::bucketOf(uint64_t value) {
+    if (value < kSubBuckets) {
+        return static_cast<size_t>(value);
+    }
+    int top_bit = 63 - __builtin_clzll(value);
+    int shift = top_bit - kSubBucketBits;
+    size_t sub_bucket = static_cast<size_t>(value >> shift) - kSubBuckets;
+    return kSubBuckets + static_cast<size_t>(shift) * kSubBuckets + sub_bucket;
+}
+
+uint64_t LatencyHistogram::upperBoundOf(size_t bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    size_t shift = (bucket - kSubBuckets) / kSubBuckets;
+    uint64_t sub_bucket = (bucket - kSubBuckets) % kSubBuckets;
+    // Wraps to the largest value for the last bucket
+    return ((kSubBuckets + sub_bucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanos) {
+    counts_[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t total = 0;
+    for (const auto& count : counts_) {
+        total += count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+        uint64_t count = other.counts_[bucket].load(std::memory_order_relaxed);
+        if (count > 0) {
+            counts_[bucket].fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+    uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(total)));
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+        seen += counts_[bucket].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return upperBoundOf(bucket);
+        }
+    }
+    // Records that landed after the total was taken
+    return upperBoundOf(kBuckets - 1);
+}
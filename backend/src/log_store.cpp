@@ -0,0 +1,1037 @@
+#include "log_store.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <cctype>
+#include <limits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace {
+
+const char kSnapshotMagic[8] = {'T', 'O', 'D', 'O', 'S', 'N', 'P', '2'};
+const size_t kFrameHeaderSize = 8;
+// Upper bound for a single record; anything larger is treated as a torn length.
+const uint32_t kMaxRecordSize = 64 * 1024 * 1024;
+
+uint32_t crc32(const char* data, size_t size) {
+    static uint32_t table[256];
+    static bool initialized = [] {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return true;
+    }();
+    (void)initialized;
+    
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void putU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+uint32_t getU32(const char* data) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+void putU64(std::string& out, uint64_t value) {
+    putU32(out, static_cast<uint32_t>(value & 0xFFFFFFFFu));
+    putU32(out, static_cast<uint32_t>(value >> 32));
+}
+
+void putString(std::string& out, const std::string& value) {
+    putU32(out, static_cast<uint32_t>(value.size()));
+    out += value;
+}
+
+std::string frame(const std::string& payload) {
+    std::string framed;
+    framed.reserve(kFrameHeaderSize + payload.size());
+    putU32(framed, static_cast<uint32_t>(payload.size()));
+    putU32(framed, crc32(payload.data(), payload.size()));
+    framed += payload;
+    return framed;
+}
+
+// Bounds-checked cursor over a record payload.
+class PayloadReader {
+public:
+    explicit PayloadReader(const std::string& payload) : data_(payload), pos_(0), ok_(true) {}
+    
+    uint8_t u8() {
+        if (pos_ + 1 > data_.size()) { ok_ = false; return 0; }
+        return static_cast<uint8_t>(data_[pos_++]);
+    }
+    
+    int32_t i32() {
+        if (pos_ + 4 > data_.size()) { ok_ = false; return 0; }
+        uint32_t value = getU32(data_.data() + pos_);
+        pos_ += 4;
+        return static_cast<int32_t>(value);
+    }
+    
+    int64_t i64() {
+        uint32_t low = static_cast<uint32_t>(i32());
+        uint32_t high = static_cast<uint32_t>(i32());
+        return static_cast<int64_t>((static_cast<uint64_t>(high) << 32) | low);
+    }
+    
+    std::string str() {
+        uint32_t size = static_cast<uint32_t>(i32());
+        if (!ok_ || pos_ + size > data_.size()) { ok_ = false; return ""; }
+        std::string value = data_.substr(pos_, size);
+        pos_ += size;
+        return value;
+    }
+    
+    bool ok() const { return ok_ && pos_ == data_.size(); }
+
+private:
+    const std::string& data_;
+    size_t pos_;
+    bool ok_;
+};
+
+// Walks framed records in `data`, stopping at the first short or corrupt one.
+// Returns the offset just past the last valid record.
+template <typename Fn>
+size_t forEachFrame(const std::string& data, size_t offset, Fn&& fn) {
+    while (offset + kFrameHeaderSize <= data.size()) {
+        uint32_t size = getU32(data.data() + offset);
+        uint32_t checksum = getU32(data.data() + offset + 4);
+        if (size > kMaxRecordSize || offset + kFrameHeaderSize + size > data.size()) {
+            break;
+        }
+        const char* payload = data.data() + offset + kFrameHeaderSize;
+        if (crc32(payload, size) != checksum) {
+            break;
+        }
+        if (!fn(std::string(payload, size))) {
+            break;
+        }
+        offset += kFrameHeaderSize + size;
+    }
+    return offset;
+}
+
+bool readFile(int fd, std::string& out) {
+    char buffer[65536];
+    while (true) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) return true;
+        out.append(buffer, static_cast<size_t>(n));
+    }
+}
+
+bool writeAll(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+std::string parentDirectory(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos) return ".";
+    if (slash == 0) return "/";
+    return path.substr(0, slash);
+}
+
+} // namespace
+
+LogStore::LogStore(const std::string& path,
+                   size_t sync_batch,
+                   std::chrono::milliseconds sync_interval,
+                   size_t snapshot_interval)
+    : log_path_(path + ".wal"),
+      snapshot_path_(path + ".snapshot"),
+      sync_batch_(sync_batch == 0 ? 1 : sync_batch),
+      sync_interval_(sync_interval),
+      snapshot_interval_(snapshot_interval),
+      log_fd_(-1),
+      failed_(false),
+      unsynced_records_(0),
+      records_since_snapshot_(0),
+      next_user_id_(1),
+      next_todo_id_(1),
+      change_seq_(0),
+      purged_seq_(0),
+      stopping_(false) {}
+
+LogStore::~LogStore() {
+    {
+        std::lock_guard<std::mutex> lock(log_mutex_);
+        stopping_ = true;
+    }
+    flusher_cv_.notify_all();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+    if (log_fd_ >= 0) {
+        syncLocked();
+        close(log_fd_);
+    }
+}
+
+// Runs before any other thread uses the store, so records are applied
+// without taking the stripe locks.
+bool LogStore::open() {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    
+    if (!loadSnapshot()) {
+        return false;
+    }
+    
+    log_fd_ = ::open(log_path_.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (log_fd_ < 0) {
+        logError("Cannot open log", {{"path", log_path_}, {"error", std::strerror(errno)}});
+        return false;
+    }
+    
+    if (!replayLog()) {
+        return false;
+    }
+    
+    last_sync_ = std::chrono::steady_clock::now();
+    flusher_ = std::thread(&LogStore::flusherLoop, this);
+    return true;
+}
+
+bool LogStore::loadSnapshot() {
+    int fd = ::open(snapshot_path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno == ENOENT;
+    }
+    
+    std::string data;
+    bool read_ok = readFile(fd, data);
+    close(fd);
+    
+    if (!read_ok || data.size() < sizeof(kSnapshotMagic) ||
+        std::memcmp(data.data(), kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) {
+        logError("Snapshot is unreadable", {{"path", snapshot_path_}});
+        return false;
+    }
+    
+    // Snapshots are published with rename(), so anything short of a complete,
+    // checksummed file means the snapshot itself is damaged.
+    bool complete = false;
+    size_t end = forEachFrame(data, sizeof(kSnapshotMagic), [&](const std::string& payload) {
+        if (!payload.empty() && static_cast<RecordType>(payload[0]) == RecordType::SnapshotEnd) {
+            complete = true;
+            return false;
+        }
+        return applyRecord(payload);
+    });
+    
+    if (!complete) {
+        logError("Snapshot is corrupt", {{"path", snapshot_path_}, {"offset", end}});
+        return false;
+    }
+    return true;
+}
+
+bool LogStore::replayLog() {
+    std::string data;
+    if (!readFile(log_fd_, data)) {
+        logError("Cannot read log", {{"path", log_path_}, {"error", std::strerror(errno)}});
+        return false;
+    }
+    
+    size_t end = forEachFrame(data, 0, [&](const std::string& payload) {
+        if (!applyRecord(payload)) {
+            return false;
+        }
+        ++records_since_snapshot_;
+        return true;
+    });
+    
+    if (end < data.size()) {
+        logWarning("Truncating torn log tail", {{"path", log_path_}, {"offset", end}, {"discarded_bytes", data.size() - end}});
+        if (ftruncate(log_fd_, static_cast<off_t>(end)) != 0 || fdatasync(log_fd_) != 0) {
+            logError("Failed to truncate log", {{"error", std::strerror(errno)}});
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LogStore::applyRecord(const std::string& payload) {
+    PayloadReader reader(payload);
+    auto type = static_cast<RecordType>(reader.u8());
+    
+    switch (type) {
+        case RecordType::UserCreated:
+        case RecordType::UserUpdated: {
+            User user;
+            user.id = reader.i32();
+            user.username = reader.str();
+            user.email = reader.str();
+            user.password_hash = reader.str();
+            user.created_at = reader.str();
+            user.updated_at = reader.str();
+            if (!reader.ok()) return false;
+            
+            user_ids_by_name_[user.username] = user.id;
+            user_ids_by_email_[user.email] = user.id;
+            next_user_id_ = std::max(next_user_id_, user.id + 1);
+            users_[user.id] = std::move(user);
+            return true;
+        }
+        case RecordType::TodoCreated:
+        case RecordType::TodoUpdated: {
+            Todo todo;
+            todo.id = reader.i32();
+            todo.user_id = reader.i32();
+            todo.text = reader.str();
+            todo.completed = reader.u8() != 0;
+            todo.created_at = reader.str();
+            todo.updated_at = reader.str();
+            todo.due_date = reader.str();
+            int64_t seq = reader.i64();
+            if (!reader.ok()) return false;
+            
+            next_todo_id_ = std::max(next_todo_id_, todo.id + 1);
+            change_seq_ = std::max(change_seq_.load(), seq);
+            Stripe& stripe = stripeFor(todo.user_id);
+            stripe.recordChange(todo.user_id, todo.id, seq, false, "");
+            stripe.todos(todo.user_id).put(todo);
+            return true;
+        }
+        case RecordType::TodoDeleted: {
+            int id = reader.i32();
+            int user_id = reader.i32();
+            int64_t seq = reader.i64();
+            std::string deleted_at = reader.str();
+            if (!reader.ok()) return false;
+            
+            change_seq_ = std::max(change_seq_.load(), seq);
+            Stripe& stripe = stripeFor(user_id);
+            auto it = stripe.todos_by_user.find(user_id);
+            if (it != stripe.todos_by_user.end()) {
+                it->second.erase(id);
+            }
+            stripe.recordChange(user_id, id, seq, true, deleted_at);
+            return true;
+        }
+        case RecordType::SnapshotMeta: {
+            int next_user_id = reader.i32();
+            int next_todo_id = reader.i32();
+            int64_t change_seq = reader.i64();
+            int64_t purged_seq = reader.i64();
+            if (!reader.ok()) return false;
+            
+            next_user_id_ = std::max(next_user_id_, next_user_id);
+            next_todo_id_ = std::max(next_todo_id_, next_todo_id);
+            change_seq_ = std::max(change_seq_.load(), change_seq);
+            purged_seq_ = std::max(purged_seq_.load(), purged_seq);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+std::string LogStore::encodeUser(RecordType type, const User& user) {
+    std::string payload;
+    payload.push_back(static_cast<char>(type));
+    putU32(payload, static_cast<uint32_t>(user.id));
+    putString(payload, user.username);
+    putString(payload, user.email);
+    putString(payload, user.password_hash);
+    putString(payload, user.created_at);
+    putString(payload, user.updated_at);
+    return payload;
+}
+
+std::string LogStore::encodeTodo(RecordType type, const Todo& todo, int64_t seq) {
+    std::string payload;
+    payload.push_back(static_cast<char>(type));
+    putU32(payload, static_cast<uint32_t>(todo.id));
+    putU32(payload, static_cast<uint32_t>(todo.user_id));
+    putString(payload, todo.text);
+    payload.push_back(todo.completed ? 1 : 0);
+    putString(payload, todo.created_at);
+    putString(payload, todo.updated_at);
+    putString(payload, todo.due_date);
+    putU64(payload, static_cast<uint64_t>(seq));
+    return payload;
+}
+
+std::string LogStore::encodeTombstone(int id, int user_id, int64_t seq, const std::string& deleted_at) {
+    std::string payload;
+    payload.push_back(static_cast<char>(RecordType::TodoDeleted));
+    putU32(payload, static_cast<uint32_t>(id));
+    putU32(payload, static_cast<uint32_t>(user_id));
+    putU64(payload, static_cast<uint64_t>(seq));
+    putString(payload, deleted_at);
+    return payload;
+}
+
+CompactTodoList& LogStore::Stripe::todos(int user_id) {
+    return todos_by_user.try_emplace(user_id, user_id).first->second;
+}
+
+const CompactTodoList* LogStore::Stripe::findTodos(int user_id) const {
+    auto it = todos_by_user.find(user_id);
+    return it != todos_by_user.end() ? &it->second : nullptr;
+}
+
+void LogStore::Stripe::recordChange(int user_id, int id, int64_t seq, bool deleted, const std::string& deleted_at) {
+    auto& changes = changes_by_user[user_id];
+    auto previous = change_seq_by_todo.find(id);
+    if (previous != change_seq_by_todo.end()) {
+        changes.erase(previous->second);
+    }
+    changes[seq] = ChangeEntry{id, deleted, deleted_at};
+    change_seq_by_todo[id] = seq;
+}
+
+LogStore::Stripe& LogStore::stripeFor(int user_id) {
+    return stripes_[static_cast<uint32_t>(user_id) % kStripes];
+}
+
+// A partly written frame is cut off again: replay stops at the first bad
+// frame, so anything appended behind it would be lost on the next open.
+// When even that fails the store takes no more writes.
+bool LogStore::appendLocked(const std::string& payload) {
+    if (log_fd_ < 0 || failed_) {
+        return false;
+    }
+    
+    off_t offset = lseek(log_fd_, 0, SEEK_END);
+    if (offset < 0 || !writeAll(log_fd_, frame(payload))) {
+        int error = errno;
+        if (offset < 0 || ftruncate(log_fd_, offset) != 0) {
+            failed_ = true;
+        }
+        logError("Failed to append to log", {{"error", std::strerror(error)}, {"store_failed", failed_ ? 1 : 0}});
+        return false;
+    }
+    
+    ++unsynced_records_;
+    ++records_since_snapshot_;
+    return true;
+}
+
+// The caller still waits for a full batch to reach the disk, but readers of
+// its stripe no longer do.
+void LogStore::finishWrite() {
+    bool snapshot_due;
+    {
+        std::lock_guard<std::mutex> lock(log_mutex_);
+        if (unsynced_records_ >= sync_batch_) {
+            syncLocked();
+        }
+        snapshot_due = snapshot_interval_ > 0 && records_since_snapshot_ >= snapshot_interval_;
+    }
+    if (snapshot_due) {
+        takeSnapshot(true);
+    }
+}
+
+void LogStore::sync() {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    syncLocked();
+}
+
+// A failed fdatasync may have dropped the dirty pages it was meant to write,
+// and a later one can succeed without them, so the store takes no more
+// writes after the first failure.
+void LogStore::syncLocked() {
+    if (log_fd_ < 0 || failed_ || unsynced_records_ == 0) {
+        return;
+    }
+    if (fdatasync(log_fd_) != 0) {
+        failed_ = true;
+        logError("Failed to sync log; refusing further writes", {{"error", std::strerror(errno)}});
+        return;
+    }
+    unsynced_records_ = 0;
+    last_sync_ = std::chrono::steady_clock::now();
+}
+
+void LogStore::flusherLoop() {
+    std::unique_lock<std::mutex> lock(log_mutex_);
+    while (!stopping_) {
+        flusher_cv_.wait_for(lock, sync_interval_);
+        if (unsynced_records_ > 0 &&
+            std::chrono::steady_clock::now() - last_sync_ >= sync_interval_) {
+            syncLocked();
+        }
+    }
+}
+
+bool LogStore::snapshot() {
+    return takeSnapshot(false);
+}
+
+// The exclusive gate waits out mutations that are appended but not yet
+// applied, so the snapshot covers every record it truncates away. Readers
+// only share state with it, so they keep going.
+bool LogStore::takeSnapshot(bool only_if_due) {
+    std::unique_lock<std::shared_mutex> gate(snapshot_gate_);
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    if (only_if_due && !(snapshot_interval_ > 0 && records_since_snapshot_ >= snapshot_interval_)) {
+        return true;
+    }
+    return snapshotLocked();
+}
+
+bool LogStore::snapshotLocked() {
+    if (failed_) {
+        return false;
+    }
+    std::string data(kSnapshotMagic, sizeof(kSnapshotMagic));
+    
+    std::string meta;
+    meta.push_back(static_cast<char>(RecordType::SnapshotMeta));
+    putU32(meta, static_cast<uint32_t>(next_user_id_));
+    putU32(meta, static_cast<uint32_t>(next_todo_id_));
+    putU64(meta, static_cast<uint64_t>(change_seq_));
+    putU64(meta, static_cast<uint64_t>(purged_seq_));
+    data += frame(meta);
+    
+    for (const auto& entry : users_) {
+        data += frame(encodeUser(RecordType::UserCreated, entry.second));
+    }
+    for (const Stripe& stripe : stripes_) {
+        for (const auto& user_todos : stripe.todos_by_user) {
+            for (const CompactTodo& todo : user_todos.second) {
+                if (!todo.erased()) {
+                    auto seq = stripe.change_seq_by_todo.find(todo.id);
+                    data += frame(encodeTodo(RecordType::TodoCreated, user_todos.second.toTodo(todo),
+                                             seq != stripe.change_seq_by_todo.end() ? seq->second : 0));
+                }
+            }
+        }
+        for (const auto& user_changes : stripe.changes_by_user) {
+            for (const auto& entry : user_changes.second) {
+                if (entry.second.deleted) {
+                    data += frame(encodeTombstone(entry.second.id, user_changes.first, entry.first, entry.second.deleted_at));
+                }
+            }
+        }
+    }
+    
+    std::string end;
+    end.push_back(static_cast<char>(RecordType::SnapshotEnd));
+    data += frame(end);
+    
+    std::string tmp_path = snapshot_path_ + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        logError("Cannot create snapshot", {{"path", tmp_path}, {"error", std::strerror(errno)}});
+        return false;
+    }
+    bool ok = writeAll(fd, data) && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmp_path.c_str(), snapshot_path_.c_str()) != 0) {
+        logError("Failed to write snapshot", {{"error", std::strerror(errno)}});
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    
+    int dir_fd = ::open(parentDirectory(snapshot_path_).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    
+    // Everything in the log is now covered by the snapshot. If we crash before
+    // the truncate lands, replaying the old records on top is a no-op.
+    if (ftruncate(log_fd_, 0) != 0 || fdatasync(log_fd_) != 0) {
+        logError("Failed to truncate log after snapshot", {{"error", std::strerror(errno)}});
+        return false;
+    }
+    unsynced_records_ = 0;
+    records_since_snapshot_ = 0;
+    last_sync_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+// Todo methods
+std::vector<Todo> LogStore::getAllTodos(int user_id) {
+    Stripe& stripe = stripeFor(user_id);
+    std::shared_lock<std::shared_mutex> lock(stripe.mutex);
+    std::vector<Todo> todos;
+    
+    const CompactTodoList* found = stripe.findTodos(user_id);
+    if (!found) {
+        return todos;
+    }
+    
+    const CompactTodoList& list = *found;
+    todos.reserve(list.size());
+    for (auto todo = list.end(); todo != list.begin();) {
+        if (!(--todo)->erased()) {
+            todos.push_back(list.toTodo(*todo));
+        }
+    }
+    return todos;
+}
+
+// Copies the packed entries and their strings as they are: no per-todo
+// conversion or allocation.
+void LogStore::getAllTodos(int user_id, CompactTodoList& todos) {
+    Stripe& stripe = stripeFor(user_id);
+    std::shared_lock<std::shared_mutex> lock(stripe.mutex);
+    
+    const CompactTodoList* found = stripe.findTodos(user_id);
+    if (!found) {
+        return;
+    }
+    
+    const CompactTodoList& list = *found;
+    todos.reserve(todos.slotCount() + list.size(), todos.poolSize() + list.poolSize());
+    for (auto todo = list.end(); todo != list.begin();) {
+        if (!(--todo)->erased()) {
+            todos.append(list, *todo);
+        }
+    }
+}
+
+bool LogStore::readTodoBatch(int user_id, TodoCursor& cursor, size_t batch_size, CompactTodoList& batch) {
+    size_t before = batch.size();
+    if (!cursor.done) {
+        Stripe& stripe = stripeFor(user_id);
+        std::shared_lock<std::shared_mutex> lock(stripe.mutex);
+        if (const CompactTodoList* list = stripe.findTodos(user_id)) {
+            // Keyed lists are in ascending id order; walk down from the cursor
+            int below_id = cursor.id != 0 ? cursor.id : std::numeric_limits<int>::max();
+            auto todo = std::lower_bound(list->begin(), list->end(), below_id,
+                                         [](const CompactTodo& entry, int id) { return entry.id < id; });
+            while (todo != list->begin() && batch.size() - before < batch_size) {
+                if (!(--todo)->erased()) {
+                    batch.append(*list, *todo);
+                }
+            }
+        }
+    }
+    size_t read = batch.size() - before;
+    if (read > 0) {
+        cursor.id = batch[batch.slotCount() - 1].id;
+    }
+    cursor.done = read < batch_size;
+    return true;
+}
+
+Todo LogStore::getTodoById(int id, int user_id) {
+    Stripe& stripe = stripeFor(user_id);
+    std::shared_lock<std::shared_mutex> lock(stripe.mutex);
+    
+    if (const CompactTodoList* list = stripe.findTodos(user_id)) {
+        if (const CompactTodo* todo = list->find(id)) {
+            return list->toTodo(*todo);
+        }
+    }
+    return {-1, -1, "", false, "", "", ""};
+}
+
+Todo LogStore::createTodo(const std::string& text, int user_id, const std::string& due_date, const std::string& timestamp) {
+    Todo todo{-1, user_id, text, false, timestamp, timestamp, due_date};
+    {
+        std::shared_lock<std::shared_mutex> gate(snapshot_gate_);
+        Stripe& stripe = stripeFor(user_id);
+        std::unique_lock<std::shared_mutex> lock(stripe.mutex);
+        
+        int64_t seq;
+        {
+            std::lock_guard<std::mutex> log_lock(log_mutex_);
+            todo.id = next_todo_id_;
+            seq = change_seq_ + 1;
+            if (!appendLocked(encodeTodo(RecordType::TodoCreated, todo, seq))) {
+                return {-1, -1, "", false, "", "", ""};
+            }
+            next_todo_id_++;
+            change_seq_ = seq;
+        }
+        
+        stripe.todos(user_id).put(todo);
+        stripe.recordChange(user_id, todo.id, seq, false, "");
+    }
+    finishWrite();
+    return todo;
+}
+
+bool LogStore::importTodos(int user_id, std::vector<Todo>& todos) {
+    bool complete;
+    {
+        std::shared_lock<std::shared_mutex> gate(snapshot_gate_);
+        Stripe& stripe = stripeFor(user_id);
+        std::unique_lock<std::shared_mutex> lock(stripe.mutex);
+        
+        int64_t first_seq;
+        size_t appended = 0;
+        {
+            std::lock_guard<std::mutex> log_lock(log_mutex_);
+            first_seq = change_seq_ + 1;
+            for (Todo& todo : todos) {
+                todo.id = next_todo_id_;
+                if (!appendLocked(encodeTodo(RecordType::TodoCreated, todo, first_seq + static_cast<int64_t>(appended)))) {
+                    break;
+                }
+                next_todo_id_++;
+                appended++;
+            }
+            change_seq_ = first_seq + static_cast<int64_t>(appended) - 1;
+        }
+        
+        // Records already in the log come back on the next open, so memory
+        // keeps them too; the batch stops at a failed append
+        complete = appended == todos.size();
+        todos.resize(appended);
+        CompactTodoList& list = stripe.todos(user_id);
+        for (size_t i = 0; i < todos.size(); ++i) {
+            list.put(todos[i]);
+            stripe.recordChange(user_id, todos[i].id, first_seq + static_cast<int64_t>(i), false, "");
+        }
+    }
+    finishWrite();
+    return complete;
+}
+
+Todo LogStore::updateTodo(int id, const std::string& text, bool completed, int user_id, const std::string& timestamp) {
+    Todo todo;
+    {
+        std::shared_lock<std::shared_mutex> gate(snapshot_gate_);
+        Stripe& stripe = stripeFor(user_id);
+        std::unique_lock<std::shared_mutex> lock(stripe.mutex);
+        
+        auto it = stripe.todos_by_user.find(user_id);
+        const CompactTodo* existing = it != stripe.todos_by_user.end() ? it->second.find(id) : nullptr;
+        if (!existing) {
+            return {-1, -1, "", false, "", "", ""};
+        }
+        
+        todo = it->second.toTodo(*existing);
+        todo.text = text;
+        todo.completed = completed;
+        todo.updated_at = timestamp;
+        int64_t seq;
+        {
+            std::lock_guard<std::mutex> log_lock(log_mutex_);
+            seq = change_seq_ + 1;
+            if (!appendLocked(encodeTodo(RecordType::TodoUpdated, todo, seq))) {
+                return {-1, -1, "", false, "", "", ""};
+            }
+            change_seq_ = seq;
+        }
+        
+        it->second.put(todo);
+        stripe.recordChange(user_id, id, seq, false, "");
+    }
+    finishWrite();
+    return todo;
+}
+
+bool LogStore::deleteTodo(int id, int user_id, const std::string& timestamp) {
+    {
+        std::shared_lock<std::shared_mutex> gate(snapshot_gate_);
+        Stripe& stripe = stripeFor(user_id);
+        std::unique_lock<std::shared_mutex> lock(stripe.mutex);
+        
+        auto it = stripe.todos_by_user.find(user_id);
+        if (it == stripe.todos_by_user.end() || !it->second.find(id)) {
+            return false;
+        }
+        
+        int64_t seq;
+        {
+            std::lock_guard<std::mutex> log_lock(log_mutex_);
+            seq = change_seq_ + 1;
+            if (!appendLocked(encodeTombstone(id, user_id, seq, timestamp))) {
+                return false;
+            }
+            change_seq_ = seq;
+        }
+        
+        it->second.erase(id);
+        stripe.recordChange(user_id, id, seq, true, timestamp);
+    }
+    finishWrite();
+    return true;
+}
+
+// Scans the user's todos in memory: every query word must be a word of the
+// text, the last one only its prefix (case-insensitive), as with the FTS5
+// search. Ranked by how many words hit, then newest.
+std::vector<Todo> LogStore::searchTodos(int user_id, const std::string& query, int limit, int offset) {
+    auto lowerWords = [](std::string_view text) {
+        std::vector<std::string> words;
+        std::string word;
+        for (char c : text) {
+            if (std::isalnum(static_cast<unsigned char>(c)) || (c & 0x80)) {
+                word += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            } else if (!word.empty()) {
+                words.push_back(word);
+                word.clear();
+            }
+        }
+        if (!word.empty()) words.push_back(word);
+        return words;
+    };
+    
+    std::vector<std::string> terms = lowerWords(query);
+    std::vector<Todo> todos;
+    if (terms.empty() || limit <= 0) {
+        return todos;
+    }
+    
+    Stripe& stripe = stripeFor(user_id);
+    std::shared_lock<std::shared_mutex> lock(stripe.mutex);
+    const CompactTodoList* found = stripe.findTodos(user_id);
+    if (!found) {
+        return todos;
+    }
+    
+    const CompactTodoList& list = *found;
+    std::vector<std::pair<int, const CompactTodo*>> matches;
+    for (auto todo = list.end(); todo != list.begin();) {
+        if ((--todo)->erased()) continue;
+        std::vector<std::string> words = lowerWords(list.text(*todo));
+        int hits = 0;
+        bool all_terms = true;
+        for (size_t i = 0; i < terms.size(); ++i) {
+            const std::string& term = terms[i];
+            bool prefix = i + 1 == terms.size();
+            int term_hits = 0;
+            for (const auto& word : words) {
+                if (prefix ? word.compare(0, term.size(), term) == 0 : word == term) term_hits++;
+            }
+            all_terms = all_terms && term_hits > 0;
+            hits += term_hits;
+        }
+        if (all_terms) {
+            matches.push_back({hits, todo});
+        }
+    }
+    
+    std::stable_sort(matches.begin(), matches.end(),
+                     [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (size_t i = static_cast<size_t>(std::max(offset, 0)); i < matches.size() && todos.size() < static_cast<size_t>(limit); ++i) {
+        todos.push_back(list.toTodo(*matches[i].second));
+    }
+    return todos;
+}
+
+std::vector<Todo> LogStore::findTodos(int user_id, const TodoFilter& filter) {
+    std::vector<Todo> todos;
+    Stripe& stripe = stripeFor(user_id);
+    std::shared_lock<std::shared_mutex> lock(stripe.mutex);
+    const CompactTodoList* found = stripe.findTodos(user_id);
+    if (!found) {
+        return todos;
+    }
+    
+    const CompactTodoList& list = *found;
+    for (auto todo = list.end(); todo != list.begin();) {
+        const CompactTodo& t = *--todo;
+        std::string_view due_date = list.dueDate(t);
+        if (t.erased()) continue;
+        if (filter.hasDueRange() && due_date.empty()) continue;
+        if (!filter.due_after.empty() && !(due_date > filter.due_after)) continue;
+        if (!filter.due_before.empty() && !(due_date < filter.due_before)) continue;
+        if (filter.completed && t.completed() != *filter.completed) continue;
+        todos.push_back(list.toTodo(t));
+    }
+    if (filter.hasDueRange()) {
+        std::sort(todos.begin(), todos.end(), [](const Todo& a, const Todo& b) {
+            return a.due_date != b.due_date ? a.due_date < b.due_date : a.id < b.id;
+        });
+    }
+    return todos;
+}
+
+std::vector<DueDateBucket> LogStore::countOpenTodosByDay(int user_id, const std::string& from, const std::string& to) {
+    std::map<std::string, int> counts;
+    {
+        Stripe& stripe = stripeFor(user_id);
+        std::shared_lock<std::shared_mutex> lock(stripe.mutex);
+        if (const CompactTodoList* list = stripe.findTodos(user_id)) {
+            for (const CompactTodo& todo : *list) {
+                std::string_view due_date = list->dueDate(todo);
+                if (!todo.erased() && !todo.completed() && !due_date.empty() && due_date >= from && due_date < to) {
+                    counts[std::string(due_date.substr(0, 10))]++;
+                }
+            }
+        }
+    }
+    
+    std::vector<DueDateBucket> buckets;
+    for (const auto& [date, count] : counts) {
+        buckets.push_back({date, count});
+    }
+    return buckets;
+}
+
+// Holding the stripe shared means every sequence number of this user up to
+// change_seq_ has been applied; newer ones belong to other users.
+TodoChanges LogStore::getChangesSince(int user_id, int64_t since, int limit) {
+    Stripe& stripe = stripeFor(user_id);
+    std::shared_lock<std::shared_mutex> lock(stripe.mutex);
+    TodoChanges changes;
+    changes.seq = since;
+    if (since > change_seq_ || (since > 0 && since < purged_seq_)) {
+        changes.reset = true;
+        return changes;
+    }
+    
+    auto user_changes = stripe.changes_by_user.find(user_id);
+    const CompactTodoList* todos = stripe.findTodos(user_id);
+    if (user_changes == stripe.changes_by_user.end() || !todos) {
+        changes.seq = change_seq_;
+        return changes;
+    }
+    for (auto it = user_changes->second.upper_bound(since); it != user_changes->second.end(); ++it) {
+        if (it->second.deleted && since == 0) {
+            continue;
+        }
+        if (static_cast<int>(changes.changed.size() + changes.deleted.size()) >= limit) {
+            changes.has_more = true;
+            break;
+        }
+        if (it->second.deleted) {
+            changes.deleted.push_back(it->second.id);
+        } else {
+            changes.changed.push_back(todos->toTodo(*todos->find(it->second.id)));
+        }
+        changes.seq = it->first;
+    }
+    if (!changes.has_more) {
+        changes.seq = change_seq_;
+    }
+    return changes;
+}
+
+int LogStore::compactTombstones(const std::string& cutoff) {
+    int removed = 0;
+    for (Stripe& stripe : stripes_) {
+        std::shared_lock<std::shared_mutex> gate(snapshot_gate_);
+        std::unique_lock<std::shared_mutex> lock(stripe.mutex);
+        for (auto& user_changes : stripe.changes_by_user) {
+            for (auto it = user_changes.second.begin(); it != user_changes.second.end();) {
+                if (it->second.deleted && it->second.deleted_at < cutoff) {
+                    // Raised before the stripe is released, so its readers see the purge
+                    int64_t purged = purged_seq_.load();
+                    while (it->first > purged && !purged_seq_.compare_exchange_weak(purged, it->first)) {
+                    }
+                    stripe.change_seq_by_todo.erase(it->second.id);
+                    it = user_changes.second.erase(it);
+                    ++removed;
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+    if (removed > 0) {
+        takeSnapshot(false);
+    }
+    return removed;
+}
+
+// User methods
+std::optional<User> LogStore::createUser(const std::string& username, const std::string& email,
+                                         const std::string& password_hash, const std::string& timestamp) {
+    User user{-1, username, email, password_hash, timestamp, timestamp};
+    {
+        std::shared_lock<std::shared_mutex> gate(snapshot_gate_);
+        std::unique_lock<std::shared_mutex> lock(users_mutex_);
+        
+        if (user_ids_by_name_.count(username) || user_ids_by_email_.count(email)) {
+            return std::nullopt;
+        }
+        
+        user.id = next_user_id_;
+        {
+            std::lock_guard<std::mutex> log_lock(log_mutex_);
+            if (!appendLocked(encodeUser(RecordType::UserCreated, user))) {
+                return std::nullopt;
+            }
+        }
+        
+        next_user_id_++;
+        user_ids_by_name_[username] = user.id;
+        user_ids_by_email_[email] = user.id;
+        users_[user.id] = user;
+    }
+    finishWrite();
+    return user;
+}
+
+std::optional<User> LogStore::getUserByUsername(const std::string& username) {
+    std::shared_lock<std::shared_mutex> lock(users_mutex_);
+    
+    auto it = user_ids_by_name_.find(username);
+    if (it == user_ids_by_name_.end()) {
+        return std::nullopt;
+    }
+    return users_.at(it->second);
+}
+
+std::optional<User> LogStore::getUserById(int id) {
+    std::shared_lock<std::shared_mutex> lock(users_mutex_);
+    
+    auto it = users_.find(id);
+    if (it == users_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+bool LogStore::updatePasswordHash(int user_id, const std::string& password_hash, const std::string& timestamp) {
+    {
+        std::shared_lock<std::shared_mutex> gate(snapshot_gate_);
+        std::unique_lock<std::shared_mutex> lock(users_mutex_);
+        
+        auto it = users_.find(user_id);
+        if (it == users_.end()) {
+            return false;
+        }
+        User user = it->second;
+        user.password_hash = password_hash;
+        user.updated_at = timestamp;
+        {
+            std::lock_guard<std::mutex> log_lock(log_mutex_);
+            if (!appendLocked(encodeUser(RecordType::UserUpdated, user))) {
+                return false;
+            }
+        }
+        it->second = std::move(user);
+    }
+    finishWrite();
+    return true;
+}
+
+bool LogStore::userExists(const std::string& username, const std::string& email) {
+    std::shared_lock<std::shared_mutex> lock(users_mutex_);
+    return user_ids_by_name_.count(username) > 0 || user_ids_by_email_.count(email) > 0;
+}
@@ -0,0 +1,417 @@
+#include "logger.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr size_t kMaxFields = 8;
+// Text of all a record's fields together; longer text is cut short
+constexpr size_t kRecordTextBytes = 320;
+
+// A record as captured: values copied, nothing formatted
+struct LogRecord {
+    int64_t unix_micros;
+    const char* message;
+    uint64_t request_id;
+    int user_id;
+    LogLevel level;
+    uint32_t suppressed;
+    uint8_t field_count;
+    uint16_t text_used;
+    struct Field {
+        const char* key;
+        LogField::Kind kind;
+        int64_t integer;
+        double real;
+        uint16_t offset;
+        uint16_t size;
+    } fields[kMaxFields];
+    char text[kRecordTextBytes];
+};
+
+// Written by its thread only, read by the flusher only
+struct Ring {
+    explicit Ring(size_t capacity) : records(new LogRecord[capacity]), capacity(capacity) {}
+    
+    std::unique_ptr<LogRecord[]> records;
+    size_t capacity;
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+    std::atomic<uint64_t> dropped{0};
+};
+
+// The rate limit is kept per message, in a fixed table indexed by the
+// message's address; messages sharing a slot share its budget
+struct RateSlot {
+    std::atomic<int64_t> second{0};
+    std::atomic<uint32_t> count{0};
+    std::atomic<uint32_t> suppressed{0};
+};
+constexpr size_t kRateSlots = 256;
+
+struct LoggerState {
+    LogOptions options;
+    std::atomic<int> level{static_cast<int>(LogLevel::Info)};
+    std::atomic<uint32_t> rate_limit{20};
+    std::atomic<size_t> ring_records{64};
+    std::array<RateSlot, kRateSlots> rate_slots;
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> suppressed{0};
+    
+    // Set while the flusher runs; bumped by every start so threads register anew
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> generation{0};
+    int fd = STDERR_FILENO;
+    std::mutex rings_mutex;
+    std::vector<std::shared_ptr<Ring>> rings;
+    std::thread flusher;
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    bool wake_pending = false;
+    bool stopping = false;
+    // Serializes writes made without the flusher
+    std::mutex write_mutex;
+};
+
+LoggerState& state() {
+    static LoggerState instance;
+    return instance;
+}
+
+struct ThreadLog {
+    std::shared_ptr<Ring> ring;
+    uint64_t generation = 0;
+    uint64_t request_id = 0;
+    int user_id = 0;
+};
+
+thread_local ThreadLog thread_log;
+
+const char* levelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::Debug: return "debug";
+    case LogLevel::Info: return "info";
+    case LogLevel::Warning: return "warning";
+    case LogLevel::Error: return "error";
+    }
+    return "info";
+}
+
+void appendEscaped(std::string& out, std::string_view text) {
+    for (char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            } else {
+                out += c;
+            }
+        }
+    }
+}
+
+void appendRecord(std::string& out, const LogRecord& record) {
+    char number[64];
+    std::time_t seconds = static_cast<std::time_t>(record.unix_micros / 1000000);
+    std::tm utc;
+    gmtime_r(&seconds, &utc);
+    size_t length = std::strftime(number, sizeof(number), "%Y-%m-%dT%H:%M:%S", &utc);
+    std::snprintf(number + length, sizeof(number) - length, ".%06dZ", static_cast<int>(record.unix_micros % 1000000));
+    out += "{\"time\":\"";
+    out += number;
+    out += "\",\"level\":\"";
+    out += levelName(record.level);
+    out += "\",\"msg\":\"";
+    appendEscaped(out, record.message);
+    out += '"';
+    if (record.request_id != 0) {
+        out += ",\"request_id\":";
+        out += std::to_string(record.request_id);
+    }
+    if (record.user_id != 0) {
+        out += ",\"user_id\":";
+        out += std::to_string(record.user_id);
+    }
+    for (size_t i = 0; i < record.field_count; ++i) {
+        const LogRecord::Field& field = record.fields[i];
+        out += ",\"";
+        appendEscaped(out, field.key);
+        out += "\":";
+        switch (field.kind) {
+        case LogField::Kind::Text:
+            out += '"';
+            appendEscaped(out, std::string_view(record.text + field.offset, field.size));
+            out += '"';
+            break;
+        case LogField::Kind::Integer:
+            out += std::to_string(field.integer);
+            break;
+        case LogField::Kind::Real:
+            std::snprintf(number, sizeof(number), "%.6g", field.real);
+            out += number;
+            break;
+        }
+    }
+    if (record.suppressed != 0) {
+        out += ",\"suppressed\":";
+        out += std::to_string(record.suppressed);
+    }
+    out += "}\n";
+}
+
+void writeAll(int fd, const std::string& text) {
+    const char* data = text.data();
+    size_t left = text.size();
+    while (left > 0) {
+        ssize_t written = ::write(fd, data, left);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        left -= static_cast<size_t>(written);
+    }
+}
+
+void capture(LogRecord& record, LogLevel level, const char* message, std::initializer_list<LogField> fields,
+             int64_t unix_micros, uint32_t suppressed) {
+    record.unix_micros = unix_micros;
+    record.message = message;
+    record.request_id = thread_log.request_id;
+    record.user_id = thread_log.user_id;
+    record.level = level;
+    record.suppressed = suppressed;
+    record.field_count = 0;
+    record.text_used = 0;
+    for (const LogField& field : fields) {
+        if (record.field_count == kMaxFields) {
+            break;
+        }
+        LogRecord::Field& captured = record.fields[record.field_count++];
+        captured.key = field.key;
+        captured.kind = field.kind;
+        captured.integer = field.integer;
+        captured.real = field.real;
+        size_t size = std::min(field.text.size(), kRecordTextBytes - record.text_used);
+        captured.offset = record.text_used;
+        captured.size = static_cast<uint16_t>(size);
+        if (size > 0) {
+            std::memcpy(record.text + record.text_used, field.text.data(), size);
+        }
+        record.text_used = static_cast<uint16_t>(record.text_used + size);
+    }
+}
+
+// Formats what every ring holds and writes it in one go; forgets the rings
+// of threads that have exited once they are empty
+void drain(LoggerState& logger) {
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(logger.rings_mutex);
+        rings = logger.rings;
+    }
+    std::string out;
+    uint64_t written = 0;
+    uint64_t dropped = 0;
+    for (const auto& ring : rings) {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            appendRecord(out, ring->records[tail % ring->capacity]);
+            ++written;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+        dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+    }
+    if (dropped > 0) {
+        LogRecord record;
+        capture(record, LogLevel::Warning, "Log records dropped: thread buffers were full", {{"count", dropped}},
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count(), 0);
+        appendRecord(out, record);
+    }
+    if (!out.empty()) {
+        writeAll(logger.fd, out);
+        logger.written.fetch_add(written, std::memory_order_relaxed);
+    }
+    rings.clear();
+    
+    std::lock_guard<std::mutex> lock(logger.rings_mutex);
+    logger.rings.erase(std::remove_if(logger.rings.begin(), logger.rings.end(), [](const std::shared_ptr<Ring>& ring) {
+        // Only the registry holds it, so its thread is gone
+        return ring.use_count() == 1 && ring->tail.load() == ring->head.load();
+    }), logger.rings.end());
+}
+
+void flushLoop(LoggerState& logger) {
+    while (true) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(logger.wake_mutex);
+            logger.wake.wait_for(lock, logger.options.flush_interval,
+                                 [&] { return logger.wake_pending || logger.stopping; });
+            logger.wake_pending = false;
+            stopping = logger.stopping;
+        }
+        drain(logger);
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+// The calling thread's ring, registered with the running logger
+Ring& threadRing(LoggerState& logger) {
+    uint64_t generation = logger.generation.load(std::memory_order_acquire);
+    if (!thread_log.ring || thread_log.generation != generation) {
+        thread_log.ring = std::make_shared<Ring>(logger.ring_records.load(std::memory_order_relaxed));
+        thread_log.generation = generation;
+        std::lock_guard<std::mutex> lock(logger.rings_mutex);
+        logger.rings.push_back(thread_log.ring);
+    }
+    return *thread_log.ring;
+}
+
+}
+
+bool Logger::start(const LogOptions& options) {
+    LoggerState& logger = state();
+    stop();
+    
+    int fd = STDERR_FILENO;
+    if (!options.path.empty()) {
+        fd = open(options.path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            logError("Cannot open log file; logging to stderr", {{"path", options.path}, {"error", std::strerror(errno)}});
+            return false;
+        }
+    }
+    logger.options = options;
+    logger.fd = fd;
+    logger.level.store(static_cast<int>(options.level), std::memory_order_relaxed);
+    logger.rate_limit.store(options.rate_limit_per_second, std::memory_order_relaxed);
+    logger.ring_records.store(std::max<size_t>(options.thread_buffer_records, 1), std::memory_order_relaxed);
+    logger.stopping = false;
+    logger.generation.fetch_add(1, std::memory_order_release);
+    logger.flusher = std::thread(flushLoop, std::ref(logger));
+    logger.running.store(true, std::memory_order_release);
+    return true;
+}
+
+void Logger::stop() {
+    LoggerState& logger = state();
+    if (!logger.running.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(logger.wake_mutex);
+        logger.stopping = true;
+    }
+    logger.wake.notify_one();
+    logger.flusher.join();
+    {
+        std::lock_guard<std::mutex> lock(logger.rings_mutex);
+        logger.rings.clear();
+    }
+    if (logger.fd != STDERR_FILENO) {
+        close(logger.fd);
+        logger.fd = STDERR_FILENO;
+    }
+}
+
+LogStats Logger::stats() {
+    LoggerState& logger = state();
+    return {logger.written.load(std::memory_order_relaxed), logger.dropped.load(std::memory_order_relaxed),
+            logger.suppressed.load(std::memory_order_relaxed)};
+}
+
+void Logger::write(LogLevel level, const char* message, std::initializer_list<LogField> fields) {
+    LoggerState& logger = state();
+    if (static_cast<int>(level) < logger.level.load(std::memory_order_relaxed)) {
+        return;
+    }
+    int64_t unix_micros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    
+    uint32_t suppressed = 0;
+    uint32_t limit = logger.rate_limit.load(std::memory_order_relaxed);
+    if (limit > 0) {
+        RateSlot& slot = logger.rate_slots[(reinterpret_cast<uintptr_t>(message) * 0x9e3779b97f4a7c15ULL) >> 56];
+        int64_t second = unix_micros / 1000000;
+        int64_t seen = slot.second.load(std::memory_order_relaxed);
+        if (seen != second && slot.second.compare_exchange_strong(seen, second, std::memory_order_relaxed)) {
+            slot.count.store(0, std::memory_order_relaxed);
+        }
+        if (slot.count.fetch_add(1, std::memory_order_relaxed) >= limit) {
+            slot.suppressed.fetch_add(1, std::memory_order_relaxed);
+            logger.suppressed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        suppressed = slot.suppressed.exchange(0, std::memory_order_relaxed);
+    }
+    
+    if (!logger.running.load(std::memory_order_acquire)) {
+        LogRecord record;
+        capture(record, level, message, fields, unix_micros, suppressed);
+        std::string line;
+        appendRecord(line, record);
+        std::lock_guard<std::mutex> lock(logger.write_mutex);
+        writeAll(STDERR_FILENO, line);
+        logger.written.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    
+    Ring& ring = threadRing(logger);
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    uint64_t queued = head - ring.tail.load(std::memory_order_acquire);
+    if (queued >= ring.capacity) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        logger.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    capture(ring.records[head % ring.capacity], level, message, fields, unix_micros, suppressed);
+    ring.head.store(head + 1, std::memory_order_release);
+    // Half full: write out now rather than at the next interval
+    if (queued + 1 == ring.capacity / 2) {
+        {
+            std::lock_guard<std::mutex> lock(logger.wake_mutex);
+            logger.wake_pending = true;
+        }
+        logger.wake.notify_one();
+    }
+}
+
+LogContext::LogContext(uint64_t request_id) : request_id_(thread_log.request_id), user_id_(thread_log.user_id) {
+    thread_log.request_id = request_id;
+    thread_log.user_id = 0;
+}
+
+LogContext::~LogContext() {
+    thread_log.request_id = request_id_;
+    thread_log.user_id = user_id_;
+}
+
+void LogContext::setUser(int user_id) {
+    thread_log.user_id = user_id;
+}
@@ -1,114 +1,142 @@
 #include <iostream>
 #include <string>
-#include <sstream>
-#include <regex>
 #include <thread>
 #include <atomic>
 #include <csignal>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+#include <optional>
+#include <ctime>
+#include <cerrno>
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <unistd.h>
 #include <cstring>
+#include "buffer_pool.h"
+#include "bounded_executor.h"
 #include "todo_service.h"
 #include "auth_service.h"
+#include "event_hub.h"
+#include "json_utils.h"
+#include "http_request.h"
+#include "request_arena.h"
+#include "task_scheduler.h"
+#include "metrics.h"
+#include "request_trace.h"
+#include "logger.h"
 
-std::string escapeJson(const std::string& input) {
+std::string urlDecode(std::string_view value) {
     std::string output;
-    for (char c : input) {
-        switch (c) {
-            case '"': output += "\\\""; break;
-            case '\\': output += "\\\\"; break;
-            case '\b': output += "\\b"; break;
-            case '\f': output += "\\f"; break;
-            case '\n': output += "\\n"; break;
-            case '\r': output += "\\r"; break;
-            case '\t': output += "\\t"; break;
-            default: output += c; break;
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (value[i] == '+') {
+            output += ' ';
+        } else if (value[i] == '%' && i + 2 < value.size() &&
+                   std::isxdigit(static_cast<unsigned char>(value[i + 1])) &&
+                   std::isxdigit(static_cast<unsigned char>(value[i + 2]))) {
+            output += static_cast<char>(std::stoi(std::string(value.substr(i + 1, 2)), nullptr, 16));
+            i += 2;
+        } else {
+            output += value[i];
         }
     }
     return output;
 }
 
-std::string todoToJson(const Todo& todo) {
-    std::stringstream ss;
-    ss << "{";
-    ss << "\"id\":" << todo.id << ",";
-    ss << "\"user_id\":" << todo.user_id << ",";
-    ss << "\"text\":\"" << escapeJson(todo.text) << "\",";
-    ss << "\"completed\":" << (todo.completed ? "true" : "false") << ",";
-    ss << "\"created_at\":\"" << escapeJson(todo.created_at) << "\",";
-    ss << "\"updated_at\":\"" << escapeJson(todo.updated_at) << "\",";
-    ss << "\"due_date\":";
-    if (todo.due_date.empty()) {
-        ss << "null";
-    } else {
-        ss << "\"" << escapeJson(todo.due_date) << "\"";
-    }
-    ss << "}";
-    return ss.str();
+std::string extractQueryParam(std::string_view query, std::string_view name) {
+    size_t start = 0;
+    while (start <= query.size()) {
+        size_t end = query.find('&', start);
+        if (end == std::string_view::npos) end = query.size();
+        size_t eq = query.find('=', start);
+        if (eq != std::string_view::npos && eq < end && query.compare(start, eq - start, name) == 0) {
+            return urlDecode(query.substr(eq + 1, end - eq - 1));
+        }
+        start = end + 1;
+    }
+    return "";
 }
 
-std::string todosToJson(const std::vector<Todo>& todos) {
-    std::stringstream ss;
-    ss << "[";
-    for (size_t i = 0; i < todos.size(); ++i) {
-        if (i > 0) ss << ",";
-        ss << todoToJson(todos[i]);
-    }
-    ss << "]";
-    return ss.str();
+int extractQueryInt(std::string_view query, std::string_view name, int default_value) {
+    std::string value = extractQueryParam(query, name);
+    if (value.empty()) {
+        return default_value;
+    }
+    try {
+        return std::stoi(value);
+    } catch (const std::exception&) {
+        return default_value;
+    }
 }
 
-std::string userToJson(const User& user) {
-    std::stringstream ss;
-    ss << "{";
-    ss << "\"id\":" << user.id << ",";
-    ss << "\"username\":\"" << escapeJson(user.username) << "\",";
-    ss << "\"email\":\"" << escapeJson(user.email) << "\",";
-    ss << "\"created_at\":\"" << escapeJson(user.created_at) << "\",";
-    ss << "\"updated_at\":\"" << escapeJson(user.updated_at) << "\"";
-    ss << "}";
-    return ss.str();
+int64_t extractQueryInt64(std::string_view query, std::string_view name, int64_t default_value) {
+    std::string value = extractQueryParam(query, name);
+    if (value.empty()) {
+        return default_value;
+    }
+    try {
+        return std::stoll(value);
+    } catch (const std::exception&) {
+        return default_value;
+    }
 }
 
-std::string authResponseToJson(const UserAuth& user, const std::string& token) {
-    std::stringstream ss;
-    ss << "{";
-    ss << "\"user\":{";
-    ss << "\"id\":" << user.user_id << ",";
-    ss << "\"username\":\"" << escapeJson(user.username) << "\",";
-    ss << "\"email\":\"" << escapeJson(user.email) << "\"";
-    ss << "},";
-    ss << "\"token\":\"" << escapeJson(token) << "\"";
-    ss << "}";
-    return ss.str();
+// Accepts YYYY-MM-DD, optionally followed by a time part, so date bounds
+// compare sensibly against stored due dates.
+bool isIsoDate(const std::string& value) {
+    if (value.size() < 10) {
+        return false;
+    }
+    for (size_t i = 0; i < 10; ++i) {
+        bool ok = (i == 4 || i == 7) ? value[i] == '-' : std::isdigit(static_cast<unsigned char>(value[i])) != 0;
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
 }
 
-std::string extractJsonField(const std::string& json, const std::string& field) {
-    std::regex pattern("\"" + field + "\"\\s*:\\s*\"([^\"]+)\"");
-    std::smatch match;
-    if (std::regex_search(json, match, pattern)) {
-        return match[1].str();
-    }
-    return "";
+std::string currentUtcDate() {
+    std::time_t now = std::time(nullptr);
+    std::tm tm_utc;
+    gmtime_r(&now, &tm_utc);
+    char date[11];
+    std::strftime(date, sizeof(date), "%Y-%m-%d", &tm_utc);
+    return date;
 }
 
-bool extractJsonBool(const std::string& json, const std::string& field) {
-    std::regex pattern("\"" + field + "\"\\s*:\\s*(true|false)");
-    std::smatch match;
-    if (std::regex_search(json, match, pattern)) {
-        return match[1].str() == "true";
+// If-None-Match holds "*" or a comma-separated list of (possibly weak) tags.
+bool etagMatches(std::string_view if_none_match, const std::string& etag) {
+    size_t start = 0;
+    while (start < if_none_match.size()) {
+        size_t end = if_none_match.find(',', start);
+        if (end == std::string_view::npos) end = if_none_match.size();
+        size_t first = if_none_match.find_first_not_of(" \t", start);
+        size_t last = if_none_match.find_last_not_of(" \t", end - 1);
+        if (first != std::string_view::npos && first < end) {
+            std::string_view tag = if_none_match.substr(first, last - first + 1);
+            if (tag.compare(0, 2, "W/") == 0) tag = tag.substr(2);
+            if (tag == "*" || tag == etag) return true;
+        }
+        start = end + 1;
     }
     return false;
 }
 
-std::string extractAuthToken(const std::string& headers) {
-    std::regex pattern("Authorization:\\s*Bearer\\s+([^\\s]+)");
-    std::smatch match;
-    if (std::regex_search(headers, match, pattern)) {
-        return match[1].str();
+std::string extractAuthToken(std::string_view headers) {
+    std::string_view value = extractHeader(headers, "Authorization");
+    if (value.compare(0, 7, "Bearer ") != 0) {
+        return "";
     }
-    return "";
+    size_t start = value.find_first_not_of(" \t", 7);
+    if (start == std::string_view::npos) {
+        return "";
+    }
+    return std::string(value.substr(start, value.find_first_of(" \t", start) - start));
 }
 
 class SimpleHttpServer {
@@ -119,9 +147,72 @@ private:
     std::atomic<bool> running_{false};
     TodoService todoService_;
     AuthService authService_;
+    EventHub eventHub_;
+    BufferPool ioBuffers_;
+    // CPU-heavy stages of requests (encoding large lists) fan out here
+    // instead of running on the connection's thread alone
+    TaskScheduler cpuPool_;
+    // Requests that touch storage run here, and so do session checks that
+    // miss the cache; connection threads answer what needs no storage, wait
+    // for the rest and do the socket I/O
+    BoundedExecutor dbExecutor_;
+    HttpMetrics metrics_;
+    TraceWriter tracer_;
+    bool server_timing_;
+    // Tags log records with the request they were written for
+    std::atomic<uint64_t> next_request_id_{1};
+    
+    // How long an idle keep-alive connection is kept open
+    static constexpr int kKeepAliveTimeoutMs = 5000;
+    // How long a client may stall in the middle of a request
+    static constexpr int kReceiveTimeoutSeconds = 10;
+    // How long a client may stop reading a response
+    static constexpr int kSendTimeoutSeconds = 10;
+    // How long a streamed list may take in all, however steadily the client
+    // reads it
+    static constexpr int kStreamTimeoutSeconds = 120;
+    // Streamed lists: rows read from storage at a time, and the payload size
+    // at which a chunk is sent
+    static constexpr size_t kStreamBatchTodos = 64;
+    static constexpr size_t kStreamChunkBytes = 16 * 1024;
+    // Fixed-width hex size plus CRLF at the front of every chunk
+    static constexpr size_t kChunkHeaderBytes = 10;
+    // Imports: todos per transaction, and rejected line numbers reported
+    static constexpr size_t kImportBatchTodos = 1000;
+    static constexpr size_t kMaxReportedLines = 20;
+    
+    // Who a request is for, settled before the request itself is queued for
+    // storage
+    struct RequestAuth {
+        std::optional<UserAuth> user;
+        // The session needed a user lookup and the storage queue was full
+        bool busy = false;
+        // The user's list tag, for GET /api/todos; sampled before any read so
+        // a concurrent write can only make it stale, never too new
+        std::string etag;
+    };
+    
+    // A response whose body processRequest leaves to streamTodos
+    struct StreamedTodos {
+        int user_id;
+        // One todo per line instead of a JSON array
+        bool ndjson;
+        // Otherwise the body ends when the connection closes (HTTP/1.0)
+        bool chunked;
+    };
     
+    enum class ReadResult { Complete, Closed, Malformed, TooLarge, NoBuffer };
+
 public:
-    SimpleHttpServer(int p) : port(p) {
+    SimpleHttpServer(int p, std::shared_ptr<Database> db, const BufferPoolOptions& buffer_options = BufferPoolOptions(),
+                     size_t cpu_workers = 0, const BoundedExecutorOptions& db_executor_options = BoundedExecutorOptions(),
+                     const AuthOptions& auth_options = AuthOptions(), const TraceOptions& trace_options = TraceOptions())
+        : port(p), todoService_(db), authService_(db, auth_options), ioBuffers_(buffer_options), cpuPool_(cpu_workers),
+          dbExecutor_(db_executor_options), tracer_(trace_options), server_timing_(trace_options.server_timing) {
+        todoService_.setChangeListener([this](const TodoChange& change) {
+            publishChange(change);
+        });
+        
         server_fd = socket(AF_INET, SOCK_STREAM, 0);
         if (server_fd == 0) {
             throw std::runtime_error("Socket creation failed");
@@ -147,96 +238,857 @@ public:
         close(server_fd);
     }
     
-    void start() {
+    // Accepts connections until `stop_fd` becomes readable
+    void start(int stop_fd) {
         std::cout << "Server listening on port " << port << std::endl;
+        if (!eventHub_.start()) {
+            throw std::runtime_error("Event hub failed to start");
+        }
         running_ = true;
         
         while (running_) {
+            pollfd ready[2] = {{server_fd, POLLIN, 0}, {stop_fd, POLLIN, 0}};
+            if (poll(ready, 2, -1) < 0) {
+                if (errno != EINTR) {
+                    logError("Poll failed", {{"error", std::strerror(errno)}});
+                }
+                continue;
+            }
+            if (ready[1].revents != 0) {
+                break;
+            }
+            
             int client_socket;
             int addrlen = sizeof(address);
             
             client_socket = accept(server_fd, (struct sockaddr *)&address, (socklen_t*)&addrlen);
             if (client_socket < 0) {
                 if (running_) {
-                    std::cerr << "Accept failed" << std::endl;
+                    logError("Accept failed", {{"error", std::strerror(errno)}});
                 }
                 continue;
             }
             
             std::thread([this, client_socket]() {
-                handleRequest(client_socket);
+                handleConnection(client_socket);
             }).detach();
         }
+        eventHub_.stop();
     }
     
     void stop() {
         running_ = false;
         close(server_fd);
     }
-    
+
 private:
-    void handleRequest(int client_socket) {
-        char buffer[4096] = {0};
-        ssize_t bytes_read = read(client_socket, buffer, sizeof(buffer) - 1);
-        if (bytes_read <= 0) {
+    // Serves requests on one connection until the client closes it, asks to
+    // close, or stays idle past kKeepAliveTimeoutMs. A buffer is taken from
+    // the pool only once the socket is readable and goes back as soon as no
+    // unread request bytes are left, so idle connections hold no buffer.
+    void handleConnection(int client_socket) {
+        metrics_.connectionOpened();
+        timeval receive_timeout{kReceiveTimeoutSeconds, 0};
+        setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &receive_timeout, sizeof(receive_timeout));
+        timeval send_timeout{kSendTimeoutSeconds, 0};
+        setsockopt(client_socket, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+        // A streamed list goes out as head, chunks and terminator; with Nagle
+        // each write after the first waits for the client's delayed ACK
+        int no_delay = 1;
+        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+        
+        BufferPool::Buffer buffer;
+        // Bytes at the front of `buffer` not yet served (pipelined requests)
+        size_t buffered = 0;
+        while (running_) {
+            if (buffered == 0) {
+                buffer.release();
+                pollfd readable{client_socket, POLLIN, 0};
+                if (poll(&readable, 1, kKeepAliveTimeoutMs) <= 0) {
+                    break;
+                }
+                buffer = ioBuffers_.acquire(1);
+                if (!buffer) {
+                    sendStatus(client_socket, "503 Service Unavailable");
+                    metrics_.recordRequest(HttpMetrics::kOtherRoute, 503, 0);
+                    break;
+                }
+            }
+            // A request's latency runs from its first byte being available to its response being sent
+            RequestTrace trace;
+            uint64_t request_id = next_request_id_.fetch_add(1, std::memory_order_relaxed);
+            LogContext log_context(request_id);
+            
+            size_t length = 0;
+            size_t read_span = trace.begin("read");
+            ReadResult result = readRequest(client_socket, buffer, buffered, length);
+            trace.end(read_span);
+            if (result != ReadResult::Complete) {
+                int status = result == ReadResult::Malformed ? 400 :
+                             result == ReadResult::TooLarge ? 413 :
+                             result == ReadResult::NoBuffer ? 503 : 0;
+                if (status == 400) {
+                    sendStatus(client_socket, "400 Bad Request");
+                } else if (status == 413) {
+                    sendStatus(client_socket, "413 Payload Too Large");
+                } else if (status == 503) {
+                    sendStatus(client_socket, "503 Service Unavailable");
+                }
+                if (status != 0) {
+                    finishRequest(HttpMetrics::kOtherRoute, status, trace);
+                }
+                break;
+            }
+            
+            // Everything below allocates from here and is released in one go per request
+            RequestArena arena;
+            HttpRequest request;
+            size_t parse_span = trace.begin("parse");
+            bool parsed = parseHttpRequest(std::string_view(buffer.data(), length), request);
+            trace.end(parse_span);
+            if (!parsed) {
+                sendStatus(client_socket, "400 Bad Request");
+                finishRequest(HttpMetrics::kOtherRoute, 400, trace);
+                break;
+            }
+            size_t route = HttpMetrics::routeOf(request.method, request.path);
+            if (request.method == "GET" && request.path == "/api/todos/stream") {
+                if (int stream_status = startStream(client_socket, request, request_id, trace)) {
+                    finishRequest(route, stream_status, trace);
+                    metrics_.connectionClosed();
+                    tracer_.flushThread();
+                    return;
+                }
+            }
+            bool keep_alive = wantsKeepAlive(request);
+            std::pmr::string response(arena.resource());
+            // Set when streamTodos already wrote the whole response
+            std::optional<bool> streamed;
+            // Set when an import read its body itself; what follows it is
+            // then already at the front of `buffer`
+            bool body_consumed = false;
+            // Of a streamed response, whose head is gone by the time it is sent
+            int status = 0;
+            RequestAuth auth = authorize(request, request_id, trace);
+            std::optional<StreamedTodos> stream;
+            if (auth.busy) {
+                sendStatus(client_socket, "503 Service Unavailable");
+                finishRequest(route, 503, trace);
+                break;
+            } else if (request.method == "POST" && request.path == "/api/todos/import") {
+                // The body is received and parsed here; only its batch inserts wait for storage
+                body_consumed = true;
+                response = importTodos(client_socket, request, request_id, auth, buffer, buffered, length,
+                                       keep_alive, arena.resource());
+            } else if (needsStorage(request, auth)) {
+                auto processed = onStorage(request_id, auth, &trace, [&] {
+                    return processRequest(request, auth, arena.resource(), keep_alive, trace, &stream);
+                });
+                if (!processed) {
+                    // Storage is already this far behind; shed the request rather than queue more
+                    sendStatus(client_socket, "503 Service Unavailable");
+                    finishRequest(route, 503, trace);
+                    break;
+                }
+                response = std::move(*processed);
+            } else {
+                response = processRequest(request, auth, arena.resource(), keep_alive, trace, &stream);
+            }
+            if (stream) {
+                status = responseStatus(response);
+                TraceSpan stream_span(trace, "stream");
+                streamed = streamTodos(client_socket, response, *stream, request_id, auth, arena.resource(), status);
+                keep_alive = keep_alive && stream->chunked;
+            }
+            bool sent = true;
+            if (streamed) {
+                sent = *streamed;
+            } else {
+                TraceSpan send_span(trace, "send");
+                sent = sendAll(client_socket, response.data(), response.size());
+            }
+            finishRequest(route, streamed ? status : responseStatus(response), trace);
+            if (!sent || !keep_alive) {
+                break;
+            }
+            
+            if (!body_consumed) {
+                buffered -= length;
+                std::memmove(buffer.data(), buffer.data() + length, buffered);
+            }
+        }
+        metrics_.connectionClosed();
+        tracer_.flushThread();
+        close(client_socket);
+    }
+    
+    // Runs `job` on a database thread, for the request `request_id` of the
+    // user in `auth`, and waits for it. The wait and the run are recorded as
+    // storage stages, and the wait as a "queue" span of `trace` if given.
+    // Empty when the queue is full: storage is already this far behind, and
+    // the caller sheds the request rather than queue more.
+    template <typename Job>
+    std::optional<std::invoke_result_t<Job>> onStorage(uint64_t request_id, const RequestAuth& auth,
+                                                       RequestTrace* trace, Job&& job) {
+        uint64_t submitted = TraceClock::now();
+        auto result = dbExecutor_.submit([&] {
+            LogContext storage_log_context(request_id);
+            if (auth.user) {
+                LogContext::setUser(auth.user->user_id);
+            }
+            uint64_t running = TraceClock::now();
+            if (trace) {
+                trace->add("queue", submitted, running);
+            }
+            metrics_.recordStorageStage(HttpMetrics::StorageStage::Queue, TraceClock::nanosBetween(submitted, running));
+            auto value = job();
+            metrics_.recordStorageStage(HttpMetrics::StorageStage::Execute,
+                                        TraceClock::nanosBetween(running, TraceClock::now()));
+            return value;
+        });
+        if (!result.valid()) {
+            return std::nullopt;
+        }
+        return result.get();
+    }
+    
+    // Counts the request and, when it is sampled, writes its trace
+    void finishRequest(size_t route, int status, const RequestTrace& trace) {
+        metrics_.recordRequest(route, status, TraceClock::nanosBetween(trace.start(), TraceClock::now()));
+        if (tracer_.sample()) {
+            tracer_.write(trace, HttpMetrics::routeMethod(route), HttpMetrics::routePath(route), status);
+        }
+    }
+    
+    // Status code of a response built by buildResponse; 0 for anything else
+    static int responseStatus(std::string_view response) {
+        std::string_view prefix = "HTTP/1.1 ";
+        if (response.size() < prefix.size() + 3 || response.compare(0, prefix.size(), prefix) != 0) {
+            return 0;
+        }
+        int status = 0;
+        for (size_t i = prefix.size(); i < prefix.size() + 3; ++i) {
+            if (!std::isdigit(static_cast<unsigned char>(response[i]))) {
+                return 0;
+            }
+            status = status * 10 + (response[i] - '0');
+        }
+        return status;
+    }
+    
+    // Reads until the first `length` bytes of `buffer` hold a whole request,
+    // trading the buffer for a larger one from the pool when the request
+    // outgrows it.
+    ReadResult readRequest(int client_socket, BufferPool::Buffer& buffer, size_t& buffered, size_t& length) {
+        while (true) {
+            bool malformed = false;
+            length = requestLength(std::string_view(buffer.data(), buffered), malformed);
+            if (malformed) {
+                return ReadResult::Malformed;
+            }
+            // An import's body is parsed as it arrives, never held whole, so
+            // its length covers the head only even when the body is here too
+            if (length != 0 && isImportRequest(std::string_view(buffer.data(), buffered))) {
+                length = requestHeadLength(std::string_view(buffer.data(), buffered));
+                return ReadResult::Complete;
+            }
+            if (length != 0 && length <= buffered) {
+                return ReadResult::Complete;
+            }
+            
+            // Until the head is complete, all that is known is that one more byte is needed
+            size_t needed = length != 0 ? length : buffered + 1;
+            if (needed > ioBuffers_.maxBufferSize()) {
+                return ReadResult::TooLarge;
+            }
+            if (needed > buffer.capacity()) {
+                BufferPool::Buffer larger = ioBuffers_.acquire(needed);
+                if (!larger) {
+                    return ReadResult::NoBuffer;
+                }
+                std::memcpy(larger.data(), buffer.data(), buffered);
+                buffer = std::move(larger);
+            }
+            
+            ssize_t received = recv(client_socket, buffer.data() + buffered, buffer.capacity() - buffered, 0);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received <= 0) {
+                return ReadResult::Closed;
+            }
+            buffered += static_cast<size_t>(received);
+        }
+    }
+    
+    // Fails once `deadline` passes with data still unsent
+    static bool sendAll(int client_socket, const char* data, size_t size,
+                        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max()) {
+        while (size > 0) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            ssize_t sent = send(client_socket, data, size, MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            if (sent <= 0) {
+                return false;
+            }
+            data += sent;
+            size -= static_cast<size_t>(sent);
+        }
+        return true;
+    }
+    
+    // POST /api/todos/import: the body is NDJSON, one todo per line (see
+    // parseImportedTodo), parsed as it comes off the socket and inserted
+    // kImportBatchTodos at a time, so memory stays at one I/O buffer plus one
+    // batch whatever the size of the body. The body is read and parsed on
+    // this thread and only the inserts go to a database thread, so a client
+    // that trickles its upload never holds one. `head_length` bytes of
+    // `buffer` hold the request head. On success the bytes after the body are
+    // at the front of `buffer`; on failure the rest of the body may still be
+    // unread, so `keep_alive` is cleared.
+    std::pmr::string importTodos(int client_socket, const HttpRequest& request, uint64_t request_id,
+                                 const RequestAuth& auth, BufferPool::Buffer& buffer, size_t& buffered,
+                                 size_t head_length, bool& keep_alive, std::pmr::memory_resource* arena) {
+        auto start = std::chrono::steady_clock::now();
+        ImportSummary summary;
+        bool malformed = false;
+        size_t remaining = requestLength(std::string_view(buffer.data(), buffered), malformed) - head_length;
+        // The request views point into `buffer`, which may be swapped below
+        bool expects_continue = extractHeader(request.headers, "Expect") == "100-continue";
+        const std::optional<UserAuth>& user_auth = auth.user;
+        
+        auto finish = [&](int status_code) {
+            summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            keep_alive = keep_alive && status_code == 200;
+            return buildResponse(status_code, "application/json", "", importSummaryToJson(summary), keep_alive, arena);
+        };
+        if (!user_auth) {
+            keep_alive = false;
+            return buildResponse(401, "application/json", "", "{\"error\":\"Unauthorized\"}", keep_alive, arena);
+        }
+        // Lines are parsed in place, so the longest line is the largest buffer
+        if (buffer.capacity() < ioBuffers_.maxBufferSize()) {
+            BufferPool::Buffer larger = ioBuffers_.acquire(ioBuffers_.maxBufferSize());
+            if (!larger) {
+                summary.error = "Server busy";
+                return finish(503);
+            }
+            std::memcpy(larger.data(), buffer.data(), buffered);
+            buffer = std::move(larger);
+        }
+        if (expects_continue && remaining > buffered - head_length &&
+            !sendAll(client_socket, "HTTP/1.1 100 Continue\r\n\r\n", 25)) {
+            summary.error = "Connection lost";
+            return finish(400);
+        }
+        
+        std::vector<Todo> batch;
+        batch.reserve(kImportBatchTodos);
+        size_t line_number = 0;
+        // Stores the batch; on failure sets the summary's error and returns
+        // the status to answer with
+        auto flush = [&]() -> int {
+            auto stored = onStorage(request_id, auth, nullptr, [&] {
+                return todoService_.importTodos(user_auth->user_id, batch);
+            });
+            if (!stored) {
+                summary.error = "Server busy";
+                return 503;
+            }
+            summary.imported += batch.size();
+            batch.clear();
+            if (!*stored) {
+                summary.error = "Storage failed";
+                return 500;
+            }
+            return 0;
+        };
+        
+        char* data = buffer.data();
+        size_t begin = head_length;
+        size_t end = buffered;
+        while (remaining > 0) {
+            // Every complete line among the body bytes read so far; the last
+            // line needs no newline
+            size_t available = std::min(end - begin, remaining);
+            while (available > 0) {
+                char* newline = static_cast<char*>(std::memchr(data + begin, '\n', available));
+                if (!newline && available < remaining) {
+                    break;
+                }
+                size_t line_length = newline ? static_cast<size_t>(newline - (data + begin)) : available;
+                size_t consumed = newline ? line_length + 1 : line_length;
+                std::string_view line(data + begin, line_length);
+                if (!line.empty() && line.back() == '\r') {
+                    line.remove_suffix(1);
+                }
+                begin += consumed;
+                available -= consumed;
+                remaining -= consumed;
+                
+                line_number++;
+                Todo todo;
+                if (line.find_first_not_of(" \t") == std::string_view::npos) {
+                    continue;
+                } else if (parseImportedTodo(line, todo)) {
+                    batch.push_back(std::move(todo));
+                } else {
+                    summary.rejected++;
+                    if (summary.rejected_lines.size() < kMaxReportedLines) {
+                        summary.rejected_lines.push_back(line_number);
+                    }
+                }
+                if (batch.size() == kImportBatchTodos) {
+                    if (int failed = flush()) {
+                        return finish(failed);
+                    }
+                }
+            }
+            if (remaining == 0) {
+                break;
+            }
+            
+            // Keep the partial line and read more behind it
+            std::memmove(data, data + begin, end - begin);
+            end -= begin;
+            begin = 0;
+            if (end == buffer.capacity()) {
+                summary.error = "Line " + std::to_string(line_number + 1) + " is longer than " +
+                                std::to_string(buffer.capacity()) + " bytes";
+                return finish(413);
+            }
+            ssize_t received = recv(client_socket, data + end, buffer.capacity() - end, 0);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received <= 0) {
+                summary.error = "Body ended early";
+                return finish(400);
+            }
+            end += static_cast<size_t>(received);
+        }
+        if (!batch.empty()) {
+            if (int failed = flush()) {
+                return finish(failed);
+            }
+        }
+        
+        // Pipelined requests behind the body
+        buffered = end - begin;
+        std::memmove(data, data + begin, buffered);
+        std::pmr::string response = finish(200);
+        logInfo("Imported todos", {{"rows", summary.imported}, {"seconds", summary.seconds},
+                                   {"rows_per_second", summary.seconds > 0 ? summary.imported / summary.seconds : 0}});
+        return response;
+    }
+    
+    static bool isImportRequest(std::string_view data) {
+        std::string_view target = "POST /api/todos/import";
+        return data.size() > target.size() && data.compare(0, target.size(), target) == 0 &&
+               (data[target.size()] == ' ' || data[target.size()] == '?');
+    }
+    
+    // The user `token` belongs to. A cached session, and a token whose
+    // signature or expiry fails, are settled on this thread from memory;
+    // otherwise the user is read on a database thread, and `busy` is set
+    // when its queue is full.
+    std::optional<UserAuth> checkSession(const std::string& token, uint64_t request_id, RequestTrace& trace,
+                                         bool& busy) {
+        TraceSpan auth_span(trace, "auth");
+        bool needs_lookup = false;
+        auto user = authService_.checkToken(token, needs_lookup);
+        if (needs_lookup) {
+            auto loaded = onStorage(request_id, RequestAuth(), &trace, [&] { return authService_.loadSession(token); });
+            busy = !loaded;
+            user = loaded ? *loaded : std::nullopt;
+        }
+        return user;
+    }
+    
+    // Checks the session of a request that needs one (see checkSession), and
+    // for GET /api/todos samples the list's tag in memory
+    RequestAuth authorize(const HttpRequest& request, uint64_t request_id, RequestTrace& trace) {
+        RequestAuth auth;
+        bool todos = request.path.rfind("/api/todos", 0) == 0;
+        if (request.method == "OPTIONS" || !(todos || (request.method == "GET" && request.path == "/api/auth/me"))) {
+            return auth;
+        }
+        auth.user = checkSession(extractAuthToken(request.headers), request_id, trace, auth.busy);
+        if (!auth.user) {
+            return auth;
+        }
+        LogContext::setUser(auth.user->user_id);
+        if (request.method == "GET" && request.path == "/api/todos") {
+            auth.etag = todoService_.getEtag(auth.user->user_id);
+        }
+        return auth;
+    }
+    
+    // Whether answering the request reads or writes storage, so it has to
+    // wait for a database thread. A request that fails authentication and a
+    // list the client already holds are answered without, and a streamed
+    // list only sends its rows to storage a batch at a time.
+    static bool needsStorage(const HttpRequest& request, const RequestAuth& auth) {
+        if (request.method == "OPTIONS" || !auth.user || streamsTodos(request)) {
+            return false;
+        }
+        if (request.method == "GET" && request.path == "/api/todos" &&
+            etagMatches(extractHeader(request.headers, "If-None-Match"), auth.etag)) {
+            return false;
+        }
+        return true;
+    }
+    
+    // The lists processRequest leaves to streamTodos: the export, and an
+    // unfiltered todo list for an HTTP/1.1 client
+    static bool streamsTodos(const HttpRequest& request) {
+        if (request.method != "GET") {
+            return false;
+        }
+        return request.path == "/api/todos/export" ||
+               (request.path == "/api/todos" && request.version == "HTTP/1.1" &&
+                extractQueryParam(request.query, "due_after").empty() &&
+                extractQueryParam(request.query, "due_before").empty() &&
+                extractQueryParam(request.query, "completed").empty());
+    }
+    
+    // Sends `head`, then the user's todos as a JSON array or as NDJSON. The
+    // rows are read kStreamBatchTodos at a time on a database thread and sent
+    // from this one, so a client that reads slowly holds its own connection
+    // thread, never a database thread; memory stays at about one chunk
+    // however long the list is, and the whole transfer has
+    // kStreamTimeoutSeconds. Returns false when the client went away,
+    // storage failed or the time ran out part way; the body is then cut short
+    // and the connection must be closed. When the first batch cannot be read
+    // nothing is sent but an error status, which goes into `status`.
+    bool streamTodos(int client_socket, const std::pmr::string& head, const StreamedTodos& stream,
+                     uint64_t request_id, const RequestAuth& auth, std::pmr::memory_resource* arena, int& status) {
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + std::chrono::seconds(kStreamTimeoutSeconds);
+        TodoCursor cursor;
+        CompactTodoList batch(stream.user_id, arena);
+        auto readBatch = [&] {
+            batch.clear();
+            auto read = onStorage(request_id, auth, nullptr, [&] {
+                return todoService_.readTodoBatch(stream.user_id, cursor, kStreamBatchTodos, batch);
+            });
+            return read ? (*read ? 200 : 500) : 503;
+        };
+        int first = readBatch();
+        if (first != 200) {
+            status = first;
+            sendStatus(client_socket, first == 503 ? "503 Service Unavailable" : "500 Internal Server Error");
+            return false;
+        }
+        if (!sendAll(client_socket, head.data(), head.size(), deadline)) {
+            return false;
+        }
+        
+        std::pmr::string chunk(arena);
+        // Room for the largest todo past the threshold without regrowing
+        chunk.reserve(2 * kStreamChunkBytes);
+        chunk.assign(kChunkHeaderBytes, ' ');
+        if (!stream.ndjson) {
+            chunk += '[';
+        }
+        size_t rows = 0;
+        while (true) {
+            for (const CompactTodo& todo : batch) {
+                if (!stream.ndjson && rows > 0) chunk += ',';
+                appendTodoJson(chunk, batch, todo);
+                if (stream.ndjson) chunk += '\n';
+                rows++;
+            }
+            if (chunk.size() - kChunkHeaderBytes >= kStreamChunkBytes &&
+                !sendChunk(client_socket, chunk, stream.chunked, deadline)) {
+                return false;
+            }
+            if (cursor.done) {
+                break;
+            }
+            if (readBatch() != 200) {
+                return false;
+            }
+        }
+        if (!stream.ndjson) {
+            chunk += ']';
+        }
+        if (!sendChunk(client_socket, chunk, stream.chunked, deadline) ||
+            (stream.chunked && !sendAll(client_socket, "0\r\n\r\n", 5, deadline))) {
+            return false;
+        }
+        if (stream.ndjson) {
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            logInfo("Exported todos", {{"rows", rows}, {"seconds", seconds}, {"rows_per_second", seconds > 0 ? rows / seconds : 0}});
+        }
+        return true;
+    }
+    
+    // Sends what follows the header placeholder at the front of `chunk`,
+    // framed as one chunk if `chunked`, then empties it back down to the
+    // placeholder.
+    static bool sendChunk(int client_socket, std::pmr::string& chunk, bool chunked,
+                          std::chrono::steady_clock::time_point deadline) {
+        if (!chunked) {
+            bool sent = sendAll(client_socket, chunk.data() + kChunkHeaderBytes, chunk.size() - kChunkHeaderBytes,
+                                deadline);
+            chunk.resize(kChunkHeaderBytes);
+            return sent;
+        }
+        size_t size = chunk.size() - kChunkHeaderBytes;
+        // Leading zeros are allowed, so the size fits the placeholder exactly
+        for (size_t i = kChunkHeaderBytes - 2; i-- > 0;) {
+            chunk[i] = "0123456789abcdef"[size & 0xf];
+            size >>= 4;
+        }
+        chunk[kChunkHeaderBytes - 2] = '\r';
+        chunk[kChunkHeaderBytes - 1] = '\n';
+        chunk += "\r\n";
+        bool sent = sendAll(client_socket, chunk.data(), chunk.size(), deadline);
+        chunk.resize(kChunkHeaderBytes);
+        return sent;
+    }
+    
+    // Body-less response for errors that end the connection
+    static void sendStatus(int client_socket, const char* status) {
+        std::string response = std::string("HTTP/1.1 ") + status +
+                               "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        sendAll(client_socket, response.data(), response.size());
+    }
+    
+    // Hands an authenticated SSE request over to the event hub, which owns
+    // the socket from then on, and returns the status answered. Returns 0
+    // (socket untouched) when the request is not authorized, so the regular
+    // path can answer 401.
+    int startStream(int client_socket, const HttpRequest& request, uint64_t request_id, RequestTrace& trace) {
+        // EventSource cannot set headers, so browsers pass the token in the query
+        std::string token = extractAuthToken(request.headers);
+        if (token.empty()) {
+            token = extractQueryParam(request.query, "token");
+        }
+        bool busy = false;
+        auto user_auth = checkSession(token, request_id, trace, busy);
+        if (busy) {
+            sendStatus(client_socket, "503 Service Unavailable");
             close(client_socket);
-            return;
+            return 503;
         }
+        if (!user_auth) {
+            return 0;
+        }
+        LogContext::setUser(user_auth->user_id);
         
-        std::string request(buffer, bytes_read);
-        std::string response = processRequest(request);
+        std::string head = "HTTP/1.1 200 OK\r\n"
+                           "Content-Type: text/event-stream\r\n"
+                           "Cache-Control: no-cache\r\n"
+                           "Connection: keep-alive\r\n"
+                           "X-Accel-Buffering: no\r\n"
+                           "Access-Control-Allow-Origin: *\r\n\r\n";
+        if (send(client_socket, head.c_str(), head.length(), MSG_NOSIGNAL) < 0) {
+            close(client_socket);
+            return 200;
+        }
         
-        send(client_socket, response.c_str(), response.length(), 0);
-        close(client_socket);
+        // Events are not replayed; a (re)connecting client reloads the list
+        // if the version in "ready" differs from what it has. The version is
+        // read once the stream is registered, so a change made meanwhile is
+        // either counted in it or sent as an event after it.
+        int user_id = user_auth->user_id;
+        auto initial = [this, user_id] {
+            uint64_t version = todoService_.getVersion(user_id);
+            return "retry: 3000\n\n" +
+                EventHub::formatEvent("ready", "{\"version\":" + std::to_string(version) + "}", std::to_string(version));
+        };
+        if (!eventHub_.subscribe(client_socket, user_id, initial)) {
+            close(client_socket);
+        }
+        return 200;
+    }
+    
+    void publishChange(const TodoChange& change) {
+        const char* event = change.type == TodoChange::Type::Created ? "created" :
+                            change.type == TodoChange::Type::Updated ? "updated" : "deleted";
+        std::string data = change.type == TodoChange::Type::Deleted
+            ? "{\"id\":" + std::to_string(change.todo.id) + "}"
+            : todoToJson(change.todo);
+        eventHub_.publish(change.user_id, EventHub::formatEvent(event, data, std::to_string(change.version)));
     }
     
-    std::string processRequest(const std::string& request) {
-        std::istringstream iss(request);
-        std::string method, path, version;
-        iss >> method >> path >> version;
+    // Builds the full response in `arena` for the caller `auth` describes;
+    // the request views stay valid for the duration of the call. Without
+    // `keep_alive` the response tells
+    // the client that the connection closes after it. Given `stream`, an
+    // unfiltered todo list for an HTTP/1.1 client and an export are not
+    // built: only the head is returned and `stream` says what streamTodos
+    // should send after it. Its stages are timed as spans of `trace`.
+    std::pmr::string processRequest(const HttpRequest& request, const RequestAuth& auth,
+                                    std::pmr::memory_resource* arena, bool keep_alive, RequestTrace& trace,
+                                    std::optional<StreamedTodos>* stream = nullptr) {
+        std::string_view method = request.method;
+        std::string_view path = request.path;
+        std::string_view query = request.query;
         
         // Handle OPTIONS for CORS
         if (method == "OPTIONS") {
-            return "HTTP/1.1 200 OK\r\n"
-                   "Access-Control-Allow-Origin: *\r\n"
-                   "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n"
-                   "Access-Control-Allow-Headers: Content-Type, Authorization\r\n"
-                   "Content-Length: 0\r\n\r\n";
+            std::pmr::string response("HTTP/1.1 200 OK\r\n"
+                                      "Access-Control-Allow-Origin: *\r\n"
+                                      "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n"
+                                      "Access-Control-Allow-Headers: Content-Type, Authorization, If-None-Match\r\n", arena);
+            if (!keep_alive) {
+                response += "Connection: close\r\n";
+            }
+            response += "Content-Length: 0\r\n\r\n";
+            return response;
         }
         
-        std::string headers = request.substr(0, request.find("\r\n\r\n"));
-        std::string body;
-        size_t body_start = request.find("\r\n\r\n");
-        if (body_start != std::string::npos) {
-            body = request.substr(body_start + 4);
-        }
+        std::string_view headers = request.headers;
+        std::string_view body = request.body;
         
-        std::string response_body;
-        std::string content_type = "application/json";
+        std::pmr::string response_body(arena);
+        const char* content_type = "application/json";
+        std::pmr::string extra_headers(arena);
         int status_code = 200;
         
         try {
             // Authentication endpoints
             if (method == "POST" && path == "/api/auth/register") {
-                response_body = handleRegister(body);
                 status_code = 201;
+                response_body = handleRegister(body, status_code);
             } else if (method == "POST" && path == "/api/auth/login") {
-                response_body = handleLogin(body);
+                response_body = handleLogin(body, status_code);
             } else if (method == "GET" && path == "/api/auth/me") {
-                std::string token = extractAuthToken(headers);
-                response_body = handleGetMe(token);
+                response_body = handleGetMe(auth.user);
+            } else if (method == "GET" && path == "/api/status") {
+                response_body = statusToJson(ioBuffers_.stats(), cpuPool_.stats(), dbExecutor_.stats(),
+                                             authService_.stats());
+            } else if (method == "GET" && path == "/metrics") {
+                std::string metrics;
+                metrics_.appendPrometheus(metrics);
+                appendRuntimeMetrics(metrics, ioBuffers_.stats(), cpuPool_.stats(), dbExecutor_.stats(),
+                                     authService_.stats());
+                appendLogMetrics(metrics, Logger::stats());
+                response_body = metrics;
+                content_type = "text/plain; version=0.0.4";
             }
             // Todo endpoints (require authentication)
             else if (path.find("/api/todos") == 0) {
-                std::string token = extractAuthToken(headers);
-                auto user_auth = authService_.validateToken(token);
+                const std::optional<UserAuth>& user_auth = auth.user;
                 if (!user_auth) {
                     response_body = "{\"error\":\"Unauthorized\"}";
                     status_code = 401;
                 } else {
+                    TraceSpan handler_span(trace, "handler");
                     if (method == "GET" && path == "/api/todos") {
-                        auto todos = todoService_.getAllTodos(user_auth->user_id);
-                        response_body = todosToJson(todos);
+                        const std::string& etag = auth.etag;
+                        TodoFilter filter;
+                        filter.due_after = extractQueryParam(query, "due_after");
+                        filter.due_before = extractQueryParam(query, "due_before");
+                        std::string completed = extractQueryParam(query, "completed");
+                        if (completed == "true" || completed == "false") {
+                            filter.completed = completed == "true";
+                        }
+                        
+                        if ((!filter.due_after.empty() && !isIsoDate(filter.due_after)) ||
+                            (!filter.due_before.empty() && !isIsoDate(filter.due_before))) {
+                            response_body = "{\"error\":\"Due date bounds must be YYYY-MM-DD\"}";
+                            status_code = 400;
+                        } else if (!completed.empty() && !filter.completed) {
+                            response_body = "{\"error\":\"completed must be true or false\"}";
+                            status_code = 400;
+                        } else if (etagMatches(extractHeader(headers, "If-None-Match"), etag)) {
+                            // Nothing changed since the client's copy: no DB read, no serialization
+                            status_code = 304;
+                        } else if (filter.hasDueRange() || filter.completed) {
+                            size_t db_span = trace.begin("db");
+                            std::vector<Todo> todos = todoService_.findTodos(user_auth->user_id, filter);
+                            trace.end(db_span);
+                            TraceSpan serialize_span(trace, "serialize");
+                            response_body = todosToJson(todos);
+                        } else if (stream && streamsTodos(request)) {
+                            *stream = StreamedTodos{user_auth->user_id, false, true};
+                            extra_headers += "Transfer-Encoding: chunked\r\n";
+                        } else {
+                            CompactTodoList todos(user_auth->user_id, arena);
+                            size_t db_span = trace.begin("db");
+                            todoService_.getAllTodos(user_auth->user_id, todos);
+                            trace.end(db_span);
+                            TraceSpan serialize_span(trace, "serialize");
+                            response_body.reserve(todos.size() * 160 + todos.poolSize() + 2);
+                            appendTodosJson(response_body, todos, cpuPool_);
+                        }
+                        if (status_code == 200 || status_code == 304) {
+                            extra_headers += "ETag: ";
+                            extra_headers += etag;
+                            extra_headers += "\r\nCache-Control: no-cache\r\n";
+                        }
+                    } else if (method == "GET" && path == "/api/todos/export") {
+                        if (stream) {
+                            // HTTP/1.0 clients get the body until the connection closes
+                            bool chunked = request.version == "HTTP/1.1";
+                            *stream = StreamedTodos{user_auth->user_id, true, chunked};
+                            content_type = "application/x-ndjson";
+                            extra_headers += "Content-Disposition: attachment; filename=\"todos.ndjson\"\r\n";
+                            if (chunked) {
+                                extra_headers += "Transfer-Encoding: chunked\r\n";
+                            } else {
+                                keep_alive = false;
+                            }
+                        } else {
+                            response_body = "{\"error\":\"Export is only served as a stream\"}";
+                            status_code = 500;
+                        }
+                    } else if (method == "GET" && path == "/api/todos/changes") {
+                        int64_t since = extractQueryInt64(query, "since", 0);
+                        int limit = std::min(std::max(extractQueryInt(query, "limit", 500), 1), 1000);
+                        if (since >= 0) {
+                            auto changes = todoService_.getChangesSince(user_auth->user_id, since, limit);
+                            response_body = todoChangesToJson(changes);
+                        } else {
+                            response_body = "{\"error\":\"since must not be negative\"}";
+                            status_code = 400;
+                        }
+                    } else if (method == "GET" && path == "/api/todos/overdue") {
+                        // Clients pass their local date; the server's UTC date is the fallback
+                        std::string today = extractQueryParam(query, "today");
+                        if (today.empty()) {
+                            today = currentUtcDate();
+                        }
+                        if (isIsoDate(today)) {
+                            response_body = todosToJson(todoService_.getOverdueTodos(user_auth->user_id, today));
+                        } else {
+                            response_body = "{\"error\":\"today must be YYYY-MM-DD\"}";
+                            status_code = 400;
+                        }
+                    } else if (method == "GET" && path == "/api/todos/calendar") {
+                        std::string from = extractQueryParam(query, "from");
+                        std::string to = extractQueryParam(query, "to");
+                        if (isIsoDate(from) && isIsoDate(to)) {
+                            auto buckets = todoService_.countOpenTodosByDay(user_auth->user_id, from, to);
+                            response_body = dueDateBucketsToJson(buckets);
+                        } else {
+                            response_body = "{\"error\":\"from and to are required (YYYY-MM-DD)\"}";
+                            status_code = 400;
+                        }
+                    } else if (method == "GET" && path == "/api/todos/search") {
+                        std::string q = extractQueryParam(query, "q");
+                        int limit = std::min(std::max(extractQueryInt(query, "limit", 20), 1), 100);
+                        int offset = std::max(extractQueryInt(query, "offset", 0), 0);
+                        if (!q.empty()) {
+                            // Fetch one extra row to learn whether another page exists
+                            auto todos = todoService_.searchTodos(user_auth->user_id, q, limit + 1, offset);
+                            bool has_more = todos.size() > static_cast<size_t>(limit);
+                            if (has_more) {
+                                todos.pop_back();
+                            }
+                            response_body = searchResultsToJson(todos, limit, offset, has_more);
+                        } else {
+                            response_body = "{\"error\":\"Query parameter q is required\"}";
+                            status_code = 400;
+                        }
                     } else if (method == "POST" && path == "/api/todos") {
                         std::string text = extractJsonField(body, "text");
                         std::string due_date = extractJsonField(body, "dueDate");
@@ -249,7 +1101,7 @@ private:
                             status_code = 400;
                         }
                     } else if (method == "PUT" && path.find("/api/todos/") == 0) {
-                        int id = std::stoi(path.substr(11));
+                        int id = std::stoi(std::string(path.substr(11)));
                         std::string text = extractJsonField(body, "text");
                         bool completed = extractJsonBool(body, "completed");
                         
@@ -261,7 +1113,7 @@ private:
                             status_code = 404;
                         }
                     } else if (method == "DELETE" && path.find("/api/todos/") == 0) {
-                        int id = std::stoi(path.substr(11));
+                        int id = std::stoi(std::string(path.substr(11)));
                         bool success = todoService_.deleteTodo(id, user_auth->user_id);
                         if (success) {
                             response_body = "";
@@ -279,30 +1131,61 @@ private:
         } catch (const std::exception& e) {
             response_body = "{\"error\":\"Internal server error\"}";
             status_code = 500;
-            std::cerr << "Error processing request: " << e.what() << std::endl;
+            logError("Error processing request", {{"error", e.what()}});
         }
         
-        std::string status_text = (status_code == 200) ? "OK" : 
+        if (server_timing_) {
+            trace.appendServerTiming(extra_headers);
+        }
+        // A 304 must not advertise a length other than the full response's,
+        // and a streamed body has none
+        bool send_length = status_code != 304 && !(stream && *stream);
+        return buildResponse(status_code, content_type, extra_headers, response_body, keep_alive, arena, send_length);
+    }
+    
+    static std::pmr::string buildResponse(int status_code, const char* content_type, std::string_view extra_headers,
+                                          std::string_view response_body, bool keep_alive,
+                                          std::pmr::memory_resource* arena, bool send_length = true) {
+        const char* status_text = (status_code == 200) ? "OK" : 
                                  (status_code == 201) ? "Created" :
                                  (status_code == 204) ? "No Content" :
+                                 (status_code == 304) ? "Not Modified" :
                                  (status_code == 400) ? "Bad Request" :
                                  (status_code == 401) ? "Unauthorized" :
-                                 (status_code == 404) ? "Not Found" : "Internal Server Error";
+                                 (status_code == 404) ? "Not Found" :
+                                 (status_code == 413) ? "Payload Too Large" :
+                                 (status_code == 503) ? "Service Unavailable" : "Internal Server Error";
         
-        std::ostringstream response;
-        response << "HTTP/1.1 " << status_code << " " << status_text << "\r\n";
-        response << "Content-Type: " << content_type << "\r\n";
-        response << "Access-Control-Allow-Origin: *\r\n";
-        response << "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n";
-        response << "Access-Control-Allow-Headers: Content-Type, Authorization\r\n";
-        response << "Content-Length: " << response_body.length() << "\r\n";
-        response << "\r\n";
-        response << response_body;
+        std::pmr::string response(arena);
+        response.reserve(320 + extra_headers.size() + response_body.size());
+        response += "HTTP/1.1 ";
+        response += std::to_string(status_code);
+        response += " ";
+        response += status_text;
+        response += "\r\nContent-Type: ";
+        response += content_type;
+        response += "\r\n";
+        response += "Access-Control-Allow-Origin: *\r\n";
+        response += "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n";
+        response += "Access-Control-Allow-Headers: Content-Type, Authorization, If-None-Match\r\n";
+        response += "Access-Control-Expose-Headers: ETag\r\n";
+        response += extra_headers;
+        if (!keep_alive) {
+            response += "Connection: close\r\n";
+        }
+        if (send_length) {
+            response += "Content-Length: ";
+            response += std::to_string(response_body.length());
+            response += "\r\n";
+        }
+        response += "\r\n";
+        response += response_body;
         
-        return response.str();
+        return response;
     }
     
-    std::string handleRegister(const std::string& body) {
+    // Set `status_code` to 503 when the password hashing pool is full
+    std::string handleRegister(std::string_view body, int& status_code) {
         std::string username = extractJsonField(body, "username");
         std::string email = extractJsonField(body, "email");
         std::string password = extractJsonField(body, "password");
@@ -311,7 +1194,12 @@ private:
             return "{\"error\":\"Username, email, and password are required\"}";
         }
         
-        auto user = authService_.registerUser(username, email, password);
+        bool busy = false;
+        auto user = authService_.registerUser(username, email, password, &busy);
+        if (busy) {
+            status_code = 503;
+            return "{\"error\":\"Too many logins, try again shortly\"}";
+        }
         if (!user) {
             return "{\"error\":\"User already exists or registration failed\"}";
         }
@@ -322,7 +1210,7 @@ private:
         return authResponseToJson(user_auth, token);
     }
     
-    std::string handleLogin(const std::string& body) {
+    std::string handleLogin(std::string_view body, int& status_code) {
         std::string username = extractJsonField(body, "username");
         std::string password = extractJsonField(body, "password");
         
@@ -330,7 +1218,12 @@ private:
             return "{\"error\":\"Username and password are required\"}";
         }
         
-        auto user_auth = authService_.loginUser(username, password);
+        bool busy = false;
+        auto user_auth = authService_.loginUser(username, password, &busy);
+        if (busy) {
+            status_code = 503;
+            return "{\"error\":\"Too many logins, try again shortly\"}";
+        }
         if (!user_auth) {
             return "{\"error\":\"Invalid username or password\"}";
         }
@@ -339,8 +1232,7 @@ private:
         return authResponseToJson(*user_auth, token);
     }
     
-    std::string handleGetMe(const std::string& token) {
-        auto user_auth = authService_.validateToken(token);
+    std::string handleGetMe(const std::optional<UserAuth>& user_auth) {
         if (!user_auth) {
             return "{\"error\":\"Invalid token\"}";
         }
@@ -354,41 +1246,203 @@ private:
     }
 };
 
-SimpleHttpServer* server = nullptr;
+// The signal handler only writes a byte here; main sees it through the
+// accept loop and shuts down outside the handler
+int shutdown_pipe[2] = {-1, -1};
 
-void signalHandler(int) {
-    std::cout << "\nShutting down server..." << std::endl;
-    if (server) {
-        server->stop();
+// DB_PATH selects the database file; STORAGE_ENGINE=log switches to the
+// log-structured engine for write-heavy deployments; DB_SHARDS spreads todos
+// over that many SQLite files.
+DatabaseOptions databaseOptionsFromEnv() {
+    DatabaseOptions options;
+    if (const char* path = std::getenv("DB_PATH")) {
+        options.path = path;
+    }
+    if (const char* shards = std::getenv("DB_SHARDS")) {
+        options.shard_count = std::atoi(shards);
     }
-    exit(0);
+    if (const char* engine = std::getenv("STORAGE_ENGINE")) {
+        if (std::string(engine) == "log") {
+            options.engine = StorageEngine::Log;
+        }
+    }
+    return options;
+}
+
+// IO_BUFFER_MEMORY_MB caps the memory of the connection I/O buffer pool
+BufferPoolOptions bufferPoolOptionsFromEnv() {
+    BufferPoolOptions options;
+    if (const char* value = std::getenv("IO_BUFFER_MEMORY_MB")) {
+        options.max_bytes = static_cast<size_t>(std::max(std::atoi(value), 1)) * 1024 * 1024;
+    }
+    return options;
+}
+
+// CPU_WORKERS sizes the task scheduler; 0 or unset means one per hardware thread
+size_t cpuWorkersFromEnv() {
+    if (const char* value = std::getenv("CPU_WORKERS")) {
+        return static_cast<size_t>(std::max(std::atoi(value), 0));
+    }
+    return 0;
+}
+
+// One database thread per storage connection, so every running job can hold
+// a connection without waiting; DB_QUEUE_LIMIT bounds the requests waiting
+// for one
+BoundedExecutorOptions dbExecutorOptionsFromEnv(const Database& db) {
+    BoundedExecutorOptions options;
+    options.threads = static_cast<size_t>(std::max(db.connectionCount(), 1));
+    if (const char* value = std::getenv("DB_QUEUE_LIMIT")) {
+        options.max_queued = static_cast<size_t>(std::max(std::atoi(value), 1));
+    }
+    return options;
+}
+
+// TOKEN_SECRET signs session tokens; PASSWORD_HASH_COST is log2 of scrypt's
+// N (memory per hash is 2^cost KiB, at most the 256 MiB scrypt accepts);
+// PASSWORD_HASH_THREADS and PASSWORD_HASH_QUEUE_LIMIT size the hashing pool
+AuthOptions authOptionsFromEnv() {
+    AuthOptions options;
+    if (const char* value = std::getenv("TOKEN_SECRET")) {
+        options.token_secret = value;
+    }
+    if (options.token_secret.empty()) {
+        logWarning("TOKEN_SECRET is not set: using a random key, so tokens do not survive a restart");
+    }
+    if (const char* value = std::getenv("PASSWORD_HASH_COST")) {
+        options.password_hash.log2_n = std::min(std::max(std::atoi(value), 10), 18);
+    }
+    if (const char* value = std::getenv("PASSWORD_HASH_THREADS")) {
+        options.hash_threads = static_cast<size_t>(std::max(std::atoi(value), 1));
+    }
+    if (const char* value = std::getenv("PASSWORD_HASH_QUEUE_LIMIT")) {
+        options.hash_max_queued = static_cast<size_t>(std::max(std::atoi(value), 1));
+    }
+    return options;
+}
+
+// TRACE_SAMPLE_RATE (0 to 1) is the fraction of requests whose stage
+// timings are written to TRACE_FILE; SERVER_TIMING=0 leaves the
+// Server-Timing header out of responses
+TraceOptions traceOptionsFromEnv() {
+    TraceOptions options;
+    if (const char* value = std::getenv("TRACE_SAMPLE_RATE")) {
+        options.sample_rate = std::min(std::max(std::atof(value), 0.0), 1.0);
+    }
+    if (const char* value = std::getenv("TRACE_FILE")) {
+        options.path = value;
+    }
+    if (const char* value = std::getenv("SERVER_TIMING")) {
+        options.server_timing = std::string(value) != "0";
+    }
+    return options;
+}
+
+// LOG_LEVEL is debug, info, warning or error; LOG_FILE appends the JSON
+// log lines to a file instead of stderr; LOG_RATE_LIMIT caps the lines one
+// message writes per second (0 for no cap)
+LogOptions logOptionsFromEnv() {
+    LogOptions options;
+    if (const char* value = std::getenv("LOG_LEVEL")) {
+        std::string level = value;
+        options.level = level == "debug" ? LogLevel::Debug :
+                        level == "warning" ? LogLevel::Warning :
+                        level == "error" ? LogLevel::Error : LogLevel::Info;
+    }
+    if (const char* value = std::getenv("LOG_FILE")) {
+        options.path = value;
+    }
+    if (const char* value = std::getenv("LOG_RATE_LIMIT")) {
+        options.rate_limit_per_second = static_cast<uint32_t>(std::max(std::atoi(value), 0));
+    }
+    return options;
+}
+
+// Deleted todos are remembered for delta sync only this long
+std::chrono::hours tombstoneRetentionFromEnv() {
+    int days = 30;
+    if (const char* value = std::getenv("TOMBSTONE_RETENTION_DAYS")) {
+        days = std::max(std::atoi(value), 1);
+    }
+    return std::chrono::hours(24 * days);
+}
+
+void startTombstoneCompaction(std::shared_ptr<Database> db, std::chrono::hours retention) {
+    std::thread([db, retention]() {
+        while (true) {
+            int removed = db->compactTombstones(retention);
+            if (removed > 0) {
+                logInfo("Compacted tombstones", {{"removed", removed}});
+            }
+            std::this_thread::sleep_for(std::chrono::hours(1));
+        }
+    }).detach();
+}
+
+void signalHandler(int) {
+    // write() is async-signal-safe; the pipe does not block, and one byte
+    // waiting is as good as many
+    char byte = 1;
+    ssize_t written = write(shutdown_pipe[1], &byte, 1);
+    (void)written;
 }
 
 int main() {
+    if (pipe2(shutdown_pipe, O_CLOEXEC | O_NONBLOCK) < 0) {
+        std::cerr << "Failed to create shutdown pipe: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
     std::signal(SIGINT, signalHandler);
     std::signal(SIGTERM, signalHandler);
+    Logger::start(logOptionsFromEnv());
+    
+    SimpleHttpServer* server = nullptr;
     
     try {
-        server = new SimpleHttpServer(8080);
+        DatabaseOptions options = databaseOptionsFromEnv();
+        auto db = std::make_shared<Database>(options);
+        if (!db->initialize()) {
+            throw std::runtime_error("Failed to initialize database");
+        }
+        std::cout << "Storage engine: " << (options.engine == StorageEngine::Log ? "log" : "sqlite")
+                  << " (" << options.path << ", " << options.shard_count << " shard(s))" << std::endl;
+        startTombstoneCompaction(db, tombstoneRetentionFromEnv());
+        
+        server = new SimpleHttpServer(8080, db, bufferPoolOptionsFromEnv(), cpuWorkersFromEnv(),
+                                      dbExecutorOptionsFromEnv(*db), authOptionsFromEnv(), traceOptionsFromEnv());
         std::cout << "Todo API Server with Authentication starting..." << std::endl;
         std::cout << "Available endpoints:" << std::endl;
         std::cout << "Authentication:" << std::endl;
         std::cout << "  POST   /api/auth/register - Register new user" << std::endl;
         std::cout << "  POST   /api/auth/login    - Login user" << std::endl;
         std::cout << "  GET    /api/auth/me       - Get current user" << std::endl;
+        std::cout << "  GET    /api/status        - Buffer pool, task scheduler, database queue and auth counters" << std::endl;
+        std::cout << "  GET    /metrics           - Prometheus metrics: per-route requests and latency, queue depths" << std::endl;
         std::cout << "Todos (authenticated):" << std::endl;
-        std::cout << "  GET    /api/todos         - Get user's todos" << std::endl;
+        std::cout << "  GET    /api/todos         - Get user's todos (?due_after=&due_before=&completed=)" << std::endl;
+        std::cout << "  GET    /api/todos/search?q= - Search user's todos" << std::endl;
+        std::cout << "  GET    /api/todos/export  - Download user's todos as NDJSON" << std::endl;
+        std::cout << "  POST   /api/todos/import  - Bulk-create todos from an NDJSON body" << std::endl;
+        std::cout << "  GET    /api/todos/changes?since= - Get todos changed or deleted since a sync point" << std::endl;
+        std::cout << "  GET    /api/todos/overdue - Get open todos past their due date" << std::endl;
+        std::cout << "  GET    /api/todos/calendar?from=&to= - Count open todos due per day" << std::endl;
+        std::cout << "  GET    /api/todos/stream  - Server-Sent Events for changes to user's todos" << std::endl;
         std::cout << "  POST   /api/todos         - Create new todo" << std::endl;
         std::cout << "  PUT    /api/todos/:id     - Update todo" << std::endl;
         std::cout << "  DELETE /api/todos/:id     - Delete todo" << std::endl;
         std::cout << std::endl;
         
-        server->start();
+        server->start(shutdown_pipe[0]);
     } catch (const std::exception& e) {
-        std::cerr << "Error: " << e.what() << std::endl;
+        logError("Server failed", {{"error", e.what()}});
+        Logger::stop();
         return 1;
     }
     
-    delete server;
+    std::cout << "\nShutting down server..." << std::endl;
+    // Not deleted: detached connection threads may still be using it until
+    // the process exits
+    server->stop();
+    Logger::stop();
     return 0;
 }
\ No newline at end of file
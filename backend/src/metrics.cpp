@@ -0,0 +1,334 @@
+#include "metrics.h"
+#include <cstdio>
+
+namespace {
+
+struct RouteName {
+    const char* method;
+    const char* route;
+};
+
+// Indexed by HttpMetrics::routeOf; the last entry is kOtherRoute
+const RouteName kRouteNames[HttpMetrics::kRoutes] = {
+    {"POST", "/api/auth/register"},
+    {"POST", "/api/auth/login"},
+    {"GET", "/api/auth/me"},
+    {"GET", "/api/status"},
+    {"GET", "/metrics"},
+    {"GET", "/api/todos"},
+    {"POST", "/api/todos"},
+    {"GET", "/api/todos/stream"},
+    {"GET", "/api/todos/export"},
+    {"POST", "/api/todos/import"},
+    {"GET", "/api/todos/changes"},
+    {"GET", "/api/todos/overdue"},
+    {"GET", "/api/todos/calendar"},
+    {"GET", "/api/todos/search"},
+    {"PUT", "/api/todos/:id"},
+    {"DELETE", "/api/todos/:id"},
+    {"OPTIONS", "*"},
+    {"other", "other"},
+};
+
+const size_t kTodoByIdRoutes[] = {14, 15};
+const size_t kOptionsRoute = 16;
+
+const int kStatusCodes[] = {200, 201, 204, 304, 400, 401, 404, 413, 500, 503};
+
+const char* kStageNames[] = {"queue", "execute"};
+
+void appendNumber(std::string& out, double value) {
+    char buffer[32];
+    int length = std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    out.append(buffer, static_cast<size_t>(length));
+}
+
+void appendHeader(std::string& out, const char* name, const char* type, const char* help) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+// A metric family with a single, unlabelled series
+void appendMetric(std::string& out, const char* name, const char* type, const char* help, double value) {
+    appendHeader(out, name, type, help);
+    out += name;
+    out += ' ';
+    appendNumber(out, value);
+    out += '\n';
+}
+
+void appendPool(std::string& out, const std::string& prefix, const std::string& jobs, const BoundedExecutorStats& pool) {
+    auto append = [&](const char* suffix, const char* type, const std::string& help, double value) {
+        appendMetric(out, (prefix + suffix).c_str(), type, (help + ".").c_str(), value);
+    };
+    append("_threads", "gauge", "Threads that run " + jobs, pool.threads);
+    append("_queued", "gauge", "Queued " + jobs + " waiting for a thread", pool.queued);
+    append("_running", "gauge", "In-progress " + jobs, pool.running);
+    append("_queue_limit", "gauge", "Limit on queued " + jobs, pool.max_queued);
+    append("_completed_total", "counter", "Completed " + jobs, pool.completed);
+    append("_rejected_total", "counter", "Refused " + jobs + " (queue full)", pool.rejected);
+}
+
+}
+
+size_t LatencyBuckets::bucketOf(uint64_t nanos) {
+    // Bounds are inclusive, so look at the value just below
+    uint64_t below = nanos == 0 ? 0 : nanos - 1;
+    if (below < (uint64_t(1) << kMinOctave)) {
+        return 0;
+    }
+    int top_bit = 63 - __builtin_clzll(below);
+    if (top_bit >= kMaxOctave) {
+        return kFinite;
+    }
+    size_t upper_half = static_cast<size_t>((below >> (top_bit - 1)) & 1);
+    return 2 * static_cast<size_t>(top_bit - kMinOctave) + 1 + upper_half;
+}
+
+uint64_t LatencyBuckets::upperBoundOf(size_t bucket) {
+    uint64_t octave = uint64_t(1) << (kMinOctave + static_cast<int>((bucket + 1) / 2));
+    // Odd buckets end at one and a half times the power of two below
+    return bucket % 2 == 1 ? octave / 2 * 3 / 2 : octave;
+}
+
+void HttpMetrics::Histogram::record(uint64_t nanos) {
+    buckets[LatencyBuckets::bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+    sum_ns.fetch_add(nanos, std::memory_order_relaxed);
+}
+
+size_t HttpMetrics::routeOf(std::string_view method, std::string_view path) {
+    if (method == "OPTIONS") {
+        return kOptionsRoute;
+    }
+    for (size_t route = 0; route < kOtherRoute; ++route) {
+        if (method == kRouteNames[route].method && path == kRouteNames[route].route) {
+            return route;
+        }
+    }
+    std::string_view prefix = "/api/todos/";
+    if (path.size() > prefix.size() && path.compare(0, prefix.size(), prefix) == 0) {
+        for (size_t route : kTodoByIdRoutes) {
+            if (method == kRouteNames[route].method) {
+                return route;
+            }
+        }
+    }
+    return kOtherRoute;
+}
+
+const char* HttpMetrics::routeMethod(size_t route) {
+    return kRouteNames[route].method;
+}
+
+const char* HttpMetrics::routePath(size_t route) {
+    return kRouteNames[route].route;
+}
+
+// Threads are spread over the shards in the order they first record
+HttpMetrics::Shard& HttpMetrics::localShard() {
+    static std::atomic<size_t> next_shard{0};
+    thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return shards_[shard];
+}
+
+size_t HttpMetrics::statusIndex(int status) {
+    for (size_t i = 0; i < kStatuses - 1; ++i) {
+        if (kStatusCodes[i] == status) {
+            return i;
+        }
+    }
+    return kStatuses - 1;
+}
+
+void HttpMetrics::recordRequest(size_t route, int status, uint64_t nanos) {
+    Shard& shard = localShard();
+    shard.requests[route][statusIndex(status)].fetch_add(1, std::memory_order_relaxed);
+    shard.latency[route].record(nanos);
+}
+
+void HttpMetrics::recordStorageStage(StorageStage stage, uint64_t nanos) {
+    localShard().storage[static_cast<size_t>(stage)].record(nanos);
+}
+
+void HttpMetrics::connectionOpened() {
+    localShard().connections.fetch_add(1, std::memory_order_relaxed);
+}
+
+void HttpMetrics::connectionClosed() {
+    localShard().connections.fetch_sub(1, std::memory_order_relaxed);
+}
+
+uint64_t HttpMetrics::requests(size_t route, int status) const {
+    uint64_t total = 0;
+    for (const Shard& shard : shards_) {
+        total += shard.requests[route][statusIndex(status)].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+int64_t HttpMetrics::connections() const {
+    int64_t total = 0;
+    for (const Shard& shard : shards_) {
+        total += shard.connections.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+template <typename Pick>
+HttpMetrics::HistogramTotals HttpMetrics::total(Pick pick) const {
+    HistogramTotals totals;
+    for (const Shard& shard : shards_) {
+        const Histogram& histogram = pick(shard);
+        for (size_t bucket = 0; bucket < LatencyBuckets::kCount; ++bucket) {
+            totals.buckets[bucket] += histogram.buckets[bucket].load(std::memory_order_relaxed);
+        }
+        totals.sum_ns += histogram.sum_ns.load(std::memory_order_relaxed);
+    }
+    for (uint64_t count : totals.buckets) {
+        totals.count += count;
+    }
+    return totals;
+}
+
+void HttpMetrics::appendHistogram(std::string& out, const char* name, const std::string& labels,
+                                  const HistogramTotals& totals) {
+    uint64_t cumulative = 0;
+    for (size_t bucket = 0; bucket < LatencyBuckets::kCount; ++bucket) {
+        cumulative += totals.buckets[bucket];
+        out += name;
+        out += "_bucket{";
+        out += labels;
+        out += ",le=\"";
+        if (bucket < LatencyBuckets::kFinite) {
+            appendNumber(out, LatencyBuckets::upperBoundOf(bucket) / 1e9);
+        } else {
+            out += "+Inf";
+        }
+        out += "\"} ";
+        out += std::to_string(cumulative);
+        out += '\n';
+    }
+    out += name;
+    out += "_sum{";
+    out += labels;
+    out += "} ";
+    appendNumber(out, totals.sum_ns / 1e9);
+    out += '\n';
+    out += name;
+    out += "_count{";
+    out += labels;
+    out += "} ";
+    out += std::to_string(totals.count);
+    out += '\n';
+}
+
+void HttpMetrics::appendPrometheus(std::string& out) const {
+    auto route_labels = [](size_t route) {
+        return std::string("method=\"") + kRouteNames[route].method + "\",route=\"" + kRouteNames[route].route + "\"";
+    };
+    
+    appendHeader(out, "todo_http_requests_total", "counter", "Requests answered, by route and status code.");
+    for (size_t route = 0; route < kRoutes; ++route) {
+        for (size_t status = 0; status < kStatuses; ++status) {
+            uint64_t count = 0;
+            for (const Shard& shard : shards_) {
+                count += shard.requests[route][status].load(std::memory_order_relaxed);
+            }
+            if (count == 0) {
+                continue;
+            }
+            out += "todo_http_requests_total{";
+            out += route_labels(route);
+            out += ",code=\"";
+            out += status < kStatuses - 1 ? std::to_string(kStatusCodes[status]) : "other";
+            out += "\"} ";
+            out += std::to_string(count);
+            out += '\n';
+        }
+    }
+    
+    appendHeader(out, "todo_http_request_duration_seconds", "histogram",
+                 "Time from a request having been read to its response having been sent.");
+    for (size_t route = 0; route < kRoutes; ++route) {
+        HistogramTotals totals = total([route](const Shard& shard) -> const Histogram& {
+            return shard.latency[route];
+        });
+        if (totals.count > 0) {
+            appendHistogram(out, "todo_http_request_duration_seconds", route_labels(route), totals);
+        }
+    }
+    
+    appendHeader(out, "todo_storage_stage_duration_seconds", "histogram",
+                 "Time storage requests waited for a database thread (queue) and then ran on it (execute).");
+    for (size_t stage = 0; stage < 2; ++stage) {
+        HistogramTotals totals = total([stage](const Shard& shard) -> const Histogram& {
+            return shard.storage[stage];
+        });
+        if (totals.count > 0) {
+            appendHistogram(out, "todo_storage_stage_duration_seconds",
+                            std::string("stage=\"") + kStageNames[stage] + "\"", totals);
+        }
+    }
+    
+    appendMetric(out, "todo_http_connections", "gauge", "Connections being served by a request thread.",
+                 static_cast<double>(connections()));
+}
+
+void appendRuntimeMetrics(std::string& out, const BufferPoolStats& buffers, const TaskSchedulerStats& scheduler,
+                          const BoundedExecutorStats& storage, const AuthStats& auth) {
+    appendPool(out, "todo_storage", "storage requests", storage);
+    appendPool(out, "todo_password_hash", "password hashes", auth.hashing);
+    
+    appendMetric(out, "todo_io_buffer_bytes_in_use", "gauge", "Bytes of connection I/O buffers held by connections.",
+                 buffers.bytes_in_use);
+    appendMetric(out, "todo_io_buffer_bytes_cached", "gauge", "Bytes of released I/O buffers kept for reuse.",
+                 buffers.bytes_cached);
+    appendMetric(out, "todo_io_buffer_max_bytes", "gauge", "Limit on I/O buffer bytes in use.", buffers.max_bytes);
+    appendMetric(out, "todo_io_buffer_acquired_total", "counter", "I/O buffers handed out.", buffers.acquired);
+    appendMetric(out, "todo_io_buffer_exhausted_total", "counter", "I/O buffer acquisitions refused at the limit.",
+                 buffers.exhausted);
+    
+    appendMetric(out, "todo_scheduler_workers", "gauge", "Task scheduler worker threads.", scheduler.workers);
+    appendMetric(out, "todo_scheduler_tasks_executed_total", "counter", "Tasks run by the scheduler.",
+                 scheduler.executed);
+    appendMetric(out, "todo_scheduler_tasks_stolen_total", "counter", "Tasks taken from another worker's deque.",
+                 scheduler.stolen);
+    appendMetric(out, "todo_scheduler_tasks_overflowed_total", "counter",
+                 "Tasks run on the submitting thread because the injection queue was full.", scheduler.overflowed);
+    
+    appendMetric(out, "todo_auth_validations_total", "counter", "Session tokens validated.", auth.validations);
+    appendMetric(out, "todo_session_cache_entries", "gauge", "Validated sessions held in memory.",
+                 auth.sessions.entries);
+    appendMetric(out, "todo_session_cache_hits_total", "counter", "Token validations answered from memory.",
+                 auth.sessions.hits);
+    appendMetric(out, "todo_session_cache_misses_total", "counter", "Token validations that decoded the token.",
+                 auth.sessions.misses);
+    appendMetric(out, "todo_session_cache_evictions_total", "counter", "Sessions dropped to make room.",
+                 auth.sessions.evictions);
+    appendMetric(out, "todo_password_rehashed_total", "counter",
+                 "Stored password hashes upgraded to the current parameters at login.", auth.rehashed);
+    appendMetric(out, "todo_user_filter_rejected_total", "counter",
+                 "User lookups answered by the username/email filter without a query.", auth.user_filter.rejected);
+    appendMetric(out, "todo_user_filter_false_positives_total", "counter",
+                 "User lookups the filter let through that found no user.", auth.user_filter.false_positives);
+}
+
+void appendLogMetrics(std::string& out, const LogStats& logs) {
+    appendHeader(out, "todo_log_records_total", "counter",
+                 "Log records by outcome: written, dropped (thread buffer full) or suppressed (rate limit).");
+    for (const auto& [outcome, count] : {std::pair<const char*, uint64_t>{"written", logs.written},
+                                         {"dropped", logs.dropped}, {"suppressed", logs.suppressed}}) {
+        out += "todo_log_records_total{outcome=\"";
+        out += outcome;
+        out += "\"} ";
+        appendNumber(out, static_cast<double>(count));
+        out += '\n';
+    }
+}
@@ -0,0 +1,230 @@
+#include "password_hash.h"
+#include "sha256.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Upper bounds on what a stored hash may ask for, so a corrupt or hostile
+// row cannot make a login allocate gigabytes. Memory is 128 * r * 2^log2_n
+// bytes; the time is that much mixing p times over.
+const int kMaxLog2N = 20;
+const int kMaxR = 32;
+const int kMaxP = 16;
+const uint64_t kMaxMemoryBytes = uint64_t(256) << 20;
+const uint64_t kMaxWorkBytes = uint64_t(1) << 30;
+const size_t kSaltBytes = 16;
+const size_t kKeyBytes = 32;
+
+// PBKDF2-HMAC-SHA256 with one iteration, which is all scrypt uses
+void pbkdf2Sha256(std::string_view password, const uint8_t* salt, size_t salt_size, uint8_t* out, size_t out_size) {
+    HmacSha256 hmac(password);
+    for (uint32_t block = 1; out_size > 0; ++block) {
+        uint8_t index[4] = {static_cast<uint8_t>(block >> 24), static_cast<uint8_t>(block >> 16),
+                            static_cast<uint8_t>(block >> 8), static_cast<uint8_t>(block)};
+        uint8_t digest[32];
+        hmac.mac(salt, salt_size, index, sizeof(index), digest);
+        size_t take = std::min(out_size, sizeof(digest));
+        std::memcpy(out, digest, take);
+        out += take;
+        out_size -= take;
+    }
+}
+
+uint32_t rotl(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+void salsa20_8(uint32_t b[16]) {
+    uint32_t x[16];
+    std::memcpy(x, b, sizeof(x));
+    for (int i = 0; i < 8; i += 2) {
+        x[4] ^= rotl(x[0] + x[12], 7);   x[8] ^= rotl(x[4] + x[0], 9);
+        x[12] ^= rotl(x[8] + x[4], 13);  x[0] ^= rotl(x[12] + x[8], 18);
+        x[9] ^= rotl(x[5] + x[1], 7);    x[13] ^= rotl(x[9] + x[5], 9);
+        x[1] ^= rotl(x[13] + x[9], 13);  x[5] ^= rotl(x[1] + x[13], 18);
+        x[14] ^= rotl(x[10] + x[6], 7);  x[2] ^= rotl(x[14] + x[10], 9);
+        x[6] ^= rotl(x[2] + x[14], 13);  x[10] ^= rotl(x[6] + x[2], 18);
+        x[3] ^= rotl(x[15] + x[11], 7);  x[7] ^= rotl(x[3] + x[15], 9);
+        x[11] ^= rotl(x[7] + x[3], 13);  x[15] ^= rotl(x[11] + x[7], 18);
+        x[1] ^= rotl(x[0] + x[3], 7);    x[2] ^= rotl(x[1] + x[0], 9);
+        x[3] ^= rotl(x[2] + x[1], 13);   x[0] ^= rotl(x[3] + x[2], 18);
+        x[6] ^= rotl(x[5] + x[4], 7);    x[7] ^= rotl(x[6] + x[5], 9);
+        x[4] ^= rotl(x[7] + x[6], 13);   x[5] ^= rotl(x[4] + x[7], 18);
+        x[11] ^= rotl(x[10] + x[9], 7);  x[8] ^= rotl(x[11] + x[10], 9);
+        x[9] ^= rotl(x[8] + x[11], 13);  x[10] ^= rotl(x[9] + x[8], 18);
+        x[12] ^= rotl(x[15] + x[14], 7); x[13] ^= rotl(x[12] + x[15], 9);
+        x[14] ^= rotl(x[13] + x[12], 13); x[15] ^= rotl(x[14] + x[13], 18);
+    }
+    for (int i = 0; i < 16; ++i) {
+        b[i] += x[i];
+    }
+}
+
+// BlockMix over 2r 64-byte blocks, with the output interleaved (even blocks
+// first, then odd) as the RFC specifies
+void blockMix(const uint32_t* in, uint32_t* out, int r) {
+    uint32_t x[16];
+    std::memcpy(x, in + (2 * r - 1) * 16, sizeof(x));
+    for (int i = 0; i < 2 * r; ++i) {
+        for (int j = 0; j < 16; ++j) {
+            x[j] ^= in[i * 16 + j];
+        }
+        salsa20_8(x);
+        std::memcpy(out + ((i % 2) * r + i / 2) * 16, x, sizeof(x));
+    }
+}
+
+// ROMix: the memory-hard part. `v` holds 2^log2_n copies of the block.
+void roMix(uint8_t* block, int r, int log2_n, std::vector<uint32_t>& v) {
+    size_t words = 32 * static_cast<size_t>(r);
+    uint64_t n = uint64_t(1) << log2_n;
+    std::vector<uint32_t> x(words), y(words);
+    for (size_t i = 0; i < words; ++i) {
+        x[i] = uint32_t(block[i * 4]) | (uint32_t(block[i * 4 + 1]) << 8) |
+               (uint32_t(block[i * 4 + 2]) << 16) | (uint32_t(block[i * 4 + 3]) << 24);
+    }
+    for (uint64_t i = 0; i < n; ++i) {
+        std::memcpy(&v[i * words], x.data(), words * 4);
+        blockMix(x.data(), y.data(), r);
+        x.swap(y);
+    }
+    for (uint64_t i = 0; i < n; ++i) {
+        uint64_t j = x[(2 * r - 1) * 16] & (n - 1);
+        for (size_t k = 0; k < words; ++k) {
+            x[k] ^= v[j * words + k];
+        }
+        blockMix(x.data(), y.data(), r);
+        x.swap(y);
+    }
+    for (size_t i = 0; i < words; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            block[i * 4 + j] = static_cast<uint8_t>(x[i] >> (8 * j));
+        }
+    }
+}
+
+std::string toHex(const uint8_t* data, size_t size) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(size * 2);
+    for (size_t i = 0; i < size; ++i) {
+        hex += digits[data[i] >> 4];
+        hex += digits[data[i] & 0xf];
+    }
+    return hex;
+}
+
+bool fromHex(std::string_view hex, std::vector<uint8_t>& out) {
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+    auto nibble = [](char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+    out.clear();
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        int high = nibble(hex[i]);
+        int low = nibble(hex[i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        out.push_back(static_cast<uint8_t>(high << 4 | low));
+    }
+    return true;
+}
+
+struct ParsedHash {
+    PasswordHashParams params;
+    std::vector<uint8_t> salt;
+    std::vector<uint8_t> key;
+};
+
+bool parseHash(std::string_view encoded, ParsedHash& parsed) {
+    const std::string_view prefix = "$scrypt$";
+    if (encoded.substr(0, prefix.size()) != prefix) {
+        return false;
+    }
+    encoded.remove_prefix(prefix.size());
+    size_t salt_start = encoded.find('$');
+    size_t key_start = salt_start == std::string_view::npos ? salt_start : encoded.find('$', salt_start + 1);
+    if (key_start == std::string_view::npos) {
+        return false;
+    }
+    std::string params(encoded.substr(0, salt_start));
+    char trailing = 0;
+    if (std::sscanf(params.c_str(), "ln=%d,r=%d,p=%d%c", &parsed.params.log2_n, &parsed.params.r,
+                    &parsed.params.p, &trailing) != 3) {
+        return false;
+    }
+    return fromHex(encoded.substr(salt_start + 1, key_start - salt_start - 1), parsed.salt) &&
+           fromHex(encoded.substr(key_start + 1), parsed.key) && !parsed.key.empty();
+}
+
+} // namespace
+
+bool scrypt(std::string_view password, std::string_view salt, const PasswordHashParams& params,
+            uint8_t* key, size_t key_length) {
+    if (params.log2_n < 1 || params.log2_n > kMaxLog2N || params.r < 1 || params.r > kMaxR ||
+        params.p < 1 || params.p > kMaxP) {
+        return false;
+    }
+    uint64_t memory = (uint64_t(128) * params.r) << params.log2_n;
+    if (memory > kMaxMemoryBytes || memory * params.p > kMaxWorkBytes) {
+        return false;
+    }
+    size_t block_size = 128 * static_cast<size_t>(params.r);
+    std::vector<uint8_t> blocks(block_size * params.p);
+    pbkdf2Sha256(password, reinterpret_cast<const uint8_t*>(salt.data()), salt.size(), blocks.data(),
+                 blocks.size());
+    std::vector<uint32_t> v((size_t(1) << params.log2_n) * block_size / 4);
+    for (int i = 0; i < params.p; ++i) {
+        roMix(blocks.data() + i * block_size, params.r, params.log2_n, v);
+    }
+    pbkdf2Sha256(password, blocks.data(), blocks.size(), key, key_length);
+    return true;
+}
+
+std::string hashPassword(std::string_view password, const PasswordHashParams& params) {
+    uint8_t salt[kSaltBytes];
+    std::random_device random;
+    for (size_t i = 0; i < kSaltBytes; i += 4) {
+        uint32_t value = random();
+        std::memcpy(salt + i, &value, 4);
+    }
+    uint8_t key[kKeyBytes];
+    if (!scrypt(password, std::string_view(reinterpret_cast<const char*>(salt), kSaltBytes), params, key,
+                kKeyBytes)) {
+        return "";
+    }
+    return "$scrypt$ln=" + std::to_string(params.log2_n) + ",r=" + std::to_string(params.r) +
+           ",p=" + std::to_string(params.p) + "$" + toHex(salt, kSaltBytes) + "$" + toHex(key, kKeyBytes);
+}
+
+bool verifyPasswordHash(std::string_view password, std::string_view encoded) {
+    ParsedHash parsed;
+    if (!parseHash(encoded, parsed)) {
+        return false;
+    }
+    std::vector<uint8_t> key(parsed.key.size());
+    if (!scrypt(password, std::string_view(reinterpret_cast<const char*>(parsed.salt.data()), parsed.salt.size()),
+                parsed.params, key.data(), key.size())) {
+        return false;
+    }
+    // Constant time, so the comparison does not leak how much of the key matched
+    uint8_t difference = 0;
+    for (size_t i = 0; i < key.size(); ++i) {
+        difference |= key[i] ^ parsed.key[i];
+    }
+    return difference == 0;
+}
+
+bool passwordHashMatches(std::string_view encoded, const PasswordHashParams& params) {
+    ParsedHash parsed;
+    return parseHash(encoded, parsed) && parsed.params.log2_n == params.log2_n && parsed.params.r == params.r &&
+           parsed.params.p == params.p;
+}
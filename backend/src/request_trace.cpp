@@ -0,0 +1,169 @@
+#include "request_trace.h"
+#include "logger.h"
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+// Spins for a few milliseconds, which is paid once, by the first request
+double measureNanosPerTick() {
+#if defined(__x86_64__) || defined(__i386__)
+    auto wall_start = std::chrono::steady_clock::now();
+    uint64_t tick_start = __rdtsc();
+    while (std::chrono::steady_clock::now() - wall_start < std::chrono::milliseconds(5)) {
+    }
+    uint64_t ticks = __rdtsc() - tick_start;
+    double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - wall_start).count();
+    return ticks > 0 ? nanos / static_cast<double>(ticks) : 1.0;
+#else
+    return 1.0;
+#endif
+}
+
+struct ThreadTraces {
+    const TraceWriter* owner = nullptr;
+    std::string events;
+    uint32_t tid = 0;
+    uint64_t random = 0;
+};
+
+thread_local ThreadTraces local_traces;
+std::atomic<uint32_t> next_tid{1};
+
+ThreadTraces& threadTraces() {
+    ThreadTraces& traces = local_traces;
+    if (traces.tid == 0) {
+        traces.tid = next_tid.fetch_add(1, std::memory_order_relaxed);
+        traces.random = (0x9e3779b97f4a7c15ULL * traces.tid ^
+                         static_cast<uint64_t>(std::hash<std::thread::id>()(std::this_thread::get_id()))) | 1;
+    }
+    return traces;
+}
+
+void appendEvent(std::string& out, std::string_view name, const char* category, uint64_t base, uint64_t start,
+                 uint64_t end, uint32_t tid, int status) {
+    char number[64];
+    out += ",\n{\"name\":\"";
+    out += name;
+    out += "\",\"cat\":\"";
+    out += category;
+    std::snprintf(number, sizeof(number), "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f",
+                  TraceClock::nanosBetween(base, start) / 1e3, TraceClock::nanosBetween(start, end) / 1e3);
+    out += number;
+    std::snprintf(number, sizeof(number), ",\"pid\":%d,\"tid\":%u", static_cast<int>(getpid()), tid);
+    out += number;
+    if (status != 0) {
+        out += ",\"args\":{\"status\":";
+        out += std::to_string(status);
+        out += '}';
+    }
+    out += '}';
+}
+
+}
+
+uint64_t TraceClock::toNanos(uint64_t ticks) {
+    static const double nanos_per_tick = measureNanosPerTick();
+    return static_cast<uint64_t>(static_cast<double>(ticks) * nanos_per_tick);
+}
+
+size_t RequestTrace::begin(const char* name) {
+    if (count_ == kMaxSpans) {
+        return kMaxSpans;
+    }
+    spans_[count_] = Span{name, TraceClock::now(), 0};
+    return count_++;
+}
+
+void RequestTrace::end(size_t span) {
+    if (span < count_) {
+        spans_[span].end = TraceClock::now();
+    }
+}
+
+void RequestTrace::add(const char* name, uint64_t start, uint64_t end) {
+    if (count_ < kMaxSpans) {
+        spans_[count_++] = Span{name, start, end};
+    }
+}
+
+TraceWriter::TraceWriter(const TraceOptions& options) : options_(options) {
+    if (options_.sample_rate >= 1) {
+        sample_threshold_ = UINT64_MAX;
+    } else if (options_.sample_rate > 0) {
+        sample_threshold_ = static_cast<uint64_t>(options_.sample_rate * 18446744073709551616.0);
+    } else {
+        sample_threshold_ = 0;
+        return;
+    }
+    file_ = std::fopen(options_.path.c_str(), "w");
+    if (!file_) {
+        logError("Failed to open trace file; tracing is off", {{"path", options_.path}});
+        return;
+    }
+    std::fputs("[", file_);
+    base_ = TraceClock::now();
+}
+
+TraceWriter::~TraceWriter() {
+    if (!file_) {
+        return;
+    }
+    flushThread();
+    std::fputs("\n]\n", file_);
+    std::fclose(file_);
+}
+
+bool TraceWriter::sample() {
+    if (sample_threshold_ == 0) {
+        return false;
+    }
+    // xorshift64: a few instructions, and no state shared between threads
+    uint64_t& x = threadTraces().random;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return x <= sample_threshold_;
+}
+
+void TraceWriter::write(const RequestTrace& trace, std::string_view method, std::string_view route, int status) {
+    if (!file_) {
+        return;
+    }
+    ThreadTraces& traces = threadTraces();
+    if (traces.owner != this) {
+        // Left by an earlier writer that is gone
+        traces.events.clear();
+        traces.owner = this;
+    }
+    uint64_t end = TraceClock::now();
+    std::string name(method);
+    name += ' ';
+    name += route;
+    appendEvent(traces.events, name, "request", base_, trace.start(), end, traces.tid, status);
+    for (size_t i = 0; i < trace.size(); ++i) {
+        const RequestTrace::Span& span = trace[i];
+        appendEvent(traces.events, span.name, "stage", base_, span.start, span.end != 0 ? span.end : end,
+                    traces.tid, 0);
+    }
+    written_.fetch_add(1, std::memory_order_relaxed);
+    if (traces.events.size() >= options_.thread_buffer_bytes) {
+        writeOut(traces.events);
+    }
+}
+
+void TraceWriter::flushThread() {
+    ThreadTraces& traces = threadTraces();
+    if (traces.owner == this && !traces.events.empty()) {
+        writeOut(traces.events);
+    }
+}
+
+void TraceWriter::writeOut(std::string& events) {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    // Every event starts with a separator; the array's first must not
+    size_t skip = std::ftell(file_) == 1 ? 1 : 0;
+    std::fwrite(events.data() + skip, 1, events.size() - skip, file_);
+    std::fflush(file_);
+    events.clear();
+}
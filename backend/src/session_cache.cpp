@@ -0,0 +1,110 @@
+#include "session_cache.h"
+#include <functional>
+#include <mutex>
+
+SessionCache::SessionCache(size_t capacity)
+    : capacity_per_shard_(capacity == 0 ? 0 : (capacity + kShards - 1) / kShards) {
+    for (Shard& shard : shards_) {
+        shard.referenced.reset(new std::atomic<bool>[capacity_per_shard_]());
+    }
+}
+
+std::optional<UserAuth> SessionCache::find(std::string_view token, int64_t now) {
+    if (capacity_per_shard_ == 0) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    uint64_t digest = std::hash<std::string_view>()(token);
+    const Shard& shard = shards_[digest % kShards];
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.index.find(digest);
+        if (it != shard.index.end()) {
+            const Session& session = shard.slots[it->second];
+            if (session.token == token && now <= session.expires_at) {
+                shard.referenced[it->second].store(true, std::memory_order_relaxed);
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return session.user;
+            }
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+}
+
+uint64_t SessionCache::generation(int user_id) const {
+    return generations_[static_cast<uint32_t>(user_id) % kGenerationSlots].load();
+}
+
+void SessionCache::insert(std::string_view token, const UserAuth& user, int64_t expires_at, int64_t now,
+                          uint64_t generation) {
+    if (capacity_per_shard_ == 0) {
+        return;
+    }
+    uint64_t digest = std::hash<std::string_view>()(token);
+    Shard& shard = shards_[digest % kShards];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    // An invalidation that bumped the generation before this lock was taken
+    // may already have swept this shard; one that bumps it later sweeps it
+    // after this insert
+    if (this->generation(user.user_id) != generation) {
+        return;
+    }
+    uint32_t slot;
+    auto existing = shard.index.find(digest);
+    if (existing != shard.index.end()) {
+        slot = existing->second;
+    } else if (!shard.free_slots.empty()) {
+        slot = shard.free_slots.back();
+        shard.free_slots.pop_back();
+    } else if (shard.slots.size() < capacity_per_shard_) {
+        slot = static_cast<uint32_t>(shard.slots.size());
+        shard.slots.emplace_back();
+    } else {
+        slot = evictLocked(shard, now);
+    }
+    shard.slots[slot] = Session{digest, std::string(token), user, expires_at, true};
+    shard.referenced[slot].store(false, std::memory_order_relaxed);
+    shard.index[digest] = slot;
+}
+
+uint32_t SessionCache::evictLocked(Shard& shard, int64_t now) {
+    uint32_t victim = 0;
+    for (size_t step = 0; step < kClockSteps; ++step) {
+        victim = static_cast<uint32_t>(shard.hand);
+        shard.hand = (shard.hand + 1) % shard.slots.size();
+        if (shard.slots[victim].expires_at < now ||
+            !shard.referenced[victim].exchange(false, std::memory_order_relaxed)) {
+            break;
+        }
+    }
+    shard.index.erase(shard.slots[victim].digest);
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+    return victim;
+}
+
+void SessionCache::invalidateUser(int user_id) {
+    generations_[static_cast<uint32_t>(user_id) % kGenerationSlots].fetch_add(1);
+    for (Shard& shard : shards_) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        for (uint32_t slot = 0; slot < shard.slots.size(); ++slot) {
+            Session& session = shard.slots[slot];
+            if (session.live && session.user.user_id == user_id) {
+                session.live = false;
+                shard.index.erase(session.digest);
+                shard.free_slots.push_back(slot);
+                invalidations_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+SessionCacheStats SessionCache::stats() const {
+    size_t entries = 0;
+    for (const Shard& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        entries += shard.index.size();
+    }
+    return {entries, capacity_per_shard_ * kShards, hits_.load(), misses_.load(), invalidations_.load(),
+            evictions_.load()};
+}
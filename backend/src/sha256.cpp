@@ -0,0 +1,114 @@
+#include "sha256.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+} // namespace
+
+void Sha256::reset() {
+    static const uint32_t initial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    std::memcpy(state_, initial, sizeof(state_));
+    length_ = 0;
+    buffered_ = 0;
+}
+
+void Sha256::update(const uint8_t* data, size_t size) {
+    length_ += size;
+    while (size > 0) {
+        size_t take = std::min(size, sizeof(block_) - buffered_);
+        std::memcpy(block_ + buffered_, data, take);
+        buffered_ += take;
+        data += take;
+        size -= take;
+        if (buffered_ == sizeof(block_)) {
+            compress(block_);
+            buffered_ = 0;
+        }
+    }
+}
+
+void Sha256::finish(uint8_t digest[kDigestBytes]) {
+    uint64_t bits = length_ * 8;
+    block_[buffered_++] = 0x80;
+    if (buffered_ > 56) {
+        std::memset(block_ + buffered_, 0, sizeof(block_) - buffered_);
+        compress(block_);
+        buffered_ = 0;
+    }
+    std::memset(block_ + buffered_, 0, 56 - buffered_);
+    for (int i = 0; i < 8; ++i) {
+        block_[56 + i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+    }
+    compress(block_);
+    for (int i = 0; i < 8; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            digest[i * 4 + j] = static_cast<uint8_t>(state_[i] >> (24 - 8 * j));
+        }
+    }
+}
+
+void Sha256::compress(const uint8_t* block) {
+    static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = (uint32_t(block[i * 4]) << 24) | (uint32_t(block[i * 4 + 1]) << 16) |
+               (uint32_t(block[i * 4 + 2]) << 8) | uint32_t(block[i * 4 + 3]);
+    }
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+    uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+    for (int i = 0; i < 64; ++i) {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state_[0] += a; state_[1] += b; state_[2] += c; state_[3] += d;
+    state_[4] += e; state_[5] += f; state_[6] += g; state_[7] += h;
+}
+
+HmacSha256::HmacSha256(std::string_view key) {
+    uint8_t block[64] = {0};
+    if (key.size() > sizeof(block)) {
+        Sha256 hash;
+        hash.update(reinterpret_cast<const uint8_t*>(key.data()), key.size());
+        hash.finish(block);
+    } else {
+        std::memcpy(block, key.data(), key.size());
+    }
+    uint8_t pad[64];
+    for (int i = 0; i < 64; ++i) pad[i] = block[i] ^ 0x36;
+    inner_.update(pad, sizeof(pad));
+    for (int i = 0; i < 64; ++i) pad[i] = block[i] ^ 0x5c;
+    outer_.update(pad, sizeof(pad));
+}
+
+void HmacSha256::mac(const uint8_t* data, size_t size, const uint8_t* more, size_t more_size,
+                     uint8_t out[Sha256::kDigestBytes]) const {
+    Sha256 inner = inner_;
+    inner.update(data, size);
+    if (more_size > 0) {
+        inner.update(more, more_size);
+    }
+    uint8_t digest[Sha256::kDigestBytes];
+    inner.finish(digest);
+    Sha256 outer = outer_;
+    outer.update(digest, sizeof(digest));
+    outer.finish(out);
+}
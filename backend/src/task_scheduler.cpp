@@ -0,0 +1,135 @@
+#include "task_scheduler.h"
+#include <algorithm>
+
+namespace {
+
+// The pool and worker index of the current thread, if it is a worker
+thread_local const TaskScheduler* current_scheduler = nullptr;
+thread_local size_t current_index = 0;
+
+// Rounds of looking for work before a worker goes to sleep
+const int kSpinRounds = 64;
+
+} // namespace
+
+TaskScheduler::TaskScheduler(size_t workers, size_t injection_capacity) : injected_(injection_capacity) {
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        workers_[i]->thread = std::thread(&TaskScheduler::workerLoop, this, i);
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+TaskSchedulerStats TaskScheduler::stats() const {
+    return {workers_.size(), executed_.load(), stolen_.load(), injected_count_.load(), overflowed_.load()};
+}
+
+long TaskScheduler::currentWorker() const {
+    return current_scheduler == this ? static_cast<long>(current_index) : -1;
+}
+
+void TaskScheduler::post(std::unique_ptr<JobBase> job) {
+    // Counted before it becomes visible, so a taker never sees it drop below zero
+    queued_++;
+    long self = currentWorker();
+    if (self >= 0) {
+        Worker& worker = *workers_[static_cast<size_t>(self)];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(job.release());
+    } else if (injected_.push(job.get())) {
+        job.release();
+        injected_count_++;
+    } else {
+        // Back-pressure: a full queue means the pool is far behind, so the
+        // submitter does the work itself instead of queueing more
+        queued_--;
+        overflowed_++;
+        job->run();
+        return;
+    }
+    wake();
+}
+
+// Pairs with the sleeper's check under sleep_mutex_: either it sees the new
+// task, or it is already waiting when notified.
+void TaskScheduler::wake() {
+    if (sleepers_.load() > 0) {
+        { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+        sleep_cv_.notify_one();
+    }
+}
+
+bool TaskScheduler::runOne(size_t self) {
+    JobBase* job = nullptr;
+    {
+        Worker& worker = *workers_[self];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            job = worker.tasks.back();
+            worker.tasks.pop_back();
+        }
+    }
+    if (!job) {
+        injected_.pop(job);
+    }
+    for (size_t i = 1; !job && i < workers_.size(); ++i) {
+        Worker& victim = *workers_[(self + i) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            job = victim.tasks.front();
+            victim.tasks.pop_front();
+            stolen_++;
+        }
+    }
+    if (!job) {
+        return false;
+    }
+    
+    queued_--;
+    // Counted first, so the count is already up to date when an awaiter wakes
+    executed_++;
+    std::unique_ptr<JobBase> owned(job);
+    owned->run();
+    return true;
+}
+
+void TaskScheduler::workerLoop(size_t index) {
+    current_scheduler = this;
+    current_index = index;
+    
+    while (true) {
+        bool ran = false;
+        for (int i = 0; i < kSpinRounds && !ran; ++i) {
+            ran = runOne(index);
+            if (!ran) {
+                std::this_thread::yield();
+            }
+        }
+        if (ran) {
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleepers_++;
+        sleep_cv_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+        sleepers_--;
+        if (stopping_ && queued_.load() == 0) {
+            break;
+        }
+    }
+}
@@ -1,30 +1,138 @@
 #include "todo_service.h"
 #include "database.h"
+#include <stdexcept>
+#include <chrono>
+#include <sstream>
 
-TodoService::TodoService() : db_(std::make_unique<Database>()) {
+namespace {
+
+std::string makeEpoch() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    std::ostringstream ss;
+    ss << std::hex << std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    return ss.str();
+}
+
+}
+
+TodoService::TodoService() : db_(std::make_shared<Database>()), epoch_(makeEpoch()) {
     if (!db_->initialize()) {
         throw std::runtime_error("Failed to initialize database");
     }
 }
 
+// The caller owns initialization so several services can share one Database,
+// which the log engine requires (one writer per log file).
+TodoService::TodoService(std::shared_ptr<Database> db) : db_(std::move(db)), epoch_(makeEpoch()) {}
+
 TodoService::~TodoService() = default;
 
 std::vector<Todo> TodoService::getAllTodos(int user_id) {
     return db_->getAllTodos(user_id);
 }
 
+void TodoService::getAllTodos(int user_id, CompactTodoList& todos) {
+    db_->getAllTodos(user_id, todos);
+}
+
+bool TodoService::readTodoBatch(int user_id, TodoCursor& cursor, size_t batch_size, CompactTodoList& batch) {
+    return db_->readTodoBatch(user_id, cursor, batch_size, batch);
+}
+
 Todo TodoService::getTodoById(int id, int user_id) {
     return db_->getTodoById(id, user_id);
 }
 
 Todo TodoService::createTodo(const std::string& text, int user_id, const std::string& due_date) {
-    return db_->createTodo(text, user_id, due_date);
+    std::lock_guard<std::mutex> lock(stripeFor(user_id).write_mutex);
+    Todo todo = db_->createTodo(text, user_id, due_date);
+    if (todo.id != -1) {
+        notify(TodoChange::Type::Created, todo);
+    }
+    return todo;
 }
 
 Todo TodoService::updateTodo(int id, const std::string& text, bool completed, int user_id) {
-    return db_->updateTodo(id, text, completed, user_id);
+    std::lock_guard<std::mutex> lock(stripeFor(user_id).write_mutex);
+    Todo todo = db_->updateTodo(id, text, completed, user_id);
+    if (todo.id != -1) {
+        notify(TodoChange::Type::Updated, todo);
+    }
+    return todo;
 }
 
 bool TodoService::deleteTodo(int id, int user_id) {
-    return db_->deleteTodo(id, user_id);
+    std::lock_guard<std::mutex> lock(stripeFor(user_id).write_mutex);
+    bool deleted = db_->deleteTodo(id, user_id);
+    if (deleted) {
+        notify(TodoChange::Type::Deleted, {id, user_id, "", false, "", "", ""});
+    }
+    return deleted;
+}
+
+bool TodoService::importTodos(int user_id, std::vector<Todo>& todos) {
+    std::lock_guard<std::mutex> lock(stripeFor(user_id).write_mutex);
+    bool imported = db_->importTodos(user_id, todos);
+    if (!todos.empty()) {
+        bumpVersion(user_id);
+    }
+    return imported;
+}
+
+std::vector<Todo> TodoService::searchTodos(int user_id, const std::string& query, int limit, int offset) {
+    return db_->searchTodos(user_id, query, limit, offset);
+}
+
+std::vector<Todo> TodoService::findTodos(int user_id, const TodoFilter& filter) {
+    return db_->findTodos(user_id, filter);
+}
+
+std::vector<Todo> TodoService::getOverdueTodos(int user_id, const std::string& today) {
+    TodoFilter filter;
+    filter.due_before = today;
+    filter.completed = false;
+    return db_->findTodos(user_id, filter);
+}
+
+std::vector<DueDateBucket> TodoService::countOpenTodosByDay(int user_id, const std::string& from, const std::string& to) {
+    return db_->countOpenTodosByDay(user_id, from, to);
+}
+
+TodoChanges TodoService::getChangesSince(int user_id, int64_t since, int limit) {
+    return db_->getChangesSince(user_id, since, limit);
+}
+
+TodoService::Stripe& TodoService::stripeFor(int user_id) {
+    return stripes_[static_cast<uint32_t>(user_id) % kStripes];
+}
+
+uint64_t TodoService::getVersion(int user_id) {
+    Stripe& stripe = stripeFor(user_id);
+    std::shared_lock<std::shared_mutex> lock(stripe.versions_mutex);
+    auto it = stripe.versions.find(user_id);
+    return it != stripe.versions.end() ? it->second : 0;
+}
+
+std::string TodoService::getEtag(int user_id) {
+    return "\"" + epoch_ + "-" + std::to_string(getVersion(user_id)) + "\"";
+}
+
+// Called after the write has committed: a reader that sampled the old
+// version may return newer rows under the old ETag, which only costs the
+// client one extra full response on its next poll.
+uint64_t TodoService::bumpVersion(int user_id) {
+    Stripe& stripe = stripeFor(user_id);
+    std::unique_lock<std::shared_mutex> lock(stripe.versions_mutex);
+    return ++stripe.versions[user_id];
+}
+
+void TodoService::setChangeListener(TodoChangeListener listener) {
+    listener_ = std::move(listener);
+}
+
+void TodoService::notify(TodoChange::Type type, const Todo& todo) {
+    uint64_t version = bumpVersion(todo.user_id);
+    if (listener_) {
+        listener_({type, todo.user_id, version, todo});
+    }
 }
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "token_codec.h"
+
+namespace {
+
+const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// Inverse of kAlphabet; -1 for characters outside it
+struct DecodeTable {
+    int8_t values[256];
+    
+    constexpr DecodeTable() : values() {
+        for (int i = 0; i < 256; ++i) values[i] = -1;
+        for (int i = 0; i < 64; ++i) values[static_cast<uint8_t>(kAlphabet[i])] = static_cast<int8_t>(i);
+    }
+};
+
+constexpr DecodeTable kDecode;
+
+// base64url without padding; `size` bytes become (size * 4 + 2) / 3 characters
+void base64UrlEncode(const uint8_t* data, size_t size, char* out) {
+    size_t i = 0;
+    for (; i + 3 <= size; i += 3) {
+        uint32_t group = (uint32_t(data[i]) << 16) | (uint32_t(data[i + 1]) << 8) | data[i + 2];
+        *out++ = kAlphabet[group >> 18];
+        *out++ = kAlphabet[(group >> 12) & 63];
+        *out++ = kAlphabet[(group >> 6) & 63];
+        *out++ = kAlphabet[group & 63];
+    }
+    if (size - i == 1) {
+        uint32_t group = uint32_t(data[i]) << 16;
+        *out++ = kAlphabet[group >> 18];
+        *out++ = kAlphabet[(group >> 12) & 63];
+    } else if (size - i == 2) {
+        uint32_t group = (uint32_t(data[i]) << 16) | (uint32_t(data[i + 1]) << 8);
+        *out++ = kAlphabet[group >> 18];
+        *out++ = kAlphabet[(group >> 12) & 63];
+        *out++ = kAlphabet[(group >> 6) & 63];
+    }
+}
+
+// Decodes exactly `size` bytes; false on a character outside the alphabet
+// or non-zero padding bits, so every token has one spelling
+bool base64UrlDecode(std::string_view text, uint8_t* out, size_t size) {
+    uint32_t group = 0;
+    int bits = 0;
+    size_t written = 0;
+    for (char c : text) {
+        int8_t value = kDecode.values[static_cast<uint8_t>(c)];
+        if (value < 0) {
+            return false;
+        }
+        group = (group << 6) | static_cast<uint32_t>(value);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            if (written == size) {
+                return false;
+            }
+            out[written++] = static_cast<uint8_t>(group >> bits);
+        }
+    }
+    return written == size && (group & ((1u << bits) - 1)) == 0;
+}
+
+} // namespace
+
+TokenCodec::TokenCodec(std::string_view secret) : hmac_(secret) {}
+
+void TokenCodec::encode(const TokenClaims& claims, char* out) const {
+    uint8_t token[kTokenBytes];
+    token[0] = kVersion;
+    uint32_t user_id = static_cast<uint32_t>(claims.user_id);
+    for (int i = 0; i < 4; ++i) {
+        token[1 + i] = static_cast<uint8_t>(user_id >> (24 - 8 * i));
+    }
+    uint64_t issued_at = static_cast<uint64_t>(claims.issued_at);
+    for (int i = 0; i < 8; ++i) {
+        token[5 + i] = static_cast<uint8_t>(issued_at >> (56 - 8 * i));
+    }
+    uint8_t mac[Sha256::kDigestBytes];
+    hmac_.mac(token, kClaimBytes, mac);
+    for (size_t i = 0; i < kMacBytes; ++i) {
+        token[kClaimBytes + i] = mac[i];
+    }
+    base64UrlEncode(token, kTokenBytes, out);
+}
+
+std::string TokenCodec::encode(const TokenClaims& claims) const {
+    std::string token(kEncodedLength, '\0');
+    encode(claims, token.data());
+    return token;
+}
+
+bool TokenCodec::decode(std::string_view text, TokenClaims& claims) const {
+    uint8_t token[kTokenBytes];
+    if (text.size() != kEncodedLength || !base64UrlDecode(text, token, kTokenBytes) || token[0] != kVersion) {
+        return false;
+    }
+    uint8_t mac[Sha256::kDigestBytes];
+    hmac_.mac(token, kClaimBytes, mac);
+    uint8_t difference = 0;
+    for (size_t i = 0; i < kMacBytes; ++i) {
+        difference |= mac[i] ^ token[kClaimBytes + i];
+    }
+    if (difference != 0) {
+        return false;
+    }
+    
+    uint32_t user_id = 0;
+    for (int i = 0; i < 4; ++i) {
+        user_id = (user_id << 8) | token[1 + i];
+    }
+    uint64_t issued_at = 0;
+    for (int i = 0; i < 8; ++i) {
+        issued_at = (issued_at << 8) | token[5 + i];
+    }
+    claims.user_id = static_cast<int>(user_id);
+    claims.issued_at = static_cast<int64_t>(issued_at);
+    return true;
+}
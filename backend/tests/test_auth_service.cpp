@@ -1,40 +1,20 @@
 #include "test_framework.h"
+#include "test_support.h"
 #include "../include/auth_service.h"
-#include <filesystem>
-
-// Helper function to clean up test database
-void cleanupAuthTestDb() {
-    std::vector<std::string> db_files = {
-        "test_auth.db", "todos.db", "auth_test.db", "test_database.db"
-    };
-    for (const auto& file : db_files) {
-        if (std::filesystem::exists(file)) {
-            std::filesystem::remove(file);
-        }
-    }
-}
 
 TEST(auth_service_initialization) {
-    cleanupAuthTestDb();
-    
-    // Test database management is handled by cleanup function
-    
     try {
-        AuthService auth;
+        AuthService auth(testDatabase());
         // If we get here, initialization succeeded
         ASSERT_TRUE(true);
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupAuthTestDb();
 }
 
 TEST(user_registration_success) {
-    cleanupAuthTestDb();
-    
     try {
-        AuthService auth;
+        AuthService auth(testDatabase());
         
         auto user = auth.registerUser("testuser", "test@example.com", "password123");
         ASSERT_TRUE(user.has_value());
@@ -46,15 +26,11 @@ TEST(user_registration_success) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupAuthTestDb();
 }
 
 TEST(user_registration_duplicate) {
-    cleanupAuthTestDb();
-    
     try {
-        AuthService auth;
+        AuthService auth(testDatabase());
         
         // Register first user
         auto user1 = auth.registerUser("testuser", "test@example.com", "password123");
@@ -71,15 +47,11 @@ TEST(user_registration_duplicate) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupAuthTestDb();
 }
 
 TEST(user_registration_empty_fields) {
-    cleanupAuthTestDb();
-    
     try {
-        AuthService auth;
+        AuthService auth(testDatabase());
         
         // Empty username
         auto user1 = auth.registerUser("", "test@example.com", "password123");
@@ -96,15 +68,11 @@ TEST(user_registration_empty_fields) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupAuthTestDb();
 }
 
 TEST(user_login_success) {
-    cleanupAuthTestDb();
-    
     try {
-        AuthService auth;
+        AuthService auth(testDatabase());
         
         // Register user first
         auto registered = auth.registerUser("testuser", "test@example.com", "password123");
@@ -120,15 +88,11 @@ TEST(user_login_success) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupAuthTestDb();
 }
 
 TEST(user_login_wrong_password) {
-    cleanupAuthTestDb();
-    
     try {
-        AuthService auth;
+        AuthService auth(testDatabase());
         
         // Register user first
         auto registered = auth.registerUser("testuser", "test@example.com", "password123");
@@ -141,15 +105,11 @@ TEST(user_login_wrong_password) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupAuthTestDb();
 }
 
 TEST(user_login_nonexistent_user) {
-    cleanupAuthTestDb();
-    
     try {
-        AuthService auth;
+        AuthService auth(testDatabase());
         
         // Login with nonexistent user
         auto user_auth = auth.loginUser("nonexistent", "password123");
@@ -158,15 +118,11 @@ TEST(user_login_nonexistent_user) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupAuthTestDb();
 }
 
 TEST(token_generation_and_validation) {
-    cleanupAuthTestDb();
-    
     try {
-        AuthService auth;
+        AuthService auth(testDatabase());
         
         // Register and login user
         auto registered = auth.registerUser("testuser", "test@example.com", "password123");
@@ -189,15 +145,11 @@ TEST(token_generation_and_validation) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupAuthTestDb();
 }
 
 TEST(token_validation_invalid_token) {
-    cleanupAuthTestDb();
-    
     try {
-        AuthService auth;
+        AuthService auth(testDatabase());
         
         // Test with invalid token formats
         auto result1 = auth.validateToken("invalid_token");
@@ -212,15 +164,11 @@ TEST(token_validation_invalid_token) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupAuthTestDb();
 }
 
 TEST(token_validation_expired_token) {
-    cleanupAuthTestDb();
-    
     try {
-        AuthService auth;
+        AuthService auth(testDatabase());
         
         // Create a token that appears expired (old timestamp)
         std::string expired_token = "1:testuser:1000000000:1234567890";
@@ -231,15 +179,11 @@ TEST(token_validation_expired_token) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupAuthTestDb();
 }
 
 TEST(auth_get_user_by_id) {
-    cleanupAuthTestDb();
-    
     try {
-        AuthService auth;
+        AuthService auth(testDatabase());
         
         // Register user
         auto registered = auth.registerUser("testuser", "test@example.com", "password123");
@@ -259,15 +203,11 @@ TEST(auth_get_user_by_id) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupAuthTestDb();
 }
 
 TEST(password_hashing_different_each_time) {
-    cleanupAuthTestDb();
-    
     try {
-        AuthService auth;
+        AuthService auth(testDatabase());
         
         // Register two users with same password
         auto user1 = auth.registerUser("user1", "user1@example.com", "samepassword");
@@ -289,6 +229,4 @@ TEST(password_hashing_different_each_time) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupAuthTestDb();
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "test_framework.h"
+#include "../include/bloom_filter.h"
+#include "../include/database.h"
+
+TEST(bloom_filter_has_no_false_negatives) {
+    BloomFilter filter(10000);
+    for (int i = 0; i < 10000; ++i) {
+        filter.insert("user" + std::to_string(i));
+    }
+    for (int i = 0; i < 10000; ++i) {
+        ASSERT_TRUE(filter.mightContain("user" + std::to_string(i)));
+    }
+    ASSERT_EQ(10000, filter.size());
+    
+    // At the load it was sized for, about 0.5% of absent keys pass
+    int false_positives = 0;
+    for (int i = 0; i < 100000; ++i) {
+        false_positives += filter.mightContain("absent" + std::to_string(i));
+    }
+    ASSERT_TRUE(false_positives < 1500);
+    ASSERT_TRUE(filter.memoryBytes() <= 10000 * 12 / 8 + 64);
+}
+
+TEST(user_filter_skips_queries_for_unknown_users) {
+    DatabaseOptions options;
+    options.path = testPath("test_user_filter.db");
+    {
+        Database db(options);
+        ASSERT_TRUE(db.initialize());
+        ASSERT_TRUE(db.createUser("known", "known@example.com", "hash").has_value());
+        
+        ASSERT_TRUE(db.getUserByUsername("known").has_value());
+        ASSERT_TRUE(db.userExists("known", "other@example.com"));
+        ASSERT_TRUE(db.userExists("other", "known@example.com"));
+        // An email is not a username
+        ASSERT_FALSE(db.getUserByUsername("known@example.com").has_value());
+        
+        for (int i = 0; i < 100; ++i) {
+            ASSERT_FALSE(db.getUserByUsername("stranger" + std::to_string(i)).has_value());
+        }
+        UserFilterStats stats = db.userFilterStats();
+        ASSERT_TRUE(stats.enabled);
+        ASSERT_EQ(2, stats.keys);
+        ASSERT_EQ(104, stats.lookups);
+        // Nearly all unknown names are answered without a query
+        ASSERT_TRUE(stats.rejected >= 95);
+        ASSERT_EQ(stats.lookups - 3 - stats.rejected, stats.false_positives);
+    }
+    {
+        // Rebuilt from the users table on the next start
+        Database db(options);
+        ASSERT_TRUE(db.initialize());
+        ASSERT_EQ(2, db.userFilterStats().keys);
+        ASSERT_TRUE(db.getUserByUsername("known").has_value());
+    }
+    {
+        DatabaseOptions disabled = options;
+        disabled.user_filter = false;
+        Database db(disabled);
+        ASSERT_TRUE(db.initialize());
+        ASSERT_FALSE(db.userFilterStats().enabled);
+        ASSERT_TRUE(db.getUserByUsername("known").has_value());
+        ASSERT_FALSE(db.getUserByUsername("stranger").has_value());
+        ASSERT_EQ(0, db.userFilterStats().lookups);
+    }
+}
+
+TEST(user_filter_grows_with_the_users_table) {
+    DatabaseOptions options;
+    options.path = testPath("test_user_filter.db");
+    {
+        Database db(options);
+        ASSERT_TRUE(db.initialize());
+        size_t initial_capacity = db.userFilterStats().capacity;
+        
+        // Past the initial sizing the filter is rebuilt larger
+        int users = static_cast<int>(initial_capacity / 2) + 10;
+        for (int i = 0; i < users; ++i) {
+            ASSERT_TRUE(db.createUser("grow" + std::to_string(i), "grow" + std::to_string(i) + "@example.com", "h")
+                            .has_value());
+        }
+        UserFilterStats stats = db.userFilterStats();
+        ASSERT_TRUE(stats.capacity > initial_capacity);
+        ASSERT_EQ(static_cast<size_t>(users) * 2, stats.keys);
+        
+        for (int i = 0; i < users; i += 97) {
+            ASSERT_TRUE(db.getUserByUsername("grow" + std::to_string(i)).has_value());
+            ASSERT_TRUE(db.userExists("nobody", "grow" + std::to_string(i) + "@example.com"));
+        }
+        ASSERT_FALSE(db.userExists("nobody", "nobody@example.com"));
+    }
+}
@@ -0,0 +1,82 @@
+#include "test_framework.h"
+#include "../include/bounded_executor.h"
+#include "../include/database.h"
+
+TEST(db_executor_runs_jobs_off_the_caller) {
+    BoundedExecutorOptions options;
+    options.threads = 2;
+    BoundedExecutor executor(options);
+    
+    std::thread::id caller = std::this_thread::get_id();
+    std::vector<std::future<bool>> futures;
+    for (int i = 0; i < 20; ++i) {
+        futures.push_back(executor.submit([caller] { return std::this_thread::get_id() != caller; }));
+    }
+    for (auto& future : futures) {
+        ASSERT_TRUE(future.valid());
+        ASSERT_TRUE(future.get());
+    }
+    
+    // Exceptions reach the waiting thread instead of killing a worker
+    auto failing = executor.submit([]() -> int { throw std::runtime_error("disk I/O error"); });
+    bool thrown = false;
+    try {
+        failing.get();
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+    ASSERT_EQ(7, executor.submit([] { return 7; }).get());
+    
+    auto stats = executor.stats();
+    ASSERT_EQ(2, stats.threads);
+    ASSERT_EQ(0, stats.rejected);
+}
+
+TEST(db_executor_rejects_when_queue_is_full) {
+    BoundedExecutorOptions options;
+    options.threads = 1;
+    options.max_queued = 3;
+    BoundedExecutor executor(options);
+    
+    // A stalled storage call holds the only thread
+    std::promise<void> stall;
+    std::shared_future<void> stalled = stall.get_future().share();
+    std::promise<void> started;
+    auto slow = executor.submit([&started, stalled] {
+        started.set_value();
+        stalled.wait();
+    });
+    started.get_future().wait();
+    
+    std::vector<std::future<int>> queued;
+    for (int i = 0; i < 3; ++i) {
+        queued.push_back(executor.submit([i] { return i; }));
+        ASSERT_TRUE(queued.back().valid());
+    }
+    auto refused = executor.submit([] { return -1; });
+    ASSERT_FALSE(refused.valid());
+    
+    auto stats = executor.stats();
+    ASSERT_EQ(3, stats.queued);
+    ASSERT_EQ(1, stats.running);
+    ASSERT_EQ(1, stats.rejected);
+    
+    // Once storage catches up the queue drains in submission order
+    stall.set_value();
+    slow.get();
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(i, queued[i].get());
+    }
+}
+
+TEST(database_connection_count) {
+    DatabaseOptions options;
+    options.readers_per_shard = 2;
+    ASSERT_EQ(3, Database(options).connectionCount());
+    options.shard_count = 4;
+    // Four todo shards plus the user directory
+    ASSERT_EQ(15, Database(options).connectionCount());
+    options.engine = StorageEngine::Log;
+    ASSERT_EQ(3, Database(options).connectionCount());
+}
@@ -0,0 +1,92 @@
+#include "test_framework.h"
+#include "../include/buffer_pool.h"
+#include "../include/http_request.h"
+
+BufferPoolOptions smallPoolOptions(size_t max_bytes) {
+    BufferPoolOptions options;
+    options.size_classes = {1024, 4096};
+    options.max_bytes = max_bytes;
+    return options;
+}
+
+TEST(buffer_pool_size_classes_and_reuse) {
+    BufferPool pool(smallPoolOptions(64 * 1024));
+    
+    auto small = pool.acquire(1);
+    ASSERT_TRUE(static_cast<bool>(small));
+    ASSERT_EQ(1024, small.capacity());
+    auto large = pool.acquire(1025);
+    ASSERT_EQ(4096, large.capacity());
+    ASSERT_FALSE(static_cast<bool>(pool.acquire(4097)));
+    
+    auto stats = pool.stats();
+    ASSERT_EQ(1, stats.classes[0].in_use);
+    ASSERT_EQ(1, stats.classes[1].in_use);
+    ASSERT_EQ(5120, stats.bytes_in_use);
+    
+    // A released buffer is handed out again instead of a new allocation
+    char* data = small.data();
+    small.release();
+    ASSERT_EQ(1, pool.stats().classes[0].cached);
+    auto again = pool.acquire(512);
+    ASSERT_TRUE(again.data() == data);
+    
+    // Moving transfers ownership; only the last handle gives the buffer back
+    BufferPool::Buffer moved = std::move(again);
+    ASSERT_FALSE(static_cast<bool>(again));
+    ASSERT_EQ(1, pool.stats().classes[0].in_use);
+    moved.release();
+    large.release();
+    
+    stats = pool.stats();
+    ASSERT_EQ(0, stats.bytes_in_use);
+    ASSERT_EQ(5120, stats.bytes_cached);
+    ASSERT_EQ(3, stats.acquired);
+}
+
+TEST(buffer_pool_caps_memory) {
+    BufferPool pool(smallPoolOptions(8192));
+    
+    auto first = pool.acquire(4096);
+    auto second = pool.acquire(4096);
+    ASSERT_TRUE(static_cast<bool>(second));
+    ASSERT_FALSE(static_cast<bool>(pool.acquire(1)));
+    ASSERT_EQ(1, pool.stats().exhausted);
+    
+    // Cached buffers of another class are freed to make room
+    first.release();
+    auto small = pool.acquire(1);
+    ASSERT_TRUE(static_cast<bool>(small));
+    auto stats = pool.stats();
+    ASSERT_EQ(0, stats.classes[1].cached);
+    ASSERT_EQ(5120, stats.bytes_in_use);
+    ASSERT_TRUE(stats.bytes_in_use + stats.bytes_cached <= stats.max_bytes);
+}
+
+TEST(request_length_and_keep_alive) {
+    bool malformed = false;
+    ASSERT_EQ(0, requestLength("GET /api/todos HTTP/1.1\r\nHost: x\r\n", malformed));
+    
+    std::string get = "GET /api/todos HTTP/1.1\r\nHost: x\r\n\r\n";
+    ASSERT_EQ(get.size(), requestLength(get + "GET /next", malformed));
+    ASSERT_FALSE(malformed);
+    
+    // The full length is known before the body has arrived
+    std::string post = "POST /api/todos HTTP/1.1\r\ncontent-length: 12\r\n\r\n";
+    ASSERT_EQ(post.size() + 12, requestLength(post + "{\"te", malformed));
+    ASSERT_EQ(post.size(), requestHeadLength(post + "{\"te"));
+    ASSERT_EQ(0, requestHeadLength("POST /api/todos HTTP/1.1\r\n"));
+    
+    requestLength("POST / HTTP/1.1\r\nContent-Length: 12x\r\n\r\n", malformed);
+    ASSERT_TRUE(malformed);
+    
+    HttpRequest request;
+    ASSERT_TRUE(parseHttpRequest(get, request));
+    ASSERT_TRUE(wantsKeepAlive(request));
+    ASSERT_TRUE(parseHttpRequest("GET / HTTP/1.1\r\nConnection: Close\r\n\r\n", request));
+    ASSERT_FALSE(wantsKeepAlive(request));
+    ASSERT_TRUE(parseHttpRequest("GET / HTTP/1.0\r\n\r\n", request));
+    ASSERT_FALSE(wantsKeepAlive(request));
+    ASSERT_TRUE(parseHttpRequest("GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n", request));
+    ASSERT_TRUE(wantsKeepAlive(request));
+}
@@ -0,0 +1,84 @@
+#include "test_framework.h"
+#include "../include/compact_todo.h"
+#include "../include/json_utils.h"
+
+TEST(compact_todo_roundtrip) {
+    ASSERT_EQ(32, sizeof(CompactTodo));
+    
+    std::vector<Todo> todos = {
+        {1, 7, "Canonical timestamps", false, "2025-08-01 09:30:15.123456", "2025-08-02 10:00:00.000001", ""},
+        {2, 7, "Completed, with a due date", true, "2025-08-01 09:30:15.123456", "2025-08-01 09:30:15.123456", "2025-09-01"},
+        // Kept verbatim: no fraction, impossible date, before the epoch
+        {3, 7, "Seeded", false, "2025-01-01 00:00:00", "2025-02-30 00:00:00.000000", "2025-09-01T09:00"},
+        {4, 7, "", false, "1969-12-31 23:59:59.999999", "garbage", ""},
+    };
+    
+    CompactTodoList list(7);
+    for (const auto& todo : todos) {
+        list.append(todo);
+    }
+    ASSERT_EQ(todos.size(), list.size());
+    for (size_t i = 0; i < todos.size(); ++i) {
+        Todo copy = list.toTodo(list[i]);
+        ASSERT_EQ(todos[i].id, copy.id);
+        ASSERT_EQ(7, copy.user_id);
+        ASSERT_STR_EQ(todos[i].text, copy.text);
+        ASSERT_TRUE(todos[i].completed == copy.completed);
+        ASSERT_STR_EQ(todos[i].created_at, copy.created_at);
+        ASSERT_STR_EQ(todos[i].updated_at, copy.updated_at);
+        ASSERT_STR_EQ(todos[i].due_date, copy.due_date);
+    }
+    
+    // Only the canonical form is stored as a number
+    ASSERT_FALSE(list[0].flags & CompactTodo::kRawCreatedAt);
+    ASSERT_TRUE(list[2].flags & CompactTodo::kRawCreatedAt);
+    ASSERT_TRUE(list[2].flags & CompactTodo::kRawUpdatedAt);
+    ASSERT_FALSE(list[3].flags & CompactTodo::kRawCreatedAt);
+    
+    std::pmr::string json;
+    appendTodosJson(json, list);
+    ASSERT_STR_EQ(todosToJson(todos), std::string(json));
+}
+
+TEST(compact_todo_keyed_updates_and_compaction) {
+    CompactTodoList list(1);
+    for (int id = 1; id <= 100; ++id) {
+        list.put({id, 1, "Todo " + std::to_string(id), false, "2025-08-01 09:30:15.000000", "2025-08-01 09:30:15.000000", ""});
+    }
+    
+    // Replacing keeps one slot per id
+    list.put({10, 1, "Todo 10, edited", true, "2025-08-01 09:30:15.000000", "2025-08-03 12:00:00.000000", "2025-09-01"});
+    ASSERT_EQ(100, list.size());
+    Todo edited = list.toTodo(*list.find(10));
+    ASSERT_STR_EQ("Todo 10, edited", edited.text);
+    ASSERT_TRUE(edited.completed);
+    ASSERT_STR_EQ("2025-09-01", edited.due_date);
+    
+    for (int id = 1; id <= 60; ++id) {
+        ASSERT_TRUE(list.erase(id));
+    }
+    ASSERT_FALSE(list.erase(5));
+    ASSERT_TRUE(list.find(5) == nullptr);
+    ASSERT_EQ(40, list.size());
+    // Erasing most of the list compacted it
+    ASSERT_TRUE(list.slotCount() < 60);
+    ASSERT_STR_EQ("Todo 61", std::string(list.text(*list.find(61))));
+    
+    // A replayed older id goes back in order
+    list.put({5, 1, "Todo 5 again", false, "2025-08-01 09:30:15.000000", "2025-08-01 09:30:15.000000", ""});
+    std::vector<int> ids;
+    for (const CompactTodo& todo : list) {
+        if (!todo.erased()) ids.push_back(todo.id);
+    }
+    ASSERT_EQ(41, ids.size());
+    ASSERT_EQ(5, ids[0]);
+    ASSERT_EQ(61, ids[1]);
+    ASSERT_EQ(100, ids[40]);
+    
+    // Rewriting the same todo over and over does not grow the pool without bound
+    for (int i = 0; i < 10000; ++i) {
+        list.put({61, 1, "Rewrite number " + std::to_string(i), false, "2025-08-01 09:30:15.000000", "2025-08-01 09:30:15.000000", ""});
+    }
+    ASSERT_TRUE(list.poolSize() < 16384);
+    ASSERT_STR_EQ("Rewrite number 9999", std::string(list.text(*list.find(61))));
+}
@@ -3,31 +3,20 @@
 #include <filesystem>
 #include <fstream>
 
-const std::string TEST_DB_PATH = "test_database.db";
-
-// Helper function to clean up test database
-void cleanupTestDb() {
-    if (std::filesystem::exists(TEST_DB_PATH)) {
-        std::filesystem::remove(TEST_DB_PATH);
-    }
+std::string testDbPath() {
+    return testPath("test_database.db");
 }
 
 TEST(database_initialization) {
-    cleanupTestDb();
-    
-    Database db(TEST_DB_PATH);
+    Database db(testDbPath());
     ASSERT_TRUE(db.initialize());
     
     // Check if database file was created
-    ASSERT_TRUE(std::filesystem::exists(TEST_DB_PATH));
-    
-    cleanupTestDb();
+    ASSERT_TRUE(std::filesystem::exists(testDbPath()));
 }
 
 TEST(user_creation) {
-    cleanupTestDb();
-    
-    Database db(TEST_DB_PATH);
+    Database db(testDbPath());
     ASSERT_TRUE(db.initialize());
     
     auto user = db.createUser("testuser", "test@example.com", "hashedpassword");
@@ -36,14 +25,10 @@ TEST(user_creation) {
     ASSERT_STR_EQ("test@example.com", user->email);
     ASSERT_STR_EQ("hashedpassword", user->password_hash);
     ASSERT_TRUE(user->id > 0);
-    
-    cleanupTestDb();
 }
 
 TEST(user_creation_duplicate) {
-    cleanupTestDb();
-    
-    Database db(TEST_DB_PATH);
+    Database db(testDbPath());
     ASSERT_TRUE(db.initialize());
     
     // Create first user
@@ -57,14 +42,10 @@ TEST(user_creation_duplicate) {
     // Try to create duplicate email
     auto user3 = db.createUser("differentuser", "test@example.com", "hashedpassword");
     ASSERT_FALSE(user3.has_value());
-    
-    cleanupTestDb();
 }
 
 TEST(db_get_user_by_username) {
-    cleanupTestDb();
-    
-    Database db(TEST_DB_PATH);
+    Database db(testDbPath());
     ASSERT_TRUE(db.initialize());
     
     // Create user
@@ -81,14 +62,10 @@ TEST(db_get_user_by_username) {
     // Try to get non-existent user
     auto nonexistent = db.getUserByUsername("nonexistent");
     ASSERT_FALSE(nonexistent.has_value());
-    
-    cleanupTestDb();
 }
 
 TEST(db_get_user_by_id) {
-    cleanupTestDb();
-    
-    Database db(TEST_DB_PATH);
+    Database db(testDbPath());
     ASSERT_TRUE(db.initialize());
     
     // Create user
@@ -105,14 +82,10 @@ TEST(db_get_user_by_id) {
     // Try to get non-existent user
     auto nonexistent = db.getUserById(999);
     ASSERT_FALSE(nonexistent.has_value());
-    
-    cleanupTestDb();
 }
 
 TEST(db_user_exists) {
-    cleanupTestDb();
-    
-    Database db(TEST_DB_PATH);
+    Database db(testDbPath());
     ASSERT_TRUE(db.initialize());
     
     // Initially no users exist
@@ -126,14 +99,10 @@ TEST(db_user_exists) {
     ASSERT_TRUE(db.userExists("testuser", "different@example.com"));
     ASSERT_TRUE(db.userExists("differentuser", "test@example.com"));
     ASSERT_FALSE(db.userExists("nonexistent", "nonexistent@example.com"));
-    
-    cleanupTestDb();
 }
 
 TEST(todo_creation) {
-    cleanupTestDb();
-    
-    Database db(TEST_DB_PATH);
+    Database db(testDbPath());
     ASSERT_TRUE(db.initialize());
     
     // Create user first
@@ -148,14 +117,10 @@ TEST(todo_creation) {
     ASSERT_FALSE(todo.completed);
     ASSERT_TRUE(!todo.created_at.empty());
     ASSERT_TRUE(!todo.updated_at.empty());
-    
-    cleanupTestDb();
 }
 
 TEST(get_all_todos_by_user) {
-    cleanupTestDb();
-    
-    Database db(TEST_DB_PATH);
+    Database db(testDbPath());
     ASSERT_TRUE(db.initialize());
     
     // Create two users
@@ -179,14 +144,10 @@ TEST(get_all_todos_by_user) {
     auto user2_todos = db.getAllTodos(user2->id);
     ASSERT_EQ(1, user2_todos.size());
     ASSERT_STR_EQ("User2 Todo1", user2_todos[0].text);
-    
-    cleanupTestDb();
 }
 
 TEST(todo_update) {
-    cleanupTestDb();
-    
-    Database db(TEST_DB_PATH);
+    Database db(testDbPath());
     ASSERT_TRUE(db.initialize());
     
     // Create user
@@ -204,14 +165,10 @@ TEST(todo_update) {
     ASSERT_TRUE(updated.completed);
     ASSERT_STR_EQ(todo.created_at, updated.created_at);
     ASSERT_TRUE(updated.updated_at != todo.updated_at);
-    
-    cleanupTestDb();
 }
 
 TEST(todo_delete) {
-    cleanupTestDb();
-    
-    Database db(TEST_DB_PATH);
+    Database db(testDbPath());
     ASSERT_TRUE(db.initialize());
     
     // Create user
@@ -231,14 +188,10 @@ TEST(todo_delete) {
     // Verify todo is gone
     auto todos = db.getAllTodos(user->id);
     ASSERT_EQ(0, todos.size());
-    
-    cleanupTestDb();
 }
 
 TEST(todo_isolation_between_users) {
-    cleanupTestDb();
-    
-    Database db(TEST_DB_PATH);
+    Database db(testDbPath());
     ASSERT_TRUE(db.initialize());
     
     // Create two users
@@ -266,6 +219,4 @@ TEST(todo_isolation_between_users) {
     auto user1_todos = db.getAllTodos(user1->id);
     ASSERT_EQ(1, user1_todos.size());
     ASSERT_STR_EQ("User1 Todo", user1_todos[0].text);
-    
-    cleanupTestDb();
 }
\ No newline at end of file
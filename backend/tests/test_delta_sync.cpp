@@ -0,0 +1,191 @@
+#include "test_framework.h"
+#include "../include/database.h"
+#include <thread>
+
+std::string syncTestDbPath() {
+    return testPath("test_delta_sync.db");
+}
+
+void checkDeltaSync(Database& db) {
+    auto first = db.createTodo("First", 1);
+    auto second = db.createTodo("Second", 1);
+    db.createTodo("Someone else's", 2);
+    
+    // A first sync returns every live todo of the user and a sync point
+    auto initial = db.getChangesSince(1, 0, 100);
+    ASSERT_EQ(2, initial.changed.size());
+    ASSERT_EQ(0, initial.deleted.size());
+    ASSERT_FALSE(initial.has_more);
+    ASSERT_FALSE(initial.reset);
+    
+    auto unchanged = db.getChangesSince(1, initial.seq, 100);
+    ASSERT_EQ(0, unchanged.changed.size());
+    ASSERT_EQ(initial.seq, unchanged.seq);
+    
+    db.updateTodo(first.id, "First, edited", true, 1);
+    ASSERT_TRUE(db.deleteTodo(second.id, 1));
+    auto third = db.createTodo("Third", 1);
+    
+    auto delta = db.getChangesSince(1, initial.seq, 100);
+    ASSERT_EQ(2, delta.changed.size());
+    ASSERT_STR_EQ("First, edited", delta.changed[0].text);
+    ASSERT_EQ(third.id, delta.changed[1].id);
+    ASSERT_EQ(1, delta.deleted.size());
+    ASSERT_EQ(second.id, delta.deleted[0]);
+    ASSERT_TRUE(delta.seq > initial.seq);
+    
+    // Tombstones are not part of a first sync
+    ASSERT_EQ(0, db.getChangesSince(1, 0, 100).deleted.size());
+    
+    // Paging through the same changes one at a time
+    int64_t since = initial.seq;
+    size_t seen = 0;
+    for (int page = 0; page < 10; ++page) {
+        auto part = db.getChangesSince(1, since, 1);
+        seen += part.changed.size() + part.deleted.size();
+        since = part.seq;
+        if (!part.has_more) break;
+    }
+    ASSERT_EQ(3, seen);
+    ASSERT_EQ(delta.seq, since);
+    
+    // A sync point from the future (e.g. a restored backup) forces a resync
+    ASSERT_TRUE(db.getChangesSince(1, delta.seq + 1000, 100).reset);
+}
+
+void checkTombstoneCompaction(Database& db) {
+    auto kept = db.createTodo("Kept", 1);
+    auto removed = db.createTodo("Removed", 1);
+    int64_t before_delete = db.getChangesSince(1, 0, 100).seq;
+    ASSERT_TRUE(db.deleteTodo(removed.id, 1));
+    
+    // Within the retention window nothing is purged
+    ASSERT_EQ(0, db.compactTombstones(std::chrono::hours(1)));
+    ASSERT_EQ(1, db.getChangesSince(1, before_delete, 100).deleted.size());
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    ASSERT_EQ(1, db.compactTombstones(std::chrono::seconds(0)));
+    
+    // A client that might have missed the purged tombstone must start over
+    auto stale = db.getChangesSince(1, before_delete, 100);
+    ASSERT_TRUE(stale.reset);
+    auto fresh = db.getChangesSince(1, 0, 100);
+    ASSERT_FALSE(fresh.reset);
+    ASSERT_EQ(1, fresh.changed.size());
+    ASSERT_EQ(kept.id, fresh.changed[0].id);
+    ASSERT_FALSE(db.getChangesSince(1, fresh.seq, 100).reset);
+}
+
+TEST(delta_sync_changes_and_tombstones) {
+    Database db(syncTestDbPath());
+    ASSERT_TRUE(db.initialize());
+    checkDeltaSync(db);
+}
+
+TEST(delta_sync_tombstone_compaction) {
+    Database db(syncTestDbPath());
+    ASSERT_TRUE(db.initialize());
+    checkTombstoneCompaction(db);
+}
+
+TEST(delta_sync_log_engine) {
+    DatabaseOptions options;
+    options.path = syncTestDbPath();
+    options.engine = StorageEngine::Log;
+    options.log_snapshot_interval = 4;
+    {
+        Database db(options);
+        ASSERT_TRUE(db.initialize());
+        checkDeltaSync(db);
+    }
+    
+    // Sequence numbers and tombstones survive snapshots and replay
+    Database db(options);
+    ASSERT_TRUE(db.initialize());
+    auto all = db.getChangesSince(1, 0, 100);
+    ASSERT_EQ(2, all.changed.size());
+    auto recent = db.getChangesSince(1, all.seq - 3, 100);
+    ASSERT_EQ(1, recent.deleted.size());
+    ASSERT_EQ(all.seq, recent.seq);
+}
+
+TEST(delta_sync_log_engine_compaction) {
+    DatabaseOptions options;
+    options.path = syncTestDbPath();
+    options.engine = StorageEngine::Log;
+    {
+        Database db(options);
+        ASSERT_TRUE(db.initialize());
+        checkTombstoneCompaction(db);
+    }
+    
+    // The purge point is persisted, so stale clients still get a reset
+    Database db(options);
+    ASSERT_TRUE(db.initialize());
+    ASSERT_EQ(1, db.getChangesSince(1, 0, 100).changed.size());
+    ASSERT_TRUE(db.getChangesSince(1, 1, 100).reset);
+}
+
+TEST(delta_sync_migrates_existing_database) {
+    // A todos table from before change tracking existed
+    sqlite3* raw;
+    ASSERT_EQ(SQLITE_OK, sqlite3_open(syncTestDbPath().c_str(), &raw));
+    const char* legacy = R"(
+        CREATE TABLE todos (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            user_id INTEGER NOT NULL,
+            text TEXT NOT NULL,
+            completed INTEGER DEFAULT 0,
+            created_at TEXT NOT NULL,
+            updated_at TEXT NOT NULL,
+            due_date TEXT
+        );
+        INSERT INTO todos (user_id, text, created_at, updated_at) VALUES (1, 'Old one', '2025-01-01', '2025-01-01');
+        INSERT INTO todos (user_id, text, created_at, updated_at) VALUES (1, 'Old two', '2025-01-02', '2025-01-02');
+    )";
+    ASSERT_EQ(SQLITE_OK, sqlite3_exec(raw, legacy, nullptr, nullptr, nullptr));
+    sqlite3_close(raw);
+    
+    Database db(syncTestDbPath());
+    ASSERT_TRUE(db.initialize());
+    auto initial = db.getChangesSince(1, 0, 100);
+    ASSERT_EQ(2, initial.changed.size());
+    
+    db.createTodo("New", 1);
+    auto delta = db.getChangesSince(1, initial.seq, 100);
+    ASSERT_EQ(1, delta.changed.size());
+    ASSERT_STR_EQ("New", delta.changed[0].text);
+}
+
+TEST(delta_sync_survives_reshard) {
+    DatabaseOptions options;
+    options.path = syncTestDbPath();
+    int64_t since;
+    int deleted_id;
+    {
+        Database db(options);
+        ASSERT_TRUE(db.initialize());
+        for (int user_id = 1; user_id <= 8; ++user_id) {
+            db.createTodo("Todo of " + std::to_string(user_id), user_id);
+        }
+        since = db.getChangesSince(5, 0, 100).seq;
+        deleted_id = db.createTodo("Short lived", 5).id;
+        db.deleteTodo(deleted_id, 5);
+    }
+    
+    ASSERT_TRUE(Database::reshard(syncTestDbPath(), 4));
+    options.shard_count = 4;
+    Database db(options);
+    ASSERT_TRUE(db.initialize());
+    
+    // The tombstone moved with the user, and moved rows come back as changes
+    // rather than being hidden behind the client's sync point
+    auto delta = db.getChangesSince(5, since, 100);
+    ASSERT_FALSE(delta.reset);
+    ASSERT_EQ(1, delta.deleted.size());
+    ASSERT_EQ(deleted_id, delta.deleted[0]);
+    ASSERT_EQ(1, delta.changed.size());
+    
+    db.createTodo("After reshard", 5);
+    ASSERT_EQ(1, db.getChangesSince(5, delta.seq, 100).changed.size());
+}
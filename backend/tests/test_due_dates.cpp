@@ -0,0 +1,98 @@
+#include "test_framework.h"
+#include "../include/database.h"
+
+std::string dueTestDbPath() {
+    return testPath("test_due_dates.db");
+}
+
+void seedDueTodos(Database& db) {
+    db.createTodo("No due date", 1);
+    db.createTodo("Pay rent", 1, "2025-08-01");
+    db.createTodo("Dentist", 1, "2025-08-03T09:30");
+    auto done = db.createTodo("Submit report", 1, "2025-07-30");
+    db.updateTodo(done.id, done.text, true, 1);
+    db.createTodo("Renew passport", 1, "2025-08-03");
+    db.createTodo("Other user's bill", 2, "2025-07-01");
+}
+
+void checkDueDateQueries(Database& db) {
+    seedDueTodos(db);
+    
+    TodoFilter overdue;
+    overdue.due_before = "2025-08-02";
+    overdue.completed = false;
+    auto todos = db.findTodos(1, overdue);
+    ASSERT_EQ(1, todos.size());
+    ASSERT_STR_EQ("Pay rent", todos[0].text);
+    
+    // Bounds are exclusive and ordered soonest first; a time part sorts after the bare date
+    TodoFilter range;
+    range.due_after = "2025-07-30";
+    todos = db.findTodos(1, range);
+    ASSERT_EQ(3, todos.size());
+    ASSERT_STR_EQ("Pay rent", todos[0].text);
+    ASSERT_STR_EQ("Renew passport", todos[1].text);
+    ASSERT_STR_EQ("Dentist", todos[2].text);
+    
+    // Without a due-date bound the listing keeps todos that have no due date
+    TodoFilter completed;
+    completed.completed = true;
+    todos = db.findTodos(1, completed);
+    ASSERT_EQ(1, todos.size());
+    ASSERT_STR_EQ("Submit report", todos[0].text);
+    completed.completed = false;
+    ASSERT_EQ(4, db.findTodos(1, completed).size());
+    
+    auto buckets = db.countOpenTodosByDay(1, "2025-07-01", "2025-09-01");
+    ASSERT_EQ(2, buckets.size());
+    ASSERT_STR_EQ("2025-08-01", buckets[0].date);
+    ASSERT_EQ(1, buckets[0].count);
+    ASSERT_STR_EQ("2025-08-03", buckets[1].date);
+    ASSERT_EQ(2, buckets[1].count);
+    ASSERT_EQ(0, db.countOpenTodosByDay(1, "2025-08-04", "2025-09-01").size());
+}
+
+TEST(due_date_queries) {
+    Database db(dueTestDbPath());
+    ASSERT_TRUE(db.initialize());
+    checkDueDateQueries(db);
+}
+
+TEST(due_date_queries_use_partial_index) {
+    {
+        Database db(dueTestDbPath());
+        ASSERT_TRUE(db.initialize());
+    }
+    
+    sqlite3* raw;
+    ASSERT_EQ(SQLITE_OK, sqlite3_open(dueTestDbPath().c_str(), &raw));
+    auto plan = [raw](const char* sql) {
+        std::string detail;
+        sqlite3_stmt* stmt;
+        std::string explain = std::string("EXPLAIN QUERY PLAN ") + sql;
+        if (sqlite3_prepare_v2(raw, explain.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                detail += reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+            }
+            sqlite3_finalize(stmt);
+        }
+        return detail;
+    };
+    
+    std::string overdue = plan("SELECT * FROM todos WHERE user_id = 1 AND due_date < '2025-08-02' AND completed = 0 ORDER BY due_date, id");
+    ASSERT_TRUE(overdue.find("idx_todos_open_due") != std::string::npos);
+    std::string calendar = plan("SELECT substr(due_date, 1, 10) AS day, COUNT(*) FROM todos "
+                                "WHERE user_id = 1 AND completed = 0 AND due_date >= '2025-08-01' AND due_date < '2025-09-01' "
+                                "GROUP BY day ORDER BY day");
+    ASSERT_TRUE(calendar.find("COVERING INDEX idx_todos_open_due") != std::string::npos);
+    sqlite3_close(raw);
+}
+
+TEST(due_date_queries_log_engine) {
+    DatabaseOptions options;
+    options.path = dueTestDbPath();
+    options.engine = StorageEngine::Log;
+    Database db(options);
+    ASSERT_TRUE(db.initialize());
+    checkDueDateQueries(db);
+}
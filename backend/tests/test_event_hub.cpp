@@ -0,0 +1,162 @@
+#include "test_framework.h"
+#include "../include/event_hub.h"
+#include <atomic>
+#include <thread>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <poll.h>
+
+// Reads whatever arrives on the client end within `timeout_ms`
+std::string readStream(int fd, int timeout_ms) {
+    std::string data;
+    char buffer[4096];
+    pollfd pfd{fd, POLLIN, 0};
+    while (poll(&pfd, 1, timeout_ms) > 0) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n <= 0) break;
+        data.append(buffer, n);
+        timeout_ms = 20;
+    }
+    return data;
+}
+
+bool waitForSubscribers(EventHub& hub, size_t count) {
+    for (int i = 0; i < 200 && hub.subscriberCount() != count; ++i) {
+        usleep(5000);
+    }
+    return hub.subscriberCount() == count;
+}
+
+TEST(event_hub_fans_out_per_user) {
+    EventHub hub;
+    ASSERT_TRUE(hub.start());
+    
+    int alice[2], alice_other_tab[2], bob[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, alice));
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, alice_other_tab));
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, bob));
+    ASSERT_TRUE(hub.subscribe(alice[0], 1, "retry: 3000\n\n"));
+    ASSERT_TRUE(hub.subscribe(alice_other_tab[0], 1));
+    ASSERT_TRUE(hub.subscribe(bob[0], 2));
+    ASSERT_STR_EQ("retry: 3000\n\n", readStream(alice[1], 500));
+    
+    hub.publish(1, EventHub::formatEvent("created", "{\"id\":7}", "1"));
+    std::string expected = "id: 1\nevent: created\ndata: {\"id\":7}\n\n";
+    ASSERT_STR_EQ(expected, readStream(alice[1], 500));
+    ASSERT_STR_EQ(expected, readStream(alice_other_tab[1], 500));
+    ASSERT_STR_EQ("", readStream(bob[1], 50));
+    
+    // A client hanging up is noticed and its socket released
+    close(alice_other_tab[1]);
+    ASSERT_TRUE(waitForSubscribers(hub, 2));
+    
+    hub.stop();
+    ASSERT_EQ(0, hub.subscriberCount());
+    close(alice[1]);
+    close(bob[1]);
+}
+
+TEST(event_hub_initial_frame_covers_earlier_events) {
+    EventHub hub;
+    ASSERT_TRUE(hub.start());
+    
+    // Versions are bumped before they are published, as TodoService does
+    std::atomic<uint64_t> version{0};
+    std::thread writer([&] {
+        for (int i = 0; i < 200; ++i) {
+            hub.publish(1, EventHub::formatEvent("updated", "{}", std::to_string(++version)));
+        }
+    });
+    int pair[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+    ASSERT_TRUE(hub.subscribe(pair[0], 1, [&] {
+        return EventHub::formatEvent("ready", "{}", std::to_string(version.load()));
+    }));
+    writer.join();
+    
+    // Whenever the stream registered, the ready version and the events
+    // after it add up to the latest version, and ready comes first
+    std::string stream = readStream(pair[1], 500);
+    ASSERT_TRUE(stream.find("event: ready") != std::string::npos);
+    ASSERT_TRUE(stream.find("event: updated") == std::string::npos ||
+                stream.find("event: ready") < stream.find("event: updated"));
+    size_t last_id = stream.rfind("id: ");
+    ASSERT_TRUE(last_id != std::string::npos);
+    ASSERT_EQ(200, std::stoi(stream.substr(last_id + 4)));
+    
+    hub.stop();
+    close(pair[1]);
+}
+
+TEST(event_hub_sends_heartbeats) {
+    EventHubOptions options;
+    // Longer than readStream's 20 ms gap, which would otherwise keep reading
+    // heartbeats for as long as they keep coming on time
+    options.heartbeat_interval = std::chrono::milliseconds(50);
+    EventHub hub(options);
+    ASSERT_TRUE(hub.start());
+    
+    int pair[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+    ASSERT_TRUE(hub.subscribe(pair[0], 1));
+    ASSERT_STR_EQ(":\n\n", readStream(pair[1], 500).substr(0, 3));
+    
+    hub.stop();
+    close(pair[1]);
+}
+
+TEST(event_hub_drops_slow_consumers) {
+    EventHubOptions options;
+    options.max_queued_bytes = 4096;
+    EventHub hub(options);
+    ASSERT_TRUE(hub.start());
+    
+    int slow[2], fast[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, slow));
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fast));
+    ASSERT_TRUE(hub.subscribe(slow[0], 1));
+    ASSERT_TRUE(hub.subscribe(fast[0], 2));
+    
+    // Never read from the slow client: once its socket buffer is full the
+    // hub-side queue grows past the limit and the stream is cut
+    std::string frame = EventHub::formatEvent("updated", std::string(1000, 'x'));
+    for (int i = 0; i < 10000 && hub.subscriberCount() == 2; ++i) {
+        hub.publish(1, frame);
+        if (i % 100 == 0) usleep(1000);
+    }
+    ASSERT_TRUE(waitForSubscribers(hub, 1));
+    ASSERT_EQ(1, hub.droppedCount());
+    
+    hub.publish(2, EventHub::formatEvent("created", "{}"));
+    ASSERT_STR_EQ("event: created\ndata: {}\n\n", readStream(fast[1], 500));
+    
+    hub.stop();
+    close(slow[1]);
+    close(fast[1]);
+}
+
+TEST(event_hub_bounds_queues_as_events_are_published) {
+    EventHubOptions options;
+    options.max_queued_bytes = 4096;
+    EventHub hub(options);
+    ASSERT_TRUE(hub.start());
+    
+    int client[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, client));
+    ASSERT_TRUE(hub.subscribe(client[0], 1));
+    
+    // The socket would take it, but it is never queued in the first place
+    hub.publish(1, EventHub::formatEvent("updated", std::string(5000, 'x')));
+    ASSERT_EQ(1, hub.droppedCount());
+    hub.publish(1, EventHub::formatEvent("updated", "{}"));
+    ASSERT_EQ(1, hub.droppedCount());
+    ASSERT_TRUE(waitForSubscribers(hub, 0));
+    ASSERT_STR_EQ("", readStream(client[1], 100));
+    
+    hub.stop();
+    close(client[1]);
+}
+
+TEST(event_hub_formats_multiline_data) {
+    ASSERT_STR_EQ("event: note\ndata: a\ndata: b\n\n", EventHub::formatEvent("note", "a\nb"));
+}
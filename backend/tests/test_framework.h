@@ -1,11 +1,26 @@
 #pragma once
 
+#include <atomic>
 #include <iostream>
+#include <filesystem>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <functional>
 #include <chrono>
+#include <unistd.h>
 
+struct TestRunOptions {
+    // Tests run at once, each on its own thread
+    size_t jobs = 1;
+    // Run only tests whose name contains one of these; all when empty
+    std::vector<std::string> filters;
+};
+
+// Every test runs in a scratch directory of its own (see testPath), created
+// empty before it starts and removed after it ends, so tests share no files
+// and any number of them can run at once.
 class TestFramework {
 public:
     struct TestResult {
@@ -14,47 +29,76 @@ public:
         std::string message;
         double duration_ms;
     };
-
+    
     static TestFramework& getInstance() {
         static TestFramework instance;
         return instance;
     }
-
+    
     void addTest(const std::string& name, std::function<void()> test) {
         tests_.push_back({name, test});
     }
-
-    void runAll() {
+    
+    void runAll(const TestRunOptions& options = TestRunOptions()) {
         std::cout << "\n=== Running Unit Tests ===\n\n";
         
+        std::vector<const Test*> selected;
+        for (const auto& test : tests_) {
+            bool wanted = options.filters.empty();
+            for (const auto& filter : options.filters) {
+                wanted = wanted || test.name.find(filter) != std::string::npos;
+            }
+            if (wanted) {
+                selected.push_back(&test);
+            }
+        }
+        results_.assign(selected.size(), TestResult{});
+        
+        std::filesystem::path root = std::filesystem::temp_directory_path() /
+                                     ("todo_tests-" + std::to_string(getpid()));
+        std::atomic<size_t> next{0};
+        std::mutex output;
         int passed = 0;
         int failed = 0;
-        
-        for (const auto& test : tests_) {
-            auto start = std::chrono::high_resolution_clock::now();
-            
-            try {
-                test.function();
-                auto end = std::chrono::high_resolution_clock::now();
-                auto duration = std::chrono::duration<double, std::milli>(end - start).count();
-                
-                results_.push_back({test.name, true, "PASSED", duration});
-                std::cout << "✓ " << test.name << " (" << duration << "ms)\n";
-                passed++;
-            } catch (const std::exception& e) {
-                auto end = std::chrono::high_resolution_clock::now();
-                auto duration = std::chrono::duration<double, std::milli>(end - start).count();
-                
-                results_.push_back({test.name, false, std::string("FAILED: ") + e.what(), duration});
-                std::cout << "✗ " << test.name << " - " << e.what() << " (" << duration << "ms)\n";
-                failed++;
+        auto worker = [&] {
+            for (size_t i; (i = next.fetch_add(1)) < selected.size();) {
+                TestResult result = run(*selected[i], root / selected[i]->name);
+                std::lock_guard<std::mutex> lock(output);
+                if (result.passed) {
+                    std::cout << "✓ " << result.name << " (" << result.duration_ms << "ms)\n";
+                    passed++;
+                } else {
+                    std::cout << "✗ " << result.name << " - " << result.message << " ("
+                              << result.duration_ms << "ms)\n";
+                    failed++;
+                }
+                results_[i] = std::move(result);
             }
+        };
+        
+        auto start = std::chrono::steady_clock::now();
+        size_t jobs = std::max<size_t>(1, std::min(options.jobs, selected.size()));
+        std::vector<std::thread> threads;
+        for (size_t j = 1; j < jobs; ++j) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : threads) {
+            thread.join();
         }
+        double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::error_code ignored;
+        std::filesystem::remove_all(root, ignored);
         
+        double test_ms = 0;
+        for (const auto& result : results_) {
+            test_ms += result.duration_ms;
+        }
         std::cout << "\n=== Test Summary ===\n";
         std::cout << "Passed: " << passed << "\n";
         std::cout << "Failed: " << failed << "\n";
-        std::cout << "Total: " << (passed + failed) << "\n\n";
+        std::cout << "Total: " << (passed + failed) << "\n";
+        std::cout << "Time: " << wall_ms << "ms with " << jobs << " job(s), " << test_ms << "ms of tests\n\n";
         
         if (failed > 0) {
             std::cout << "Some tests failed!\n";
@@ -62,21 +106,58 @@ public:
             std::cout << "All tests passed! ✓\n";
         }
     }
-
+    
     const std::vector<TestResult>& getResults() const {
         return results_;
     }
+    
+    // The running test's scratch directory; empty outside a test
+    static const std::filesystem::path& scratchDirectory() {
+        return currentScratch();
+    }
 
 private:
     struct Test {
         std::string name;
         std::function<void()> function;
     };
-
+    
     std::vector<Test> tests_;
     std::vector<TestResult> results_;
+    
+    static std::filesystem::path& currentScratch() {
+        thread_local std::filesystem::path directory;
+        return directory;
+    }
+    
+    static TestResult run(const Test& test, const std::filesystem::path& scratch) {
+        std::error_code ignored;
+        std::filesystem::remove_all(scratch, ignored);
+        std::filesystem::create_directories(scratch);
+        currentScratch() = scratch;
+        
+        auto start = std::chrono::high_resolution_clock::now();
+        TestResult result{test.name, true, "PASSED", 0};
+        try {
+            test.function();
+        } catch (const std::exception& e) {
+            result.passed = false;
+            result.message = std::string("FAILED: ") + e.what();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        result.duration_ms = std::chrono::duration<double, std::milli>(end - start).count();
+        
+        currentScratch().clear();
+        std::filesystem::remove_all(scratch, ignored);
+        return result;
+    }
 };
 
+// `name` inside the running test's scratch directory
+inline std::string testPath(const std::string& name) {
+    return (TestFramework::scratchDirectory() / name).string();
+}
+
 // Helper macros for testing
 #define ASSERT_TRUE(condition) \
     if (!(condition)) { \
@@ -116,5 +197,5 @@ private:
     }(); \
     void test_##name()
 
-#define RUN_ALL_TESTS() \
-    TestFramework::getInstance().runAll();
\ No newline at end of file
+#define RUN_ALL_TESTS(options) \
+    TestFramework::getInstance().runAll(options);
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include "test_framework.h"
+#include "../include/database.h"
+#include "../include/todo_service.h"
+#include "../include/json_utils.h"
+#include "../include/compact_todo.h"
+
+std::string importTestDbPath() {
+    return testPath("test_import.db");
+}
+
+TEST(parse_imported_todo_lines) {
+    Todo todo;
+    ASSERT_TRUE(parseImportedTodo(R"({"text":"Plain"})", todo));
+    ASSERT_STR_EQ("Plain", todo.text);
+    ASSERT_FALSE(todo.completed);
+    ASSERT_STR_EQ("", todo.due_date);
+    ASSERT_STR_EQ("", todo.created_at);
+    
+    // An export line imports as itself, minus the id
+    ASSERT_TRUE(parseImportedTodo(R"({"id":7,"user_id":3,"text":"Tab\there \"quoted\" é😀","completed":true,)"
+                                  R"("created_at":"2025-08-01 09:30:15.123456","updated_at":"2025-08-02 10:00:00.000001",)"
+                                  R"("due_date":"2025-09-01"})", todo));
+    ASSERT_STR_EQ("Tab\there \"quoted\" \xc3\xa9\xf0\x9f\x98\x80", todo.text);
+    ASSERT_TRUE(todo.completed);
+    ASSERT_STR_EQ("2025-08-01 09:30:15.123456", todo.created_at);
+    ASSERT_STR_EQ("2025-08-02 10:00:00.000001", todo.updated_at);
+    ASSERT_STR_EQ("2025-09-01", todo.due_date);
+    
+    // The POST field name, spacing, and non-canonical timestamps
+    ASSERT_TRUE(parseImportedTodo(R"(  { "text" : "Spaced", "dueDate" : "2025-10-01", "created_at" : "yesterday", "due_date" : null }  )", todo));
+    ASSERT_STR_EQ("2025-10-01", todo.due_date);
+    ASSERT_STR_EQ("", todo.created_at);
+    
+    ASSERT_FALSE(parseImportedTodo("", todo));
+    ASSERT_FALSE(parseImportedTodo("not json", todo));
+    ASSERT_FALSE(parseImportedTodo(R"({"completed":true})", todo));
+    ASSERT_FALSE(parseImportedTodo(R"({"text":""})", todo));
+    ASSERT_FALSE(parseImportedTodo(R"({"text":"Open)", todo));
+    ASSERT_FALSE(parseImportedTodo(R"({"text":"Two"}{"text":"objects"})", todo));
+    ASSERT_FALSE(parseImportedTodo(R"({"text":"Bad","completed":"yes"})", todo));
+    ASSERT_FALSE(parseImportedTodo(R"({"text":"Nested","tags":["a"]})", todo));
+    ASSERT_FALSE(parseImportedTodo(R"({"text":"Lone \ud83d surrogate"})", todo));
+}
+
+TEST(exported_control_characters_round_trip) {
+    // Import decodes \u escapes to raw control bytes; every writer has to
+    // escape them again for the output to stay valid JSON
+    Todo todo;
+    ASSERT_TRUE(parseImportedTodo(R"({"text":"Bell\u0007 nul\u0000 esc\u001b","due_date":"2025-09-01"})", todo));
+    ASSERT_TRUE(todo.text == std::string("Bell\x07 nul") + '\0' + " esc\x1b");
+    
+    std::string expected = R"("text":"Bell\u0007 nul\u0000 esc\u001b")";
+    std::string json = todoToJson(todo);
+    ASSERT_TRUE(json.find(expected) != std::string::npos);
+    CompactTodoList list(1);
+    list.append(todo);
+    std::pmr::string streamed;
+    appendTodoJson(streamed, list, list[0]);
+    ASSERT_TRUE(std::string(streamed).find(expected) != std::string::npos);
+    
+    Todo reparsed;
+    ASSERT_TRUE(parseImportedTodo(json, reparsed));
+    ASSERT_TRUE(todo.text == reparsed.text);
+}
+
+// Imports two batches, checks ids, fields, list order and the change feed
+void checkImportTodos(Database& db) {
+    db.createTodo("Made before the import", 1);
+    
+    std::vector<Todo> batch;
+    for (int i = 0; i < 50; ++i) {
+        Todo todo;
+        parseImportedTodo("{\"text\":\"Imported " + std::to_string(i) + "\",\"completed\":" + (i % 2 ? "true" : "false") +
+                          ",\"created_at\":\"2025-01-01 00:00:" + (i < 10 ? "0" : "") + std::to_string(i) + ".000000\"}", todo);
+        batch.push_back(todo);
+    }
+    std::vector<Todo> second(batch.begin() + 25, batch.end());
+    batch.resize(25);
+    ASSERT_TRUE(db.importTodos(1, batch));
+    ASSERT_TRUE(db.importTodos(1, second));
+    ASSERT_EQ(2, batch[0].id);
+    ASSERT_EQ(26, batch[24].id);
+    ASSERT_EQ(51, second[24].id);
+    
+    ASSERT_EQ(51, db.getAllTodos(1).size());
+    Todo last = db.getTodoById(51, 1);
+    ASSERT_STR_EQ("Imported 49", last.text);
+    ASSERT_TRUE(last.completed);
+    ASSERT_STR_EQ("2025-01-01 00:00:49.000000", last.created_at);
+    ASSERT_STR_EQ("2025-01-01 00:00:49.000000", last.updated_at);
+    ASSERT_FALSE(db.getTodoById(2, 1).completed);
+    
+    auto changes = db.getChangesSince(1, 0, 100);
+    ASSERT_EQ(51, changes.changed.size());
+    ASSERT_EQ(51, db.searchTodos(1, "imported", 100, 0).size() + 1);
+}
+
+TEST(import_todos_sqlite) {
+    {
+        Database db(importTestDbPath());
+        ASSERT_TRUE(db.initialize());
+        checkImportTodos(db);
+        
+        // Imported timestamps are kept, so the todo created today lists
+        // first and the imports in their own creation order after it
+        auto todos = db.getAllTodos(1);
+        ASSERT_STR_EQ("Made before the import", todos[0].text);
+        ASSERT_STR_EQ("Imported 49", todos[1].text);
+        ASSERT_STR_EQ("Imported 0", todos[50].text);
+    }
+}
+
+TEST(import_todos_log_engine) {
+    DatabaseOptions options;
+    options.path = importTestDbPath();
+    options.engine = StorageEngine::Log;
+    {
+        Database db(options);
+        ASSERT_TRUE(db.initialize());
+        checkImportTodos(db);
+    }
+    
+    // Replayed from the log with completion and timestamps intact
+    Database reopened(options);
+    ASSERT_TRUE(reopened.initialize());
+    ASSERT_EQ(51, reopened.getAllTodos(1).size());
+    Todo last = reopened.getTodoById(51, 1);
+    ASSERT_TRUE(last.completed);
+    ASSERT_STR_EQ("2025-01-01 00:00:49.000000", last.created_at);
+    ASSERT_EQ(52, reopened.createTodo("After reopening", 1).id);
+}
+
+TEST(import_todos_bumps_version_once_per_batch) {
+    {
+        auto db = std::make_shared<Database>(importTestDbPath());
+        ASSERT_TRUE(db->initialize());
+        TodoService service(db);
+        int notifications = 0;
+        service.setChangeListener([&notifications](const TodoChange&) { notifications++; });
+        
+        std::vector<Todo> batch(10, Todo{-1, -1, "Bulk", false, "", "", ""});
+        ASSERT_TRUE(service.importTodos(4, batch));
+        ASSERT_EQ(1, service.getVersion(4));
+        ASSERT_EQ(0, notifications);
+        ASSERT_EQ(10, service.getAllTodos(4).size());
+        
+        std::vector<Todo> empty;
+        ASSERT_TRUE(service.importTodos(4, empty));
+        ASSERT_EQ(1, service.getVersion(4));
+    }
+}
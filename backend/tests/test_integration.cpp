@@ -1,28 +1,15 @@
 #include "test_framework.h"
+#include "test_support.h"
 #include "../include/auth_service.h"
 #include "../include/todo_service.h"
-#include <filesystem>
 #include <thread>
 #include <chrono>
 
-// Helper function to clean up test database
-void cleanupIntegrationTestDb() {
-    std::vector<std::string> db_files = {
-        "test_integration.db", "todos.db", "integration_test.db", "test_database.db"
-    };
-    for (const auto& file : db_files) {
-        if (std::filesystem::exists(file)) {
-            std::filesystem::remove(file);
-        }
-    }
-}
-
 TEST(integration_user_registration_and_todo_creation) {
-    cleanupIntegrationTestDb();
-    
     try {
-        AuthService auth;
-        TodoService todoService;
+        auto db = testDatabase();
+        AuthService auth(db);
+        TodoService todoService(db);
         
         // Register a user
         auto user = auth.registerUser("integrationuser", "integration@example.com", "password123");
@@ -46,16 +33,13 @@ TEST(integration_user_registration_and_todo_creation) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupIntegrationTestDb();
 }
 
 TEST(integration_multiple_users_todo_isolation) {
-    cleanupIntegrationTestDb();
-    
     try {
-        AuthService auth;
-        TodoService todoService;
+        auto db = testDatabase();
+        AuthService auth(db);
+        TodoService todoService(db);
         
         // Register two users
         auto user1 = auth.registerUser("user1", "user1@example.com", "password123");
@@ -89,16 +73,13 @@ TEST(integration_multiple_users_todo_isolation) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupIntegrationTestDb();
 }
 
 TEST(integration_token_workflow) {
-    cleanupIntegrationTestDb();
-    
     try {
-        AuthService auth;
-        TodoService todoService;
+        auto db = testDatabase();
+        AuthService auth(db);
+        TodoService todoService(db);
         
         // Register user
         auto user = auth.registerUser("tokenuser", "token@example.com", "password123");
@@ -125,16 +106,13 @@ TEST(integration_token_workflow) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupIntegrationTestDb();
 }
 
 TEST(integration_complete_todo_workflow) {
-    cleanupIntegrationTestDb();
-    
     try {
-        AuthService auth;
-        TodoService todoService;
+        auto db = testDatabase();
+        AuthService auth(db);
+        TodoService todoService(db);
         
         // Register and login user
         auto user = auth.registerUser("workflowuser", "workflow@example.com", "password123");
@@ -179,15 +157,11 @@ TEST(integration_complete_todo_workflow) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupIntegrationTestDb();
 }
 
 TEST(integration_password_security) {
-    cleanupIntegrationTestDb();
-    
     try {
-        AuthService auth;
+        AuthService auth(testDatabase());
         
         // Register user
         auto user = auth.registerUser("securityuser", "security@example.com", "mypassword");
@@ -208,15 +182,11 @@ TEST(integration_password_security) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupIntegrationTestDb();
 }
 
 TEST(integration_user_data_consistency) {
-    cleanupIntegrationTestDb();
-    
     try {
-        AuthService auth;
+        AuthService auth(testDatabase());
         
         // Register user
         auto registered = auth.registerUser("consistencyuser", "consistency@example.com", "password123");
@@ -241,6 +211,4 @@ TEST(integration_user_data_consistency) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupIntegrationTestDb();
 }
\ No newline at end of file
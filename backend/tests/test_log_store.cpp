@@ -0,0 +1,183 @@
+#include "test_framework.h"
+#include "../include/database.h"
+#include "../include/log_store.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+std::string logTestDbPath() {
+    return testPath("test_log_store.db");
+}
+
+DatabaseOptions logTestOptions(size_t snapshot_interval = 0) {
+    DatabaseOptions options;
+    options.path = logTestDbPath();
+    options.engine = StorageEngine::Log;
+    options.log_sync_batch = 1;
+    options.log_snapshot_interval = snapshot_interval;
+    return options;
+}
+
+std::string readBinaryFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeBinaryFile(const std::string& path, const std::string& data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+TEST(log_store_roundtrip) {
+    int user_id;
+    int kept_id;
+    {
+        Database db(logTestOptions());
+        ASSERT_TRUE(db.initialize());
+        
+        auto user = db.createUser("loguser", "log@example.com", "hashedpassword");
+        ASSERT_TRUE(user.has_value());
+        user_id = user->id;
+        
+        auto kept = db.createTodo("Keep me", user_id, "2025-08-01");
+        auto removed = db.createTodo("Delete me", user_id);
+        kept_id = kept.id;
+        
+        auto updated = db.updateTodo(kept.id, "Kept and updated", true, user_id);
+        ASSERT_STR_EQ("Kept and updated", updated.text);
+        ASSERT_TRUE(db.deleteTodo(removed.id, user_id));
+        ASSERT_FALSE(db.deleteTodo(removed.id, user_id));
+    }
+    
+    Database reopened(logTestOptions());
+    ASSERT_TRUE(reopened.initialize());
+    
+    auto user = reopened.getUserByUsername("loguser");
+    ASSERT_TRUE(user.has_value());
+    ASSERT_EQ(user_id, user->id);
+    ASSERT_TRUE(reopened.userExists("other", "log@example.com"));
+    ASSERT_FALSE(reopened.createUser("loguser", "new@example.com", "hash").has_value());
+    
+    auto todos = reopened.getAllTodos(user_id);
+    ASSERT_EQ(1, todos.size());
+    ASSERT_EQ(kept_id, todos[0].id);
+    ASSERT_STR_EQ("Kept and updated", todos[0].text);
+    ASSERT_TRUE(todos[0].completed);
+    ASSERT_STR_EQ("2025-08-01", todos[0].due_date);
+    
+    // Ids keep increasing after a restart
+    auto next = reopened.createTodo("After restart", user_id);
+    ASSERT_TRUE(next.id > kept_id);
+}
+
+TEST(log_store_snapshot_bounds_log) {
+    {
+        Database db(logTestOptions(5));
+        ASSERT_TRUE(db.initialize());
+        for (int i = 0; i < 12; ++i) {
+            db.createTodo("Todo " + std::to_string(i), 1);
+        }
+    }
+    
+    ASSERT_TRUE(std::filesystem::exists(logTestDbPath() + ".snapshot"));
+    // Two snapshots were taken (after records 5 and 10), so only the tail remains in the log
+    ASSERT_TRUE(std::filesystem::file_size(logTestDbPath() + ".wal") <
+                std::filesystem::file_size(logTestDbPath() + ".snapshot"));
+    
+    Database reopened(logTestOptions(5));
+    ASSERT_TRUE(reopened.initialize());
+    auto todos = reopened.getAllTodos(1);
+    ASSERT_EQ(12, todos.size());
+    ASSERT_STR_EQ("Todo 11", todos[0].text);
+    ASSERT_STR_EQ("Todo 0", todos[11].text);
+}
+
+TEST(log_store_replay_after_snapshot_is_idempotent) {
+    std::string log_before_snapshot;
+    {
+        LogStore store(logTestDbPath(), 1, std::chrono::milliseconds(10), 0);
+        ASSERT_TRUE(store.open());
+        auto first = store.createTodo("First", 1, "", "2025-01-01 00:00:00.000000");
+        store.createTodo("Second", 1, "", "2025-01-01 00:00:01.000000");
+        store.updateTodo(first.id, "First updated", true, 1, "2025-01-01 00:00:02.000000");
+        store.deleteTodo(first.id, 1, "2025-01-01 00:00:03.000000");
+        log_before_snapshot = readBinaryFile(store.logPath());
+        ASSERT_TRUE(store.snapshot());
+    }
+    
+    // Simulate a crash between publishing the snapshot and truncating the log
+    writeBinaryFile(logTestDbPath() + ".wal", log_before_snapshot);
+    
+    LogStore store(logTestDbPath(), 1, std::chrono::milliseconds(10), 0);
+    ASSERT_TRUE(store.open());
+    auto todos = store.getAllTodos(1);
+    ASSERT_EQ(1, todos.size());
+    ASSERT_STR_EQ("Second", todos[0].text);
+}
+
+TEST(log_store_crash_recovery_random_truncation) {
+    const int todo_count = 40;
+    {
+        Database db(logTestOptions());
+        ASSERT_TRUE(db.initialize());
+        for (int i = 0; i < todo_count; ++i) {
+            db.createTodo("Todo " + std::to_string(i), 1, i % 2 ? "2025-09-01" : "");
+        }
+    }
+    std::string full_log = readBinaryFile(logTestDbPath() + ".wal");
+    ASSERT_TRUE(!full_log.empty());
+    
+    std::mt19937 rng(20250719);
+    std::uniform_int_distribution<size_t> offset_dist(0, full_log.size());
+    
+    for (int round = 0; round < 25; ++round) {
+        size_t offset = offset_dist(rng);
+        writeBinaryFile(logTestDbPath() + ".wal", full_log.substr(0, offset));
+        
+        size_t recovered;
+        {
+            Database db(logTestOptions());
+            ASSERT_TRUE(db.initialize());
+            auto todos = db.getAllTodos(1);
+            recovered = todos.size();
+            ASSERT_TRUE(recovered <= static_cast<size_t>(todo_count));
+            
+            // Every surviving record is intact and the survivors form a prefix
+            for (size_t i = 0; i < recovered; ++i) {
+                size_t original = recovered - 1 - i;
+                ASSERT_STR_EQ("Todo " + std::to_string(original), todos[i].text);
+                ASSERT_EQ(static_cast<int>(original) + 1, todos[i].id);
+            }
+            
+            // The torn tail was cut off, so new writes land on a clean boundary
+            auto todo = db.createTodo("After crash", 1);
+            ASSERT_TRUE(todo.id > 0);
+        }
+        
+        Database reopened(logTestOptions());
+        ASSERT_TRUE(reopened.initialize());
+        auto todos = reopened.getAllTodos(1);
+        ASSERT_EQ(recovered + 1, todos.size());
+        ASSERT_STR_EQ("After crash", todos[0].text);
+    }
+}
+
+TEST(log_store_checksum_stops_replay) {
+    {
+        Database db(logTestOptions());
+        ASSERT_TRUE(db.initialize());
+        for (int i = 0; i < 10; ++i) {
+            db.createTodo("Todo " + std::to_string(i), 1);
+        }
+    }
+    
+    // Flip a byte inside the last record's payload
+    std::string log = readBinaryFile(logTestDbPath() + ".wal");
+    log[log.size() - 3] ^= 0x5A;
+    writeBinaryFile(logTestDbPath() + ".wal", log);
+    
+    Database db(logTestOptions());
+    ASSERT_TRUE(db.initialize());
+    ASSERT_EQ(9, db.getAllTodos(1).size());
+}
@@ -0,0 +1,127 @@
+#include "test_framework.h"
+#include "../include/logger.h"
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// The logger is process-wide: tests that start it take turns
+std::mutex logger_test_mutex;
+
+std::vector<std::string> logLines(const std::string& path, const std::string& message) {
+    std::ifstream file(path);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.find("\"msg\":\"" + message + "\"") != std::string::npos) {
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+TEST(logger_writes_json_lines_with_context) {
+    std::lock_guard<std::mutex> lock(logger_test_mutex);
+    LogOptions options;
+    options.path = testPath("json.log");
+    ASSERT_TRUE(Logger::start(options));
+    {
+        LogContext request(41);
+        LogContext::setUser(7);
+        logError("Failed to read todos", {{"error", "disk \"full\"\n"}, {"rows", 3}, {"seconds", 0.25}});
+        {
+            LogContext nested(42);
+            logWarning("Nested request");
+        }
+        logInfo("Back in request");
+    }
+    logInfo("No request");
+    logDebug("Below the level");
+    Logger::stop();
+    
+    auto failed = logLines(options.path, "Failed to read todos");
+    ASSERT_EQ(1, failed.size());
+    const std::string& line = failed[0];
+    ASSERT_TRUE(line.rfind("{\"time\":\"", 0) == 0);
+    ASSERT_TRUE(line.find("Z\",\"level\":\"error\"") != std::string::npos);
+    ASSERT_TRUE(line.find(",\"request_id\":41,\"user_id\":7,") != std::string::npos);
+    ASSERT_TRUE(line.find(",\"error\":\"disk \\\"full\\\"\\n\"") != std::string::npos);
+    ASSERT_TRUE(line.find(",\"rows\":3,\"seconds\":0.25}") != std::string::npos);
+    
+    auto nested = logLines(options.path, "Nested request");
+    ASSERT_EQ(1, nested.size());
+    ASSERT_TRUE(nested[0].find("\"request_id\":42") != std::string::npos);
+    ASSERT_TRUE(nested[0].find("user_id") == std::string::npos);
+    auto back = logLines(options.path, "Back in request");
+    ASSERT_EQ(1, back.size());
+    ASSERT_TRUE(back[0].find("\"request_id\":41,\"user_id\":7") != std::string::npos);
+    auto outside = logLines(options.path, "No request");
+    ASSERT_EQ(1, outside.size());
+    ASSERT_TRUE(outside[0].find("request_id") == std::string::npos);
+    ASSERT_EQ(0, logLines(options.path, "Below the level").size());
+}
+
+TEST(logger_rate_limits_repeated_messages) {
+    std::lock_guard<std::mutex> lock(logger_test_mutex);
+    LogOptions options;
+    options.path = testPath("limited.log");
+    options.rate_limit_per_second = 5;
+    options.thread_buffer_records = 256;
+    ASSERT_TRUE(Logger::start(options));
+    uint64_t suppressed_before = Logger::stats().suppressed;
+    for (int i = 0; i < 100; ++i) {
+        logError("Database is busy", {{"attempt", i}});
+    }
+    uint64_t suppressed = Logger::stats().suppressed - suppressed_before;
+    // The burst may straddle a second boundary, which lets a second five through
+    ASSERT_TRUE(suppressed >= 90 && suppressed <= 95);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    logError("Database is busy", {{"attempt", 100}});
+    Logger::stop();
+    
+    auto lines = logLines(options.path, "Database is busy");
+    ASSERT_EQ(100 - suppressed + 1, lines.size());
+    // The first line after the window reports what the limit held back
+    ASSERT_TRUE(lines.back().find("\"attempt\":100,\"suppressed\":") != std::string::npos);
+}
+
+TEST(logger_drops_rather_than_blocks_when_buffers_fill) {
+    std::lock_guard<std::mutex> lock(logger_test_mutex);
+    LogOptions options;
+    options.path = testPath("threads.log");
+    options.rate_limit_per_second = 0;
+    options.thread_buffer_records = 16;
+    options.flush_interval = std::chrono::milliseconds(5);
+    ASSERT_TRUE(Logger::start(options));
+    LogStats before = Logger::stats();
+    const int kThreads = 4;
+    const int kRecords = 2000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([t] {
+            LogContext request(1000 + t);
+            for (int i = 0; i < kRecords; ++i) {
+                logInfo("Load record", {{"thread", t}, {"i", i}});
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    Logger::stop();
+    LogStats after = Logger::stats();
+    
+    size_t written = logLines(options.path, "Load record").size();
+    uint64_t dropped = after.dropped - before.dropped;
+    ASSERT_EQ(kThreads * kRecords, written + dropped);
+    ASSERT_TRUE(written >= 16);
+    if (dropped > 0) {
+        ASSERT_TRUE(logLines(options.path, "Log records dropped: thread buffers were full").size() > 0);
+    }
+    std::ifstream file(options.path);
+    std::string line;
+    while (std::getline(file, line)) {
+        ASSERT_TRUE(line.rfind("{\"time\":", 0) == 0 && line.back() == '}');
+    }
+}
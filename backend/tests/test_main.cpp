@@ -2,15 +2,64 @@
 
 // Include all test files
 #include "test_database.cpp"
+#include "test_log_store.cpp"
+#include "test_sharding.cpp"
+#include "test_search.cpp"
+#include "test_due_dates.cpp"
+#include "test_delta_sync.cpp"
+#include "test_event_hub.cpp"
+#include "test_request_arena.cpp"
+#include "test_compact_todo.cpp"
+#include "test_streaming.cpp"
+#include "test_import_export.cpp"
+#include "test_buffer_pool.cpp"
+#include "test_task_scheduler.cpp"
+#include "test_bounded_executor.cpp"
+#include "test_concurrency.cpp"
 #include "test_auth_service.cpp"
+#include "test_session_cache.cpp"
+#include "test_password_hash.cpp"
+#include "test_bloom_filter.cpp"
+#include "test_token_codec.cpp"
+#include "test_metrics.cpp"
+#include "test_request_trace.cpp"
+#include "test_logger.cpp"
 #include "test_todo_service.cpp"
 #include "test_integration.cpp"
 
-int main() {
+namespace {
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [-j N] [--filter NAME]...\n"
+              << "  -j N           run N tests at once, each in its own scratch directory (default 1)\n"
+              << "  --filter NAME  run only tests whose name contains NAME (repeatable)\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    TestRunOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "-j" || arg == "--jobs") {
+            options.jobs = static_cast<size_t>(std::max(std::atoi(value.c_str()), 1));
+        } else if (arg == "--filter") {
+            options.filters.push_back(value);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    
     std::cout << "=== Todo Backend Unit Tests ===\n";
     std::cout << "Running comprehensive test suite...\n";
     
-    RUN_ALL_TESTS();
+    RUN_ALL_TESTS(options);
     
     const auto& results = TestFramework::getInstance().getResults();
     
@@ -0,0 +1,117 @@
+#include "test_framework.h"
+#include "../include/metrics.h"
+#include <thread>
+#include <vector>
+
+TEST(metrics_latency_buckets_are_log_linear) {
+    ASSERT_EQ(8192, LatencyBuckets::upperBoundOf(0));
+    ASSERT_EQ(12288, LatencyBuckets::upperBoundOf(1));
+    ASSERT_EQ(16384, LatencyBuckets::upperBoundOf(2));
+    ASSERT_EQ(uint64_t(1) << 33, LatencyBuckets::upperBoundOf(LatencyBuckets::kFinite - 1));
+    
+    // Bounds are inclusive, like Prometheus' `le`
+    ASSERT_EQ(0, LatencyBuckets::bucketOf(0));
+    ASSERT_EQ(0, LatencyBuckets::bucketOf(8192));
+    ASSERT_EQ(1, LatencyBuckets::bucketOf(8193));
+    ASSERT_EQ(1, LatencyBuckets::bucketOf(12288));
+    ASSERT_EQ(2, LatencyBuckets::bucketOf(12289));
+    ASSERT_EQ(LatencyBuckets::kFinite - 1, LatencyBuckets::bucketOf(uint64_t(1) << 33));
+    ASSERT_EQ(LatencyBuckets::kFinite, LatencyBuckets::bucketOf((uint64_t(1) << 33) + 1));
+    ASSERT_EQ(LatencyBuckets::kFinite, LatencyBuckets::bucketOf(UINT64_MAX));
+    
+    for (size_t bucket = 0; bucket < LatencyBuckets::kFinite; ++bucket) {
+        ASSERT_EQ(bucket, LatencyBuckets::bucketOf(LatencyBuckets::upperBoundOf(bucket)));
+    }
+}
+
+TEST(metrics_routes_are_templates) {
+    size_t put_route = HttpMetrics::routeOf("PUT", "/api/todos/42");
+    ASSERT_EQ(put_route, HttpMetrics::routeOf("PUT", "/api/todos/7"));
+    ASSERT_TRUE(put_route != HttpMetrics::kOtherRoute);
+    ASSERT_TRUE(HttpMetrics::routeOf("DELETE", "/api/todos/42") != put_route);
+    ASSERT_TRUE(HttpMetrics::routeOf("GET", "/api/todos") != HttpMetrics::routeOf("POST", "/api/todos"));
+    ASSERT_TRUE(HttpMetrics::routeOf("GET", "/api/todos/search") != HttpMetrics::kOtherRoute);
+    ASSERT_EQ(HttpMetrics::routeOf("OPTIONS", "/api/todos"), HttpMetrics::routeOf("OPTIONS", "/anything"));
+    ASSERT_EQ(HttpMetrics::kOtherRoute, HttpMetrics::routeOf("GET", "/api/todos/"));
+    ASSERT_EQ(HttpMetrics::kOtherRoute, HttpMetrics::routeOf("GET", "/nope"));
+    ASSERT_EQ(HttpMetrics::kOtherRoute, HttpMetrics::routeOf("BREW", "/api/todos"));
+}
+
+TEST(metrics_counts_requests_from_many_threads) {
+    HttpMetrics metrics;
+    size_t route = HttpMetrics::routeOf("GET", "/api/todos");
+    const int kThreads = 8;
+    const int kPerThread = 5000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&metrics, route, t] {
+            metrics.connectionOpened();
+            for (int i = 0; i < kPerThread; ++i) {
+                metrics.recordRequest(route, i % 10 == 0 ? 304 : 200, 10000 * (t + 1));
+            }
+            metrics.connectionClosed();
+        });
+    }
+    metrics.connectionOpened();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    ASSERT_EQ(kThreads * kPerThread * 9 / 10, metrics.requests(route, 200));
+    ASSERT_EQ(kThreads * kPerThread / 10, metrics.requests(route, 304));
+    ASSERT_EQ(0, metrics.requests(route, 404));
+    ASSERT_EQ(1, metrics.connections());
+    
+    std::string text;
+    metrics.appendPrometheus(text);
+    ASSERT_TRUE(text.find("todo_http_requests_total{method=\"GET\",route=\"/api/todos\",code=\"200\"} 36000\n") !=
+                std::string::npos);
+    ASSERT_TRUE(text.find("todo_http_requests_total{method=\"GET\",route=\"/api/todos\",code=\"304\"} 4000\n") !=
+                std::string::npos);
+    ASSERT_TRUE(text.find("code=\"404\"") == std::string::npos);
+    ASSERT_TRUE(text.find("# TYPE todo_http_request_duration_seconds histogram\n") != std::string::npos);
+    // 10 µs lands in the 12.288 µs bucket; everything is at most 80 µs
+    ASSERT_TRUE(text.find("route=\"/api/todos\",le=\"8.192e-06\"} 0\n") != std::string::npos);
+    ASSERT_TRUE(text.find("route=\"/api/todos\",le=\"1.2288e-05\"} 5000\n") != std::string::npos);
+    ASSERT_TRUE(text.find("route=\"/api/todos\",le=\"+Inf\"} 40000\n") != std::string::npos);
+    ASSERT_TRUE(text.find("todo_http_request_duration_seconds_count{method=\"GET\",route=\"/api/todos\"} 40000\n") !=
+                std::string::npos);
+    ASSERT_TRUE(text.find("todo_http_request_duration_seconds_sum{method=\"GET\",route=\"/api/todos\"} 1.8\n") !=
+                std::string::npos);
+    ASSERT_TRUE(text.find("todo_http_connections 1\n") != std::string::npos);
+    
+    // Buckets are cumulative
+    uint64_t previous = 0;
+    size_t at = 0;
+    std::string series = "todo_http_request_duration_seconds_bucket{method=\"GET\",route=\"/api/todos\"";
+    while ((at = text.find(series, at)) != std::string::npos) {
+        size_t value = text.find("} ", at) + 2;
+        uint64_t count = std::stoull(text.substr(value, text.find('\n', value) - value));
+        ASSERT_TRUE(count >= previous);
+        previous = count;
+        at = value;
+    }
+    ASSERT_EQ(40000, previous);
+}
+
+TEST(metrics_export_storage_stages_and_queue_depths) {
+    HttpMetrics metrics;
+    metrics.recordStorageStage(HttpMetrics::StorageStage::Queue, 5000);
+    metrics.recordStorageStage(HttpMetrics::StorageStage::Execute, 2000000);
+    std::string text;
+    metrics.appendPrometheus(text);
+    ASSERT_TRUE(text.find("todo_storage_stage_duration_seconds_count{stage=\"queue\"} 1\n") != std::string::npos);
+    ASSERT_TRUE(text.find("todo_storage_stage_duration_seconds_sum{stage=\"execute\"} 0.002\n") != std::string::npos);
+    
+    BoundedExecutorStats storage{3, 7, 3, 1024, 100, 2};
+    AuthStats auth{};
+    auth.hashing = BoundedExecutorStats{2, 5, 2, 32, 40, 1};
+    BufferPoolStats buffers{};
+    buffers.bytes_in_use = 65536;
+    text.clear();
+    appendRuntimeMetrics(text, buffers, TaskSchedulerStats{}, storage, auth);
+    ASSERT_TRUE(text.find("# TYPE todo_storage_queued gauge\ntodo_storage_queued 7\n") != std::string::npos);
+    ASSERT_TRUE(text.find("todo_storage_rejected_total 2\n") != std::string::npos);
+    ASSERT_TRUE(text.find("todo_password_hash_queued 5\n") != std::string::npos);
+    ASSERT_TRUE(text.find("todo_io_buffer_bytes_in_use 65536\n") != std::string::npos);
+}
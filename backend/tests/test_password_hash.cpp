@@ -0,0 +1,176 @@
+#include "test_framework.h"
+#include "../include/password_hash.h"
+#include "../include/auth_service.h"
+#include <thread>
+
+std::string scryptHex(std::string_view password, std::string_view salt, int log2_n, int r, int p) {
+    uint8_t key[64];
+    if (!scrypt(password, salt, {log2_n, r, p}, key, sizeof(key))) {
+        return "";
+    }
+    std::string hex;
+    char digits[3];
+    for (uint8_t byte : key) {
+        std::snprintf(digits, sizeof(digits), "%02x", byte);
+        hex += digits;
+    }
+    return hex;
+}
+
+TEST(scrypt_rfc7914_vectors) {
+    ASSERT_STR_EQ("77d6576238657b203b19ca42c18a0497f16b4844e3074ae8dfdffa3fede21442"
+                  "fcd0069ded0948f8326a753a0fc81f17e8d3e0fb2e0d3628cf35e20c38d18906",
+                  scryptHex("", "", 4, 1, 1));
+    ASSERT_STR_EQ("fdbabe1c9d3472007856e7190d01e9fe7c6ad7cbc8237830e77376634b373162"
+                  "2eaf30d92e22a3886ff109279d9830dac727afb94a83ee6d8360cbdfa2cc0640",
+                  scryptHex("password", "NaCl", 10, 8, 16));
+    // Parameters beyond the supported range are refused, not computed
+    ASSERT_STR_EQ("", scryptHex("password", "NaCl", 30, 8, 1));
+    // Each within its own limit, but 4 GiB together
+    ASSERT_STR_EQ("", scryptHex("password", "NaCl", 20, 32, 1));
+    // 256 MiB of memory mixed 16 times over
+    ASSERT_STR_EQ("", scryptHex("password", "NaCl", 18, 8, 16));
+}
+
+TEST(password_hash_round_trip) {
+    PasswordHashParams params{10, 8, 1};
+    std::string hash = hashPassword("correct horse", params);
+    ASSERT_TRUE(hash.rfind("$scrypt$ln=10,r=8,p=1$", 0) == 0);
+    ASSERT_TRUE(verifyPasswordHash("correct horse", hash));
+    ASSERT_FALSE(verifyPasswordHash("correct horse!", hash));
+    // Salted: the same password never hashes the same way twice
+    ASSERT_TRUE(hash != hashPassword("correct horse", params));
+    
+    ASSERT_TRUE(passwordHashMatches(hash, params));
+    ASSERT_FALSE(passwordHashMatches(hash, {11, 8, 1}));
+    ASSERT_FALSE(passwordHashMatches("todo_app_salt_1:2", params));
+    
+    ASSERT_FALSE(verifyPasswordHash("x", ""));
+    ASSERT_FALSE(verifyPasswordHash("x", "$scrypt$ln=10,r=8,p=1$zz$00"));
+    ASSERT_FALSE(verifyPasswordHash("x", "$scrypt$ln=10,r=8,p=1,q=2$00$00"));
+    ASSERT_FALSE(verifyPasswordHash("x", "$scrypt$ln=40,r=8,p=1$00$00"));
+}
+
+void checkPasswordUpgrade(DatabaseOptions options) {
+    {
+        auto db = std::make_shared<Database>(options);
+        ASSERT_TRUE(db->initialize());
+        // Stored by the scheme used before scrypt
+        std::string legacy = "todo_app_salt_1700000000:" + std::to_string(std::hash<std::string>()("hunter2todo_app_salt_1700000000"));
+        auto legacy_user = db->createUser("legacy", "legacy@example.com", legacy);
+        ASSERT_TRUE(legacy_user.has_value());
+        
+        AuthOptions cheap;
+        cheap.password_hash.log2_n = 10;
+        AuthService auth(db, cheap);
+        ASSERT_FALSE(auth.loginUser("legacy", "wrong").has_value());
+        ASSERT_STR_EQ(legacy, db->getUserById(legacy_user->id)->password_hash);
+        std::string token = auth.generateToken({legacy_user->id, "legacy", "legacy@example.com"});
+        ASSERT_TRUE(auth.validateToken(token).has_value());
+        ASSERT_EQ(1, auth.stats().sessions.entries);
+        
+        ASSERT_TRUE(auth.loginUser("legacy", "hunter2").has_value());
+        std::string upgraded = db->getUserById(legacy_user->id)->password_hash;
+        ASSERT_TRUE(passwordHashMatches(upgraded, cheap.password_hash));
+        ASSERT_EQ(1, auth.stats().rehashed);
+        // Changing the stored user drops its cached sessions
+        ASSERT_EQ(0, auth.stats().sessions.entries);
+        
+        // Logging in again at the same cost leaves the hash alone
+        ASSERT_TRUE(auth.loginUser("legacy", "hunter2").has_value());
+        ASSERT_STR_EQ(upgraded, db->getUserById(legacy_user->id)->password_hash);
+        
+        // Raising the cost upgrades at the next login
+        AuthOptions raised = cheap;
+        raised.password_hash.log2_n = 11;
+        AuthService stronger(db, raised);
+        ASSERT_TRUE(stronger.loginUser("legacy", "hunter2").has_value());
+        ASSERT_TRUE(passwordHashMatches(db->getUserById(legacy_user->id)->password_hash, raised.password_hash));
+        db->flush();
+    }
+    {
+        // The upgraded hash is what storage kept
+        auto db = std::make_shared<Database>(options);
+        ASSERT_TRUE(db->initialize());
+        AuthOptions raised;
+        raised.password_hash.log2_n = 11;
+        AuthService auth(db, raised);
+        ASSERT_TRUE(auth.loginUser("legacy", "hunter2").has_value());
+        ASSERT_EQ(0, auth.stats().rehashed);
+    }
+}
+
+TEST(login_upgrades_password_hash_sqlite) {
+    DatabaseOptions options;
+    options.path = testPath("test_password_hash.db");
+    checkPasswordUpgrade(options);
+}
+
+TEST(login_upgrades_password_hash_log_engine) {
+    DatabaseOptions options;
+    options.path = testPath("test_password_hash_log.db");
+    options.engine = StorageEngine::Log;
+    checkPasswordUpgrade(options);
+}
+
+TEST(login_flood_is_refused_when_hashing_pool_is_full) {
+    DatabaseOptions options;
+    options.path = testPath("test_password_flood.db");
+    {
+        auto db = std::make_shared<Database>(options);
+        ASSERT_TRUE(db->initialize());
+        AuthOptions auth_options;
+        auth_options.hash_threads = 1;
+        auth_options.hash_max_queued = 1;
+        AuthService auth(db, auth_options);
+        ASSERT_TRUE(auth.registerUser("flood", "flood@example.com", "password").has_value());
+        
+        const int attempts = 8;
+        std::vector<int> outcomes(attempts);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < attempts; ++i) {
+            threads.emplace_back([&auth, &outcomes, i] {
+                bool busy = false;
+                bool ok = auth.loginUser("flood", "password", &busy).has_value();
+                outcomes[i] = ok ? 1 : busy ? 2 : 0;
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        
+        // Every attempt either logged in or was turned away at once
+        uint64_t refused = 0;
+        for (int outcome : outcomes) {
+            ASSERT_TRUE(outcome != 0);
+            refused += outcome == 2;
+        }
+        ASSERT_TRUE(refused > 0);
+        ASSERT_EQ(refused, auth.stats().hashing.rejected);
+    }
+}
+
+TEST(login_unknown_user_costs_a_hash) {
+    DatabaseOptions options;
+    options.path = testPath("test_password_unknown.db");
+    auto db = std::make_shared<Database>(options);
+    ASSERT_TRUE(db->initialize());
+    AuthOptions cheap;
+    cheap.password_hash.log2_n = 10;
+    AuthService auth(db, cheap);
+    ASSERT_TRUE(auth.registerUser("known", "known@example.com", "password").has_value());
+    // A job counts as completed only after its caller has the result
+    auto hashed = [&auth] {
+        BoundedExecutorStats stats = auth.stats().hashing;
+        return stats.completed + stats.running;
+    };
+    uint64_t before = hashed();
+    
+    // A wrong password and an unknown user both wait for one hash
+    ASSERT_FALSE(auth.loginUser("known", "wrong").has_value());
+    ASSERT_EQ(before + 1, hashed());
+    ASSERT_FALSE(auth.loginUser("nobody", "wrong").has_value());
+    ASSERT_EQ(before + 2, hashed());
+    ASSERT_FALSE(auth.loginUser("nobody", "wrong").has_value());
+    ASSERT_EQ(before + 3, hashed());
+}
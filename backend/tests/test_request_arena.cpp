@@ -0,0 +1,85 @@
+#include "test_framework.h"
+#include "../include/database.h"
+#include "../include/http_request.h"
+#include "../include/json_utils.h"
+#include "../include/request_arena.h"
+#include "../include/compact_todo.h"
+
+std::string arenaTestDbPath() {
+    return testPath("test_request_arena.db");
+}
+
+void checkArenaListing(Database& db) {
+    db.createTodo("Plain", 1);
+    db.createTodo("Quotes \"and\" back\\slashes\nand a newline", 1, "2025-09-01");
+    db.createTodo("A todo text long enough to never fit in a small string buffer", 1);
+    db.createTodo("Not mine", 2);
+    
+    RequestArena arena;
+    CompactTodoList todos(1, arena.resource());
+    db.getAllTodos(1, todos);
+    auto expected = db.getAllTodos(1);
+    
+    ASSERT_EQ(expected.size(), todos.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        Todo todo = todos.toTodo(todos[i]);
+        ASSERT_EQ(expected[i].id, todo.id);
+        ASSERT_STR_EQ(expected[i].text, todo.text);
+        ASSERT_STR_EQ(expected[i].created_at, todo.created_at);
+        ASSERT_STR_EQ(expected[i].due_date, todo.due_date);
+    }
+    
+    // The arena writer produces exactly what the stream-based one does
+    std::pmr::string json(arena.resource());
+    appendTodosJson(json, todos);
+    ASSERT_STR_EQ(todosToJson(expected), std::string(json));
+}
+
+TEST(parse_http_request_in_place) {
+    std::string raw = "PUT /api/todos/7?due_after=2025-01-01&x=%20y HTTP/1.1\r\n"
+                      "Host: localhost\r\n"
+                      "authorization:  Bearer abc.def \r\n"
+                      "\r\n"
+                      "{\"text\":\"hi\"}";
+    HttpRequest request;
+    ASSERT_TRUE(parseHttpRequest(raw, request));
+    ASSERT_STR_EQ("PUT", std::string(request.method));
+    ASSERT_STR_EQ("/api/todos/7", std::string(request.path));
+    ASSERT_STR_EQ("due_after=2025-01-01&x=%20y", std::string(request.query));
+    ASSERT_STR_EQ("HTTP/1.1", std::string(request.version));
+    ASSERT_STR_EQ("{\"text\":\"hi\"}", std::string(request.body));
+    
+    // Fields point into the caller's buffer rather than copies
+    ASSERT_TRUE(request.path.data() >= raw.data() && request.path.data() < raw.data() + raw.size());
+    
+    ASSERT_STR_EQ("Bearer abc.def", std::string(extractHeader(request.headers, "Authorization")));
+    ASSERT_STR_EQ("localhost", std::string(extractHeader(request.headers, "HOST")));
+    ASSERT_TRUE(extractHeader(request.headers, "If-None-Match").empty());
+    // The body is not searched for headers
+    ASSERT_TRUE(extractHeader(request.headers, "{\"text\"").empty());
+    
+    HttpRequest no_query;
+    ASSERT_TRUE(parseHttpRequest("GET /api/todos HTTP/1.1\r\n\r\n", no_query));
+    ASSERT_STR_EQ("/api/todos", std::string(no_query.path));
+    ASSERT_TRUE(no_query.query.empty());
+    ASSERT_TRUE(no_query.body.empty());
+    
+    HttpRequest garbage;
+    ASSERT_FALSE(parseHttpRequest("\r\n\r\n", garbage));
+    ASSERT_FALSE(parseHttpRequest("GET", garbage));
+}
+
+TEST(arena_listing_matches_heap_listing) {
+    Database db(arenaTestDbPath());
+    ASSERT_TRUE(db.initialize());
+    checkArenaListing(db);
+}
+
+TEST(arena_listing_log_engine) {
+    DatabaseOptions options;
+    options.path = arenaTestDbPath();
+    options.engine = StorageEngine::Log;
+    Database db(options);
+    ASSERT_TRUE(db.initialize());
+    checkArenaListing(db);
+}
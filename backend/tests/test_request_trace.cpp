@@ -0,0 +1,123 @@
+#include "test_framework.h"
+#include "../include/request_trace.h"
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+TEST(trace_clock_tracks_steady_clock) {
+    // Calibrates on first use; keep that out of the measured interval
+    TraceClock::toNanos(1);
+    auto wall_start = std::chrono::steady_clock::now();
+    uint64_t start = TraceClock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t end = TraceClock::now();
+    auto wall_end = std::chrono::steady_clock::now();
+    uint64_t nanos = TraceClock::nanosBetween(start, end);
+    double wall = std::chrono::duration<double, std::nano>(wall_end - wall_start).count();
+    ASSERT_TRUE(nanos > wall * 0.8);
+    ASSERT_TRUE(nanos < wall * 1.2);
+    ASSERT_EQ(0, TraceClock::nanosBetween(start + 10, start));
+}
+
+TEST(request_trace_server_timing_header) {
+    RequestTrace trace;
+    {
+        TraceSpan auth(trace, "auth");
+    }
+    size_t db = trace.begin("db");
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    trace.end(db);
+    // Still open when the header is built: left out
+    trace.begin("send");
+    ASSERT_EQ(3, trace.size());
+    
+    std::string header;
+    trace.appendServerTiming(header);
+    ASSERT_TRUE(header.rfind("Server-Timing: auth;dur=", 0) == 0);
+    ASSERT_TRUE(header.find(", db;dur=") != std::string::npos);
+    ASSERT_TRUE(header.find("send") == std::string::npos);
+    ASSERT_TRUE(header.find(", total;dur=") != std::string::npos);
+    ASSERT_TRUE(header.size() > 2 && header.compare(header.size() - 2, 2, "\r\n") == 0);
+    double db_ms = std::stod(header.substr(header.find("db;dur=") + 7));
+    ASSERT_TRUE(db_ms >= 1.5);
+    
+    for (size_t i = 0; i < 2 * RequestTrace::kMaxSpans; ++i) {
+        trace.add("extra", trace.start(), trace.start() + 1);
+    }
+    ASSERT_EQ(RequestTrace::kMaxSpans, trace.size());
+    ASSERT_EQ(RequestTrace::kMaxSpans, trace.begin("dropped"));
+}
+
+TEST(trace_writer_samples_and_writes_chrome_traces) {
+    {
+        TraceWriter off;
+        ASSERT_FALSE(off.enabled());
+        ASSERT_FALSE(off.sample());
+    }
+    
+    TraceOptions options;
+    options.sample_rate = 0.25;
+    options.path = testPath("test_traces_sampled.json");
+    {
+        TraceWriter quarter(options);
+        int sampled = 0;
+        for (int i = 0; i < 100000; ++i) {
+            sampled += quarter.sample() ? 1 : 0;
+        }
+        ASSERT_TRUE(sampled > 23000 && sampled < 27000);
+    }
+    
+    options.sample_rate = 1;
+    options.path = testPath("test_traces.json");
+    // Small enough that some threads write out mid-run
+    options.thread_buffer_bytes = 2048;
+    const int kThreads = 4;
+    const int kRequests = 50;
+    {
+        TraceWriter writer(options);
+        ASSERT_TRUE(writer.enabled());
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&writer] {
+                for (int i = 0; i < kRequests; ++i) {
+                    RequestTrace trace;
+                    {
+                        TraceSpan db(trace, "db");
+                    }
+                    {
+                        TraceSpan serialize(trace, "serialize");
+                    }
+                    if (writer.sample()) {
+                        writer.write(trace, "GET", "/api/todos", 200);
+                    }
+                }
+                writer.flushThread();
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        ASSERT_EQ(kThreads * kRequests, writer.written());
+    }
+    
+    std::ifstream file(options.path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string json = contents.str();
+    ASSERT_TRUE(json.rfind("[\n{\"name\":", 0) == 0);
+    ASSERT_TRUE(json.size() > 4 && json.compare(json.size() - 4, 4, "}\n]\n") == 0);
+    size_t events = 0;
+    size_t requests = 0;
+    for (size_t at = json.find("\"ph\":\"X\""); at != std::string::npos; at = json.find("\"ph\":\"X\"", at + 1)) {
+        ++events;
+    }
+    for (size_t at = json.find("\"name\":\"GET /api/todos\""); at != std::string::npos;
+         at = json.find("\"name\":\"GET /api/todos\"", at + 1)) {
+        ++requests;
+    }
+    ASSERT_EQ(kThreads * kRequests * 3, events);
+    ASSERT_EQ(kThreads * kRequests, requests);
+    ASSERT_TRUE(json.find(",\n,") == std::string::npos);
+    ASSERT_TRUE(json.find("\"args\":{\"status\":200}") != std::string::npos);
+}
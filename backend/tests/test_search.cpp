@@ -0,0 +1,147 @@
+#include "test_framework.h"
+#include "../include/database.h"
+#include <set>
+
+std::string searchTestDbPath() {
+    return testPath("test_search.db");
+}
+
+void seedSearchTodos(Database& db) {
+    db.createTodo("Buy milk and eggs", 1);
+    db.createTodo("Milk the cows", 1);
+    db.createTodo("Read a book about milkshakes", 1);
+    db.createTodo("Call mom", 1);
+    db.createTodo("Buy milk for the office", 2);
+}
+
+// What both storage engines must agree on
+void checkWordsAndPrefixes(Database& db) {
+    seedSearchTodos(db);
+    
+    auto results = db.searchTodos(1, "milk", 10, 0);
+    ASSERT_EQ(3, results.size());
+    for (const auto& todo : results) {
+        ASSERT_EQ(1, todo.user_id);
+    }
+    
+    // Every word has to match
+    results = db.searchTodos(1, "buy milk", 10, 0);
+    ASSERT_EQ(1, results.size());
+    ASSERT_STR_EQ("Buy milk and eggs", results[0].text);
+    
+    // The last word matches as a prefix, the others only whole
+    ASSERT_EQ(1, db.searchTodos(1, "mo", 10, 0).size());
+    ASSERT_EQ(1, db.searchTodos(1, "milk egg", 10, 0).size());
+    ASSERT_EQ(0, db.searchTodos(1, "mil eggs", 10, 0).size());
+    ASSERT_EQ(2, db.searchTodos(1, "MILK", 10, 1).size());
+    ASSERT_EQ(0, db.searchTodos(1, "office", 10, 0).size());
+    ASSERT_EQ(0, db.searchTodos(1, "   ", 10, 0).size());
+}
+
+TEST(search_matches_words_and_prefixes) {
+    Database db(searchTestDbPath());
+    ASSERT_TRUE(db.initialize());
+    checkWordsAndPrefixes(db);
+}
+
+TEST(search_ignores_query_syntax_in_input) {
+    Database db(searchTestDbPath());
+    ASSERT_TRUE(db.initialize());
+    seedSearchTodos(db);
+    db.createTodo("Say \"hello\" OR wave", 1);
+    
+    ASSERT_EQ(1, db.searchTodos(1, "\"hello\" OR", 10, 0).size());
+    ASSERT_EQ(0, db.searchTodos(1, "owner:u2 office", 10, 0).size());
+    ASSERT_EQ(0, db.searchTodos(1, "NEAR(milk", 10, 0).size());
+}
+
+TEST(search_index_follows_updates_and_deletes) {
+    Database db(searchTestDbPath());
+    ASSERT_TRUE(db.initialize());
+    auto todo = db.createTodo("Water the plants", 1);
+    
+    ASSERT_EQ(1, db.searchTodos(1, "plants", 10, 0).size());
+    
+    db.updateTodo(todo.id, "Water the garden", false, 1);
+    ASSERT_EQ(0, db.searchTodos(1, "plants", 10, 0).size());
+    ASSERT_EQ(1, db.searchTodos(1, "garden", 10, 0).size());
+    
+    db.deleteTodo(todo.id, 1);
+    ASSERT_EQ(0, db.searchTodos(1, "garden", 10, 0).size());
+}
+
+TEST(search_pagination_and_ranking) {
+    Database db(searchTestDbPath());
+    ASSERT_TRUE(db.initialize());
+    for (int i = 0; i < 25; ++i) {
+        db.createTodo("Report number " + std::to_string(i), 1);
+    }
+    db.createTodo("Report report report", 1);
+    
+    auto first = db.searchTodos(1, "report", 10, 0);
+    ASSERT_EQ(10, first.size());
+    ASSERT_STR_EQ("Report report report", first[0].text);
+    
+    auto last = db.searchTodos(1, "report", 10, 20);
+    ASSERT_EQ(6, last.size());
+    for (const auto& a : first) {
+        for (const auto& b : last) {
+            ASSERT_TRUE(a.id != b.id);
+        }
+    }
+}
+
+TEST(search_ranks_every_match_across_pages) {
+    Database db(searchTestDbPath());
+    ASSERT_TRUE(db.initialize());
+    // The best match is the oldest, behind more than a thousand newer ones
+    std::vector<Todo> todos(1);
+    todos[0].text = "Invoice invoice invoice";
+    for (int i = 0; i < 1200; ++i) {
+        Todo todo;
+        todo.text = "Invoice " + std::to_string(i) + " for the quarterly client review";
+        todos.push_back(todo);
+    }
+    ASSERT_TRUE(db.importTodos(1, todos));
+    
+    auto first = db.searchTodos(1, "invoice", 10, 0);
+    ASSERT_EQ(10, first.size());
+    ASSERT_STR_EQ("Invoice invoice invoice", first[0].text);
+    
+    // Pages past the thousandth match neither overlap nor skip rows
+    std::set<int> seen;
+    for (int offset = 0; offset < 1300; offset += 100) {
+        for (const auto& todo : db.searchTodos(1, "invoice", 100, offset)) {
+            ASSERT_TRUE(seen.insert(todo.id).second);
+        }
+    }
+    ASSERT_EQ(1201, seen.size());
+}
+
+TEST(search_indexes_existing_todos) {
+    // A database written before the search index existed
+    {
+        sqlite3* raw = nullptr;
+        sqlite3_open(searchTestDbPath().c_str(), &raw);
+        sqlite3_exec(raw, "CREATE TABLE todos (id INTEGER PRIMARY KEY AUTOINCREMENT, user_id INTEGER NOT NULL, "
+                          "text TEXT NOT NULL, completed INTEGER DEFAULT 0, created_at TEXT NOT NULL, "
+                          "updated_at TEXT NOT NULL, due_date TEXT);"
+                          "INSERT INTO todos (user_id, text, created_at, updated_at) "
+                          "VALUES (1, 'Legacy groceries', '2025-01-01 00:00:00', '2025-01-01 00:00:00');",
+                     nullptr, nullptr, nullptr);
+        sqlite3_close(raw);
+    }
+    
+    Database db(searchTestDbPath());
+    ASSERT_TRUE(db.initialize());
+    ASSERT_EQ(1, db.searchTodos(1, "groceries", 10, 0).size());
+}
+
+TEST(search_log_engine) {
+    DatabaseOptions options;
+    options.path = searchTestDbPath();
+    options.engine = StorageEngine::Log;
+    Database db(options);
+    ASSERT_TRUE(db.initialize());
+    checkWordsAndPrefixes(db);
+}
@@ -0,0 +1,156 @@
+#include "test_framework.h"
+#include "../include/session_cache.h"
+#include "../include/latency_histogram.h"
+#include "../include/auth_service.h"
+
+TEST(session_cache_hits_and_expiry) {
+    SessionCache cache(64);
+    UserAuth alice{1, "alice", "alice@example.com"};
+    
+    ASSERT_FALSE(cache.find("1:alice:100:42", 100).has_value());
+    cache.insert("1:alice:100:42", alice, 200, 100, cache.generation(alice.user_id));
+    
+    auto found = cache.find("1:alice:100:42", 150);
+    ASSERT_TRUE(found.has_value());
+    ASSERT_EQ(1, found->user_id);
+    ASSERT_STR_EQ("alice@example.com", found->email);
+    ASSERT_TRUE(cache.find("1:alice:100:42", 200).has_value());
+    ASSERT_FALSE(cache.find("1:alice:100:42", 201).has_value());
+    ASSERT_FALSE(cache.find("1:alice:100:43", 150).has_value());
+    
+    SessionCacheStats stats = cache.stats();
+    ASSERT_EQ(1, stats.entries);
+    ASSERT_EQ(2, stats.hits);
+    ASSERT_EQ(3, stats.misses);
+}
+
+TEST(session_cache_invalidates_users_and_evicts) {
+    SessionCache cache(1024);
+    for (int i = 0; i < 20; ++i) {
+        cache.insert("token-" + std::to_string(i), {i % 2, "user", "user@example.com"}, 1000, 0, cache.generation(i % 2));
+    }
+    ASSERT_EQ(20, cache.stats().entries);
+    
+    cache.invalidateUser(1);
+    ASSERT_EQ(10, cache.stats().entries);
+    ASSERT_EQ(10, cache.stats().invalidations);
+    ASSERT_FALSE(cache.find("token-1", 0).has_value());
+    ASSERT_TRUE(cache.find("token-2", 0).has_value());
+    
+    // Far more tokens than fit: the cache stays within its capacity
+    SessionCache small(32);
+    for (int i = 0; i < 1000; ++i) {
+        small.insert("other-" + std::to_string(i), {2, "user", "user@example.com"}, 1000, 0, small.generation(2));
+    }
+    SessionCacheStats stats = small.stats();
+    ASSERT_TRUE(stats.entries <= stats.capacity);
+    ASSERT_TRUE(stats.evictions > 0);
+    
+    // A lookup that started before an invalidation is not cached after it
+    uint64_t before = cache.generation(1);
+    cache.invalidateUser(1);
+    cache.insert("token-stale", {1, "user", "old@example.com"}, 1000, 0, before);
+    ASSERT_FALSE(cache.find("token-stale", 0).has_value());
+    ASSERT_TRUE(cache.generation(0) == cache.generation(2));
+    cache.insert("token-fresh", {1, "user", "new@example.com"}, 1000, 0, cache.generation(1));
+    ASSERT_TRUE(cache.find("token-fresh", 0).has_value());
+    
+    SessionCache disabled(0);
+    disabled.insert("token", {1, "user", "user@example.com"}, 1000, 0, 0);
+    ASSERT_FALSE(disabled.find("token", 0).has_value());
+    ASSERT_EQ(0, disabled.stats().entries);
+}
+
+TEST(session_cache_keeps_hot_sessions_under_churn) {
+    SessionCache cache(128);
+    UserAuth user{1, "user", "user@example.com"};
+    cache.insert("hot", user, 1000, 0, cache.generation(1));
+    for (int i = 0; i < 5000; ++i) {
+        cache.insert("cold-" + std::to_string(i), user, 1000, 0, cache.generation(1));
+        ASSERT_TRUE(cache.find("hot", 0).has_value());
+    }
+    SessionCacheStats stats = cache.stats();
+    ASSERT_TRUE(stats.entries <= stats.capacity);
+    ASSERT_EQ(5001 - stats.entries, stats.evictions);
+    
+    // Invalidated slots are reused before anything else is evicted
+    cache.invalidateUser(1);
+    ASSERT_EQ(0, cache.stats().entries);
+    for (int i = 0; i < 5; ++i) {
+        cache.insert("again-" + std::to_string(i), user, 1000, 0, cache.generation(1));
+    }
+    ASSERT_EQ(5, cache.stats().entries);
+    ASSERT_EQ(stats.evictions, cache.stats().evictions);
+}
+
+TEST(latency_histogram_percentiles) {
+    LatencyHistogram histogram;
+    ASSERT_EQ(0, histogram.percentile(0.5));
+    for (uint64_t i = 1; i <= 1000; ++i) {
+        histogram.record(i * 1000);
+    }
+    ASSERT_EQ(1000, histogram.count());
+    
+    // Within one sub-bucket (1/16) above the exact value
+    uint64_t p50 = histogram.percentile(0.5);
+    uint64_t p99 = histogram.percentile(0.99);
+    ASSERT_TRUE(p50 >= 500000 && p50 <= 500000 + 500000 / 16);
+    ASSERT_TRUE(p99 >= 990000 && p99 <= 990000 + 990000 / 16);
+    ASSERT_EQ(7, [] { LatencyHistogram small; small.record(7); return small.percentile(1.0); }());
+    
+    LatencyHistogram slow;
+    for (int i = 0; i < 1000; ++i) {
+        slow.record(2000000);
+    }
+    slow.merge(histogram);
+    ASSERT_EQ(2000, slow.count());
+    ASSERT_TRUE(slow.percentile(0.25) <= 500000 + 500000 / 16);
+    ASSERT_TRUE(slow.percentile(0.75) >= 2000000);
+}
+
+TEST(auth_validate_token_uses_session_cache) {
+    {
+        DatabaseOptions options;
+        options.path = testPath("test_session_cache.db");
+        auto db = std::make_shared<Database>(options);
+        ASSERT_TRUE(db->initialize());
+        AuthService auth(db);
+        
+        auto user = auth.registerUser("cached", "cached@example.com", "password123");
+        ASSERT_TRUE(user.has_value());
+        std::string token = auth.generateToken({user->id, user->username, user->email});
+        
+        for (int i = 0; i < 3; ++i) {
+            auto validated = auth.validateToken(token);
+            ASSERT_TRUE(validated.has_value());
+            ASSERT_STR_EQ("cached@example.com", validated->email);
+        }
+        AuthStats stats = auth.stats();
+        ASSERT_EQ(3, stats.validations);
+        ASSERT_EQ(2, stats.sessions.hits);
+        ASSERT_EQ(1, stats.sessions.entries);
+        ASSERT_TRUE(stats.p99_ns >= stats.p50_ns);
+        
+        // A tampered token is never cached
+        ASSERT_FALSE(auth.validateToken(token + "0").has_value());
+        ASSERT_EQ(1, auth.stats().sessions.entries);
+        
+        auth.invalidateUser(user->id);
+        ASSERT_EQ(0, auth.stats().sessions.entries);
+        ASSERT_TRUE(auth.validateToken(token).has_value());
+        ASSERT_EQ(1, auth.stats().sessions.entries);
+        
+        // Only a well-signed, unexpired token the cache misses needs the user read
+        bool needs_lookup = true;
+        ASSERT_TRUE(auth.checkToken(token, needs_lookup).has_value());
+        ASSERT_FALSE(needs_lookup);
+        ASSERT_FALSE(auth.checkToken(token + "0", needs_lookup).has_value());
+        ASSERT_FALSE(needs_lookup);
+        auth.invalidateUser(user->id);
+        ASSERT_FALSE(auth.checkToken(token, needs_lookup).has_value());
+        ASSERT_TRUE(needs_lookup);
+        ASSERT_STR_EQ("cached@example.com", auth.loadSession(token)->email);
+        ASSERT_TRUE(auth.checkToken(token, needs_lookup).has_value());
+        ASSERT_FALSE(needs_lookup);
+    }
+}
@@ -0,0 +1,182 @@
+#include "test_framework.h"
+#include "../include/database.h"
+#include <filesystem>
+#include <set>
+#include <thread>
+
+std::string shardTestDbPath() {
+    return testPath("test_sharding.db");
+}
+
+DatabaseOptions shardTestOptions(int shard_count) {
+    DatabaseOptions options;
+    options.path = shardTestDbPath();
+    options.shard_count = shard_count;
+    return options;
+}
+
+int countTodosInFile(const std::string& path, int user_id) {
+    sqlite3* db = nullptr;
+    sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr);
+    sqlite3_stmt* stmt;
+    int count = -1;
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM todos WHERE user_id = ?", -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, user_id);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            count = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(db);
+    return count;
+}
+
+TEST(shard_assignment_is_stable) {
+    ASSERT_EQ(0, Database::shardOf(42, 1));
+    std::set<int> used;
+    for (int user_id = 1; user_id <= 64; ++user_id) {
+        int shard = Database::shardOf(user_id, 4);
+        ASSERT_TRUE(shard >= 0 && shard < 4);
+        ASSERT_EQ(shard, Database::shardOf(user_id, 4));
+        used.insert(shard);
+    }
+    ASSERT_EQ(4, used.size());
+    ASSERT_STR_EQ("todos.shard-3.db", Database::shardPath("todos.db", 3, 4));
+    ASSERT_STR_EQ("todos.db", Database::shardPath("todos.db", 0, 1));
+}
+
+TEST(sharded_todos_live_in_their_users_shard) {
+    Database db(shardTestOptions(4));
+    ASSERT_TRUE(db.initialize());
+    
+    std::set<int> ids;
+    std::vector<int> user_ids;
+    for (int i = 0; i < 12; ++i) {
+        auto user = db.createUser("user" + std::to_string(i), "user" + std::to_string(i) + "@example.com", "hash");
+        ASSERT_TRUE(user.has_value());
+        user_ids.push_back(user->id);
+        for (int j = 0; j < 3; ++j) {
+            auto todo = db.createTodo("Todo " + std::to_string(j), user->id);
+            ASSERT_TRUE(todo.id > 0);
+            ids.insert(todo.id);
+        }
+    }
+    
+    // Ids are unique across shards
+    ASSERT_EQ(36, ids.size());
+    
+    for (int user_id : user_ids) {
+        ASSERT_EQ(3, db.getAllTodos(user_id).size());
+        int home = Database::shardOf(user_id, 4);
+        for (int shard = 0; shard < 4; ++shard) {
+            int expected = shard == home ? 3 : 0;
+            ASSERT_EQ(expected, countTodosInFile(Database::shardPath(shardTestDbPath(), shard, 4), user_id));
+        }
+    }
+    
+    // Users stay in the directory, reachable from any shard
+    ASSERT_TRUE(db.userExists("user5", "other@example.com"));
+    ASSERT_TRUE(db.getUserByUsername("user11").has_value());
+}
+
+TEST(sharded_layout_mismatch_is_rejected) {
+    {
+        Database db(shardTestOptions(4));
+        ASSERT_TRUE(db.initialize());
+    }
+    
+    Database wrong(shardTestOptions(2));
+    ASSERT_FALSE(wrong.initialize());
+}
+
+TEST(sharded_parallel_writes_for_different_users) {
+    Database db(shardTestOptions(4));
+    ASSERT_TRUE(db.initialize());
+    
+    const int thread_count = 8;
+    const int todos_per_thread = 25;
+    std::vector<std::thread> threads;
+    std::vector<int> failures(thread_count, 0);
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t]() {
+            int user_id = 100 + t;
+            for (int i = 0; i < todos_per_thread; ++i) {
+                if (db.createTodo("Parallel " + std::to_string(i), user_id).id <= 0) {
+                    failures[t]++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    for (int t = 0; t < thread_count; ++t) {
+        ASSERT_EQ(0, failures[t]);
+        ASSERT_EQ(todos_per_thread, db.getAllTodos(100 + t).size());
+    }
+}
+
+TEST(reshard_moves_users_between_files) {
+    std::vector<std::pair<int, int>> todos;  // (user_id, todo_id)
+    {
+        Database db(shardTestOptions(1));
+        ASSERT_TRUE(db.initialize());
+        for (int user_id = 1; user_id <= 10; ++user_id) {
+            for (int j = 0; j < 2; ++j) {
+                auto todo = db.createTodo("User " + std::to_string(user_id) + " todo " + std::to_string(j), user_id);
+                todos.push_back({user_id, todo.id});
+            }
+        }
+    }
+    
+    ASSERT_TRUE(Database::reshard(shardTestDbPath(), 4));
+    {
+        Database db(shardTestOptions(4));
+        ASSERT_TRUE(db.initialize());
+        for (const auto& entry : todos) {
+            auto todo = db.getTodoById(entry.second, entry.first);
+            ASSERT_EQ(entry.second, todo.id);
+            ASSERT_EQ(2, countTodosInFile(Database::shardPath(shardTestDbPath(), Database::shardOf(entry.first, 4), 4), entry.first));
+        }
+        
+        // Freshly leased ids never collide with moved ones
+        auto fresh = db.createTodo("Fresh", 3);
+        for (const auto& entry : todos) {
+            ASSERT_TRUE(fresh.id != entry.second);
+        }
+        todos.push_back({3, fresh.id});
+    }
+    
+    ASSERT_TRUE(Database::reshard(shardTestDbPath(), 2));
+    ASSERT_FALSE(std::filesystem::exists(Database::shardPath(shardTestDbPath(), 3, 4)));
+    {
+        Database db(shardTestOptions(2));
+        ASSERT_TRUE(db.initialize());
+        for (const auto& entry : todos) {
+            ASSERT_EQ(entry.second, db.getTodoById(entry.second, entry.first).id);
+        }
+        ASSERT_EQ(3, db.getAllTodos(3).size());
+    }
+}
+
+TEST(reshard_takes_any_path) {
+    DatabaseOptions options;
+    options.path = testPath("o'brien's todos.db");
+    {
+        Database db(options);
+        ASSERT_TRUE(db.initialize());
+        for (int user_id = 1; user_id <= 4; ++user_id) {
+            db.createTodo("Todo of user " + std::to_string(user_id), user_id);
+        }
+    }
+    
+    ASSERT_TRUE(Database::reshard(options.path, 2));
+    options.shard_count = 2;
+    Database db(options);
+    ASSERT_TRUE(db.initialize());
+    for (int user_id = 1; user_id <= 4; ++user_id) {
+        ASSERT_EQ(1, db.getAllTodos(user_id).size());
+        ASSERT_EQ(1, countTodosInFile(Database::shardPath(options.path, Database::shardOf(user_id, 2), 2), user_id));
+    }
+}
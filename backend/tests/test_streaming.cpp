@@ -0,0 +1,75 @@
+#include "test_framework.h"
+#include "../include/database.h"
+#include "../include/compact_todo.h"
+
+std::string streamingTestDbPath() {
+    return testPath("test_streaming.db");
+}
+
+// Batches read one after another, put together, are exactly getAllTodos,
+// and no batch is larger than asked for
+void checkTodoBatches(Database& db) {
+    for (int i = 0; i < 150; ++i) {
+        db.createTodo("Streamed todo " + std::to_string(i), 1, i % 4 == 0 ? "2025-10-01" : "");
+        db.createTodo("Other user's todo", 2);
+    }
+    for (int id = 1; id <= 300; id += 9) {
+        db.deleteTodo(id, id % 2 == 1 ? 1 : 2);
+    }
+    std::vector<Todo> expected = db.getAllTodos(1);
+    
+    size_t batches = 0;
+    std::vector<Todo> streamed;
+    TodoCursor cursor;
+    while (!cursor.done) {
+        CompactTodoList batch(1);
+        ASSERT_TRUE(db.readTodoBatch(1, cursor, 16, batch));
+        ASSERT_TRUE(batch.size() <= 16);
+        batches++;
+        for (const CompactTodo& todo : batch) {
+            streamed.push_back(batch.toTodo(todo));
+        }
+        // A todo written between batches is newer than the cursor
+        if (batches == 2) {
+            db.createTodo("Created mid-stream", 1);
+        }
+    }
+    ASSERT_EQ(expected.size(), streamed.size());
+    ASSERT_EQ(expected.size() / 16 + 1, batches);
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(expected[i].id, streamed[i].id);
+        ASSERT_EQ(1, streamed[i].user_id);
+        ASSERT_STR_EQ(expected[i].text, streamed[i].text);
+        ASSERT_STR_EQ(expected[i].created_at, streamed[i].created_at);
+        ASSERT_STR_EQ(expected[i].due_date, streamed[i].due_date);
+    }
+    
+    // A finished cursor reads nothing more; an unknown user has one empty batch
+    CompactTodoList after(1);
+    ASSERT_TRUE(db.readTodoBatch(1, cursor, 16, after));
+    ASSERT_EQ(0, after.size());
+    TodoCursor unknown;
+    CompactTodoList none(99);
+    ASSERT_TRUE(db.readTodoBatch(99, unknown, 16, none));
+    ASSERT_EQ(0, none.size());
+    ASSERT_TRUE(unknown.done);
+}
+
+TEST(stream_todos_sqlite) {
+    {
+        Database db(streamingTestDbPath());
+        ASSERT_TRUE(db.initialize());
+        checkTodoBatches(db);
+    }
+}
+
+TEST(stream_todos_log_engine) {
+    {
+        DatabaseOptions options;
+        options.path = streamingTestDbPath();
+        options.engine = StorageEngine::Log;
+        Database db(options);
+        ASSERT_TRUE(db.initialize());
+        checkTodoBatches(db);
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "test_framework.h"
+#include "../include/database.h"
+#include <memory>
+#include <stdexcept>
+
+// An initialized database in the running test's scratch directory, to hand
+// to the services the way the server hands them its own
+inline std::shared_ptr<Database> testDatabase(const std::string& name = "todos.db") {
+    auto db = std::make_shared<Database>(testPath(name));
+    if (!db->initialize()) {
+        throw std::runtime_error("Failed to initialize " + testPath(name));
+    }
+    return db;
+}
@@ -0,0 +1,132 @@
+#include "test_framework.h"
+#include "../include/task_scheduler.h"
+#include "../include/json_utils.h"
+#include <chrono>
+#include <stdexcept>
+
+// Sums [begin, end) by splitting it until the ranges are small, awaiting the
+// halves from inside the pool
+long parallelSum(TaskScheduler& scheduler, long begin, long end) {
+    if (end - begin <= 16) {
+        long sum = 0;
+        for (long i = begin; i < end; ++i) sum += i;
+        return sum;
+    }
+    long middle = begin + (end - begin) / 2;
+    auto left = scheduler.submit([&scheduler, begin, middle] { return parallelSum(scheduler, begin, middle); });
+    long right = parallelSum(scheduler, middle, end);
+    return scheduler.await(left) + right;
+}
+
+TEST(task_scheduler_results_and_exceptions) {
+    TaskScheduler scheduler(2);
+    ASSERT_EQ(2, scheduler.workerCount());
+    
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 100; ++i) {
+        futures.push_back(scheduler.submit([i] { return i * i; }));
+    }
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(i * i, scheduler.await(futures[i]));
+    }
+    
+    // A throwing task surfaces its exception to whoever awaits it
+    auto failing = scheduler.submit([]() -> int { throw std::runtime_error("boom"); });
+    bool thrown = false;
+    try {
+        scheduler.await(failing);
+    } catch (const std::runtime_error& e) {
+        thrown = std::string(e.what()) == "boom";
+    }
+    ASSERT_TRUE(thrown);
+    
+    auto stats = scheduler.stats();
+    ASSERT_EQ(101, stats.executed);
+    ASSERT_EQ(101, stats.injected);
+}
+
+TEST(task_scheduler_nested_await) {
+    // A single worker would deadlock on nested waits if await() only blocked
+    for (size_t workers : {1, 4}) {
+        TaskScheduler scheduler(workers);
+        auto root = scheduler.submit([&scheduler] { return parallelSum(scheduler, 0, 10000); });
+        ASSERT_EQ(49995000L, scheduler.await(root));
+    }
+}
+
+TEST(task_scheduler_steals_from_busy_workers) {
+    TaskScheduler scheduler(4);
+    
+    // All subtasks land on the deque of the worker running the root task;
+    // the other workers only get them by stealing
+    auto root = scheduler.submit([&scheduler] {
+        std::vector<std::future<void>> parts;
+        for (int i = 0; i < 32; ++i) {
+            parts.push_back(scheduler.submit([] { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }));
+        }
+        for (auto& part : parts) {
+            scheduler.await(part);
+        }
+    });
+    scheduler.await(root);
+    
+    auto stats = scheduler.stats();
+    ASSERT_EQ(33, stats.executed);
+    ASSERT_EQ(1, stats.injected);
+    ASSERT_TRUE(stats.stolen > 0);
+}
+
+TEST(task_scheduler_runs_inline_when_queue_is_full) {
+    TaskScheduler scheduler(1, 4);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    
+    // Park the only worker so the injection queue fills up
+    std::promise<void> parked;
+    auto blocker = scheduler.submit([&parked, released] {
+        parked.set_value();
+        released.wait();
+    });
+    parked.get_future().wait();
+    
+    std::thread::id caller = std::this_thread::get_id();
+    std::vector<std::future<bool>> futures;
+    for (int i = 0; i < 8; ++i) {
+        futures.push_back(scheduler.submit([caller] { return std::this_thread::get_id() == caller; }));
+    }
+    release.set_value();
+    
+    int inline_runs = 0;
+    for (auto& future : futures) {
+        if (scheduler.await(future)) inline_runs++;
+    }
+    scheduler.await(blocker);
+    ASSERT_EQ(4, inline_runs);
+    ASSERT_EQ(4, scheduler.stats().overflowed);
+}
+
+TEST(parallel_todo_list_json_matches_sequential) {
+    CompactTodoList list(3);
+    for (int id = 1; id <= 1000; ++id) {
+        list.put({id, 3, "Todo \"" + std::to_string(id) + "\"", id % 3 == 0, "2025-08-01 09:30:15.123456",
+                  "2025-08-02 10:00:00.000001", id % 5 == 0 ? "2025-09-01" : ""});
+    }
+    // Erased slots, including a whole chunk of them, must not leave stray commas
+    for (int id = 1; id <= 1000; ++id) {
+        if (id % 7 == 0 || (id > 100 && id <= 200)) list.erase(id);
+    }
+    
+    TaskScheduler scheduler(3);
+    std::pmr::string sequential;
+    appendTodosJson(sequential, list);
+    for (size_t chunk : {1000, 100, 37, 1}) {
+        std::pmr::string parallel;
+        appendTodosJson(parallel, list, scheduler, chunk);
+        ASSERT_STR_EQ(std::string(sequential), std::string(parallel));
+    }
+    
+    CompactTodoList empty(3);
+    std::pmr::string json;
+    appendTodosJson(json, empty, scheduler, 1);
+    ASSERT_STR_EQ("[]", std::string(json));
+}
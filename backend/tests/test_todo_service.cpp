@@ -1,38 +1,20 @@
 #include "test_framework.h"
+#include "test_support.h"
 #include "../include/todo_service.h"
-#include <filesystem>
-
-// Helper function to clean up test database
-void cleanupTodoTestDb() {
-    std::vector<std::string> db_files = {
-        "test_todo.db", "todos.db", "todo_test.db", "test_database.db"
-    };
-    for (const auto& file : db_files) {
-        if (std::filesystem::exists(file)) {
-            std::filesystem::remove(file);
-        }
-    }
-}
 
 TEST(todo_service_initialization) {
-    cleanupTodoTestDb();
-    
     try {
-        TodoService service;
+        TodoService service(testDatabase());
         // If we get here, initialization succeeded
         ASSERT_TRUE(true);
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupTodoTestDb();
 }
 
 TEST(create_todo_success) {
-    cleanupTodoTestDb();
-    
     try {
-        TodoService service;
+        TodoService service(testDatabase());
         
         int user_id = 1;
         auto todo = service.createTodo("Test todo item", user_id);
@@ -47,15 +29,11 @@ TEST(create_todo_success) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupTodoTestDb();
 }
 
 TEST(create_multiple_todos) {
-    cleanupTodoTestDb();
-    
     try {
-        TodoService service;
+        TodoService service(testDatabase());
         
         int user_id = 1;
         auto todo1 = service.createTodo("First todo", user_id);
@@ -70,15 +48,11 @@ TEST(create_multiple_todos) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupTodoTestDb();
 }
 
 TEST(get_all_todos_empty) {
-    cleanupTodoTestDb();
-    
     try {
-        TodoService service;
+        TodoService service(testDatabase());
         
         int user_id = 1;
         auto todos = service.getAllTodos(user_id);
@@ -88,15 +62,11 @@ TEST(get_all_todos_empty) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupTodoTestDb();
 }
 
 TEST(get_all_todos_with_items) {
-    cleanupTodoTestDb();
-    
     try {
-        TodoService service;
+        TodoService service(testDatabase());
         
         int user_id = 1;
         auto todo1 = service.createTodo("First todo", user_id);
@@ -113,15 +83,11 @@ TEST(get_all_todos_with_items) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupTodoTestDb();
 }
 
 TEST(get_todo_by_id_success) {
-    cleanupTodoTestDb();
-    
     try {
-        TodoService service;
+        TodoService service(testDatabase());
         
         int user_id = 1;
         auto created = service.createTodo("Test todo", user_id);
@@ -136,15 +102,11 @@ TEST(get_todo_by_id_success) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupTodoTestDb();
 }
 
 TEST(get_todo_by_id_not_found) {
-    cleanupTodoTestDb();
-    
     try {
-        TodoService service;
+        TodoService service(testDatabase());
         
         int user_id = 1;
         auto retrieved = service.getTodoById(999, user_id);
@@ -154,15 +116,11 @@ TEST(get_todo_by_id_not_found) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupTodoTestDb();
 }
 
 TEST(update_todo_success) {
-    cleanupTodoTestDb();
-    
     try {
-        TodoService service;
+        TodoService service(testDatabase());
         
         int user_id = 1;
         auto created = service.createTodo("Original text", user_id);
@@ -178,15 +136,11 @@ TEST(update_todo_success) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupTodoTestDb();
 }
 
 TEST(update_todo_not_found) {
-    cleanupTodoTestDb();
-    
     try {
-        TodoService service;
+        TodoService service(testDatabase());
         
         int user_id = 1;
         auto updated = service.updateTodo(999, "Updated text", true, user_id);
@@ -196,15 +150,11 @@ TEST(update_todo_not_found) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupTodoTestDb();
 }
 
 TEST(delete_todo_success) {
-    cleanupTodoTestDb();
-    
     try {
-        TodoService service;
+        TodoService service(testDatabase());
         
         int user_id = 1;
         auto created = service.createTodo("Todo to delete", user_id);
@@ -219,15 +169,11 @@ TEST(delete_todo_success) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupTodoTestDb();
 }
 
 TEST(delete_todo_not_found) {
-    cleanupTodoTestDb();
-    
     try {
-        TodoService service;
+        TodoService service(testDatabase());
         
         int user_id = 1;
         bool deleted = service.deleteTodo(999, user_id);
@@ -236,15 +182,11 @@ TEST(delete_todo_not_found) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupTodoTestDb();
 }
 
 TEST(user_isolation_in_todos) {
-    cleanupTodoTestDb();
-    
     try {
-        TodoService service;
+        TodoService service(testDatabase());
         
         int user1_id = 1;
         int user2_id = 2;
@@ -280,15 +222,11 @@ TEST(user_isolation_in_todos) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupTodoTestDb();
 }
 
 TEST(todo_completion_toggle) {
-    cleanupTodoTestDb();
-    
     try {
-        TodoService service;
+        TodoService service(testDatabase());
         
         int user_id = 1;
         auto created = service.createTodo("Todo to toggle", user_id);
@@ -305,6 +243,61 @@ TEST(todo_completion_toggle) {
     } catch (const std::exception& e) {
         ASSERT_TRUE(false); // Should not throw
     }
-    
-    cleanupTodoTestDb();
+}
+
+TEST(todo_service_versions_track_writes) {
+    try {
+        TodoService service(testDatabase());
+        
+        int user_id = 1;
+        ASSERT_EQ(0, service.getVersion(user_id));
+        std::string initial_etag = service.getEtag(user_id);
+        
+        auto todo = service.createTodo("Versioned todo", user_id);
+        ASSERT_EQ(1, service.getVersion(user_id));
+        service.updateTodo(todo.id, "Versioned todo", true, user_id);
+        ASSERT_EQ(2, service.getVersion(user_id));
+        ASSERT_TRUE(service.deleteTodo(todo.id, user_id));
+        ASSERT_EQ(3, service.getVersion(user_id));
+        ASSERT_TRUE(service.getEtag(user_id) != initial_etag);
+        
+        // Failed writes and other users' writes leave the version alone
+        service.updateTodo(todo.id, "Gone", false, user_id);
+        ASSERT_FALSE(service.deleteTodo(todo.id, user_id));
+        service.createTodo("Someone else's todo", 2);
+        ASSERT_EQ(3, service.getVersion(user_id));
+        ASSERT_EQ(1, service.getVersion(2));
+        
+    } catch (const std::exception& e) {
+        ASSERT_TRUE(false); // Should not throw
+    }
+}
+
+TEST(todo_service_notifies_change_listener) {
+    try {
+        TodoService service(testDatabase());
+        std::vector<TodoChange> changes;
+        service.setChangeListener([&changes](const TodoChange& change) {
+            changes.push_back(change);
+        });
+        
+        int user_id = 1;
+        auto todo = service.createTodo("Streamed todo", user_id);
+        service.updateTodo(todo.id, "Streamed todo", true, user_id);
+        service.deleteTodo(todo.id, user_id);
+        ASSERT_FALSE(service.deleteTodo(todo.id, user_id));
+        
+        ASSERT_EQ(3, changes.size());
+        ASSERT_TRUE(changes[0].type == TodoChange::Type::Created);
+        ASSERT_STR_EQ("Streamed todo", changes[0].todo.text);
+        ASSERT_TRUE(changes[1].type == TodoChange::Type::Updated);
+        ASSERT_TRUE(changes[1].todo.completed);
+        ASSERT_TRUE(changes[2].type == TodoChange::Type::Deleted);
+        ASSERT_EQ(todo.id, changes[2].todo.id);
+        ASSERT_EQ(3, changes[2].version);
+        ASSERT_EQ(user_id, changes[2].user_id);
+        
+    } catch (const std::exception& e) {
+        ASSERT_TRUE(false); // Should not throw
+    }
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "test_framework.h"
+#include "../include/token_codec.h"
+#include "../include/auth_service.h"
+
+TEST(token_codec_round_trip) {
+    TokenCodec codec("test secret");
+    std::string token = codec.encode({42, 1750000000});
+    ASSERT_EQ(TokenCodec::kEncodedLength, token.size());
+    for (char c : token) {
+        ASSERT_TRUE(std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_');
+    }
+    
+    TokenClaims claims{0, 0};
+    ASSERT_TRUE(codec.decode(token, claims));
+    ASSERT_EQ(42, claims.user_id);
+    ASSERT_EQ(1750000000, claims.issued_at);
+    
+    // Extremes of both fields survive
+    ASSERT_TRUE(codec.decode(codec.encode({2147483647, 0}), claims));
+    ASSERT_EQ(2147483647, claims.user_id);
+    ASSERT_EQ(0, claims.issued_at);
+}
+
+TEST(token_codec_rejects_forgeries) {
+    TokenCodec codec("test secret");
+    std::string token = codec.encode({7, 1750000000});
+    TokenClaims claims{0, 0};
+    
+    // Any changed character fails the MAC, the version or the padding check
+    for (size_t i = 0; i < token.size(); ++i) {
+        std::string tampered = token;
+        tampered[i] = tampered[i] == 'A' ? 'B' : 'A';
+        ASSERT_FALSE(codec.decode(tampered, claims));
+    }
+    ASSERT_FALSE(TokenCodec("other secret").decode(token, claims));
+    ASSERT_FALSE(codec.decode(token.substr(1), claims));
+    ASSERT_FALSE(codec.decode(token + "A", claims));
+    ASSERT_FALSE(codec.decode(std::string(TokenCodec::kEncodedLength, '='), claims));
+    ASSERT_FALSE(codec.decode("", claims));
+    ASSERT_FALSE(codec.decode("1:testuser:1000000000:1234567890", claims));
+}
+
+TEST(auth_tokens_use_binary_format) {
+    {
+        DatabaseOptions db_options;
+        db_options.path = testPath("test_token_codec.db");
+        auto db = std::make_shared<Database>(db_options);
+        ASSERT_TRUE(db->initialize());
+        AuthOptions options;
+        options.token_secret = "shared secret";
+        options.password_hash.log2_n = 10;
+        AuthService auth(db, options);
+        
+        // Colons in a username used to break the token format
+        auto user = auth.registerUser("a:b:c", "colons@example.com", "password");
+        ASSERT_TRUE(user.has_value());
+        std::string token = auth.generateToken({user->id, user->username, user->email});
+        auto validated = auth.validateToken(token);
+        ASSERT_TRUE(validated.has_value());
+        ASSERT_STR_EQ("a:b:c", validated->username);
+        
+        // Another instance with the same secret accepts it
+        AuthService other(db, options);
+        ASSERT_TRUE(other.validateToken(token).has_value());
+        AuthOptions different = options;
+        different.token_secret = "different secret";
+        ASSERT_FALSE(AuthService(db, different).validateToken(token).has_value());
+        
+        // Signed correctly but older than a day
+        TokenCodec codec("shared secret");
+        int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        ASSERT_TRUE(auth.validateToken(codec.encode({user->id, now - 3600})).has_value());
+        ASSERT_FALSE(auth.validateToken(codec.encode({user->id, now - 2 * 86400})).has_value());
+        ASSERT_FALSE(auth.validateToken(codec.encode({user->id + 1, now})).has_value());
+    }
+}
@@ -0,0 +1,736 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "latency_histogram.h"
+
+// HTTP load generator for todo_backend: many keep-alive connections, each
+// logged in as one of a set of users, send a weighted mix of API calls.
+//
+// By default the load is open loop: requests are due on a fixed schedule
+// (--rate per second, spread over the connections) whether or not earlier
+// ones have been answered, and latency counts from when a request was due,
+// not from when it was sent. A server that stalls therefore shows the
+// stall in every request that should have gone out meanwhile, instead of
+// the generator quietly sending less (coordinated omission). --rate 0 runs
+// closed loop, each connection sending as soon as its last answer arrives.
+//
+//   todo_loadgen [--rate 500] [--connections 16] [--duration 10] ...
+//   todo_loadgen --spawn ./todo_backend ...   starts and stops the server
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum Op { Register, Login, List, Create, Update, Delete, kOps };
+const char* kOpNames[kOps] = {"register", "login", "list", "create", "update", "delete"};
+
+struct LoadOptions {
+    std::string host = "127.0.0.1";
+    std::string port = "8080";
+    size_t connections = 16;
+    // Requests per second over all connections; 0 runs closed loop
+    double rate = 500;
+    double duration_seconds = 10;
+    // Run before measuring, so connections, caches and the server's pools are warm
+    double warmup_seconds = 2;
+    // Users the connections are spread over; 0 means one per connection
+    size_t users = 0;
+    // Todos each connection creates before the run, for updates and deletes to work on
+    size_t seed_todos = 5;
+    std::array<unsigned, kOps> mix{1, 4, 50, 20, 15, 10};
+    uint64_t seed = 1;
+    // A todo_backend binary to start for the run and stop after it
+    std::string spawn;
+};
+
+// One keep-alive HTTP/1.1 connection, used by one thread
+class HttpConnection {
+public:
+    ~HttpConnection() { disconnect(); }
+    
+    bool connect(const std::string& host, const std::string& port) {
+        disconnect();
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addresses = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+            return false;
+        }
+        for (addrinfo* address = addresses; address && fd_ < 0; address = address->ai_next) {
+            int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (fd < 0) {
+                continue;
+            }
+            if (::connect(fd, address->ai_addr, address->ai_addrlen) == 0) {
+                fd_ = fd;
+            } else {
+                close(fd);
+            }
+        }
+        freeaddrinfo(addresses);
+        if (fd_ < 0) {
+            return false;
+        }
+        int one = 1;
+        setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        timeval timeout{10, 0};
+        setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd_, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        return true;
+    }
+    
+    void disconnect() {
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+        inbound_.clear();
+    }
+    
+    bool connected() const { return fd_ >= 0; }
+    
+    // Sends `request` and reads the whole response. False when the
+    // connection failed; the caller reconnects.
+    bool roundTrip(const std::string& request, int& status, std::string& body) {
+        const char* data = request.data();
+        size_t left = request.size();
+        while (left > 0) {
+            ssize_t sent = send(fd_, data, left, MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            if (sent <= 0) {
+                return false;
+            }
+            data += sent;
+            left -= static_cast<size_t>(sent);
+        }
+        return readResponse(status, body);
+    }
+
+private:
+    int fd_ = -1;
+    // Received bytes not consumed yet
+    std::string inbound_;
+    
+    bool fill() {
+        char chunk[16384];
+        while (true) {
+            ssize_t received = recv(fd_, chunk, sizeof(chunk), 0);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received <= 0) {
+                return false;
+            }
+            inbound_.append(chunk, static_cast<size_t>(received));
+            return true;
+        }
+    }
+    
+    // Takes `size` bytes off the front of the inbound data into `out`
+    bool take(size_t size, std::string* out) {
+        while (inbound_.size() < size) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        if (out) {
+            out->append(inbound_, 0, size);
+        }
+        inbound_.erase(0, size);
+        return true;
+    }
+    
+    bool takeLine(std::string& line) {
+        size_t end;
+        while ((end = inbound_.find("\r\n")) == std::string::npos) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        line.assign(inbound_, 0, end);
+        inbound_.erase(0, end + 2);
+        return true;
+    }
+    
+    static std::string lowercase(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+        return text;
+    }
+    
+    bool readResponse(int& status, std::string& body) {
+        body.clear();
+        std::string line;
+        if (!takeLine(line) || line.size() < 12 || line.compare(0, 5, "HTTP/") != 0) {
+            return false;
+        }
+        status = std::atoi(line.c_str() + 9);
+        long content_length = -1;
+        bool chunked = false;
+        bool close_after = false;
+        while (takeLine(line) && !line.empty()) {
+            std::string header = lowercase(line);
+            if (header.rfind("content-length:", 0) == 0) {
+                content_length = std::atol(header.c_str() + 15);
+            } else if (header.rfind("transfer-encoding:", 0) == 0 && header.find("chunked") != std::string::npos) {
+                chunked = true;
+            } else if (header.rfind("connection:", 0) == 0 && header.find("close") != std::string::npos) {
+                close_after = true;
+            }
+        }
+        if (!line.empty()) {
+            return false;
+        }
+        
+        bool complete = true;
+        if (chunked) {
+            while (true) {
+                if (!takeLine(line)) {
+                    return false;
+                }
+                size_t size = std::strtoul(line.c_str(), nullptr, 16);
+                if (size == 0) {
+                    // Trailers, then the blank line
+                    while (takeLine(line) && !line.empty()) {
+                    }
+                    break;
+                }
+                if (!take(size, &body) || !take(2, nullptr)) {
+                    return false;
+                }
+            }
+        } else if (content_length >= 0) {
+            complete = take(static_cast<size_t>(content_length), &body);
+        } else if (status != 204 && status != 304) {
+            // Delimited by the end of the connection
+            while (fill()) {
+            }
+            body = inbound_;
+            close_after = true;
+        }
+        if (close_after) {
+            disconnect();
+        }
+        return complete;
+    }
+};
+
+std::string jsonString(const std::string& body, const std::string& field) {
+    std::string key = "\"" + field + "\":\"";
+    size_t at = body.find(key);
+    if (at == std::string::npos) {
+        return "";
+    }
+    at += key.size();
+    return body.substr(at, body.find('"', at) - at);
+}
+
+int jsonInt(const std::string& body, const std::string& field) {
+    std::string key = "\"" + field + "\":";
+    size_t at = body.find(key);
+    return at == std::string::npos ? -1 : std::atoi(body.c_str() + at + key.size());
+}
+
+std::string buildRequest(const LoadOptions& options, const char* method, const std::string& path,
+                         const std::string& token, const std::string& body) {
+    std::string request = std::string(method) + " " + path + " HTTP/1.1\r\nHost: " + options.host + "\r\n";
+    if (!token.empty()) {
+        request += "Authorization: Bearer " + token + "\r\n";
+    }
+    if (!body.empty() || std::strcmp(method, "POST") == 0 || std::strcmp(method, "PUT") == 0) {
+        request += "Content-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    return request + "\r\n" + body;
+}
+
+struct OpStats {
+    LatencyHistogram latency;
+    std::mutex mutex;
+    // By status code; 0 counts requests whose connection failed
+    std::map<int, uint64_t> statuses;
+};
+
+struct Results {
+    std::array<OpStats, kOps> ops;
+    std::atomic<uint64_t> late{0};
+    std::atomic<uint64_t> max_lag_ns{0};
+};
+
+bool succeeded(int status) {
+    return (status >= 200 && status < 300) || status == 304;
+}
+
+// What one connection does: its user, the todos it created and its share
+// of the schedule
+class Client {
+public:
+    Client(const LoadOptions& options, size_t index, std::string username, std::string token)
+        : options_(options), index_(index), username_(std::move(username)), token_(std::move(token)),
+          random_((options.seed + 1) * 0x9e3779b97f4a7c15ULL + index * 0xbf58476d1ce4e5b9ULL) {}
+    
+    bool seed() {
+        for (size_t i = 0; i < options_.seed_todos; ++i) {
+            if (!succeeded(perform(Create))) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // Runs this connection's share of the load from `start` until `end`;
+    // requests due before `measure_from` are not recorded
+    void run(Clock::time_point start, Clock::time_point measure_from, Clock::time_point end, Results& results) {
+        bool open_loop = options_.rate > 0;
+        auto interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(open_loop ? options_.connections / options_.rate : 0));
+        auto offset = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(open_loop ? index_ / options_.rate : 0));
+        for (uint64_t k = 0;; ++k) {
+            Clock::time_point due = open_loop ? start + offset + interval * static_cast<long>(k) : Clock::now();
+            if (due >= end) {
+                break;
+            }
+            if (open_loop) {
+                auto now = Clock::now();
+                if (now < due) {
+                    std::this_thread::sleep_until(due);
+                } else {
+                    uint64_t lag = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - due).count());
+                    if (due >= measure_from && lag > 1000000) {
+                        results.late.fetch_add(1, std::memory_order_relaxed);
+                        uint64_t seen = results.max_lag_ns.load(std::memory_order_relaxed);
+                        while (lag > seen && !results.max_lag_ns.compare_exchange_weak(seen, lag)) {
+                        }
+                    }
+                }
+            }
+            
+            Op op = pick();
+            int status = perform(op, &op);
+            if (due < measure_from) {
+                continue;
+            }
+            OpStats& stats = results.ops[op];
+            stats.latency.record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - due).count()));
+            std::lock_guard<std::mutex> lock(stats.mutex);
+            ++stats.statuses[status];
+        }
+    }
+
+private:
+    const LoadOptions& options_;
+    size_t index_;
+    std::string username_;
+    std::string token_;
+    uint64_t random_;
+    HttpConnection connection_;
+    std::vector<int> todo_ids_;
+    uint64_t counter_ = 0;
+    
+    uint64_t next() {
+        random_ ^= random_ << 13;
+        random_ ^= random_ >> 7;
+        random_ ^= random_ << 17;
+        return random_;
+    }
+    
+    Op pick() {
+        unsigned total = 0;
+        for (unsigned weight : options_.mix) {
+            total += weight;
+        }
+        unsigned roll = static_cast<unsigned>(next() % total);
+        for (int op = 0; op < kOps; ++op) {
+            if (roll < options_.mix[op]) {
+                return static_cast<Op>(op);
+            }
+            roll -= options_.mix[op];
+        }
+        return List;
+    }
+    
+    // Sends one request of kind `op` and returns its status, 0 when the
+    // connection failed. An update or delete with no todo to work on
+    // creates one instead, and says so through `performed`.
+    int perform(Op op, Op* performed = nullptr) {
+        if ((op == Update || op == Delete) && todo_ids_.empty()) {
+            op = Create;
+        }
+        if (performed) {
+            *performed = op;
+        }
+        ++counter_;
+        std::string request;
+        switch (op) {
+        case Register: {
+            std::string name = username_ + "_r" + std::to_string(counter_);
+            request = buildRequest(options_, "POST", "/api/auth/register", "",
+                                   "{\"username\":\"" + name + "\",\"email\":\"" + name +
+                                   "@loadgen.test\",\"password\":\"loadgen-password\"}");
+            break;
+        }
+        case Login:
+            request = buildRequest(options_, "POST", "/api/auth/login", "",
+                                   "{\"username\":\"" + username_ + "\",\"password\":\"loadgen-password\"}");
+            break;
+        case List:
+            request = buildRequest(options_, "GET", "/api/todos", token_, "");
+            break;
+        case Create:
+            request = buildRequest(options_, "POST", "/api/todos", token_,
+                                   "{\"text\":\"Load test todo " + std::to_string(counter_) + "\"}");
+            break;
+        case Update: {
+            int id = todo_ids_[next() % todo_ids_.size()];
+            request = buildRequest(options_, "PUT", "/api/todos/" + std::to_string(id), token_,
+                                   "{\"text\":\"Updated todo " + std::to_string(counter_) + "\",\"completed\":" +
+                                   (counter_ % 2 == 0 ? "true" : "false") + "}");
+            break;
+        }
+        case Delete:
+            request = buildRequest(options_, "DELETE", "/api/todos/" + std::to_string(todo_ids_.back()), token_, "");
+            todo_ids_.pop_back();
+            break;
+        default:
+            return 0;
+        }
+        
+        if (!connection_.connected() && !connection_.connect(options_.host, options_.port)) {
+            return 0;
+        }
+        int status = 0;
+        std::string body;
+        if (!connection_.roundTrip(request, status, body)) {
+            connection_.disconnect();
+            return 0;
+        }
+        if (op == Create && status == 201) {
+            int id = jsonInt(body, "id");
+            if (id > 0) {
+                todo_ids_.push_back(id);
+            }
+        } else if (op == Login && status == 200) {
+            std::string token = jsonString(body, "token");
+            if (!token.empty()) {
+                token_ = token;
+            }
+        }
+        return status;
+    }
+};
+
+bool parseMix(const std::string& text, std::array<unsigned, kOps>& mix) {
+    std::array<unsigned, kOps> parsed{};
+    std::stringstream entries(text);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        size_t equals = entry.find('=');
+        if (equals == std::string::npos) {
+            return false;
+        }
+        std::string name = entry.substr(0, equals);
+        auto op = std::find_if(std::begin(kOpNames), std::end(kOpNames), [&](const char* op) { return name == op; });
+        if (op == std::end(kOpNames)) {
+            return false;
+        }
+        parsed[op - std::begin(kOpNames)] = static_cast<unsigned>(std::atoi(entry.c_str() + equals + 1));
+    }
+    unsigned total = 0;
+    for (unsigned weight : parsed) {
+        total += weight;
+    }
+    if (total == 0) {
+        return false;
+    }
+    mix = parsed;
+    return true;
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --host HOST          server host (default 127.0.0.1)\n"
+              << "  --port PORT          server port (default 8080)\n"
+              << "  --connections N      keep-alive connections, one thread each (default 16)\n"
+              << "  --rate RPS           requests per second over all connections; 0 = closed loop (default 500)\n"
+              << "  --duration SECONDS   measured time (default 10)\n"
+              << "  --warmup SECONDS     unmeasured time before it (default 2)\n"
+              << "  --users N            users the connections log in as (default: one per connection)\n"
+              << "  --mix OP=W,...       weights of register, login, list, create, update, delete\n"
+              << "                       (default register=1,login=4,list=50,create=20,update=15,delete=10)\n"
+              << "  --seed N             seed of the request mix (default 1)\n"
+              << "  --spawn PATH         start this todo_backend for the run and stop it afterwards\n";
+}
+
+bool parseArgs(int argc, char* argv[], LoadOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--host") {
+            options.host = value;
+        } else if (arg == "--port") {
+            options.port = value;
+        } else if (arg == "--connections") {
+            options.connections = static_cast<size_t>(std::max(std::atoi(value.c_str()), 1));
+        } else if (arg == "--rate") {
+            options.rate = std::max(std::atof(value.c_str()), 0.0);
+        } else if (arg == "--duration") {
+            options.duration_seconds = std::max(std::atof(value.c_str()), 0.1);
+        } else if (arg == "--warmup") {
+            options.warmup_seconds = std::max(std::atof(value.c_str()), 0.0);
+        } else if (arg == "--users") {
+            options.users = static_cast<size_t>(std::max(std::atoi(value.c_str()), 0));
+        } else if (arg == "--mix") {
+            if (!parseMix(value, options.mix)) {
+                std::cerr << "Invalid mix: " << value << std::endl;
+                return false;
+            }
+        } else if (arg == "--seed") {
+            options.seed = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--spawn") {
+            options.spawn = value;
+        } else {
+            return false;
+        }
+    }
+    if (options.users == 0 || options.users > options.connections) {
+        options.users = options.connections;
+    }
+    return true;
+}
+
+// Starts the server with its output discarded and waits until it accepts
+// connections; returns its pid, or -1
+pid_t spawnServer(const LoadOptions& options) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        if (null >= 0) {
+            dup2(null, STDOUT_FILENO);
+        }
+        execl(options.spawn.c_str(), options.spawn.c_str(), static_cast<char*>(nullptr));
+        std::cerr << "Failed to start " << options.spawn << ": " << std::strerror(errno) << std::endl;
+        _exit(127);
+    }
+    if (pid < 0) {
+        return -1;
+    }
+    auto deadline = Clock::now() + std::chrono::seconds(10);
+    while (Clock::now() < deadline) {
+        HttpConnection probe;
+        if (probe.connect(options.host, options.port)) {
+            return pid;
+        }
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            return -1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+    return -1;
+}
+
+std::string formatMillis(uint64_t nanos) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3) << nanos / 1e6;
+    return out.str();
+}
+
+void printReport(const LoadOptions& options, Results& results, double seconds) {
+    std::cout << "\n" << std::left << std::setw(10) << "op" << std::right << std::setw(10) << "requests"
+              << std::setw(8) << "errors" << std::setw(10) << "req/s" << std::setw(10) << "p50 ms" << std::setw(10)
+              << "p90 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "p99.9 ms" << std::setw(10) << "max ms"
+              << "\n";
+    LatencyHistogram all;
+    uint64_t total = 0;
+    uint64_t total_errors = 0;
+    std::map<int, uint64_t> statuses;
+    for (int op = 0; op < kOps; ++op) {
+        OpStats& stats = results.ops[op];
+        uint64_t requests = stats.latency.count();
+        if (requests == 0) {
+            continue;
+        }
+        uint64_t errors = 0;
+        for (const auto& [status, count] : stats.statuses) {
+            statuses[status] += count;
+            if (!succeeded(status)) {
+                errors += count;
+            }
+        }
+        total += requests;
+        total_errors += errors;
+        all.merge(stats.latency);
+        std::cout << std::left << std::setw(10) << kOpNames[op] << std::right << std::setw(10) << requests
+                  << std::setw(8) << errors << std::setw(10) << std::fixed << std::setprecision(1)
+                  << requests / seconds << std::setw(10) << formatMillis(stats.latency.percentile(0.5))
+                  << std::setw(10) << formatMillis(stats.latency.percentile(0.9)) << std::setw(10)
+                  << formatMillis(stats.latency.percentile(0.99)) << std::setw(10)
+                  << formatMillis(stats.latency.percentile(0.999)) << std::setw(10)
+                  << formatMillis(stats.latency.percentile(1.0)) << "\n";
+    }
+    std::cout << std::left << std::setw(10) << "all" << std::right << std::setw(10) << total << std::setw(8)
+              << total_errors << std::setw(10) << std::fixed << std::setprecision(1) << total / seconds
+              << std::setw(10) << formatMillis(all.percentile(0.5)) << std::setw(10)
+              << formatMillis(all.percentile(0.9)) << std::setw(10) << formatMillis(all.percentile(0.99))
+              << std::setw(10) << formatMillis(all.percentile(0.999)) << std::setw(10)
+              << formatMillis(all.percentile(1.0)) << "\n\nstatus:";
+    for (const auto& [status, count] : statuses) {
+        std::cout << "  " << (status == 0 ? std::string("failed") : std::to_string(status)) << " x " << count;
+    }
+    std::cout << "\n";
+    if (options.rate > 0) {
+        std::cout << "target " << options.rate << " req/s, achieved " << std::setprecision(1) << total / seconds
+                  << " req/s; latency counts from when each request was due\n";
+        uint64_t late = results.late.load();
+        if (late > 0) {
+            std::cout << late << " request(s) went out more than 1 ms after they were due (max "
+                      << formatMillis(results.max_lag_ns.load()) << " ms): every connection was still waiting for "
+                      << "an earlier response; add connections if this is most requests\n";
+        }
+    }
+    std::cout << "percentiles are bucket upper bounds, within 1/16 of the recorded latency\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    if (!parseArgs(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    
+    pid_t server = -1;
+    if (!options.spawn.empty()) {
+        server = spawnServer(options);
+        if (server < 0) {
+            std::cerr << "Server " << options.spawn << " did not start listening on port " << options.port << std::endl;
+            return 1;
+        }
+    }
+    auto stopServer = [&] {
+        if (server > 0) {
+            kill(server, SIGTERM);
+            waitpid(server, nullptr, 0);
+        }
+    };
+    
+    // Users are registered one after another before the clock starts;
+    // names carry the start time so reruns against one database do not clash
+    std::string run = std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    std::vector<std::pair<std::string, std::string>> users;
+    HttpConnection setup;
+    for (size_t i = 0; i < options.users; ++i) {
+        std::string name = "lg" + run + "_" + std::to_string(i);
+        int status = 0;
+        std::string body;
+        std::string request = buildRequest(options, "POST", "/api/auth/register", "",
+                                           "{\"username\":\"" + name + "\",\"email\":\"" + name +
+                                           "@loadgen.test\",\"password\":\"loadgen-password\"}");
+        bool sent = (setup.connected() || setup.connect(options.host, options.port)) &&
+                    setup.roundTrip(request, status, body);
+        std::string token = jsonString(body, "token");
+        if (!sent || status != 201 || token.empty()) {
+            std::cerr << "Registering load test user " << name << " failed (status " << status << ")" << std::endl;
+            stopServer();
+            return 1;
+        }
+        users.emplace_back(name, token);
+    }
+    setup.disconnect();
+    
+    std::vector<std::unique_ptr<Client>> clients;
+    for (size_t c = 0; c < options.connections; ++c) {
+        const auto& user = users[c % users.size()];
+        clients.push_back(std::make_unique<Client>(options, c, user.first, user.second));
+    }
+    
+    std::cout << "Load: " << options.connections << " connections, " << options.users << " users, "
+              << (options.rate > 0 ? std::to_string(static_cast<long>(options.rate)) + " req/s open loop"
+                                   : std::string("closed loop"))
+              << ", " << options.warmup_seconds << " s warmup + " << options.duration_seconds << " s, mix";
+    for (int op = 0; op < kOps; ++op) {
+        std::cout << " " << kOpNames[op] << "=" << options.mix[op];
+    }
+    std::cout << std::endl;
+    
+    Results results;
+    std::atomic<size_t> seeded{0};
+    std::atomic<bool> seed_failed{false};
+    std::mutex start_mutex;
+    std::condition_variable start_cv;
+    bool started = false;
+    Clock::time_point start, measure_from, end;
+    std::vector<std::thread> threads;
+    for (auto& client : clients) {
+        threads.emplace_back([&, client = client.get()] {
+            if (!client->seed()) {
+                seed_failed = true;
+            }
+            seeded.fetch_add(1);
+            start_cv.notify_all();
+            std::unique_lock<std::mutex> lock(start_mutex);
+            start_cv.wait(lock, [&] { return started; });
+            lock.unlock();
+            if (!seed_failed) {
+                client->run(start, measure_from, end, results);
+            }
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(start_mutex);
+        start_cv.wait(lock, [&] { return seeded.load() == clients.size(); });
+        start = Clock::now();
+        measure_from = start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(options.warmup_seconds));
+        end = measure_from + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(options.duration_seconds));
+        started = true;
+    }
+    start_cv.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // Requests due before the end that were answered after it still count
+    double seconds = std::chrono::duration<double>(std::max(Clock::now(), end) - measure_from).count();
+    stopServer();
+    
+    if (seed_failed) {
+        std::cerr << "Creating the todos the run starts with failed" << std::endl;
+        return 1;
+    }
+    printReport(options, results, seconds);
+    return 0;
+}
@@ -0,0 +1,30 @@
+#include <iostream>
+#include <string>
+#include "database.h"
+
+// Offline resharding: stop todo_backend, then run
+//   todo_reshard <db_path> <new_shard_count>
+// and restart the backend with the new shard count.
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <db_path> <new_shard_count>" << std::endl;
+        return 2;
+    }
+    
+    std::string db_path = argv[1];
+    int shard_count = 0;
+    try {
+        shard_count = std::stoi(argv[2]);
+    } catch (const std::exception&) {
+        std::cerr << "Invalid shard count: " << argv[2] << std::endl;
+        return 2;
+    }
+    
+    if (!Database::reshard(db_path, shard_count)) {
+        std::cerr << "Resharding failed; rerunning is safe once the cause is fixed" << std::endl;
+        return 1;
+    }
+    
+    std::cout << "Database " << db_path << " now uses " << shard_count << " shard(s)" << std::endl;
+    return 0;
+}
@@ -11,8 +11,25 @@ const getAuthHeaders = () => {
   };
 };
 
+export type TodoChangeEvent =
+  | { type: 'ready'; version: number }
+  | { type: 'created' | 'updated'; todo: Todo }
+  | { type: 'deleted'; id: number };
+
+// A list and the change version it reflects, taken from its ETag
+// ("<epoch>-<version>"); null when the ETag is missing
+export interface TodoListSnapshot {
+  todos: Todo[];
+  version: number | null;
+}
+
+const versionFromEtag = (etag: string | null): number | null => {
+  const match = etag ? /-(\d+)"?$/.exec(etag) : null;
+  return match ? Number(match[1]) : null;
+};
+
 export class TodoAPI {
-  static async getAllTodos(): Promise<Todo[]> {
+  static async getAllTodos(): Promise<TodoListSnapshot> {
     const response = await fetch(`${API_BASE_URL}/api/todos`, {
       headers: getAuthHeaders(),
     });
@@ -23,7 +40,7 @@ export class TodoAPI {
       }
       throw new Error('Failed to fetch todos');
     }
-    return response.json();
+    return { todos: await response.json(), version: versionFromEtag(response.headers.get('ETag')) };
   }
 
   static async createTodo(text: string, dueDate?: string): Promise<Todo> {
@@ -76,4 +93,27 @@ export class TodoAPI {
       throw new Error('Failed to delete todo');
     }
   }
-}
\ No newline at end of file
+
+  // Live changes from other tabs and devices. EventSource reconnects on its
+  // own and every (re)connect starts with a 'ready' event.
+  static subscribeToChanges(onChange: (event: TodoChangeEvent) => void): () => void {
+    const token = localStorage.getItem('auth_token');
+    if (!token) {
+      return () => {};
+    }
+    const source = new EventSource(`${API_BASE_URL}/api/todos/stream?token=${encodeURIComponent(token)}`);
+    source.addEventListener('ready', (e) => {
+      onChange({ type: 'ready', version: JSON.parse((e as MessageEvent).data).version });
+    });
+    source.addEventListener('created', (e) => {
+      onChange({ type: 'created', todo: JSON.parse((e as MessageEvent).data) });
+    });
+    source.addEventListener('updated', (e) => {
+      onChange({ type: 'updated', todo: JSON.parse((e as MessageEvent).data) });
+    });
+    source.addEventListener('deleted', (e) => {
+      onChange({ type: 'deleted', id: JSON.parse((e as MessageEvent).data).id });
+    });
+    return () => source.close();
+  }
+}
@@ -1,4 +1,4 @@
-import React, { useState, useEffect } from 'react';
+import React, { useState, useEffect, useRef } from 'react';
 import { Todo } from '../types';
 import { TodoAPI } from '../api';
 import TodoItem from './TodoItem';
@@ -9,16 +9,44 @@ const TodoList: React.FC = () => {
   const [newTodoDueDate, setNewTodoDueDate] = useState('');
   const [loading, setLoading] = useState(true);
   const [error, setError] = useState<string | null>(null);
+  // Version of the last list loaded, compared with every 'ready' event
+  const loadedVersion = useRef<number | null>(null);
+  // Only the latest load may set the list
+  const loadSequence = useRef(0);
 
   useEffect(() => {
     loadTodos();
   }, []);
 
+  useEffect(() => {
+    return TodoAPI.subscribeToChanges((event) => {
+      switch (event.type) {
+        case 'ready':
+          // Events are not replayed: changes made before this (re)connect
+          // but after the list was loaded only show in the version
+          if (loadedVersion.current !== event.version) loadTodos();
+          break;
+        case 'created':
+          setTodos(current => current.some(todo => todo.id === event.todo.id) ? current : [event.todo, ...current]);
+          break;
+        case 'updated':
+          setTodos(current => current.map(todo => todo.id === event.todo.id ? event.todo : todo));
+          break;
+        case 'deleted':
+          setTodos(current => current.filter(todo => todo.id !== event.id));
+          break;
+      }
+    });
+  }, []);
+
   const loadTodos = async () => {
     try {
       setLoading(true);
-      const fetchedTodos = await TodoAPI.getAllTodos();
-      setTodos(fetchedTodos);
+      const sequence = ++loadSequence.current;
+      const snapshot = await TodoAPI.getAllTodos();
+      if (sequence !== loadSequence.current) return;
+      loadedVersion.current = snapshot.version;
+      setTodos(snapshot.todos);
       setError(null);
     } catch (err) {
       if (err instanceof Error && err.message.includes('Unauthorized')) {
@@ -38,7 +66,7 @@ const TodoList: React.FC = () => {
 
     try {
       const newTodo = await TodoAPI.createTodo(newTodoText.trim(), newTodoDueDate || undefined);
-      setTodos([newTodo, ...todos]);
+      setTodos(current => current.some(todo => todo.id === newTodo.id) ? current : [newTodo, ...current]);
       setNewTodoText('');
       setNewTodoDueDate('');
       setError(null);
@@ -51,7 +79,7 @@ const TodoList: React.FC = () => {
   const handleUpdateTodo = async (id: number, text: string, completed: boolean) => {
     try {
       const updatedTodo = await TodoAPI.updateTodo(id, text, completed);
-      setTodos(todos.map(todo => todo.id === id ? updatedTodo : todo));
+      setTodos(current => current.map(todo => todo.id === id ? updatedTodo : todo));
       setError(null);
     } catch (err) {
       setError('Failed to update todo');
@@ -62,7 +90,7 @@ const TodoList: React.FC = () => {
   const handleDeleteTodo = async (id: number) => {
     try {
       await TodoAPI.deleteTodo(id);
-      setTodos(todos.filter(todo => todo.id !== id));
+      setTodos(current => current.filter(todo => todo.id !== id));
       setError(null);
     } catch (err) {
       setError('Failed to delete todo');